@@ -4,9 +4,39 @@
 #include "stdafx.h"
 #include "AutoSave.h"
 #include "Application.h"
+#include "HeadlessService.h"
+
+#include <objbase.h>
 
 declare_logging();
 
+// "/S 1": no window, no icon, no OLE; just the countdown and the control
+// endpoint. Stop it with "AutoSave.exe /Q quit".
+static int runHeadless(PWSTR pCmdLine)
+{
+	// Only for starting the connected application through the shell.
+	const bool needsCom = Configuration::isConnectingCommandLine(pCmdLine) &&
+		SUCCEEDED(CoInitializeEx(NULL,
+			COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE));
+	int exitCode = 1;
+	Configuration cfg;
+	try {
+		cfg.loadFromRegistry(DEFAULT_REGISTRY_KEY);
+		cfg.loadFromCommandLine(pCmdLine);
+		HeadlessService service(cfg, Platform::getClock(),
+			Platform::getWindowEnumerator(), Platform::getInputSink());
+		service.setEndpointName(ControlService::getEndpointName());
+		exitCode = service.run();
+	}
+	catch (AutoSaveException& exc) {
+		log(exc.wcwhat());
+	}
+	if (needsCom)
+		CoUninitialize();
+	return exitCode;
+}
+
+
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR pCmdLine, int nCmdShow)
 {
 	begin_logging();
@@ -16,6 +46,13 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR pCmdLine, int nCmdShow
 	log(L"Command line:");
 	log(pCmdLine);
 
+	if (Configuration::isHeadlessCommandLine(pCmdLine))
+	{
+		int exitCode = runHeadless(pCmdLine);
+		end_logging();
+		return exitCode;
+	}
+
 	Application mainWindow(pCmdLine);
 	mainWindow.registerWindowClass();
 	if (!mainWindow.create())
@@ -27,10 +64,10 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR pCmdLine, int nCmdShow
 	// We do /not/ show the main window.
 	// 'tis a mere dummy.
 	// mainWindow.showWindow(nCmdShow);
-	mainWindow.mainLoop();
+	int exitCode = mainWindow.mainLoop();
 
 
 	end_logging();
 
-	return 0;
+	return exitCode;
 }
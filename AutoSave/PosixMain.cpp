@@ -0,0 +1,81 @@
+// PosixMain.cpp : Entry point of the autosave executable that CMake
+// builds on other systems. There is no desktop there, so it always runs
+// headless (see HeadlessService.h); the command line is the same as on
+// Windows, and "autosave /Q <command>" controls a running one.
+// SIGINT and SIGTERM stop it.
+
+// AutoSave/stdafx.h is the Windows one; HeadlessService.h brings the
+// core's.
+#include "HeadlessService.h"
+
+#include <clocale>
+#include <cstdio>
+#include <csignal>
+#include <thread>
+#include <pthread.h>
+
+
+namespace {
+	wstring widen(const char* arg)
+	{
+		const wstring wide = Platform::toWide(arg);
+		return (wide.empty() && *arg != '\0') ? wstring(arg, arg + strlen(arg)) : wide;
+	}
+
+	int runControlClient(const wstring& request)
+	{
+		try {
+			const string response = Platform::sendControlRequest(
+				ControlService::getEndpointName(), ControlService::toUtf8(request));
+			fputs(response.c_str(), stdout);
+			return response.compare(0, 3, "ok\n") == 0 ? 0 : 1;
+		}
+		catch (AutoSaveException&) {
+			fputs("error not running\n", stdout);
+			return 1;
+		}
+	}
+}
+
+
+
+int main(int argc, char* argv[])
+{
+	setlocale(LC_ALL, "");
+	vector<wstring> args;
+	for (int i = 1; i < argc; ++i)
+		args.push_back(widen(argv[i]));
+
+	Configuration cfg;
+	try {
+		cfg.loadFromCommandLine(CommandLineParser::joinArguments(args));
+	}
+	catch (AutoSaveException& exc) {
+		fprintf(stderr, "%s: invalid command line (%s)\n", argv[0], exc.what());
+		return 2;
+	}
+	if (!cfg.controlRequest.empty())
+		return runControlClient(cfg.controlRequest);
+
+	// Take the signals on a thread of their own, where stopping is safe.
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	HeadlessService service(cfg, Platform::getClock(),
+		Platform::getWindowEnumerator(), Platform::getInputSink());
+	service.setEndpointName(ControlService::getEndpointName());
+	std::thread signalThread([&service, &signals]() {
+		int signal = 0;
+		sigwait(&signals, &signal);
+		service.stop();
+	});
+
+	int exitCode = service.run();
+	// If it stopped for another reason, the thread is still waiting.
+	pthread_kill(signalThread.native_handle(), SIGTERM);
+	signalThread.join();
+	return exitCode;
+}
@@ -63,6 +63,7 @@
 #define IDS_DISABLED_CAPTION                    40004
 #define IDC_SETTINGS_AUTOSTARTBUTTON            40005
 #define IDC_SHORTCUTS_INTERVALEDIT              40005
+#define IDM_METRICS                             40005
 #define IDS_DISABLED_TEXT                       40005
 #define IDC_SETTINGS_ABOUT                      40006
 #define IDC_SHORTCUTS_INTERVALUPDOWN            40006
@@ -89,3 +90,6 @@
 #define IDS_TARGET_BADREGEX                     40022
 #define IDS_TARGET_NOWINDOWS                    40023
 #define IDS_ERROR_NODROPPEDSHORTCUTS            40024
+
+#define IDS_SAVEFAILED_CAPTION                  40025
+#define IDS_SAVEFAILED_TEXT                     40026
\ No newline at end of file
@@ -0,0 +1,145 @@
+// BackupStoreBenchmarks.cpp : How fast documents go into the BackupStore.
+// Cutting and hashing are per 8 MiB, so that 8 MiB divided by the time
+// is the throughput. The backups run on synthetic files of the given
+// number of MiB in a temporary directory: once as they are, which only
+// reads, cuts, and hashes, since every chunk is stored already, and once
+// with a small edit before each backup, which is what saving a large
+// document again costs: a new version that shares all but a chunk or two.
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "BackupStore.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
+
+
+namespace {
+	const size_t mebibyte = 1024 * 1024;
+
+	// Incompressible, like most large documents.
+	vector<BYTE> makeData(size_t size, ULONGLONG seed)
+	{
+		vector<BYTE> data(size);
+		ULONGLONG state = seed;
+		for (size_t i = 0; i < size; ++i)
+		{
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			data[i] = (BYTE) (state >> 56);
+		}
+		return data;
+	}
+
+	int removeEntry(const char* pPath, const struct stat*, int, FTW*)
+	{
+		return remove(pPath);
+	}
+
+	// A document of the given size and a store that has a version of it.
+	class BackupFixture
+	{
+	public:
+		BackupFixture(size_t megabytes)
+		{
+			strcpy(m_directory, "/tmp/autosave_bench_XXXXXX");
+			if (mkdtemp(m_directory) == NULL)
+				abort();
+			const string directory = m_directory;
+			m_documentName = directory + "/document.psd";
+			m_document.assign(m_documentName.begin(), m_documentName.end());
+
+			FILE* pFile = fopen(m_documentName.c_str(), "wb");
+			const vector<BYTE> data = makeData(mebibyte, 1);
+			for (size_t i = 0; i < megabytes; ++i)
+			{
+				// Each MiB different from the others.
+				const BYTE salt = (BYTE) i;
+				fwrite(&salt, 1, 1, pFile);
+				fwrite(&data[1], 1, data.size() - 1, pFile);
+			}
+			fclose(pFile);
+
+			const string root = directory + "/store";
+			m_pStore.reset(new BackupStore(wstring(root.begin(), root.end())));
+			m_pStore->backUp(m_document, 0);
+		}
+
+		~BackupFixture()
+		{
+			m_pStore.reset();
+			nftw(m_directory, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+		}
+
+		inline BackupStore& getStore() { return *m_pStore; }
+		inline const wstring& getDocument() const { return m_document; }
+
+		// Overwrites a few bytes in place.
+		void edit(ULONGLONG offset, ULONGLONG seed)
+		{
+			const vector<BYTE> bytes = makeData(64, seed);
+			FILE* pFile = fopen(m_documentName.c_str(), "r+b");
+			fseek(pFile, (long) offset, SEEK_SET);
+			fwrite(bytes.data(), 1, bytes.size(), pFile);
+			fclose(pFile);
+		}
+
+	private:
+		char m_directory[32];
+		string m_documentName;
+		wstring m_document;
+		std::unique_ptr<BackupStore> m_pStore;
+	};
+}
+
+
+
+static void Backup_FindCuts(BenchmarkState& state)
+{
+	const vector<BYTE> data = makeData(8 * mebibyte, 2);
+	const ContentChunker chunker;
+	while (state.keepRunning())
+	{
+		size_t chunks = 0;
+		for (size_t offset = 0; offset < data.size(); ++chunks)
+			offset += chunker.findCut(&data[offset], data.size() - offset);
+		Benchmark::doNotOptimize(chunks);
+	}
+}
+BENCHMARK(Backup_FindCuts);
+
+
+
+static void Backup_Sha256(BenchmarkState& state)
+{
+	const vector<BYTE> data = makeData(8 * mebibyte, 3);
+	while (state.keepRunning())
+		Benchmark::doNotOptimize(Sha256::hash(data.data(), data.size()));
+}
+BENCHMARK(Backup_Sha256);
+
+
+
+static void BackupStore_BackUpUnchanged(BenchmarkState& state)
+{
+	BackupFixture fixture((size_t) state.arg());
+	while (state.keepRunning())
+		Benchmark::doNotOptimize(fixture.getStore().backUp(fixture.getDocument(), 1));
+}
+BENCHMARK(BackupStore_BackUpUnchanged)->arg(16)->arg(128);
+
+
+
+static void BackupStore_BackUpEdited(BenchmarkState& state)
+{
+	const ULONGLONG size = (ULONGLONG) state.arg() * mebibyte;
+	BackupFixture fixture((size_t) state.arg());
+	ULONGLONG time = 1;
+	while (state.keepRunning())
+	{
+		// Moves through the document, so that each edit makes new chunks.
+		fixture.edit((time * 7919 * 4096) % (size - 64), time);
+		Benchmark::doNotOptimize(fixture.getStore().backUp(fixture.getDocument(), time++));
+	}
+}
+BENCHMARK(BackupStore_BackUpEdited)->arg(16)->arg(128);
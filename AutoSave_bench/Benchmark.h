@@ -0,0 +1,114 @@
+// Benchmark.h : A small harness for micro-benchmarks of the portable core.
+// Benchmarks register themselves with BENCHMARK when the program starts;
+// BenchmarkMain.cpp runs them and reports time, heap allocations, and
+// allocated bytes per operation, either as a table or as JSON.
+// A benchmark function does its setup, then loops like this:
+//
+//     while (state.keepRunning())
+//         Benchmark::doNotOptimize(matcher.match(title));
+//
+// Only the loop is measured. Parameterized benchmarks get their
+// parameter from state.arg(); register one run per value with ->arg(n).
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <chrono>
+
+class BenchmarkState;
+
+class Benchmark
+{
+public:
+	typedef void (*Function)(BenchmarkState& state);
+
+	struct AllocationCounts
+	{
+		uint64_t allocations;
+		uint64_t bytes;
+	};
+
+	// Registers a benchmark. The returned object lives until the end.
+	static Benchmark* add(const char* name, Function function);
+	static std::vector<Benchmark*>& getAll();
+
+	// Adds a run with the given parameter.
+	Benchmark* arg(int64_t value);
+
+	inline const std::string& getName() const { return m_name; }
+	inline Function getFunction() const { return m_function; }
+	inline const std::vector<int64_t>& getArgs() const { return m_args; }
+
+	// Totals since the program started. Counted by the global
+	// operator new in BenchmarkMain.cpp.
+	static AllocationCounts getAllocationCounts();
+
+	// Keeps the compiler from optimizing away the computation of value.
+	template<typename T>
+	static inline void doNotOptimize(const T& value) {
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+private:
+	Benchmark(const char* name, Function function)
+		: m_name(name), m_function(function) {}
+
+	std::string m_name;
+	Function m_function;
+	std::vector<int64_t> m_args;
+};
+
+
+
+class BenchmarkState
+{
+public:
+	BenchmarkState(uint64_t iterations, int64_t arg)
+		: m_iterations(iterations), m_arg(arg), m_done(0),
+		m_elapsedNanoseconds(0), m_allocations(0), m_bytes(0) {}
+
+	// Returns true as long as another iteration should run.
+	// Measurement starts with the first call and ends with the last.
+	inline bool keepRunning() {
+		if (m_done < m_iterations)
+		{
+			if (m_done++ == 0)
+				start();
+			return true;
+		}
+		stop();
+		return false;
+	}
+
+	inline int64_t arg() const { return m_arg; }
+	inline uint64_t getIterations() const { return m_done; }
+	inline uint64_t getElapsedNanoseconds() const { return m_elapsedNanoseconds; }
+	inline uint64_t getAllocations() const { return m_allocations; }
+	inline uint64_t getBytes() const { return m_bytes; }
+
+private:
+	void start();
+	void stop();
+
+	uint64_t m_iterations;
+	int64_t m_arg;
+	uint64_t m_done;
+
+	std::chrono::steady_clock::time_point m_startTime;
+	Benchmark::AllocationCounts m_startCounts;
+
+	uint64_t m_elapsedNanoseconds;
+	uint64_t m_allocations;
+	uint64_t m_bytes;
+};
+
+
+
+#define BENCHMARK_CONCAT2(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT2(a, b)
+
+#define BENCHMARK(function) \
+	static Benchmark* BENCHMARK_CONCAT(benchmark_, __LINE__) = \
+		Benchmark::add(#function, function)
@@ -0,0 +1,122 @@
+#include "stdafx.h"
+#include "BenchmarkCorpus.h"
+
+
+const vector<wstring>& BenchmarkCorpus::getWindowTitles()
+{
+	static const vector<wstring> titles = {
+		L"Program Manager",
+		L"Start",
+		L"",
+		L"Untitled - Notepad",
+		L"*notes.txt - Notepad",
+		L"Quarterly Report 2014.docx - Microsoft Word",
+		L"Budget.xlsx  -  Excel",
+		L"Inbox - someone@example.com - Outlook",
+		L"Re: Meeting on Thursday - Message (HTML)",
+		L"AutoSave - Microsoft Visual Studio (Administrator)",
+		L"Configuration.cpp - AutoSave - Microsoft Visual Studio",
+		L"C:\\Users\\someone\\Documents\\Projects\\AutoSave - File Explorer",
+		L"Downloads",
+		L"GitHub - troiganto/autosave - Mozilla Firefox",
+		L"Stack Overflow - Where Developers Learn, Share, & Build Careers - Google Chrome",
+		L"YouTube - Google Chrome",
+		L"poster_final_v3.ai @ 66.67% (CMYK/Preview) - Adobe Illustrator",
+		L"Adobe Photoshop CC 2014 - holiday_0042.psd @ 33.3% (Layer 1, RGB/8)",
+		L"GIMP - [Untitled]-1.0 (RGB color, 1 layer) 800x600",
+		L"Inkscape - drawing.svg",
+		L"thesis.tex - TeXstudio",
+		L"Calculator",
+		L"Task Manager",
+		L"Windows PowerShell",
+		L"C:\\WINDOWS\\system32\\cmd.exe",
+		L"Spotify",
+		L"Skype\u2122 - someone.example",
+		L"VLC media player",
+		L"Blender [C:\\Users\\someone\\Desktop\\scene.blend]",
+		L"AutoCAD 2014 - [Drawing1.dwg]",
+		L"LibreOffice Calc - Haushalt.ods",
+		L"\u00dcbersicht der \u00c4nderungen - Writer",
+		L"\u65b0\u3057\u3044\u30c6\u30ad\u30b9\u30c8 \u30c9\u30ad\u30e5\u30e1\u30f3\u30c8 - \u30e1\u30e2\u5e33",
+		L"Settings",
+		L"Notepad++ - C:\\src\\main.c",
+		L"Paint.NET v4.0 - Untitled",
+		L"MSCTFIME UI",
+		L"Default IME",
+		L"AutoSave",
+		L"Inbox (3) - Mail",
+	};
+	return titles;
+}
+
+
+
+vector<wstring> BenchmarkCorpus::makeShortcutPaths(size_t count, size_t firstIndex)
+{
+	vector<wstring> paths;
+	paths.reserve(count);
+	for (size_t i = firstIndex; i < firstIndex + count; ++i)
+	{
+		paths.push_back(L"C:\\Users\\someone\\Desktop\\AutoSave Shortcut " +
+			std::to_wstring(i) + L".lnk");
+	}
+	return paths;
+}
+
+
+
+FakeWindowEnumerator::FakeWindowEnumerator(size_t windowCount)
+{
+	const vector<wstring>& titles = BenchmarkCorpus::getWindowTitles();
+	m_titles.reserve(windowCount);
+	for (size_t i = 0; i < windowCount; ++i)
+		m_titles.push_back(titles[i % titles.size()]);
+}
+
+
+
+void FakeWindowEnumerator::setTitle(size_t index, const wstring& title)
+{
+	m_titles.at(index) = title;
+}
+
+
+
+HWND FakeWindowEnumerator::getHwnd(size_t index)
+{
+	return (HWND) (index + 1);
+}
+
+
+
+size_t FakeWindowEnumerator::getIndex(HWND hwnd)
+{
+	return (size_t) hwnd - 1;
+}
+
+
+
+void FakeWindowEnumerator::enumWindows(
+	const std::function<bool(HWND)>& callback) const
+{
+	for (size_t i = 0; i < m_titles.size(); ++i)
+	{
+		if (!callback(getHwnd(i)))
+			break;
+	}
+}
+
+
+
+wstring FakeWindowEnumerator::getWindowText(HWND hwnd) const
+{
+	size_t index = getIndex(hwnd);
+	return (index < m_titles.size()) ? m_titles[index] : L"";
+}
+
+
+
+DWORD FakeWindowEnumerator::getWindowProcessId(HWND hwnd) const
+{
+	return 1000 + (DWORD) getIndex(hwnd);
+}
@@ -0,0 +1,52 @@
+// BenchmarkCorpus.h : Inputs for the benchmarks that look like what
+// AutoSave sees on a real desktop, and a WindowEnumerator that serves
+// an arbitrary number of windows from them without a desktop.
+// Nothing here throws (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+
+using std::wstring;
+using std::vector;
+
+namespace BenchmarkCorpus
+{
+	// Captions of top-level windows, as seen on a busy desktop.
+	const vector<wstring>& getWindowTitles();
+
+	// Paths of shortcut files, as ShortcutsDisconnector collects them.
+	vector<wstring> makeShortcutPaths(size_t count, size_t firstIndex = 0);
+}
+
+
+
+// Window n (counting from 1) has the caption getWindowTitles()[n-1],
+// wrapping around, unless setTitle has changed it.
+class FakeWindowEnumerator : public WindowEnumerator
+{
+public:
+	FakeWindowEnumerator(size_t windowCount);
+	virtual ~FakeWindowEnumerator() {}
+
+	void setTitle(size_t index, const wstring& title);
+	static HWND getHwnd(size_t index);
+
+	virtual void enumWindows(const std::function<bool(HWND)>& callback) const;
+	virtual wstring getWindowText(HWND hwnd) const;
+	virtual vector<HWND> takeUnresponsiveWindows() const { return vector<HWND>(); }
+	virtual DWORD getWindowProcessId(HWND hwnd) const;
+	virtual wstring getWindowExecutable(HWND hwnd) const { return L""; }
+	virtual bool isOwnedWindow(HWND hwnd) const { return false; }
+	virtual bool isWindowVisible(HWND hwnd) const { return true; }
+	virtual bool isWindowMinimized(HWND hwnd) const { return false; }
+	virtual HWND getForegroundWindow() const { return getHwnd(0); }
+	virtual bool isWindowResponding(HWND hwnd, DWORD timeout) const { return true; }
+	virtual ULONGLONG getProcessCpuTime(HWND hwnd) const { return 0; }
+
+private:
+	static size_t getIndex(HWND hwnd);
+
+	vector<wstring> m_titles;
+};
@@ -0,0 +1,289 @@
+// BenchmarkMain.cpp : Runs the benchmarks registered through Benchmark.h.
+// Usage: autosave_bench [--min-time=SECONDS] [--json=FILE] [filter...]
+// Only runs benchmarks whose name contains one of the filters, if any
+// are given. Each benchmark is repeated with growing iteration counts
+// until one run takes at least the minimum time (default: 0.5 s).
+// With --json, the results are also written to FILE ("-" for stdout).
+
+#include "Benchmark.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+#include <vector>
+
+
+namespace {
+	std::atomic<uint64_t> allocationCount(0);
+	std::atomic<uint64_t> allocatedBytes(0);
+
+	struct Result
+	{
+		std::string name;
+		uint64_t iterations;
+		double nsPerOp;
+		double allocsPerOp;
+		double bytesPerOp;
+	};
+
+	struct Options
+	{
+		double minTime;
+		std::string jsonPath;
+		std::vector<std::string> filters;
+	};
+
+	bool isSelected(const std::string& name, const Options& options)
+	{
+		if (options.filters.empty())
+			return true;
+		for (const std::string& filter : options.filters)
+		{
+			if (name.find(filter) != std::string::npos)
+				return true;
+		}
+		return false;
+	}
+
+	bool startsWith(const char* s, const char* prefix)
+	{
+		return strncmp(s, prefix, strlen(prefix)) == 0;
+	}
+
+	bool parseOptions(int argc, char* argv[], Options* pOptions)
+	{
+		pOptions->minTime = 0.5;
+		for (int i = 1; i < argc; ++i)
+		{
+			if (startsWith(argv[i], "--min-time="))
+				pOptions->minTime = atof(argv[i] + strlen("--min-time="));
+			else if (startsWith(argv[i], "--json="))
+				pOptions->jsonPath = argv[i] + strlen("--json=");
+			else if (startsWith(argv[i], "--"))
+				return false;
+			else
+				pOptions->filters.push_back(argv[i]);
+		}
+		return pOptions->minTime >= 0.0;
+	}
+
+	// Like Google Benchmark: grow the iteration count by at most 10x
+	// per round, aiming a bit beyond the minimum time.
+	Result run(const Benchmark& benchmark, int64_t arg, bool hasArg,
+		double minTime)
+	{
+		const double minNanoseconds = minTime * 1e9;
+		const uint64_t maxIterations = 1000000000;
+		uint64_t iterations = 1;
+		while (true)
+		{
+			BenchmarkState state(iterations, arg);
+			benchmark.getFunction()(state);
+			const uint64_t elapsed = state.getElapsedNanoseconds();
+			const uint64_t done = state.getIterations();
+			if (elapsed >= minNanoseconds || iterations >= maxIterations || done == 0)
+			{
+				Result result;
+				result.name = benchmark.getName();
+				if (hasArg)
+					result.name += "/" + std::to_string(arg);
+				result.iterations = done;
+				const double n = (done == 0) ? 1.0 : (double) done;
+				result.nsPerOp = elapsed / n;
+				result.allocsPerOp = state.getAllocations() / n;
+				result.bytesPerOp = state.getBytes() / n;
+				return result;
+			}
+
+			double multiplier = (elapsed == 0) ? 10.0 :
+				1.4 * minNanoseconds / (double) elapsed;
+			if (multiplier > 10.0)
+				multiplier = 10.0;
+			uint64_t next = (uint64_t) (iterations * multiplier);
+			iterations = (next > iterations) ? next : iterations + 1;
+			if (iterations > maxIterations)
+				iterations = maxIterations;
+		}
+	}
+
+	std::string escapeJson(const std::string& s)
+	{
+		std::string result;
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\')
+				result.push_back('\\');
+			result.push_back(c);
+		}
+		return result;
+	}
+
+	bool writeJson(const std::string& path, const std::vector<Result>& results,
+		const Options& options)
+	{
+		FILE* file = (path == "-") ? stdout : fopen(path.c_str(), "w");
+		if (file == NULL)
+			return false;
+
+		char date[32];
+		time_t now = time(NULL);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+		fprintf(file, "{\n  \"context\": {\n");
+		fprintf(file, "    \"date\": \"%s\",\n", date);
+		fprintf(file, "    \"min_time\": %g\n  },\n", options.minTime);
+		fprintf(file, "  \"benchmarks\": [");
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const Result& r = results[i];
+			fprintf(file, "%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+				"\"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, "
+				"\"bytes_per_op\": %.1f}",
+				(i == 0) ? "" : ",", escapeJson(r.name).c_str(),
+				(unsigned long long) r.iterations,
+				r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+		}
+		fprintf(file, "\n  ]\n}\n");
+		return (file == stdout) ? fflush(file) == 0 : fclose(file) == 0;
+	}
+}
+
+
+
+// Counting allocations. The sized and aligned variants and the array
+// forms of new end up here, too.
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+
+
+Benchmark::AllocationCounts Benchmark::getAllocationCounts()
+{
+	AllocationCounts counts;
+	counts.allocations = allocationCount.load(std::memory_order_relaxed);
+	counts.bytes = allocatedBytes.load(std::memory_order_relaxed);
+	return counts;
+}
+
+
+
+Benchmark* Benchmark::add(const char* name, Function function)
+{
+	Benchmark* pBenchmark = new Benchmark(name, function);
+	getAll().push_back(pBenchmark);
+	return pBenchmark;
+}
+
+
+
+std::vector<Benchmark*>& Benchmark::getAll()
+{
+	static std::vector<Benchmark*> benchmarks;
+	return benchmarks;
+}
+
+
+
+Benchmark* Benchmark::arg(int64_t value)
+{
+	m_args.push_back(value);
+	return this;
+}
+
+
+
+void BenchmarkState::start()
+{
+	m_startCounts = Benchmark::getAllocationCounts();
+	m_startTime = std::chrono::steady_clock::now();
+}
+
+
+
+void BenchmarkState::stop()
+{
+	auto stopTime = std::chrono::steady_clock::now();
+	Benchmark::AllocationCounts stopCounts = Benchmark::getAllocationCounts();
+	if (m_done == 0)
+		return;
+	m_elapsedNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		stopTime - m_startTime).count();
+	m_allocations = stopCounts.allocations - m_startCounts.allocations;
+	m_bytes = stopCounts.bytes - m_startCounts.bytes;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parseOptions(argc, argv, &options))
+	{
+		fprintf(stderr, "Usage: %s [--min-time=SECONDS] [--json=FILE] "
+			"[filter...]\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<Result> results;
+	const bool isConsoleQuiet = (options.jsonPath == "-");
+	if (!isConsoleQuiet)
+	{
+		printf("%-48s %12s %14s %12s %12s\n", "Benchmark", "Iterations",
+			"ns/op", "allocs/op", "bytes/op");
+	}
+
+	for (Benchmark* pBenchmark : Benchmark::getAll())
+	{
+		std::vector<int64_t> args = pBenchmark->getArgs();
+		const bool hasArgs = !args.empty();
+		if (!hasArgs)
+			args.push_back(0);
+		for (int64_t arg : args)
+		{
+			std::string name = pBenchmark->getName();
+			if (hasArgs)
+				name += "/" + std::to_string(arg);
+			if (!isSelected(name, options))
+				continue;
+
+			Result result = run(*pBenchmark, arg, hasArgs, options.minTime);
+			results.push_back(result);
+			if (!isConsoleQuiet)
+			{
+				printf("%-48s %12llu %14.1f %12.2f %12.1f\n", result.name.c_str(),
+					(unsigned long long) result.iterations,
+					result.nsPerOp, result.allocsPerOp, result.bytesPerOp);
+				fflush(stdout);
+			}
+		}
+	}
+
+	if (!options.jsonPath.empty() && !writeJson(options.jsonPath, results, options))
+	{
+		fprintf(stderr, "Couldn't write %s\n", options.jsonPath.c_str());
+		return 1;
+	}
+	return 0;
+}
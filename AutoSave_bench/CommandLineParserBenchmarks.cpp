@@ -0,0 +1,81 @@
+// CommandLineParserBenchmarks.cpp : Parsing AutoSave's own command
+// lines and building the ones passed to connected applications.
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "CommandLineParser.h"
+#include "Configuration.h"
+
+
+namespace {
+	const wstring settingsLine =
+		L"/I 300 /H 0x0253 /V 2 /R \"^.* - (Notepad|Word)$\"";
+
+	const wstring connectionLine =
+		L"/I 120 \"C:\\Program Files (x86)\\Adobe\\Illustrator\\Illustrator.exe\" "
+		L"\"C:\\Users\\someone\\My Documents\\poster \\\"final\\\".ai\" /safe";
+
+	const vector<wstring> connectionArgs = {
+		L"C:\\Program Files (x86)\\Adobe\\Illustrator\\Illustrator.exe",
+		L"C:\\Users\\someone\\My Documents\\poster \"final\".ai",
+		L"/safe",
+		L"--trailing-backslash\\",
+		L"",
+		L"plain",
+	};
+}
+
+
+
+static void CommandLineParser_ParseSettings(BenchmarkState& state)
+{
+	CommandLineParser cli;
+	cli.setAllowedKeys(Configuration::getAllowedKeys());
+	while (state.keepRunning())
+	{
+		cli.parse(settingsLine);
+		Benchmark::doNotOptimize(cli.gotArgs());
+	}
+}
+BENCHMARK(CommandLineParser_ParseSettings);
+
+
+
+static void CommandLineParser_ParseConnection(BenchmarkState& state)
+{
+	CommandLineParser cli;
+	cli.setAllowedKeys(Configuration::getAllowedKeys());
+	while (state.keepRunning())
+	{
+		cli.parse(connectionLine);
+		Benchmark::doNotOptimize(cli.getLArgs().size());
+	}
+}
+BENCHMARK(CommandLineParser_ParseConnection);
+
+
+
+static void CommandLineParser_JoinArguments(BenchmarkState& state)
+{
+	while (state.keepRunning())
+	{
+		wstring line = CommandLineParser::joinArguments(connectionArgs);
+		Benchmark::doNotOptimize(line);
+	}
+}
+BENCHMARK(CommandLineParser_JoinArguments);
+
+
+
+static void CommandLineParser_EscapeArgument(BenchmarkState& state)
+{
+	size_t i = 0;
+	while (state.keepRunning())
+	{
+		wstring arg = CommandLineParser::escapeArgument(connectionArgs[i]);
+		Benchmark::doNotOptimize(arg);
+		if (++i == connectionArgs.size())
+			i = 0;
+	}
+}
+BENCHMARK(CommandLineParser_EscapeArgument);
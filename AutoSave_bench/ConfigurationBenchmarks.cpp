@@ -0,0 +1,88 @@
+// ConfigurationBenchmarks.cpp : Configuration::matchingWindowExists,
+// which runs whenever a countdown reaches zero, over desktops with
+// different numbers of windows. The argument is the number of windows.
+// Only the last window matches, so that all of them are looked at.
+// Also, registering a Connected Shortcut at start-up, the old way and
+// with ShortcutJournal. The argument is the number of shortcuts that are
+// already registered.
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "BenchmarkCorpus.h"
+#include "Configuration.h"
+#include "ShortcutJournal.h"
+#include "MemoryConfigStore.h"
+
+
+namespace {
+	void findLastWindow(BenchmarkState& state, const wstring& filter, bool isRegex)
+	{
+		const size_t windowCount = (size_t) state.arg();
+		FakeWindowEnumerator windows(windowCount);
+		windows.setTitle(windowCount - 1, L"Mein Lebenslauf.odt - LibreOffice Writer");
+
+		Configuration cfg;
+		cfg.filter.setFilter(filter, isRegex);
+		while (state.keepRunning())
+			Benchmark::doNotOptimize(cfg.matchingWindowExists(windows));
+	}
+
+	vector<wstring> makeShortcutList(size_t count)
+	{
+		vector<wstring> files;
+		for (size_t i = 0; i < count; ++i)
+			files.push_back(L"C:\\Users\\Someone\\Desktop\\Shortcut " +
+				std::to_wstring(i) + L".lnk");
+		return files;
+	}
+
+	const wchar_t listName[] = L"connectedShortcutsList";
+	const wchar_t startingShortcut[] = L"C:\\Users\\Someone\\Desktop\\New.lnk";
+}
+
+
+
+static void Configuration_MatchingWindowPhrase(BenchmarkState& state)
+{
+	findLastWindow(state, L"LibreOffice Writer", false);
+}
+BENCHMARK(Configuration_MatchingWindowPhrase)->arg(10)->arg(100)->arg(1000);
+
+
+
+static void Configuration_MatchingWindowRegex(BenchmarkState& state)
+{
+	findLastWindow(state, L"\\.(odt|docx?) - (LibreOffice|Microsoft) Writer$", true);
+}
+BENCHMARK(Configuration_MatchingWindowRegex)->arg(10)->arg(100)->arg(1000);
+
+
+
+// What RegistryAccess::AppendToMultiString does. Each shortcut takes the
+// place of the one before, so that the list doesn't grow.
+static void Configuration_RegisterShortcutInList(BenchmarkState& state)
+{
+	const size_t count = (size_t) state.arg();
+	MemoryConfigStore store;
+	store.writeMultiString(listName, makeShortcutList(count));
+	while (state.keepRunning())
+	{
+		vector<wstring> files = store.readMultiString(listName);
+		files.resize(count);
+		files.push_back(startingShortcut);
+		store.writeMultiString(listName, files);
+	}
+}
+BENCHMARK(Configuration_RegisterShortcutInList)->arg(10)->arg(100)->arg(1000);
+
+
+
+static void Configuration_RegisterShortcutInJournal(BenchmarkState& state)
+{
+	MemoryConfigStore store;
+	store.writeMultiString(listName, makeShortcutList((size_t) state.arg()));
+	ShortcutJournal journal(store, listName);
+	while (state.keepRunning())
+		journal.add(startingShortcut);
+}
+BENCHMARK(Configuration_RegisterShortcutInJournal)->arg(10)->arg(100)->arg(1000);
@@ -0,0 +1,52 @@
+// EventLogBenchmarks.cpp : What recording an event costs the thread that
+// records it, with the flushing thread draining the buffer meanwhile.
+// Should be about as cheap as one atomic operation, plus reading the clock.
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "EventLog.h"
+
+
+namespace {
+	class NullSink : public EventSink
+	{
+	public:
+		virtual void write(const EventRecord* pRecords, size_t count) {
+			Benchmark::doNotOptimize(pRecords[count - 1].time);
+		}
+	};
+}
+
+
+
+static void EventLog_Record(BenchmarkState& state)
+{
+	EventLog eventLog(Platform::getClock(), 65536);
+	NullSink sink;
+	eventLog.startFlushing(sink, 10);
+	UINT i = 0;
+	while (state.keepRunning())
+		eventLog.record(EventLog::EV_TICK, ++i);
+	eventLog.stopFlushing();
+	Benchmark::doNotOptimize(eventLog.getDroppedCount());
+}
+BENCHMARK(EventLog_Record);
+
+
+
+// Without the clock: the ring buffer alone.
+static void EventLog_Push(BenchmarkState& state)
+{
+	EventLog eventLog(Platform::getClock(), 65536);
+	NullSink sink;
+	eventLog.startFlushing(sink, 10);
+	EventRecord event = { 0, EventLog::EV_TICK, 0, 0, 0 };
+	while (state.keepRunning())
+	{
+		++event.arg0;
+		eventLog.push(event);
+	}
+	eventLog.stopFlushing();
+	Benchmark::doNotOptimize(eventLog.getDroppedCount());
+}
+BENCHMARK(EventLog_Push);
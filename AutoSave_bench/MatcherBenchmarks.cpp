@@ -0,0 +1,68 @@
+// MatcherBenchmarks.cpp : Matching single window captions. Each
+// operation matches one caption; the benchmarks cycle through all of
+// BenchmarkCorpus::getWindowTitles().
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "BenchmarkCorpus.h"
+#include "Matcher.h"
+
+
+namespace {
+	void matchAll(BenchmarkState& state, const Matcher& matcher)
+	{
+		const vector<wstring>& titles = BenchmarkCorpus::getWindowTitles();
+		size_t i = 0;
+		while (state.keepRunning())
+		{
+			Benchmark::doNotOptimize(matcher.match(titles[i]));
+			if (++i == titles.size())
+				i = 0;
+		}
+	}
+}
+
+
+
+static void Matcher_Phrase(BenchmarkState& state)
+{
+	matchAll(state, Matcher(L"illustrator", false));
+}
+BENCHMARK(Matcher_Phrase);
+
+
+
+static void Matcher_PhraseMiss(BenchmarkState& state)
+{
+	matchAll(state, Matcher(L"this is in no caption", false));
+}
+BENCHMARK(Matcher_PhraseMiss);
+
+
+
+// Handled by BoundedRegex.
+static void Matcher_Regex(BenchmarkState& state)
+{
+	matchAll(state, Matcher(L"\\.(ai|psd|svg) @ \\d+(\\.\\d+)?%", true));
+}
+BENCHMARK(Matcher_Regex);
+
+
+
+static void Matcher_RegexAnchored(BenchmarkState& state)
+{
+	matchAll(state, Matcher(L"^.* - Notepad$", true));
+}
+BENCHMARK(Matcher_RegexAnchored);
+
+
+
+static void Matcher_Construct(BenchmarkState& state)
+{
+	while (state.keepRunning())
+	{
+		Matcher matcher(L"\\.(ai|psd|svg) @ \\d+(\\.\\d+)?%", true);
+		Benchmark::doNotOptimize(matcher.isValid());
+	}
+}
+BENCHMARK(Matcher_Construct);
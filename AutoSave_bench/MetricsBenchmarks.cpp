@@ -0,0 +1,44 @@
+// MetricsBenchmarks.cpp : What the Scheduler pays for each event it
+// counts or times. Both should stay well below a microsecond.
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "Metrics.h"
+
+
+static void Metrics_Count(BenchmarkState& state)
+{
+	Metrics metrics;
+	while (state.keepRunning())
+		metrics.count(Metrics::MC_TICKS);
+	Benchmark::doNotOptimize(metrics.getCounter(Metrics::MC_TICKS));
+}
+BENCHMARK(Metrics_Count);
+
+
+
+// Values spread over six orders of magnitude, like latencies are.
+static void Metrics_Record(BenchmarkState& state)
+{
+	Metrics metrics;
+	ULONGLONG value = 1;
+	while (state.keepRunning())
+	{
+		value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+		metrics.record(Metrics::MH_SAVE_LATENCY, (value >> 40) % 1000000);
+	}
+	Benchmark::doNotOptimize(metrics.getHistogram(Metrics::MH_SAVE_LATENCY).getCount());
+}
+BENCHMARK(Metrics_Record);
+
+
+
+static void Metrics_Snapshot(BenchmarkState& state)
+{
+	Metrics metrics;
+	for (ULONGLONG i = 0; i < 10000; ++i)
+		metrics.record(Metrics::MH_ZERO_WAIT, i * i);
+	while (state.keepRunning())
+		Benchmark::doNotOptimize(metrics.takeSnapshot().serialize().size());
+}
+BENCHMARK(Metrics_Snapshot);
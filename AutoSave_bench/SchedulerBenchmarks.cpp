@@ -0,0 +1,40 @@
+// SchedulerBenchmarks.cpp : One operation is a simulated workday of
+// eight hours, with focus moving between the windows of
+// BenchmarkCorpus::getWindowTitles() every few minutes.
+// The argument is the save interval in seconds.
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "BenchmarkCorpus.h"
+#include "DesktopSimulator.h"
+
+
+static void Scheduler_Workday(BenchmarkState& state)
+{
+	const ULONGLONG workday = 8 * 60 * 60 * 1000;
+	Configuration cfg;
+	cfg.settings.setInterval((UINT) state.arg());
+	cfg.filter.setFilter(L"Notepad", false);
+
+	while (state.keepRunning())
+	{
+		DesktopSimulator sim(cfg);
+		SimulatedDesktop& desktop = sim.getDesktop();
+		vector<HWND> windows;
+		for (const wstring& title : BenchmarkCorpus::getWindowTitles())
+			windows.push_back(desktop.openWindow(title));
+
+		unsigned int seed = 1;
+		for (ULONGLONG t = 0; t < workday; )
+		{
+			seed = seed * 1103515245 + 12345;
+			t += 1000 + (seed >> 8) % (5 * 60 * 1000);
+			HWND next = windows[(seed >> 4) % windows.size()];
+			sim.at(t, [&desktop, next]() { desktop.setForeground(next); });
+		}
+		sim.start();
+		sim.runFor(workday);
+		Benchmark::doNotOptimize(sim.getSaves().size());
+	}
+}
+BENCHMARK(Scheduler_Workday)->arg(60)->arg(300);
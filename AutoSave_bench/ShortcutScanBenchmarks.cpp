@@ -0,0 +1,91 @@
+// ShortcutScanBenchmarks.cpp : Looking for Connected Shortcuts among
+// files of which many can't be read, the way ShortcutsDisconnector scans
+// a folder, once with exceptions for each failure and once with the
+// tryRead/tryParse functions. The argument is the number of files; 30%
+// of them are broken. Without a shell, each file is a value in a
+// MemoryConfigStore holding the shortcut's arguments: a missing value
+// is a file that can't be opened, an int one that isn't a shortcut, and
+// "/I" an argument list that doesn't parse.
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "BenchmarkCorpus.h"
+#include "CommandLineParser.h"
+#include "MemoryConfigStore.h"
+
+
+namespace {
+	const wstring connectedArguments =
+		L"/I 120 \"C:\\Program Files\\Paint Tool SAI\\sai.exe\" picture.sai";
+
+	vector<wstring> makeFiles(size_t count, MemoryConfigStore* pStore)
+	{
+		vector<wstring> paths = BenchmarkCorpus::makeShortcutPaths(count);
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			switch (i % 10)
+			{
+			case 0:
+				break;
+			case 1:
+				pStore->writeInt(paths[i], 0);
+				break;
+			case 2:
+				pStore->writeString(paths[i], L"/I");
+				break;
+			default:
+				pStore->writeString(paths[i], connectedArguments);
+				break;
+			}
+		}
+		return paths;
+	}
+}
+
+
+
+static void ShortcutScan_Exceptions(BenchmarkState& state)
+{
+	MemoryConfigStore files;
+	const vector<wstring> paths = makeFiles((size_t) state.arg(), &files);
+	CommandLineParser cli;
+	cli.allowAllKeys();
+	while (state.keepRunning())
+	{
+		size_t connectedCount = 0;
+		for (const wstring& path : paths)
+		{
+			try {
+				cli.parse(files.readString(path));
+				if (cli.gotLArgs())
+					++connectedCount;
+			}
+			catch (std::exception&) {}
+		}
+		Benchmark::doNotOptimize(connectedCount);
+	}
+}
+BENCHMARK(ShortcutScan_Exceptions)->arg(10000);
+
+
+
+static void ShortcutScan_Expected(BenchmarkState& state)
+{
+	MemoryConfigStore files;
+	const vector<wstring> paths = makeFiles((size_t) state.arg(), &files);
+	CommandLineParser cli;
+	cli.allowAllKeys();
+	while (state.keepRunning())
+	{
+		size_t connectedCount = 0;
+		for (const wstring& path : paths)
+		{
+			Expected<wstring> arguments = files.tryReadString(path);
+			if (arguments && !cli.tryParse(arguments.value()).isError() &&
+				cli.gotLArgs())
+				++connectedCount;
+		}
+		Benchmark::doNotOptimize(connectedCount);
+	}
+}
+BENCHMARK(ShortcutScan_Expected)->arg(10000);
@@ -0,0 +1,125 @@
+// StringListBenchmarks.cpp : The string list conversions used for
+// REG_MULTI_SZ values and the merging of shortcut lists in
+// ShortcutsDisconnector. The argument is the number of strings.
+// Also the compaction of the Connected Shortcuts list, on one thread and
+// on as many as ShortcutListCompactor uses by default; there the argument is the
+// length of the list. And the list behind the uninstaller's listbox,
+// which the user may fill with thousands of shortcuts and then delete
+// every other one.
+
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "BenchmarkCorpus.h"
+#include "StringListUtils.h"
+#include "ShortcutListCompactor.h"
+#include "SortedPathList.h"
+#include <chrono>
+#include <thread>
+
+
+static void StringList_VectorToMultiString(BenchmarkState& state)
+{
+	vector<wstring> paths = BenchmarkCorpus::makeShortcutPaths((size_t) state.arg());
+	while (state.keepRunning())
+	{
+		wstring multiString = StringListUtils::vectorToMultiString(paths);
+		Benchmark::doNotOptimize(multiString);
+	}
+}
+BENCHMARK(StringList_VectorToMultiString)->arg(10)->arg(100)->arg(1000);
+
+
+
+static void StringList_MultiStringToVector(BenchmarkState& state)
+{
+	wstring multiString = StringListUtils::vectorToMultiString(
+		BenchmarkCorpus::makeShortcutPaths((size_t) state.arg()));
+	while (state.keepRunning())
+	{
+		vector<wstring> paths =
+			StringListUtils::multiStringToVector(multiString.c_str());
+		Benchmark::doNotOptimize(paths);
+	}
+}
+BENCHMARK(StringList_MultiStringToVector)->arg(10)->arg(100)->arg(1000);
+
+
+
+// Half of the donated paths are already registered, as after a few
+// sessions in which the user kept their shortcuts on the desktop.
+static void StringList_MergeLists(BenchmarkState& state)
+{
+	const size_t count = (size_t) state.arg();
+	const vector<wstring> registered = BenchmarkCorpus::makeShortcutPaths(count);
+	const vector<wstring> onDesktop =
+		BenchmarkCorpus::makeShortcutPaths(count, count / 2);
+	vector<wstring> acceptor;
+	while (state.keepRunning())
+	{
+		acceptor = registered;
+		StringListUtils::mergeLists(acceptor, onDesktop);
+		Benchmark::doNotOptimize(acceptor);
+	}
+}
+BENCHMARK(StringList_MergeLists)->arg(10)->arg(100)->arg(1000);
+
+
+
+namespace {
+	// A list as older versions left it: each shortcut started twenty
+	// times, and every third one deleted since. Checking a file waits
+	// about as long as PathFileExists on a disk that isn't in the cache.
+	void compactShortcutList(BenchmarkState& state, unsigned threadCount)
+	{
+		const size_t count = (size_t) state.arg();
+		const vector<wstring> unique = BenchmarkCorpus::makeShortcutPaths(count / 20);
+		vector<wstring> files;
+		files.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+			files.push_back(unique[i % unique.size()]);
+
+		auto exists = [](const wstring& file) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			return file[file.size() - 5] % 3 != 0;
+		};
+		ShortcutListCompactor compactor(exists,
+			ShortcutListCompactor::defaultMaxEntries, threadCount);
+		while (state.keepRunning())
+			Benchmark::doNotOptimize(compactor.compact(files));
+	}
+}
+
+
+
+static void StringList_CompactShortcutsSerial(BenchmarkState& state)
+{
+	compactShortcutList(state, 1);
+}
+BENCHMARK(StringList_CompactShortcutsSerial)->arg(1000)->arg(50000);
+
+
+
+static void StringList_CompactShortcutsParallel(BenchmarkState& state)
+{
+	compactShortcutList(state, ShortcutListCompactor::maxThreadCount);
+}
+BENCHMARK(StringList_CompactShortcutsParallel)->arg(1000)->arg(50000);
+
+
+
+static void StringList_SortedPathListEraseHalf(BenchmarkState& state)
+{
+	const vector<wstring> paths = BenchmarkCorpus::makeShortcutPaths((size_t) state.arg());
+	vector<size_t> everyOther;
+	for (size_t i = 0; i < paths.size(); i += 2)
+		everyOther.push_back(i);
+
+	SortedPathList list;
+	while (state.keepRunning())
+	{
+		list.insert(paths);
+		Benchmark::doNotOptimize(list.eraseAt(everyOther));
+		list.clear();
+	}
+}
+BENCHMARK(StringList_SortedPathListEraseHalf)->arg(100)->arg(5000);
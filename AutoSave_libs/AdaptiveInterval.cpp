@@ -0,0 +1,33 @@
+#include "stdafx.h"
+#include "AdaptiveInterval.h"
+
+
+UINT AdaptiveInterval::getBusyInterval(const AdaptivePolicy& policy,
+	ULONGLONG saveDuration)
+{
+	ULONGLONG interval = policy.minInterval;
+	if (policy.maxBusyPercent > 0)
+	{
+		// Round up, so that slow saves can't exceed their share.
+		ULONGLONG busyBound = (saveDuration * 100 / policy.maxBusyPercent
+			+ 999) / 1000;
+		interval = __max(interval, busyBound);
+	}
+	// The maximum wins: it's the most work the user may lose.
+	return (UINT) __min(interval, (ULONGLONG) policy.maxInterval);
+}
+
+
+
+UINT AdaptiveInterval::next(const AdaptivePolicy& policy, UINT current,
+	const Signals& signals)
+{
+	const UINT busyInterval = getBusyInterval(policy, signals.saveDuration);
+	const bool isIdle = signals.fileChange == FC_UNCHANGED || !signals.hadInput;
+	if (!isIdle)
+		return busyInterval;
+
+	ULONGLONG grown = (ULONGLONG) current * policy.growthPercent / 100;
+	grown = __max(grown, (ULONGLONG) busyInterval);
+	return (UINT) __min(grown, (ULONGLONG) policy.maxInterval);
+}
@@ -0,0 +1,55 @@
+// AdaptiveInterval.h : Picks the time until the next save from what
+// happened since the last one. While the user works, saves come as often
+// as the policy allows; while there's nothing to save, they come less
+// and less often. The policy is part of MiscSettings.
+// Never throws exceptions.
+
+#pragma once
+
+#include "stdafx.h"
+
+struct AdaptivePolicy
+{
+	UINT minInterval;    // In seconds.
+	UINT maxInterval;    // In seconds.
+	UINT growthPercent;  // Applied to the interval while idle.
+	UINT maxBusyPercent; // Share of the time that saving may take up.
+
+	inline bool operator==(const AdaptivePolicy& other) const {
+		return minInterval == other.minInterval &&
+			maxInterval == other.maxInterval &&
+			growthPercent == other.growthPercent &&
+			maxBusyPercent == other.maxBusyPercent;
+	}
+	inline bool operator!=(const AdaptivePolicy& other) const {
+		return !(*this == other);
+	}
+};
+
+
+
+namespace AdaptiveInterval
+{
+	enum FileChange {
+		FC_UNKNOWN,   // No documents known, e.g. without Connected Shortcut.
+		FC_UNCHANGED, // The previous save didn't write anything.
+		FC_CHANGED
+	};
+
+	struct Signals
+	{
+		bool hadInput;          // Any user input since the previous save.
+		FileChange fileChange;
+		ULONGLONG saveDuration; // In milliseconds, zero if unknown.
+	};
+
+	// The interval while the user works: the minimum, unless saving takes
+	// so long that it would keep the application busy for more than
+	// maxBusyPercent of the time. Never more than the maximum.
+	UINT getBusyInterval(const AdaptivePolicy& policy, ULONGLONG saveDuration);
+
+	// Grows the interval if the previous save didn't change the file or
+	// if the user didn't do anything since. Otherwise, returns the busy
+	// interval.
+	UINT next(const AdaptivePolicy& policy, UINT current, const Signals& signals);
+}
@@ -4,16 +4,9 @@
 
 // Copy constructor
 AppConnection::AppConnection(const AppConnection& ac)
-	: m_processId(ac.m_processId)
+	: m_process(ac.m_process ? ac.m_process->clone() : nullptr),
+	  m_args(ac.m_args)
 {
-	if (ac.isConnected())
-	{
-		// Explicitly duplicate handles for reference count purposes.
-		DuplicateHandle(
-			GetCurrentProcess(), ac.m_hProcess,
-			GetCurrentProcess(), &m_hProcess,
-			0, FALSE, DUPLICATE_SAME_ACCESS);
-	}
 }
 
 
@@ -25,15 +18,9 @@ AppConnection& AppConnection::operator=(const AppConnection& ac)
 	{
 		// Invalidate old handles before they are lost.
 		disconnect();
-		m_processId = ac.m_processId;
 		if (ac.isConnected())
-		{
-			// Explicitly duplicate handles for reference count purposes.
-			DuplicateHandle(
-				GetCurrentProcess(), ac.m_hProcess,
-				GetCurrentProcess(), &m_hProcess,
-				0, FALSE, DUPLICATE_SAME_ACCESS);
-		}
+			m_process = ac.m_process->clone();
+		m_args = ac.m_args;
 	}
 	return *this;
 }
@@ -42,12 +29,8 @@ AppConnection& AppConnection::operator=(const AppConnection& ac)
 
 // Move constructor
 AppConnection::AppConnection(AppConnection&& ac)
-	: m_processId(ac.m_processId),
-	  m_hProcess(ac.m_hProcess)
+	: m_process(std::move(ac.m_process)), m_args(std::move(ac.m_args))
 {
-	// We needn't close the handles since we keep them in this object.
-	ac.m_hProcess = 0;
-	ac.m_processId = 0;
 }
 
 
@@ -58,10 +41,8 @@ AppConnection& AppConnection::operator=(AppConnection&& ac)
 	// Invalidate old handles before they are lost.
 	disconnect();
 	// We needn't close the handles since we keep them in this object.
-	m_hProcess = ac.m_hProcess;
-	m_processId = ac.m_processId;
-	ac.m_hProcess = 0;
-	ac.m_processId = 0;
+	m_process = std::move(ac.m_process);
+	m_args = std::move(ac.m_args);
 
 	return *this;
 }
@@ -77,13 +58,8 @@ void AppConnection::connect(const vector<wstring>& args)
 		args.begin() + 1, args.end());
 
 	throwIfStartingSelf(openedFile);
-	m_hProcess = shellExecute(openedFile, commandLine);
-	m_processId = GetProcessId(m_hProcess);
-	if (m_processId == 0)
-	{
-		CloseHandle(m_hProcess);
-		throw AutoSaveException();
-	}
+	m_process = Platform::startProcess(openedFile, commandLine);
+	m_args = args;
 }
 
 
@@ -98,89 +74,37 @@ void AppConnection::connect(const wstring& file)
 
 void AppConnection::disconnect()
 {
-	if (isConnected())
-	{
-		CloseHandle(m_hProcess);
-		m_hProcess = 0;
-		m_processId = 0;
-	}
-}
-
-
-
-
-HANDLE AppConnection::shellExecute(const wstring& file, const wstring& argLine)
-{
-	STARTUPINFO si;
-	GetStartupInfo(&si);
-
-	SHELLEXECUTEINFO see = { 0 };
-	see.cbSize = sizeof(see);
-	see.fMask = SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_LOG_USAGE;
-	see.lpVerb = L"open";
-	see.lpFile = file.data();
-	see.lpParameters = argLine.data();
-	see.lpDirectory = NULL;
-	see.nShow = si.wShowWindow;
-
-	throwIfZero<AutoSaveException, BOOL>(
-		ShellExecuteEx(&see));
-	return see.hProcess;
+	m_process.reset();
+	m_args.clear();
 }
 
 
 
 void AppConnection::throwIfStartingSelf(const wstring& startedFile)
 {
-	if (OleUtils::isSelf(findExecutable(startedFile)))
+	if (Platform::wouldStartSelf(startedFile))
 		throw std::runtime_error("AutoSave must not start itself");
 }
 
 
 
-wstring AppConnection::findExecutable(const wstring& documentPath)
-{
-	if (OleUtils::isExecutable(documentPath))
-		return documentPath;
-
-	TCHAR buffer[MAX_PATH];
-	HINSTANCE feResult = FindExecutable(documentPath.data(), NULL, buffer);
-	if ((int) feResult <= 32)
-		throw AutoSaveException();
-	return buffer;
-}
-
-
-
-DWORD AppConnection::getExitCode(HANDLE hProcess)
+vector<HWND> AppConnection::getConnectedWindows() const
 {
-	DWORD exitCode = 0;
-	return GetExitCodeProcess(hProcess, &exitCode) == FALSE ? 0 : exitCode;
+	return getConnectedWindows(Platform::getWindowEnumerator());
 }
 
 
 
-vector<HWND> AppConnection::getConnectedWindows() const
-{
-	EnumProcArgs args = { getProcessId(), {} };
-	EnumWindows(getConnectedWindowsEnumProc, (LPARAM) &args);
-	return args.matchingWindows;
-}
-
-BOOL CALLBACK AppConnection::getConnectedWindowsEnumProc(
-	HWND hwnd, LPARAM lParam)
+vector<HWND> AppConnection::getConnectedWindows(
+	const WindowEnumerator& windows) const
 {
-	auto pArgs = (EnumProcArgs*) lParam;
-	DWORD windowProcessId;
-	GetWindowThreadProcessId(hwnd, &windowProcessId);
-	
-	if (windowProcessId == pArgs->expectedProcessId && GetParent(hwnd) == 0)
-		pArgs->matchingWindows.push_back(hwnd);
-
-	return TRUE;
+	vector<HWND> matchingWindows;
+	const DWORD expectedProcessId = getProcessId();
+	windows.enumWindows([&](HWND hwnd) {
+		if (windows.getWindowProcessId(hwnd) == expectedProcessId &&
+			!windows.isOwnedWindow(hwnd))
+			matchingWindows.push_back(hwnd);
+		return true;
+	});
+	return matchingWindows;
 }
-
-
-
-
-
@@ -6,14 +6,14 @@
 
 #include "stdafx.h"
 #include "CommandLineParser.h"
-#include "OleUtils.h"
 #include "AutoSaveException.h"
+#include "Platform.h"
 
 class AppConnection
 {
 public:
 	// constructors and destructor
-	AppConnection() : m_hProcess(0), m_processId(0) {}
+	AppConnection() : m_process() {}
 	~AppConnection() { disconnect(); }
 
 	// copy constructors
@@ -34,30 +34,25 @@ public:
 	static void throwIfStartingSelf(const wstring& startedFile);
 
 	// Getters.
-	inline DWORD getProcessId() const { return m_processId; }
-	inline bool isConnected() const { return m_processId != 0; }
+	inline DWORD getProcessId() const {
+		return m_process ? m_process->getProcessId() : 0;
+	}
+	inline bool isConnected() const { return getProcessId() != 0; }
 	bool isConnectionAlive() const {
-		return isConnected() && getExitCode(m_hProcess) == STILL_ACTIVE;
+		return isConnected() && m_process->isAlive();
 	}
 	inline DWORD waitForInputIdle(DWORD timeout) const {
-		return WaitForInputIdle(m_hProcess, timeout);
+		return m_process ? m_process->waitForInputIdle(timeout) : 0;
 	}
 
+	// The file and arguments passed to connect, e.g. the documents
+	// a SaveVerifier can watch.
+	inline const vector<wstring>& getArguments() const { return m_args; }
+
 	vector<HWND> getConnectedWindows() const;
+	vector<HWND> getConnectedWindows(const WindowEnumerator& windows) const;
 
 private:
-	static DWORD getExitCode(HANDLE hProcess);
-
-	static BOOL CALLBACK getConnectedWindowsEnumProc(HWND hwnd, LPARAM lParam);
-	struct EnumProcArgs {
-		DWORD expectedProcessId;
-		vector<HWND> matchingWindows;
-	};
-
-	static HANDLE shellExecute(const wstring& file, const wstring& argLine);
-	static wstring findExecutable(const wstring& documentPath);
-
-	DWORD m_processId;
-	HANDLE m_hProcess;
+	unique_ptr<ProcessHandle> m_process;
+	vector<wstring> m_args;
 };
-
@@ -6,15 +6,27 @@ const LPTSTR Application::windowClassName = APP_NAME L" main window class";
 
 Application::Application(LPCTSTR pCmdLine)
 	: m_commandLine(pCmdLine),
-	  m_sender(m_cfg.settings.getInterval())
+	  m_sender(m_cfg.settings.getInterval()),
+	  m_scheduler(m_cfg, m_sender.getCountdown(), Platform::getClock(),
+		Platform::getWindowEnumerator(), Platform::getInputSink(), *this),
+	  m_eventLog(Platform::getClock()),
+	  m_hContextMenu(NULL),
+	  m_isOleInitialized(false),
+	  m_startTime(Platform::getClock().getTickCount()),
+	  m_clicks(Platform::getClock(), GetDoubleClickTime(), longPressTime),
+	  m_clickedIconId(0),
+	  m_isPausedRemotely(false),
+	  m_exitCode(0)
 {
-	OleInitialize(NULL);
+	// Kept until the event log is started.
+	traceStartup(EventLog::SP_CREATED);
 }
 
 
 Application::~Application()
 {
-	OleUninitialize();
+	if (m_isOleInitialized)
+		OleUninitialize();
 }
 
 
@@ -38,7 +50,7 @@ void Application::registerWindowClass()
 
 
 
-void Application::mainLoop()
+int Application::mainLoop()
 {
 	MSG msg = {};
 	BOOL getMessageResult;
@@ -46,8 +58,7 @@ void Application::mainLoop()
 	{
 		if (getMessageResult == -1)
 		{
-			log(L"Fatal error! Variable getMessageResult is -1!");
-			log(L"How could this happend to meeeeeeee~~~");
+			m_eventLog.record(EventLog::EV_FATAL, GetLastError());
 			break;
 		}
 		else {
@@ -55,6 +66,7 @@ void Application::mainLoop()
 			DispatchMessage(&msg);
 		}
 	}
+	return (int) msg.wParam;
 }
 
 
@@ -70,11 +82,23 @@ LRESULT Application::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 		case WM_DESTROY:
 			OnDestroy();
-			PostQuitMessage(0);
+			PostQuitMessage(m_exitCode);
 			return 0;
 
 		case WM_TIMER:
-			OnTimer();
+			if (wParam == clickTimerId)
+				onClickTimer();
+			else if (wParam == startingShortcutTimerId)
+				registerStartingShortcut();
+			else if (wParam == settingsTimerId)
+				flushSettings();
+			else if (wParam == foregroundRetryTimerId)
+			{
+				KillTimer(m_hwnd, foregroundRetryTimerId);
+				onForegroundChanged(GetForegroundWindow());
+			}
+			else
+				OnTimer();
 			return 0;
 
 		case NotifyIcon::message: {
@@ -85,6 +109,10 @@ LRESULT Application::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 			return 0;
 		}
 
+		case WM_CONTROLCOMMAND:
+			onControlCommand((ControlService::Command) wParam);
+			return 0;
+
 		case PeriodicSender::SM_ATZERO:
 			onSenderAtZero();
 			return 0;
@@ -103,10 +131,12 @@ LRESULT Application::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 	}
 	catch (AutoSaveException& exc) {
 		// Emergency exception handler.
+		m_eventLog.record(EventLog::EV_EXCEPTION, (UINT) exc.errorCode());
 		exc.showMessageBox(m_hwnd, L"An unexpected error occured.");
 		return DefWindowProc(m_hwnd, uMsg, wParam, lParam);
 	}
 	catch (std::exception& exc) {
+		m_eventLog.record(EventLog::EV_EXCEPTION);
 		AutoSaveException::showMessageBox(
 			m_hwnd, L"An unexpected error occured.", exc);
 		return DefWindowProc(m_hwnd, uMsg, wParam, lParam);
@@ -117,57 +147,77 @@ LRESULT Application::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 void Application::OnNotifyIcon(WORD msg, WORD iconId, int x, int y)
 {
-	// This bool is both a mutex and a signaling tool to distinguish
-	// between a single and a double left click.
-	static bool isWaitingForSecondClick;
-
-	if (msg == NIN_BALLOONTIMEOUT)
+	ClickGesture::Gesture gesture = ClickGesture::GS_NONE;
+	switch (msg)
 	{
+	case NIN_BALLOONTIMEOUT:
 		m_icon.clearNotification();
-	}
-	else if (msg == NIN_BALLOONUSERCLICK)
-	{
+		return;
+	case NIN_BALLOONUSERCLICK:
 		onNotifyBubbleClicked(m_icon.getCurrentNotification());
 		m_icon.clearNotification();
+		return;
+	case WM_LBUTTONDOWN:
+		// The user may have changed it since we started.
+		m_clicks.setDoubleClickTime(GetDoubleClickTime());
+		gesture = m_clicks.onButtonDown(ClickGesture::BT_LEFT, x, y);
+		break;
+	case WM_LBUTTONUP:
+		gesture = m_clicks.onButtonUp(ClickGesture::BT_LEFT, x, y);
+		break;
+	case WM_LBUTTONDBLCLK:
+		gesture = m_clicks.onDoubleClick(ClickGesture::BT_LEFT, x, y);
+		break;
+	case WM_MBUTTONUP:
+		gesture = m_clicks.onButtonUp(ClickGesture::BT_MIDDLE, x, y);
+		break;
+	case WM_RBUTTONUP:
+		gesture = m_clicks.onButtonUp(ClickGesture::BT_RIGHT, x, y);
+		break;
+	default:
+		return;
 	}
-	else if (msg == WM_LBUTTONDBLCLK)
-	{
-		isWaitingForSecondClick = false;
-		onNotifyIconLDblClk(iconId, x, y);
-	}
-	else if (msg == WM_LBUTTONCLICKEDONCE)
+	m_clickedIconId = iconId;
+	setClickTimer();
+	onClickGesture(gesture, iconId);
+}
+
+
+
+void Application::onClickGesture(ClickGesture::Gesture gesture, WORD iconId)
+{
+	const int x = m_clicks.getX();
+	const int y = m_clicks.getY();
+	switch (gesture)
 	{
+	case ClickGesture::GS_CLICK:
 		onNotifyIconLClick(iconId, x, y);
-	}
-	else if (msg == WM_LBUTTONDOWN && !isWaitingForSecondClick)
-	{
-		isWaitingForSecondClick = true;
-		auto pArgs = new NOTIFYTHREADARGUMENTS;
-		*pArgs = { this, &isWaitingForSecondClick, iconId, x, y };
-		CloseHandle(CreateThread(NULL, 12, onNotifyLClickThread, pArgs, 0, NULL));
-	}
-	else if (msg == WM_RBUTTONUP)
-	{
-		isWaitingForSecondClick = false;
+		break;
+	case ClickGesture::GS_DOUBLE_CLICK:
+		onNotifyIconLDblClk(iconId, x, y);
+		break;
+	case ClickGesture::GS_LONG_PRESS:
+		onNotifyIconLongPress(iconId, x, y);
+		break;
+	case ClickGesture::GS_MIDDLE_CLICK:
+		onNotifyIconMClick(iconId, x, y);
+		break;
+	case ClickGesture::GS_RIGHT_CLICK:
 		onNotifyIconRClick(iconId, x, y);
+		break;
+	default:
+		break;
 	}
 }
 
-DWORD CALLBACK Application::onNotifyLClickThread(LPVOID lParam)
+
+
+void Application::onClickTimer()
 {
-	// We copy the struct pointed to by lParam because it might
-	// cease to exist once the other function exits.
-	auto pArgs = (NOTIFYTHREADARGUMENTS*) lParam;
-	Sleep(GetDoubleClickTime());
-	if (*pArgs->pIsWaitingForSecondClick)
-	{
-		PostMessage(pArgs->pThis->m_hwnd, NotifyIcon::message,
-			MAKELONG(pArgs->x, pArgs->y),
-			MAKELONG(WM_LBUTTONCLICKEDONCE, pArgs->iconId));
-	}
-	*pArgs->pIsWaitingForSecondClick = false;
-	delete pArgs;
-	return 0;
+	KillTimer(m_hwnd, clickTimerId);
+	ClickGesture::Gesture gesture = m_clicks.onTimer();
+	setClickTimer();
+	onClickGesture(gesture, m_clickedIconId);
 }
 
 
@@ -175,16 +225,32 @@ DWORD CALLBACK Application::onNotifyLClickThread(LPVOID lParam)
 void Application::OnCreate()
 {
 	initConfiguration();
-	wstring startingShortcut = getStartingShortcutFileName();
-	if (!startingShortcut.empty())
-		ShortcutsDisconnector::registerConnectedShortcuts(startingShortcut);
+	if (!m_cfg.controlRequest.empty())
+	{
+		m_exitCode = runControlClient();
+		PostMessage(m_hwnd, WM_CLOSE, 0, 0);
+		return;
+	}
+
+	traceStartup(EventLog::SP_CONFIGURATION);
+	startEventLog();
+	traceStartup(EventLog::SP_EVENT_LOG);
+
+	// The first save needs neither; see registerStartingShortcut and
+	// getContextMenu.
+	m_startingShortcut = getStartingShortcutFileName();
+	if (!m_startingShortcut.empty())
+		SetTimer(m_hwnd, startingShortcutTimerId, startingShortcutDelay, NULL);
 
-	m_hContextMenu = LoadMenu(GetModuleHandle(NULL), MAKEINTRESOURCE(IDC_MENU));
 	m_sender.setWindow(m_hwnd);
 	m_icon.setWindow(m_hwnd);
+	m_pForegroundWatcher = Platform::createForegroundWatcher();
+	m_scheduler.setForegroundReported(m_pForegroundWatcher->startWatching(
+		[this](HWND hwnd) { onForegroundChanged(hwnd); }));
 
 	if (m_cfg.connection.isConnected())
 	{
+		m_eventLog.record(EventLog::EV_CONNECTED, m_cfg.connection.getProcessId());
 		switchToBeingEnabled();
 	}
 	else if (m_cfg.isFirstSession)
@@ -194,6 +260,9 @@ void Application::OnCreate()
 	else {
 		switchToBeingEnabled();
 	}
+	traceStartup(EventLog::SP_COUNTDOWN);
+	startControlServer();
+	traceStartup(EventLog::SP_CONTROL_SERVER);
 }
 
 void Application::OnTimer()
@@ -201,19 +270,47 @@ void Application::OnTimer()
 	// Quit when the connected app is closed.
 	if (m_cfg.connection.isConnected() && !m_cfg.connection.isConnectionAlive())
 	{
+		m_eventLog.record(EventLog::EV_DISCONNECTED, m_cfg.connection.getProcessId());
 		PostMessage(m_hwnd, WM_CLOSE, 0, 0);
 	}
+	// Saves wait while the calibration sends its own.
+	else if (isCalibrating()) {
+		stepCalibration();
+		updateControlStatus();
+	}
 	else {
+		m_scheduler.onTick();
 		m_sender.step();
+		updateControlStatus();
 	}
 }
 
 void Application::OnDestroy()
 {
-	DestroyMenu(m_hContextMenu);
+	// Stop taking commands before there's nothing left to command.
+	m_pControlServer.reset();
+	KillTimer(m_hwnd, clickTimerId);
+	KillTimer(m_hwnd, startingShortcutTimerId);
+	KillTimer(m_hwnd, foregroundRetryTimerId);
+	// A session shorter than startingShortcutDelay still leaves its
+	// shortcut to the uninstaller; compacting can wait for another one.
+	if (!m_startingShortcut.empty())
+	{
+		initOle();
+		ShortcutsDisconnector::registerConnectedShortcuts(m_startingShortcut);
+		m_startingShortcut.clear();
+	}
+	m_pForegroundWatcher.reset();
+	flushSettings();
+	if (m_compactionThread.joinable())
+		m_compactionThread.join();
+	if (m_hContextMenu != NULL)
+		DestroyMenu(m_hContextMenu);
 
 	m_icon.hide();
 	m_sender.stop();
+	m_scheduler.setEventLog(NULL);
+	m_eventLog.stopFlushing();
 }
 
 
@@ -234,6 +331,16 @@ void Application::onNotifyIconRClick(WORD iconId, int x, int y)
 	onShortcutMenuClicked(trackShortcutMenu(x, y));
 }
 
+void Application::onNotifyIconLongPress(WORD iconId, int x, int y)
+{
+	saveNow();
+}
+
+void Application::onNotifyIconMClick(WORD iconId, int x, int y)
+{
+	saveNow();
+}
+
 void Application::onNotifyBubbleClicked(int notifyId)
 {
 	if (notifyId == IDS_ALERT_CAPTION)
@@ -263,6 +370,9 @@ void Application::onShortcutMenuClicked(int menuId)
 		if (m_cfg.isEnabled)
 			switchToBeingDisabled();
 		break;
+	case IDM_METRICS:
+		saveMetrics();
+		break;
 	case IDM_CLOSE:
 		shutdown();
 		break;
@@ -273,76 +383,287 @@ void Application::onShortcutMenuClicked(int menuId)
 
 
 
+// Runs on the UI thread, like the menu does.
+void Application::onControlCommand(ControlService::Command command)
+{
+	switch (command)
+	{
+	case ControlService::CMD_PAUSE:
+		if (!m_isPausedRemotely)
+		{
+			m_isPausedRemotely = true;
+			m_sender.pause();
+		}
+		break;
+	case ControlService::CMD_RESUME:
+		if (m_isPausedRemotely)
+		{
+			m_isPausedRemotely = false;
+			m_sender.resume();
+		}
+		break;
+	case ControlService::CMD_SAVE:
+		saveNow();
+		break;
+	case ControlService::CMD_RELOAD:
+		// A connected shortcut's settings come from its command line.
+		if (!m_cfg.connection.isConnected())
+		{
+			// Else the changes still pending would be read back as they
+			// were, and land in the registry after they have been undone.
+			flushSettings();
+			m_cfg.loadFromRegistry(DEFAULT_REGISTRY_KEY);
+			if (m_cfg.isEnabled)
+				switchToBeingEnabled();
+		}
+		break;
+	case ControlService::CMD_CALIBRATE:
+		startCalibration();
+		break;
+	case ControlService::CMD_QUIT:
+		// Unlike the menu, doesn't ask about a connected application.
+		PostMessage(m_hwnd, WM_CLOSE, 0, 0);
+		break;
+	default:
+		break;
+	}
+	updateControlStatus();
+}
+
+
+
 void Application::onSenderDelayAtZero()
 {
-	m_icon.show(IDI_A);
+	m_scheduler.onDelayAtZero();
 }
 
 void Application::onSenderAtFive(UINT_PTR secondsLeft)
 {
-	if (!m_cfg.matchingWindowExists())
+	m_scheduler.onFiveSecondsLeft();
+}
+
+void Application::onSenderAtLessThanFive(UINT_PTR secondsLeft)
+{
+	m_scheduler.onLessThanFiveLeft((UINT) secondsLeft);
+}
+
+// Without the timer, nobody would notice a connected application
+// closing, so that keeps ticking.
+void Application::onSenderAtZero()
+{
+	m_scheduler.onAtZero();
+	if (m_scheduler.canIdleAtZero() && !m_cfg.connection.isConnected())
+		m_sender.sleep();
+}
+
+void Application::onForegroundChanged(HWND hwnd)
+{
+	if (m_scheduler.onForegroundChanged(hwnd))
 	{
-		m_sender.resetCountdown();
-		m_icon.show(IDI_A);
+		SetTimer(m_hwnd, foregroundRetryTimerId,
+			Scheduler::getForegroundRetryDelay(), NULL);
 	}
-	else
+	if (m_sender.isAsleep() && !m_scheduler.canIdleAtZero())
+		m_sender.wake();
+}
+
+
+
+void Application::showIndicator(Indicator indicator)
+{
+	switch (indicator)
 	{
-		if (m_cfg.settings.verbosityExceeds(MiscSettings::ALERT_FIVE_SECONDS))
-		{
-			m_icon.notify(IDS_ALERT_CAPTION, IDS_ALERT_TEXT, IDI_A);
-		}
-		if (m_cfg.settings.verbosityExceeds(MiscSettings::SHOW_ICONS))
-		{
-			m_icon.show(IDI_COUNT5);
-		}
+	case IND_IDLE: m_icon.show(IDI_A); break;
+	case IND_COUNT5: m_icon.show(IDI_COUNT5); break;
+	case IND_COUNT4: m_icon.show(IDI_COUNT4); break;
+	case IND_COUNT3: m_icon.show(IDI_COUNT3); break;
+	case IND_COUNT2: m_icon.show(IDI_COUNT2); break;
+	case IND_COUNT1: m_icon.show(IDI_COUNT1); break;
+	case IND_COUNT0: m_icon.show(IDI_COUNT0); break;
+	case IND_SAVED: m_icon.show(IDI_OK); break;
+	default: break;
 	}
 }
 
-void Application::onSenderAtLessThanFive(UINT_PTR secondsLeft)
+void Application::showFiveSecondsAlert()
+{
+	m_icon.notify(IDS_ALERT_CAPTION, IDS_ALERT_TEXT, IDI_A);
+}
+
+void Application::clearAlert()
+{
+	m_icon.clearNotification();
+}
+
+void Application::showSaveFailedAlert()
+{
+	m_icon.notify(IDS_SAVEFAILED_CAPTION, IDS_SAVEFAILED_TEXT, IDI_A);
+}
+
+void Application::onSaveConfirmed(const vector<wstring>& files)
+{
+	if (m_pBackupWorker)
+		m_pBackupWorker->request(files);
+}
+
+
+
+// Writes to the temporary directory; autosave_metrics prints the file.
+void Application::saveMetrics()
 {
-	if (m_cfg.settings.verbosityExceeds(MiscSettings::SHOW_ICONS))
+	wchar_t tempPath[MAX_PATH + 1];
+	DWORD length = GetTempPath(MAX_PATH + 1, tempPath);
+	if (length == 0 || length > MAX_PATH)
 	{
-		switch (secondsLeft)
-		{
-		case 4: m_icon.show(IDI_COUNT4); break;
-		case 3: m_icon.show(IDI_COUNT3); break;
-		case 2: m_icon.show(IDI_COUNT2); break;
-		case 1: m_icon.show(IDI_COUNT1); break;
-		default: break;
-		}
+		AutoSaveException(GetLastError()).showMessageBox(m_hwnd,
+			L"Couldn't find the temporary directory.");
+		return;
+	}
+	const wstring path = wstring(tempPath) + SHORT_APP_NAME L".metrics";
+	const string bytes = m_scheduler.getMetrics().takeSnapshot().serialize();
+
+	HANDLE hFile = CreateFile(path.data(), GENERIC_WRITE, 0, NULL,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	DWORD written = 0;
+	BOOL success = hFile != INVALID_HANDLE_VALUE && WriteFile(hFile,
+		bytes.data(), (DWORD) bytes.size(), &written, NULL);
+	DWORD errorCode = GetLastError();
+	if (hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile);
+	if (!success)
+	{
+		AutoSaveException(errorCode).showMessageBox(m_hwnd,
+			L"Couldn't save the metrics to " + path);
+		return;
 	}
+	MessageBox(m_hwnd, (L"The metrics have been saved to " + path).data(),
+		APP_NAME, MB_OK);
 }
 
-void Application::onSenderAtZero()
+
+
+// Next to the metrics; autosave_events prints the files.
+void Application::startEventLog()
 {
-	if (m_sender.noKeyPressed() && m_cfg.windowMatch(GetForegroundWindow()))
-	{
-		PeriodicSender::sendKeys(m_cfg.settings.getHotkey());
-		m_sender.resetCountdown();
-		if (m_cfg.settings.verbosityExceeds(MiscSettings::SHOW_ICONS))
-		{
-			m_sender.resetDelay();
-			// Clear potential five-seconds alert.
-			m_icon.clearNotification();
-			m_icon.show(IDI_OK);
-		}
+	wchar_t tempPath[MAX_PATH + 1];
+	DWORD length = GetTempPath(MAX_PATH + 1, tempPath);
+	if (length == 0 || length > MAX_PATH)
+		return;
+	m_pEventSink.reset(new RotatingFileSink(
+		wstring(tempPath) + SHORT_APP_NAME L".events", 1024 * 1024, 3));
+	if (!m_pEventSink->isOpen())
+		return; // Another instance has it; go without.
+	m_eventLog.record(EventLog::EV_STARTED, GetCurrentProcessId());
+	m_scheduler.setEventLog(&m_eventLog);
+	m_eventLog.startFlushing(*m_pEventSink, 1000);
+}
+
+
+
+// Someone else may already be serving; then this instance goes without.
+void Application::startControlServer()
+{
+	m_pControlService.reset(new ControlService(m_scheduler.getMetrics(),
+		Platform::getClock(), [this](ControlService::Command command) {
+			PostMessage(m_hwnd, WM_CONTROLCOMMAND, (WPARAM) command, 0);
+		}));
+	updateControlStatus();
+	try {
+		ControlService* pService = m_pControlService.get();
+		m_pControlServer = Platform::startControlServer(
+			ControlService::getEndpointName(), [pService](const string& request) {
+				return pService->handle(request);
+			});
 	}
-	else if (!m_cfg.matchingWindowExists())
+	catch (AutoSaveException& exc) {
+		m_eventLog.record(EventLog::EV_EXCEPTION, (UINT) exc.errorCode());
+	}
+}
+
+
+
+void Application::updateControlStatus()
+{
+	if (!m_pControlService)
+		return;
+
+	const Countdown& countdown = m_sender.getCountdown();
+	ControlService::Status status;
+	status.isEnabled = m_cfg.isEnabled;
+	status.isPaused = countdown.isPaused();
+	status.isConnected = m_cfg.connection.isConnected();
+	status.target = status.isConnected ? L"" : m_cfg.filter.getFilter();
+	status.interval = countdown.getInterval();
+	status.secondsLeft = countdown.getSecondsLeft();
+	status.lastSaveTime =
+		m_scheduler.getMetrics().getCounter(Metrics::MC_SAVES) == 0
+		? 0 : m_scheduler.getLastSaveTime();
+	status.isCalibrating = isCalibrating();
+	m_pControlService->setStatus(status);
+}
+
+
+
+// For /Q. Returns the exit code.
+int Application::runControlClient()
+{
+	string request;
+	for (wchar_t c : m_cfg.controlRequest)
+		request.push_back((c < 0x80) ? (char) c : '?');
+	try {
+		const string response = Platform::sendControlRequest(
+			ControlService::getEndpointName(), request);
+		printControlResponse(response);
+		return response.compare(0, 3, "ok\n") == 0 ? 0 : 1;
+	}
+	catch (AutoSaveException& exc) {
+		printControlResponse("error not running\n");
+		log(exc.wcwhat());
+		return 1;
+	}
+}
+
+
+
+// AutoSave has no console of its own, so borrow the caller's if there
+// is one, and show a message box if there isn't.
+void Application::printControlResponse(const string& response)
+{
+	HANDLE hOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+	bool isOwnHandle = false;
+	if ((hOutput == NULL || hOutput == INVALID_HANDLE_VALUE) &&
+		AttachConsole(ATTACH_PARENT_PROCESS))
 	{
-		m_sender.resetCountdown();
-		m_icon.clearNotification();
-		m_icon.show(IDI_A);
+		hOutput = CreateFile(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE,
+			NULL, OPEN_EXISTING, 0, NULL);
+		isOwnHandle = true;
 	}
-	else if (m_cfg.settings.verbosityExceeds(MiscSettings::SHOW_ICONS))
+
+	DWORD written = 0;
+	if (hOutput != NULL && hOutput != INVALID_HANDLE_VALUE &&
+		WriteFile(hOutput, response.data(), (DWORD) response.size(), &written, NULL))
 	{
-		m_icon.show(IDI_COUNT0);
+		if (isOwnHandle)
+			CloseHandle(hOutput);
+		return;
 	}
+	if (isOwnHandle && hOutput != INVALID_HANDLE_VALUE)
+		CloseHandle(hOutput);
+
+	int length = MultiByteToWideChar(CP_UTF8, 0, response.data(),
+		(int) response.size(), NULL, 0);
+	wstring text(length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, response.data(), (int) response.size(),
+		&text[0], length);
+	MessageBox(0, text.data(), APP_NAME, MB_OK);
 }
 
 
 
 void Application::initConfiguration()
 {
+	if (Configuration::isConnectingCommandLine(m_commandLine))
+		initOle();
 	try {
 		m_cfg.loadFromRegistry(DEFAULT_REGISTRY_KEY);
 	}
@@ -383,10 +704,108 @@ wstring Application::getStartingShortcutFileName()
 
 
 
+// Only shortcut files, the options window and starting a connected
+// application need OLE, and loading it takes a while at login.
+void Application::initOle()
+{
+	if (m_isOleInitialized)
+		return;
+	m_isOleInitialized = SUCCEEDED(OleInitialize(NULL));
+	traceStartup(EventLog::SP_OLE);
+}
+
+
+
+// Remembers the Connected Shortcut that started us for the uninstaller.
+// Reading the shortcut and the list can wait until the start-up rush is
+// over, or until the options window may show the list.
+void Application::registerStartingShortcut()
+{
+	KillTimer(m_hwnd, startingShortcutTimerId);
+	if (m_startingShortcut.empty())
+		return;
+	initOle();
+	ShortcutsDisconnector::registerConnectedShortcuts(m_startingShortcut);
+	m_startingShortcut.clear();
+	traceStartup(EventLog::SP_SHORTCUTS);
+
+	// Every start from a shortcut makes the list a bit longer.
+	m_compactionThread = std::thread([]() {
+		SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+		ShortcutsDisconnector::compactConnectedShortcuts();
+	});
+}
+
+
+
+// Only the settings that have changed, and only once the user has had
+// a moment to open the options window again.
+void Application::saveSettings()
+{
+	try {
+		if (!m_pSettingsStore)
+		{
+			// E.g. the uninstaller has removed it.
+			if (!Platform::configStoreExists(DEFAULT_REGISTRY_KEY))
+				m_cfg.forgetStore();
+			m_pSettingsStore.reset(new WriteBehindStore(
+				Platform::openConfigStore(DEFAULT_REGISTRY_KEY)));
+		}
+		m_cfg.saveChangesToStore(*m_pSettingsStore);
+	}
+	catch (AutoSaveException& exc) {
+		exc.showMessageBox(0, L"Couldn't save app settings.");
+	}
+	if (m_pSettingsStore && m_pSettingsStore->getPendingCount() > 0)
+		SetTimer(m_hwnd, settingsTimerId, settingsFlushDelay, NULL);
+}
+
+
+
+// Lets go of the store, so that the options window and the uninstaller
+// see the registry as it is.
+void Application::flushSettings()
+{
+	KillTimer(m_hwnd, settingsTimerId);
+	if (!m_pSettingsStore)
+		return;
+	try {
+		m_pSettingsStore->flush();
+	}
+	catch (AutoSaveException& exc) {
+		exc.showMessageBox(0, L"Couldn't save app settings.");
+	}
+	m_pSettingsStore.reset();
+}
+
+
+
+HMENU Application::getContextMenu()
+{
+	if (m_hContextMenu == NULL)
+	{
+		m_hContextMenu = LoadMenu(GetModuleHandle(NULL), MAKEINTRESOURCE(IDC_MENU));
+		traceStartup(EventLog::SP_MENU);
+	}
+	return GetSubMenu(m_hContextMenu, 0);
+}
+
+
+
+// Goes into the event log even before it's started, so that every phase
+// since the Application was created is in there.
+void Application::traceStartup(EventLog::StartupPhase phase)
+{
+	m_eventLog.record(EventLog::EV_STARTUP, phase,
+		Platform::getClock().getTickCount() - m_startTime);
+}
+
+
+
 int Application::trackShortcutMenu(int x, int y)
 {
 	m_sender.pause();
-	HMENU contextMenu = GetSubMenu(m_hContextMenu, 0);
+	HMENU contextMenu = getContextMenu();
 	if (m_cfg.connection.isConnected())
 	{
 		RemoveMenu(contextMenu, IDM_OPTIONS, MF_BYCOMMAND);
@@ -410,7 +829,9 @@ int Application::trackShortcutMenu(int x, int y)
 		contextMenu, flags, x, y, 0, m_hwnd, NULL);
 	PostMessage(m_hwnd, WM_NULL, 0, 0);
 
-	m_sender.resume();
+	// A pause over the control endpoint outlasts the menu.
+	if (!m_isPausedRemotely)
+		m_sender.resume();
 	return result;
 }
 
@@ -424,14 +845,8 @@ void Application::switchToOptionsWindow(OptionsWindow::PageNumber pageNumber)
 	showOptionsWindow(pageNumber, &shallSave, &shallExit);
 	shallEnable = m_cfg.isEnabled || shallSave;
 
-	if (shallSave) {
-		try {
-			m_cfg.saveToRegistry(DEFAULT_REGISTRY_KEY);
-		}
-		catch (AutoSaveException& exc) {
-			exc.showMessageBox(0, L"Couldn't save app settings.");
-		}
-	}
+	if (shallSave)
+		saveSettings();
 
 	// The showOptionsWindow function has manipulated m_icon and m_sender.
 	// Here, we take care of that.
@@ -455,12 +870,15 @@ void Application::switchToBeingEnabled()
 		m_icon.show(IDI_A);
 		m_icon.setTip(APP_NAME, L"Running");
 		m_sender.setInterval(m_cfg.settings.getInterval());
+		setUpSaveVerification();
 		m_sender.start();
+		m_isPausedRemotely = false;
 		m_cfg.isEnabled = true;
 		if (m_cfg.settings.verbosityExceeds(MiscSettings::ALERT_START))
 		{
 			m_icon.notify(IDS_STARTED_CAPTION, IDS_STARTED_TEXT, IDI_A);
 		}
+		updateControlStatus();
 	}
 	else {
 		switchToBeingDisabled();
@@ -473,7 +891,113 @@ void Application::switchToBeingDisabled()
 	m_icon.show(IDI_DISABLED);
 	m_icon.setTip(APP_NAME, L"Disabled");
 	m_sender.stop();
+	m_isPausedRemotely = false;
 	m_cfg.isEnabled = false;
+	updateControlStatus();
+}
+
+
+
+// Lets the countdown run out, so that the Scheduler saves as soon as a
+// matching window is in front.
+void Application::saveNow()
+{
+	if (m_cfg.isEnabled)
+		m_sender.getCountdown().shortenTo(0);
+}
+
+
+
+// One-shot: the ClickGesture says when it needs to hear from us again.
+void Application::setClickTimer()
+{
+	UINT timeout = m_clicks.getTimeout();
+	if (timeout == 0)
+		KillTimer(m_hwnd, clickTimerId);
+	else
+		SetTimer(m_hwnd, clickTimerId, timeout, NULL);
+}
+
+
+
+// Only Connected Shortcuts tell which documents are being edited.
+void Application::setUpSaveVerification()
+{
+	m_scheduler.setVerifier(NULL);
+	m_pVerifier.reset();
+	m_pFileWatcher.reset();
+
+	UINT timeout = m_cfg.settings.getSaveCheckTimeout();
+	if (timeout == 0 || !m_cfg.connection.isConnected())
+	{
+		setUpBackups();
+		return;
+	}
+
+	m_pFileWatcher = Platform::createFileWatcher();
+	m_pVerifier.reset(new SaveVerifier(*m_pFileWatcher, Platform::getClock()));
+	m_pVerifier->setTimeout(timeout * 1000);
+	m_pVerifier->setFiles(m_cfg.connection.getArguments());
+	if (m_pVerifier->isActive())
+		m_scheduler.setVerifier(m_pVerifier.get());
+	setUpBackups();
+}
+
+
+
+// Backups go with save checks, which tell when the documents have been
+// written. The worker is kept across changes to the settings, because
+// stopping it waits for the backup under way.
+void Application::setUpBackups()
+{
+	if (!m_cfg.settings.isBackupOn() || !m_pVerifier || !m_pVerifier->isActive())
+	{
+		m_pBackupWorker.reset();
+		return;
+	}
+	if (m_pBackupWorker)
+	{
+		m_pBackupWorker->setPolicy(m_cfg.settings.getRetentionPolicy());
+		return;
+	}
+	const wstring dataDirectory = Platform::getDataDirectory();
+	if (dataDirectory.empty())
+		return;
+	m_pBackupWorker.reset(new BackupWorker(dataDirectory + L"\\Backups",
+		m_cfg.settings.getRetentionPolicy()));
+}
+
+
+
+// Only a window that would be saved is worth calibrating for.
+void Application::startCalibration()
+{
+	const WindowEnumerator& windows = Platform::getWindowEnumerator();
+	const HWND target = windows.getForegroundWindow();
+	if (!m_cfg.isEnabled || !m_cfg.windowMatch(target, windows))
+		return;
+	if (!m_pCalibrator)
+	{
+		m_pCalibrationWatcher = Platform::createFileWatcher();
+		m_pCalibrator.reset(new PacingCalibrator(Platform::getClock(), windows,
+			Platform::getInputSink(), *m_pCalibrationWatcher));
+	}
+	m_pCalibrator->start(target, m_cfg.settings.getSaveMacro(),
+		m_cfg.connection.getArguments());
+}
+
+
+
+void Application::stepCalibration()
+{
+	if (m_pCalibrator->step() != PacingCalibrator::PC_DONE)
+		return;
+	try {
+		m_cfg.learnPacing(DEFAULT_REGISTRY_KEY, m_pCalibrator->getProfile());
+	}
+	catch (AutoSaveException& exc) {
+		exc.showMessageBox(0, L"Couldn't save the calibrated pacing.");
+	}
 }
 
 
@@ -485,6 +1009,9 @@ void Application::showOptionsWindow(OptionsWindow::PageNumber pageNumber,
 	if (!m_cfg.connection.isConnected())
 	{
 		m_sender.stop();
+		initOle();
+		registerStartingShortcut();
+		flushSettings();
 		int optionsResult = OptionsWindow::show(0, &m_cfg, pageNumber);
 		if (optionsResult == OptionsWindow::Result::PSERROR)
 		{
@@ -10,12 +10,20 @@
 #include "ShortcutsDisconnector.h"
 #include "NotifyIcon.h"
 #include "PeriodicSender.h"
+#include "Scheduler.h"
+#include "ControlService.h"
+#include "PacingCalibrator.h"
+#include "EventLog.h"
+#include "WriteBehindStore.h"
+#include "BackupWorker.h"
+#include "ClickGesture.h"
 #include "BaseWindow.h"
 #include "..\AutoSave\\Resource.h"
+#include <thread>
 
 using std::wstring;
 
-class Application : public BaseWindow
+class Application : public BaseWindow, private SchedulerListener
 {
 public:
 	Application(LPCTSTR pCmdLine);
@@ -25,7 +33,8 @@ public:
 	void registerWindowClass();
 	static const LPTSTR windowClassName;
 
-	static void mainLoop();
+	// Returns the exit code.
+	int mainLoop();
 
 protected:
 	// Implement purely virtual inherited member function.
@@ -33,15 +42,10 @@ protected:
 
 	// Event handlers
 	void OnNotifyIcon(WORD msg, WORD iconId, int x, int y);
-	static DWORD CALLBACK onNotifyLClickThread(LPVOID lParam);
-	struct NOTIFYTHREADARGUMENTS {
-		Application* pThis;
-		bool* pIsWaitingForSecondClick;
-		WORD iconId;
-		int x;
-		int y;
-	};
-	enum {WM_LBUTTONCLICKEDONCE = WM_USER + 0x000A};
+	void onClickGesture(ClickGesture::Gesture gesture, WORD iconId);
+	void onClickTimer();
+	// Posted by the control server's thread; wParam is the Command.
+	enum {WM_CONTROLCOMMAND = WM_USER + 0x000B};
 
 	void OnCreate();
 	void OnTimer();
@@ -50,18 +54,42 @@ protected:
 	void onNotifyIconLClick(WORD iconId, int x, int y);
 	void onNotifyIconLDblClk(WORD iconId, int x, int y);
 	void onNotifyIconRClick(WORD iconId, int x, int y);
+	void onNotifyIconLongPress(WORD iconId, int x, int y);
+	void onNotifyIconMClick(WORD iconId, int x, int y);
 	void onNotifyBubbleClicked(int notifId);
 	
 	void onShortcutMenuClicked(int menuId);
+	void onControlCommand(ControlService::Command command);
 
 	void onSenderDelayAtZero();
 	void onSenderAtFive(UINT_PTR secondsLeft);
 	void onSenderAtLessThanFive(UINT_PTR secondsLeft);
 	void onSenderAtZero();
+	// From the ForegroundWatcher, and again while a key is held down.
+	void onForegroundChanged(HWND hwnd);
+
+	// Implement SchedulerListener.
+	void showIndicator(Indicator indicator);
+	void showFiveSecondsAlert();
+	void clearAlert();
+	void showSaveFailedAlert();
+	void onSaveConfirmed(const vector<wstring>& files);
 
 private:
+	void saveMetrics();
 	void initConfiguration();
+	void startEventLog();
+	void startControlServer();
+	void updateControlStatus();
+	int runControlClient();
+	static void printControlResponse(const string& response);
 	static wstring getStartingShortcutFileName();
+	void initOle();
+	void registerStartingShortcut();
+	void saveSettings();
+	void flushSettings();
+	HMENU getContextMenu();
+	void traceStartup(EventLog::StartupPhase phase);
 
 	// Lower-level stuff.
 	int trackShortcutMenu(int x, int y);
@@ -70,6 +98,15 @@ private:
 			OptionsWindow::PageNumber::TargetPage);
 	void switchToBeingEnabled();
 	void switchToBeingDisabled();
+	void saveNow();
+	void setClickTimer();
+	void setUpSaveVerification();
+	void setUpBackups();
+	void startCalibration();
+	void stepCalibration();
+	inline bool isCalibrating() const {
+		return m_pCalibrator && m_pCalibrator->isProbing();
+	}
 	void showOptionsWindow(OptionsWindow::PageNumber pageNumber,
 		bool* pShallSave, bool* pShallExit);
 	void shutdown();
@@ -78,7 +115,38 @@ private:
 	Configuration m_cfg;
 	NotifyIcon m_icon;
 	PeriodicSender m_sender;
-	HMENU m_hContextMenu;
-
+	Scheduler m_scheduler;
+	unique_ptr<RotatingFileSink> m_pEventSink;
+	EventLog m_eventLog;
+	unique_ptr<FileWatcher> m_pFileWatcher;
+	unique_ptr<SaveVerifier> m_pVerifier;
+	unique_ptr<BackupWorker> m_pBackupWorker; // Kept while backups are on.
+	unique_ptr<ForegroundWatcher> m_pForegroundWatcher;
+	// Made on the first "calibrate", with a watcher of its own.
+	unique_ptr<FileWatcher> m_pCalibrationWatcher;
+	unique_ptr<PacingCalibrator> m_pCalibrator;
+	HMENU m_hContextMenu; // Loaded on first use.
+	bool m_isOleInitialized;
+	wstring m_startingShortcut; // Until registered.
+	std::thread m_compactionThread; // Of the Connected Shortcuts list.
+	ULONGLONG m_startTime;
+	ClickGesture m_clicks;
+	WORD m_clickedIconId;
+	unique_ptr<ControlService> m_pControlService;
+	unique_ptr<ControlServer> m_pControlServer;
+	unique_ptr<WriteBehindStore> m_pSettingsStore; // Until flushed.
+	bool m_isPausedRemotely;
+	int m_exitCode;
+
+	static const UINT_PTR clickTimerId = 623;
+	static const UINT longPressTime = 1000;
+	// Registering the starting shortcut waits until start-up is over.
+	static const UINT_PTR startingShortcutTimerId = 624;
+	static const UINT startingShortcutDelay = 30 * 1000;
+	// Saved settings are written after this, all at once.
+	static const UINT_PTR settingsTimerId = 625;
+	static const UINT settingsFlushDelay = 2 * 1000;
+	// One-shot, see Scheduler::onForegroundChanged.
+	static const UINT_PTR foregroundRetryTimerId = 626;
 };
 
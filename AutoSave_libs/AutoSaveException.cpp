@@ -13,12 +13,21 @@ AutoSaveException::AutoSaveException(DWORD errorCode)
 
 AutoSaveException::~AutoSaveException()
 {
+#ifdef _WIN32
 	LocalFree((HLOCAL) m_ansiBuffer);
 	LocalFree((HLOCAL) m_wideBuffer);
+#else
+	free(m_ansiBuffer);
+	free(m_wideBuffer);
+#endif
 }
 
 
 
+#ifdef _WIN32
+
+
+
 LPCSTR AutoSaveException::what()
 {
 	if (m_ansiBuffer == NULL)
@@ -108,12 +117,84 @@ wstring AutoSaveException::ansiToWide(LPCSTR ansi)
 	if (sizeNeeded == 0)
 		return L"Couldn't retrieve error message";
 
-	std::auto_ptr<wchar_t> wide(new wchar_t[sizeNeeded]);
+	std::vector<wchar_t> wide(sizeNeeded);
 	size_t result = MultiByteToWideChar(
-		CP_ACP, MB_USEGLYPHCHARS, ansi, -1, wide.get(), (int) sizeNeeded);
+		CP_ACP, MB_USEGLYPHCHARS, ansi, -1, wide.data(), (int) sizeNeeded);
 	if (result == 0)
 		return L"Couldn't retrieve error message";
 
-	return wide.get();
+	return wide.data();
 }
 
+
+
+#else
+// Without FormatMessage, errors in the Win32 facility are taken to be
+// errno values, since that's what GetLastError returns there.
+
+LPCSTR AutoSaveException::what()
+{
+	if (m_ansiBuffer == NULL)
+	{
+		char buffer[64];
+		if (HRESULT_FACILITY(m_hResult) == FACILITY_WIN32 || m_hResult == 0)
+		{
+			snprintf(buffer, sizeof(buffer), "%s\r\n",
+				strerror((int) errorCode()));
+		}
+		else {
+			snprintf(buffer, sizeof(buffer),
+				"Unknown exception (HRESULT value 0x%08X)\r\n",
+				(unsigned) m_hResult);
+		}
+		m_ansiBuffer = strdup(buffer);
+	}
+	return m_ansiBuffer;
+}
+
+
+
+LPCWSTR AutoSaveException::wcwhat()
+{
+	if (m_wideBuffer == NULL)
+		m_wideBuffer = wcsdup(ansiToWide(what()).c_str());
+	return m_wideBuffer;
+}
+
+
+
+void AutoSaveException::showMessageBox(HWND hwnd, wstring text)
+{
+	text.append(L"\nThe reason was a ");
+	text.append(exceptionType());
+	text.append(L". This is the error message returned by the system:\n");
+	text.append(wcwhat());
+	std::wcerr << APP_NAME << L": " << text << std::endl;
+}
+
+
+
+void AutoSaveException::showMessageBox(HWND hwnd, wstring text, std::exception& exc)
+{
+	text.append(L"\nThe reason was an unspecified exception. "
+		L"This is the error message returned by the system:\n");
+	text.append(ansiToWide(exc.what()));
+	std::wcerr << APP_NAME << L": " << text << std::endl;
+}
+
+
+
+wstring AutoSaveException::ansiToWide(LPCSTR ansi)
+{
+	if (ansi == NULL || *ansi == '\0')
+		return L"No error message specified";
+
+	size_t sizeNeeded = mbstowcs(NULL, ansi, 0);
+	if (sizeNeeded == (size_t) -1)
+		return L"Couldn't retrieve error message";
+
+	wstring wide(sizeNeeded, L'\0');
+	mbstowcs(&wide[0], ansi, sizeNeeded);
+	return wide;
+}
+#endif
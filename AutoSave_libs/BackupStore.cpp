@@ -0,0 +1,606 @@
+#include "stdafx.h"
+#include "BackupStore.h"
+#include "ControlService.h"
+#include "Platform.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+	const char manifestHeader[] = "AutoSave backup 1";
+	const wchar_t versionExtension[] = L".version";
+	const size_t documentKeySize = 8; // Bytes of the path's hash.
+	const ULONGLONG secondsPerDay = 24 * 60 * 60;
+
+	ErrorCode lastError()
+	{
+		DWORD errorCode = GetLastError();
+		return ErrorCode::fromWin32(errorCode != 0 ? errorCode : (DWORD) E_FAIL);
+	}
+
+	// Only the file names the store makes up itself, which are ASCII.
+	wstring widen(const string& ascii) { return wstring(ascii.begin(), ascii.end()); }
+	string narrow(const wstring& ascii) { return string(ascii.begin(), ascii.end()); }
+
+	bool endsWith(const wstring& text, const wstring& suffix)
+	{
+		return text.size() >= suffix.size() &&
+			text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	// Directories and locks, which only the store deals with; files go
+	// through Platform.
+#ifdef _WIN32
+	const wchar_t separator = L'\\';
+
+	bool makeDirectory(const wstring& path)
+	{
+		return CreateDirectoryW(path.data(), NULL) ||
+			GetLastError() == ERROR_ALREADY_EXISTS;
+	}
+
+	void removeDirectory(const wstring& path) { RemoveDirectoryW(path.data()); }
+
+	vector<wstring> listDirectory(const wstring& path)
+	{
+		vector<wstring> names;
+		WIN32_FIND_DATAW data;
+		HANDLE hFind = FindFirstFileW((path + L"\\*").data(), &data);
+		if (hFind == INVALID_HANDLE_VALUE)
+			return names;
+		do {
+			const wstring name = data.cFileName;
+			if (name != L"." && name != L"..")
+				names.push_back(name);
+		} while (FindNextFileW(hFind, &data));
+		FindClose(hFind);
+		return names;
+	}
+
+	// Two processes may store the same chunk at once.
+	wstring getTempSuffix()
+	{
+		return L"." + std::to_wstring(GetCurrentProcessId()) + L".tmp";
+	}
+
+	// The system lets go of the lock if the process dies.
+	typedef HANDLE LockHandle;
+	const LockHandle noLock = INVALID_HANDLE_VALUE;
+
+	// Fails with ERROR_LOCK_VIOLATION if an exclusive lock would wait.
+	ErrorCode lockFile(const wstring& path, bool isExclusive, LockHandle* pHandle)
+	{
+		*pHandle = CreateFileW(path.data(), GENERIC_READ | GENERIC_WRITE,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL, NULL);
+		if (*pHandle == INVALID_HANDLE_VALUE)
+			return lastError();
+		OVERLAPPED overlapped = {};
+		const DWORD flags = isExclusive ?
+			LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY : 0;
+		if (LockFileEx(*pHandle, flags, 0, 1, 0, &overlapped))
+			return ErrorCode();
+		const ErrorCode error = lastError();
+		CloseHandle(*pHandle);
+		*pHandle = noLock;
+		return error;
+	}
+
+	void unlockFile(LockHandle hFile) { CloseHandle(hFile); }
+
+	// Windows doesn't care about case, and takes either slash.
+	wstring normalizePath(const wstring& path)
+	{
+		wstring normal = path;
+		for (wchar_t& c : normal)
+			c = (c == L'/') ? L'\\' : (wchar_t) towlower(c);
+		return normal;
+	}
+#else
+	const wchar_t separator = L'/';
+
+	bool makeDirectory(const wstring& path)
+	{
+		return mkdir(Platform::toNarrow(path).c_str(), 0777) == 0 || errno == EEXIST;
+	}
+
+	void removeDirectory(const wstring& path) { rmdir(Platform::toNarrow(path).c_str()); }
+
+	vector<wstring> listDirectory(const wstring& path)
+	{
+		vector<wstring> names;
+		DIR* pDir = opendir(Platform::toNarrow(path).c_str());
+		if (pDir == NULL)
+			return names;
+		while (const dirent* pEntry = readdir(pDir))
+		{
+			const string name = pEntry->d_name;
+			if (name != "." && name != "..")
+				names.push_back(Platform::toWide(name));
+		}
+		closedir(pDir);
+		return names;
+	}
+
+	wstring getTempSuffix()
+	{
+		return L"." + std::to_wstring(getpid()) + L".tmp";
+	}
+
+	typedef int LockHandle;
+	const LockHandle noLock = -1;
+
+	ErrorCode lockFile(const wstring& path, bool isExclusive, LockHandle* pHandle)
+	{
+		*pHandle = open(Platform::toNarrow(path).c_str(), O_RDWR | O_CREAT, 0666);
+		if (*pHandle < 0)
+			return lastError();
+		if (flock(*pHandle, isExclusive ? LOCK_EX | LOCK_NB : LOCK_SH) == 0)
+			return ErrorCode();
+		const ErrorCode error = (errno == EWOULDBLOCK) ?
+			ErrorCode::fromWin32(ERROR_LOCK_VIOLATION) : lastError();
+		close(*pHandle);
+		*pHandle = noLock;
+		return error;
+	}
+
+	void unlockFile(LockHandle fd) { close(fd); }
+
+	wstring normalizePath(const wstring& path) { return path; }
+#endif
+
+	wstring joinPath(const wstring& directory, const wstring& name)
+	{
+		return directory + separator + name;
+	}
+
+	// Makes the parents too.
+	bool makeDirectories(const wstring& path)
+	{
+		if (makeDirectory(path))
+			return true;
+		const size_t end = path.find_last_of(L"\\/");
+		if (end == wstring::npos || end == 0 || path[end - 1] == L':')
+			return false;
+		return makeDirectories(path.substr(0, end)) && makeDirectory(path);
+	}
+
+	bool readFile(const wstring& path, string* pContents)
+	{
+		FILE* pFile = Platform::openFile(path, L"rb");
+		if (pFile == NULL)
+			return false;
+		pContents->clear();
+		char buffer[64 * 1024];
+		size_t count;
+		while ((count = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+			pContents->append(buffer, count);
+		const bool isRead = !ferror(pFile);
+		fclose(pFile);
+		return isRead;
+	}
+
+	// Under another name first, so that nobody ever sees half of it.
+	ErrorCode writeFile(const wstring& path, const void* pData, size_t size)
+	{
+		const wstring tempPath = path + getTempSuffix();
+		FILE* pFile = Platform::openFile(tempPath, L"wb");
+		if (pFile == NULL)
+			return lastError();
+		bool isWritten = fwrite(pData, 1, size, pFile) == size;
+		isWritten = (fclose(pFile) == 0) && isWritten;
+		if (isWritten && Platform::renameFile(tempPath, path))
+			return ErrorCode();
+		ErrorCode error = lastError();
+		Platform::removeFile(tempPath);
+		return error;
+	}
+
+	// Shared while backing up, exclusive while pruning.
+	class StoreLock
+	{
+	public:
+		StoreLock(const wstring& root, bool isExclusive)
+			: m_handle(noLock)
+		{
+			m_error = lockFile(joinPath(root, L"lock"), isExclusive, &m_handle);
+		}
+		~StoreLock()
+		{
+			if (m_handle != noLock)
+				unlockFile(m_handle);
+		}
+
+		// Why the store isn't locked, if it isn't.
+		const ErrorCode& getError() const { return m_error; }
+
+	private:
+		StoreLock(const StoreLock&);
+		StoreLock& operator=(const StoreLock&);
+
+		LockHandle m_handle;
+		ErrorCode m_error;
+	};
+
+	wstring getVersionFileName(ULONGLONG id)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%010llu", (unsigned long long) id);
+		return widen(name) + versionExtension;
+	}
+}
+
+
+
+BackupStore::BackupStore(const wstring& root, const ContentChunker& chunker)
+	: m_root(root), m_chunker(chunker)
+{
+	while (m_root.size() > 1 && (m_root.back() == L'\\' || m_root.back() == L'/'))
+		m_root.pop_back();
+}
+
+
+
+Expected<BackupVersion> BackupStore::backUp(const wstring& path, ULONGLONG time,
+	bool* pIsNew)
+{
+	if (pIsNew != NULL)
+		*pIsNew = false;
+	if (!makeDirectories(m_root))
+		return lastError();
+	const StoreLock lock(m_root, false);
+	if (lock.getError().isError())
+		return lock.getError();
+	FILE* pFile = Platform::openFile(path, L"rb");
+	if (pFile == NULL)
+		return lastError();
+
+	vector<ChunkRef> chunks;
+	BackupVersion version = { 0, time, 0, "", 0, 0 };
+	// Each byte is hashed once, for its chunk; the version's digest is
+	// made from the chunks' digests.
+	Sha256 chunkDigests;
+	ErrorCode error;
+	// Room for a chunk of the largest size after any leftover.
+	vector<BYTE> buffer(2 * m_chunker.getMaxSize());
+	size_t start = 0, end = 0;
+	bool isAtEnd = false;
+	while (!error.isError())
+	{
+		if (!isAtEnd && end - start < m_chunker.getMaxSize())
+		{
+			memmove(&buffer[0], &buffer[start], end - start);
+			end -= start;
+			start = 0;
+			while (!isAtEnd && end < buffer.size())
+			{
+				const size_t count = fread(&buffer[end], 1, buffer.size() - end, pFile);
+				end += count;
+				if (count == 0)
+				{
+					if (ferror(pFile))
+						error = lastError();
+					isAtEnd = true;
+				}
+			}
+			if (error.isError())
+				break;
+		}
+		if (start == end)
+			break;
+
+		ChunkRef chunk;
+		chunk.size = m_chunker.findCut(&buffer[start], end - start);
+		bool isNew = false;
+		error = storeChunk(&buffer[start], chunk.size, &chunk.digest, &isNew);
+		chunkDigests.update(chunk.digest.bytes, Sha256::digestSize);
+		chunks.push_back(chunk);
+		version.size += chunk.size;
+		if (isNew)
+			version.newBytes += chunk.size;
+		start += chunk.size;
+	}
+	fclose(pFile);
+	if (error.isError())
+		return error;
+	version.digest = chunkDigests.finish().toHex();
+	version.chunkCount = chunks.size();
+
+	const wstring directory = getDocumentDirectory(path);
+	vector<BackupVersion> versions = readVersions(directory, NULL);
+	if (!versions.empty() && versions.back().digest == version.digest)
+		return versions.back();
+	version.id = versions.empty() ? 1 : versions.back().id + 1;
+
+	if (!makeDirectories(directory))
+		return lastError();
+	const wstring pathFile = joinPath(directory, L"path");
+	if (!Platform::fileExists(pathFile))
+	{
+		const string utf8 = ControlService::toUtf8(path);
+		error = writeFile(pathFile, utf8.data(), utf8.size());
+		if (error.isError())
+			return error;
+	}
+
+	std::ostringstream manifest;
+	manifest << manifestHeader << "\n"
+		<< "time " << version.time << "\n"
+		<< "size " << version.size << "\n"
+		<< "digest " << version.digest << "\n"
+		<< "new " << version.newBytes << "\n";
+	for (const ChunkRef& chunk : chunks)
+		manifest << "chunk " << chunk.digest.toHex() << " " << chunk.size << "\n";
+	const string text = manifest.str();
+	error = writeFile(joinPath(directory, getVersionFileName(version.id)),
+		text.data(), text.size());
+	if (error.isError())
+		return error;
+	if (pIsNew != NULL)
+		*pIsNew = true;
+	return version;
+}
+
+
+
+vector<BackupVersion> BackupStore::listVersions(const wstring& path) const
+{
+	return readVersions(getDocumentDirectory(path), NULL);
+}
+
+
+
+ErrorCode BackupStore::restore(const wstring& path, ULONGLONG id,
+	const wstring& destination) const
+{
+	vector<vector<ChunkRef>> chunkLists;
+	const vector<BackupVersion> versions =
+		readVersions(getDocumentDirectory(path), &chunkLists);
+	size_t index = 0;
+	while (index < versions.size() && versions[index].id != id)
+		++index;
+	if (index == versions.size())
+		return ErrorCode::fromWin32(ERROR_FILE_NOT_FOUND);
+
+	const wstring tempPath = destination + getTempSuffix();
+	FILE* pFile = Platform::openFile(tempPath, L"wb");
+	if (pFile == NULL)
+		return lastError();
+
+	ErrorCode error;
+	string contents;
+	for (const ChunkRef& chunk : chunkLists[index])
+	{
+		if (!readFile(getChunkPath(chunk.digest), &contents) ||
+			contents.size() != chunk.size ||
+			Sha256::hash(contents.data(), contents.size()) != chunk.digest)
+		{
+			error = ErrorCode::fromWin32(ERROR_FILE_CORRUPT);
+			break;
+		}
+		if (fwrite(contents.data(), 1, contents.size(), pFile) != contents.size())
+		{
+			error = lastError();
+			break;
+		}
+	}
+	if (fclose(pFile) != 0 && !error.isError())
+		error = lastError();
+	if (!error.isError() && !Platform::renameFile(tempPath, destination))
+		error = lastError();
+	if (error.isError())
+		Platform::removeFile(tempPath);
+	return error;
+}
+
+
+
+vector<string> BackupStore::listDocuments() const
+{
+	vector<string> documents;
+	const wstring docs = joinPath(m_root, L"docs");
+	for (const wstring& key : listDirectory(docs))
+	{
+		const wstring directory = joinPath(docs, key);
+		const vector<wstring> names = listDirectory(directory);
+		const bool hasVersions = std::any_of(names.begin(), names.end(),
+			[](const wstring& name) { return endsWith(name, versionExtension); });
+		string path;
+		if (hasVersions && readFile(joinPath(directory, L"path"), &path))
+			documents.push_back(path);
+	}
+	std::sort(documents.begin(), documents.end());
+	return documents;
+}
+
+
+
+// Marks the chunks of the versions that stay, then sweeps the rest.
+Expected<BackupStore::PruneResult> BackupStore::prune(
+	const RetentionPolicy& policy, ULONGLONG now)
+{
+	PruneResult result = { 0, 0 };
+	if (listDirectory(m_root).empty())
+		return result;
+	const StoreLock lock(m_root, true);
+	if (lock.getError().isError())
+		return lock.getError();
+	ErrorCode error;
+	std::set<string> usedChunks;
+	bool areChunksKnown = true;
+	const ULONGLONG today = now / secondsPerDay;
+
+	const wstring docs = joinPath(m_root, L"docs");
+	for (const wstring& key : listDirectory(docs))
+	{
+		const wstring directory = joinPath(docs, key);
+		vector<vector<ChunkRef>> chunkLists;
+		bool isComplete = true;
+		const vector<BackupVersion> versions =
+			readVersions(directory, &chunkLists, &isComplete);
+		areChunksKnown = areChunksKnown && isComplete;
+
+		const size_t count = versions.size();
+		vector<bool> isKept(count, false);
+		std::set<ULONGLONG> keptDays;
+		for (size_t i = count; i > 0; --i)
+		{
+			const ULONGLONG day = versions[i - 1].time / secondsPerDay;
+			if (count - i < __max(policy.keepLast, (UINT) 1))
+				isKept[i - 1] = true;
+			if (day + policy.keepDaily > today && keptDays.insert(day).second)
+				isKept[i - 1] = true;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (!isKept[i])
+			{
+				if (Platform::removeFile(joinPath(directory, getVersionFileName(versions[i].id))))
+				{
+					++result.versionsRemoved;
+					continue;
+				}
+				if (!error.isError())
+					error = lastError();
+			}
+			for (const ChunkRef& chunk : chunkLists[i])
+				usedChunks.insert(chunk.digest.toHex());
+		}
+	}
+
+	if (!areChunksKnown)
+		return ErrorCode::fromWin32(ERROR_FILE_CORRUPT);
+	const wstring chunks = joinPath(m_root, L"chunks");
+	for (const wstring& prefix : listDirectory(chunks))
+	{
+		const wstring directory = joinPath(chunks, prefix);
+		for (const wstring& name : listDirectory(directory))
+		{
+			// Somebody else's chunk on its way in.
+			if (endsWith(name, L".tmp"))
+				continue;
+			if (usedChunks.count(narrow(name)) == 0 &&
+				Platform::removeFile(joinPath(directory, name)))
+			{
+				++result.chunksRemoved;
+			}
+		}
+		removeDirectory(directory); // Only goes if empty.
+	}
+	if (error.isError())
+		return error;
+	return result;
+}
+
+
+
+// A hash of the path, so that any path makes a valid directory name.
+wstring BackupStore::getDocumentDirectory(const wstring& path) const
+{
+	const string utf8 = ControlService::toUtf8(normalizePath(path));
+	const string key = Sha256::hash(utf8.data(), utf8.size()).toHex();
+	return joinPath(joinPath(m_root, L"docs"), widen(key.substr(0, 2 * documentKeySize)));
+}
+
+
+
+wstring BackupStore::getChunkPath(const Sha256::Digest& digest) const
+{
+	const string hex = digest.toHex();
+	return joinPath(joinPath(joinPath(m_root, L"chunks"), widen(hex.substr(0, 2))),
+		widen(hex));
+}
+
+
+
+ErrorCode BackupStore::storeChunk(const BYTE* pData, size_t size,
+	Sha256::Digest* pDigest, bool* pIsNew)
+{
+	*pDigest = Sha256::hash(pData, size);
+	const wstring path = getChunkPath(*pDigest);
+	*pIsNew = !Platform::fileExists(path);
+	if (!*pIsNew)
+		return ErrorCode();
+	if (!makeDirectories(path.substr(0, path.find_last_of(separator))))
+		return lastError();
+	return writeFile(path, pData, size);
+}
+
+
+
+vector<BackupVersion> BackupStore::readVersions(const wstring& directory,
+	vector<vector<ChunkRef>>* pChunkLists, bool* pIsComplete) const
+{
+	vector<wstring> names = listDirectory(directory);
+	std::sort(names.begin(), names.end()); // The ids are zero-padded.
+
+	vector<BackupVersion> versions;
+	if (pChunkLists != NULL)
+		pChunkLists->clear();
+	if (pIsComplete != NULL)
+		*pIsComplete = true;
+	string text;
+	for (const wstring& name : names)
+	{
+		if (!endsWith(name, versionExtension))
+			continue;
+		if (!readFile(joinPath(directory, name), &text))
+		{
+			if (pIsComplete != NULL)
+				*pIsComplete = false;
+			continue;
+		}
+		BackupVersion version = { 0, 0, 0, "", 0, 0 };
+		version.id = std::strtoull(narrow(name).c_str(), NULL, 10);
+		vector<ChunkRef> chunks;
+		std::istringstream lines(text);
+		string line, keyword;
+		bool isValid = std::getline(lines, line) && line == manifestHeader;
+		while (isValid && std::getline(lines, line))
+		{
+			std::istringstream fields(line);
+			fields >> keyword;
+			if (keyword == "time")
+				fields >> version.time;
+			else if (keyword == "size")
+				fields >> version.size;
+			else if (keyword == "digest")
+				fields >> version.digest;
+			else if (keyword == "new")
+				fields >> version.newBytes;
+			else if (keyword == "chunk")
+			{
+				string hex;
+				ChunkRef chunk;
+				fields >> hex >> chunk.size;
+				isValid = Sha256::Digest::fromHex(hex, &chunk.digest);
+				chunks.push_back(chunk);
+			}
+			isValid = isValid && !fields.fail();
+		}
+		if (!isValid || version.id == 0 || version.digest.empty())
+		{
+			if (pIsComplete != NULL)
+				*pIsComplete = false;
+			continue;
+		}
+		version.chunkCount = chunks.size();
+		versions.push_back(version);
+		if (pChunkLists != NULL)
+			pChunkLists->push_back(chunks);
+	}
+	return versions;
+}
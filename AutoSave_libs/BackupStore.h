@@ -0,0 +1,133 @@
+// BackupStore.h : Keeps versions of saved documents, so that a bad save,
+// or a save over the wrong thing, doesn't take the earlier work with it.
+// Each version is cut into chunks where the content says so (see
+// ContentChunker), and each chunk is stored once, in a file named after
+// its SHA-256; a version is a list of chunks. Versions of a large
+// document that was only edited in places therefore share most of their
+// chunks, and only the new ones take up room.
+// Everything lives in one directory:
+//   chunks\ab\abcdef...   The chunks, by hash, in 256 subdirectories.
+//   docs\<key>\path       The document's path, as UTF-8, where <key> is
+//                         made from the path.
+//   docs\<key>\0000000001.version
+//                         The versions, as text: when and how large,
+//                         a digest of the document, and the chunks in
+//                         order.
+//   lock                  Locked while backing up or pruning.
+// Files are written under another name and renamed into place, so a
+// crash leaves a version either complete or missing, never half there.
+// Several processes may back up into the same store at once, but not
+// while it is pruned: a chunk that a backup found already stored isn't
+// listed by its version until the backup is done. Backing up waits for
+// pruning; pruning gives up while anybody is backing up.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "ContentChunker.h"
+#include "Sha256.h"
+#include "Expected.h"
+
+using std::string;
+using std::wstring;
+using std::vector;
+
+// Which versions BackupStore::prune keeps.
+struct RetentionPolicy
+{
+	// The newest versions of each document. Zero turns backups off.
+	UINT keepLast;
+	// Also the newest version of each of this many days, today included,
+	// as UTC counts days.
+	UINT keepDaily;
+
+	inline bool operator==(const RetentionPolicy& other) const {
+		return keepLast == other.keepLast && keepDaily == other.keepDaily;
+	}
+	inline bool operator!=(const RetentionPolicy& other) const {
+		return !(*this == other);
+	}
+};
+
+
+
+struct BackupVersion
+{
+	ULONGLONG id;         // Counts up from 1 for each document.
+	ULONGLONG time;       // Seconds since 1970, UTC.
+	ULONGLONG size;       // Of the document.
+	// As hex: the SHA-256 of the chunks' SHA-256 digests, in order, so
+	// that a document is only hashed once. Equal for equal documents.
+	string digest;
+	size_t chunkCount;
+	ULONGLONG newBytes;   // In chunks that the store didn't have before.
+};
+
+
+
+class BackupStore
+{
+public:
+	struct PruneResult
+	{
+		size_t versionsRemoved;
+		size_t chunksRemoved;
+	};
+
+	// The directory is made on the first backup.
+	explicit BackupStore(const wstring& root,
+		const ContentChunker& chunker = ContentChunker());
+
+	inline const wstring& getRoot() const { return m_root; }
+
+	// Adds a version of the file, taken at time, unless it is the same as
+	// the newest one; that is returned then, and *pIsNew is false. Returns
+	// the error from the file system if the file can't be read or the
+	// store written.
+	Expected<BackupVersion> backUp(const wstring& path, ULONGLONG time,
+		bool* pIsNew = NULL);
+	// Oldest first. Empty if the document has never been backed up.
+	vector<BackupVersion> listVersions(const wstring& path) const;
+	// Writes a version to destination, which is only replaced once all of
+	// it has been read back and checked. Returns ERROR_FILE_NOT_FOUND if
+	// there is no such version, or ERROR_FILE_CORRUPT if a chunk is
+	// missing or damaged.
+	ErrorCode restore(const wstring& path, ULONGLONG id,
+		const wstring& destination) const;
+
+	// The paths of the documents that have versions, as UTF-8.
+	vector<string> listDocuments() const;
+
+	// Removes the versions of every document that the policy doesn't
+	// keep, and then the chunks that no version uses any more. The newest
+	// version of a document is always kept. now is like BackupVersion::time.
+	// Returns ERROR_LOCK_VIOLATION, having done nothing, while another
+	// BackupStore backs up into the same directory. Returns
+	// ERROR_FILE_CORRUPT if a version can't be read; since its chunks
+	// aren't known, no chunks are removed then.
+	Expected<PruneResult> prune(const RetentionPolicy& policy, ULONGLONG now);
+
+private:
+	BackupStore(const BackupStore&);
+	BackupStore& operator=(const BackupStore&);
+
+	struct ChunkRef
+	{
+		Sha256::Digest digest;
+		size_t size;
+	};
+
+	wstring getDocumentDirectory(const wstring& path) const;
+	wstring getChunkPath(const Sha256::Digest& digest) const;
+	// Sets *pIsNew if it wasn't stored yet.
+	ErrorCode storeChunk(const BYTE* pData, size_t size, Sha256::Digest* pDigest,
+		bool* pIsNew);
+	// Oldest first, skipping what can't be read; *pIsComplete is false
+	// if anything was skipped.
+	vector<BackupVersion> readVersions(const wstring& directory,
+		vector<vector<ChunkRef>>* pChunkLists, bool* pIsComplete = NULL) const;
+
+	wstring m_root;
+	ContentChunker m_chunker;
+};
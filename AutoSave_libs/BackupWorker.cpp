@@ -0,0 +1,122 @@
+#include "stdafx.h"
+#include "BackupWorker.h"
+
+#include <algorithm>
+#include <ctime>
+
+
+BackupWorker::BackupWorker(const wstring& root, const RetentionPolicy& policy,
+	const ContentChunker& chunker)
+	: m_store(root, chunker), m_isBusy(false), m_isStopping(false),
+	  m_policy(policy), m_lastPruneTime(0)
+{
+	Stats stats = { 0, 0, 0, 0, ErrorCode() };
+	m_stats = stats;
+	m_thread = std::thread(&BackupWorker::run, this);
+}
+
+
+
+BackupWorker::~BackupWorker()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_isStopping = true;
+		m_pending.clear();
+	}
+	m_wakeUp.notify_one();
+	m_thread.join();
+}
+
+
+
+void BackupWorker::setPolicy(const RetentionPolicy& policy)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_policy = policy;
+}
+
+
+
+void BackupWorker::request(const vector<wstring>& files)
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		for (const wstring& path : files)
+		{
+			if (std::find(m_pending.begin(), m_pending.end(), path) == m_pending.end())
+				m_pending.push_back(path);
+		}
+	}
+	m_wakeUp.notify_one();
+}
+
+
+
+void BackupWorker::waitUntilIdle()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_idle.wait(lock, [this] { return m_pending.empty() && !m_isBusy; });
+}
+
+
+
+BackupWorker::Stats BackupWorker::getStats() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_stats;
+}
+
+
+
+void BackupWorker::run()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	while (!m_isStopping)
+	{
+		if (m_pending.empty())
+		{
+			m_wakeUp.wait(lock);
+			continue;
+		}
+		const wstring path = m_pending.front();
+		m_pending.erase(m_pending.begin());
+		m_isBusy = true;
+		lock.unlock();
+
+		const ULONGLONG now = (ULONGLONG) time(NULL);
+		bool isNew = false;
+		Expected<BackupVersion> version = m_store.backUp(path, now, &isNew);
+
+		lock.lock();
+		if (!version)
+		{
+			++m_stats.failures;
+			m_stats.lastError = version.error();
+		}
+		else if (isNew) {
+			++m_stats.backups;
+			m_stats.storedBytes += version.value().newBytes;
+		}
+		else {
+			++m_stats.unchanged;
+		}
+
+		if (m_pending.empty() && now - m_lastPruneTime >= prunePeriod)
+		{
+			const RetentionPolicy policy = m_policy;
+			m_lastPruneTime = now;
+			lock.unlock();
+			Expected<BackupStore::PruneResult> result = m_store.prune(policy, now);
+			lock.lock();
+			// Another AutoSave is backing up; try again after the next backup.
+			if (!result && result.error().errorCode() == ERROR_LOCK_VIOLATION)
+				m_lastPruneTime = 0;
+		}
+		m_isBusy = false;
+		if (m_pending.empty())
+			m_idle.notify_all();
+	}
+	m_isBusy = false;
+	m_idle.notify_all();
+}
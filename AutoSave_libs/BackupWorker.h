@@ -0,0 +1,68 @@
+// BackupWorker.h : Backs up documents into a BackupStore on a thread of
+// its own, so that reading a large document doesn't hold up saving.
+// Files asked for while it is busy wait their turn; a file that is
+// already waiting isn't backed up twice. Once nothing is left to do, it
+// prunes the store with the retention policy, at most once an hour;
+// if another process was backing up into it, after the next backup.
+// Stopping finishes the backup under way and drops the rest, which is
+// fine, since the documents themselves are safe on disk.
+// Never throws exceptions (except std::bad_alloc, and std::system_error
+// when starting the thread).
+
+#pragma once
+
+#include "stdafx.h"
+#include "BackupStore.h"
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+class BackupWorker
+{
+public:
+	struct Stats
+	{
+		UINT backups;     // New versions.
+		UINT unchanged;   // Files that were the same as their newest version.
+		UINT failures;
+		ULONGLONG storedBytes;
+		ErrorCode lastError;
+	};
+
+	// Starts the thread.
+	BackupWorker(const wstring& root, const RetentionPolicy& policy,
+		const ContentChunker& chunker = ContentChunker());
+	~BackupWorker();
+
+	inline const wstring& getRoot() const { return m_store.getRoot(); }
+	void setPolicy(const RetentionPolicy& policy);
+
+	void request(const vector<wstring>& files);
+	// Blocks until nothing is waiting or under way.
+	void waitUntilIdle();
+	Stats getStats() const;
+
+private:
+	BackupWorker(const BackupWorker&);
+	BackupWorker& operator=(const BackupWorker&);
+
+	void run();
+
+	static const ULONGLONG prunePeriod = 60 * 60; // In seconds.
+
+	BackupStore m_store; // Only used by the thread.
+
+	mutable std::mutex m_lock;
+	std::condition_variable m_wakeUp;
+	std::condition_variable m_idle;
+	// Guarded by m_lock.
+	vector<wstring> m_pending;
+	bool m_isBusy;
+	bool m_isStopping;
+	RetentionPolicy m_policy;
+	ULONGLONG m_lastPruneTime;
+	Stats m_stats;
+
+	std::thread m_thread;
+};
@@ -0,0 +1,286 @@
+#include "stdafx.h"
+#include "BoundedRegex.h"
+
+
+
+bool BoundedRegex::compile(const wstring& pattern, bool ignoreCase)
+{
+	unique_ptr<RegexNode> root = RegexParser::parse(pattern);
+	if (!root)
+	{
+		clear();
+		return false;
+	}
+	return compile(*root, ignoreCase);
+}
+
+
+
+bool BoundedRegex::compile(const RegexNode& root, bool ignoreCase)
+{
+	clear();
+	m_ignoreCase = ignoreCase;
+	if (!emit(root) || m_program.size() >= maxProgramSize)
+	{
+		clear();
+		return false;
+	}
+	append(OP_MATCH);
+	return true;
+}
+
+
+
+bool BoundedRegex::emit(const RegexNode& node)
+{
+	if (m_program.size() >= maxProgramSize)
+		return false;
+
+	switch (node.kind)
+	{
+	case RegexNode::EMPTY:
+		return true;
+
+	case RegexNode::CHAR:
+		append(OP_CHAR, m_ignoreCase ? (wchar_t) towlower(node.ch) : node.ch);
+		return true;
+
+	case RegexNode::ANY:
+		append(OP_ANY);
+		return true;
+
+	case RegexNode::CLASS:
+		m_classes.push_back(node.charClass);
+		append(OP_CLASS, 0, m_classes.size() - 1);
+		return true;
+
+	case RegexNode::CONCAT:
+	case RegexNode::GROUP:
+		for (const auto& child : node.children)
+		{
+			if (!emit(*child))
+				return false;
+		}
+		return true;
+
+	case RegexNode::ALTERNATE: {
+		// split L1, next; L1: child; jump end; next: split L2, ... end:
+		vector<size_t> jumpsToEnd;
+		for (size_t i = 0; i < node.children.size(); ++i)
+		{
+			const bool isLast = i + 1 == node.children.size();
+			size_t split = 0;
+			if (!isLast)
+				split = append(OP_SPLIT, 0, m_program.size() + 1);
+			if (!emit(*node.children[i]))
+				return false;
+			if (!isLast)
+			{
+				jumpsToEnd.push_back(append(OP_JUMP));
+				m_program[split].y = m_program.size();
+			}
+		}
+		for (size_t jump : jumpsToEnd)
+		{
+			m_program[jump].x = m_program.size();
+		}
+		return true;
+	}
+
+	case RegexNode::REPEAT: {
+		const RegexNode& body = *node.children[0];
+		for (int i = 0; i < node.min; ++i)
+		{
+			if (!emit(body) || m_program.size() >= maxProgramSize)
+				return false;
+		}
+
+		if (node.max == RegexNode::UNBOUNDED)
+		{
+			// loop: split body, end; body; jump loop; end:
+			const size_t loop = append(OP_SPLIT, 0, m_program.size() + 1);
+			if (!emit(body))
+				return false;
+			append(OP_JUMP, 0, loop);
+			m_program[loop].y = m_program.size();
+		}
+		else {
+			// split body, end; body; split body, end; body; ... end:
+			vector<size_t> splits;
+			for (int i = node.min; i < node.max; ++i)
+			{
+				splits.push_back(append(OP_SPLIT, 0, m_program.size() + 1));
+				if (!emit(body) || m_program.size() >= maxProgramSize)
+					return false;
+			}
+			for (size_t split : splits)
+			{
+				m_program[split].y = m_program.size();
+			}
+		}
+		return true;
+	}
+
+	case RegexNode::LINE_BEGIN:
+		append(OP_LINE_BEGIN);
+		return true;
+	case RegexNode::LINE_END:
+		append(OP_LINE_END);
+		return true;
+	case RegexNode::WORD_BOUNDARY:
+		append(OP_WORD_BOUNDARY);
+		return true;
+	case RegexNode::NOT_WORD_BOUNDARY:
+		append(OP_NOT_WORD_BOUNDARY);
+		return true;
+
+	default:
+		// Backreferences and lookaheads need backtracking.
+		return false;
+	}
+}
+
+
+
+size_t BoundedRegex::append(Opcode op, wchar_t ch, size_t x, size_t y)
+{
+	m_program.push_back({ op, ch, x, y });
+	return m_program.size() - 1;
+}
+
+
+
+// Each thread of the VM is a pair of program counter and a flag telling
+// whether it has consumed any input yet, encoded as pc * 2 + flag.
+// The flag implements match_not_null.
+BoundedRegex::SearchResult BoundedRegex::search(
+	const wstring& text, unsigned long maxSteps) const
+{
+	m_lastStepCount = 0;
+	if (isEmpty())
+		return NO_MATCH;
+
+	const size_t stateCount = m_program.size() * 2;
+	vector<size_t> current, next, stack;
+	current.reserve(stateCount);
+	next.reserve(stateCount);
+	// visitedAt[s] == pos + 1 if state s was added at position pos.
+	vector<size_t> visitedAt(stateCount, 0);
+	unsigned long steps = 0;
+
+	// Follows jumps and assertions from state, adding all states
+	// that wait for input to list.
+	auto addClosure = [&](vector<size_t>& list, size_t state, size_t pos)
+		-> SearchResult
+	{
+		stack.push_back(state);
+		while (!stack.empty())
+		{
+			const size_t s = stack.back();
+			stack.pop_back();
+			if (visitedAt[s] == pos + 1)
+				continue;
+			visitedAt[s] = pos + 1;
+			if (++steps > maxSteps)
+				return BUDGET_EXCEEDED;
+
+			const size_t pc = s / 2;
+			const size_t consumed = s % 2;
+			const Instruction& inst = m_program[pc];
+			switch (inst.op)
+			{
+			case OP_JUMP:
+				stack.push_back(inst.x * 2 + consumed);
+				break;
+			case OP_SPLIT:
+				stack.push_back(inst.y * 2 + consumed);
+				stack.push_back(inst.x * 2 + consumed);
+				break;
+			case OP_MATCH:
+				if (consumed)
+					return MATCH;
+				break;
+			case OP_LINE_BEGIN:
+			case OP_LINE_END:
+			case OP_WORD_BOUNDARY:
+			case OP_NOT_WORD_BOUNDARY:
+				if (assertionHolds(inst, text, pos))
+					stack.push_back((pc + 1) * 2 + consumed);
+				break;
+			default:
+				list.push_back(s);
+				break;
+			}
+		}
+		return NO_MATCH;
+	};
+
+	SearchResult result = addClosure(current, 0, 0);
+	for (size_t pos = 0; pos < text.size() && result == NO_MATCH; ++pos)
+	{
+		const wchar_t c = text[pos];
+		for (size_t s : current)
+		{
+			if (++steps > maxSteps)
+			{
+				result = BUDGET_EXCEEDED;
+				break;
+			}
+			if (consumes(m_program[s / 2], c))
+			{
+				result = addClosure(next, (s / 2 + 1) * 2 + 1, pos + 1);
+				if (result != NO_MATCH)
+					break;
+			}
+		}
+		// Unanchored search: a new attempt starts at every position.
+		if (result == NO_MATCH)
+			result = addClosure(next, 0, pos + 1);
+
+		current.swap(next);
+		next.clear();
+		stack.clear();
+	}
+
+	m_lastStepCount = steps;
+	return result;
+}
+
+
+
+bool BoundedRegex::consumes(const Instruction& inst, wchar_t c) const
+{
+	switch (inst.op)
+	{
+	case OP_CHAR:
+		return (m_ignoreCase ? (wchar_t) towlower(c) : c) == inst.ch;
+	case OP_ANY:
+		return !RegexCharClass::isLineTerminator(c);
+	case OP_CLASS:
+		return m_classes[inst.x].matches(c, m_ignoreCase);
+	default:
+		return false;
+	}
+}
+
+
+
+bool BoundedRegex::assertionHolds(
+	const Instruction& inst, const wstring& text, size_t pos) const
+{
+	switch (inst.op)
+	{
+	case OP_LINE_BEGIN:
+		return pos == 0;
+	case OP_LINE_END:
+		return pos == text.size();
+	case OP_WORD_BOUNDARY:
+	case OP_NOT_WORD_BOUNDARY: {
+		const bool before = pos > 0 && RegexCharClass::isWordChar(text[pos - 1]);
+		const bool after = pos < text.size() && RegexCharClass::isWordChar(text[pos]);
+		return (before != after) == (inst.op == OP_WORD_BOUNDARY);
+	}
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,78 @@
+// BoundedRegex.h : A small regex engine for the patterns Matcher deals
+// with. It simulates all possible matches at once (a Pike VM), so its
+// running time is linear in the length of the searched text, and it
+// counts its steps so that the caller can enforce a budget.
+// Backreferences and lookaheads aren't supported; compile returns false
+// for patterns containing them.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "RegexParser.h"
+
+using std::wstring;
+using std::vector;
+
+class BoundedRegex
+{
+public:
+	enum SearchResult {
+		NO_MATCH,
+		MATCH,
+		BUDGET_EXCEEDED
+	};
+
+	BoundedRegex() : m_ignoreCase(false), m_lastStepCount(0) {}
+	~BoundedRegex() {}
+
+	// Returns false if the pattern can't be handled; the object is
+	// empty afterwards.
+	bool compile(const wstring& pattern, bool ignoreCase);
+	bool compile(const RegexNode& root, bool ignoreCase);
+	inline void clear() { m_program.clear(); m_classes.clear(); }
+	inline bool isEmpty() const { return m_program.empty(); }
+
+	// Looks for a non-empty match anywhere in text, like regex_search
+	// with match_not_null. Gives up after maxSteps steps.
+	SearchResult search(const wstring& text, unsigned long maxSteps) const;
+
+	// Number of steps the last call to search took.
+	inline unsigned long getLastStepCount() const { return m_lastStepCount; }
+
+	// Programs are expanded from counted repetitions, e.g. a{1000}.
+	// Patterns that would expand beyond this are not compiled.
+	static const size_t maxProgramSize = 20000;
+
+private:
+	enum Opcode {
+		OP_CHAR,
+		OP_ANY,
+		OP_CLASS,
+		OP_SPLIT,
+		OP_JUMP,
+		OP_LINE_BEGIN,
+		OP_LINE_END,
+		OP_WORD_BOUNDARY,
+		OP_NOT_WORD_BOUNDARY,
+		OP_MATCH
+	};
+
+	struct Instruction {
+		Opcode op;
+		wchar_t ch;
+		size_t x; // Jump target, class index.
+		size_t y; // Second jump target of OP_SPLIT.
+	};
+
+	bool emit(const RegexNode& node);
+	size_t append(Opcode op, wchar_t ch = 0, size_t x = 0, size_t y = 0);
+	bool consumes(const Instruction& inst, wchar_t c) const;
+	bool assertionHolds(const Instruction& inst, const wstring& text,
+		size_t pos) const;
+
+	vector<Instruction> m_program;
+	vector<RegexCharClass> m_classes;
+	bool m_ignoreCase;
+	mutable unsigned long m_lastStepCount;
+};
@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include "ClickGesture.h"
+
+
+ClickGesture::ClickGesture(const Clock& clock, UINT doubleClickTime,
+	UINT longPressTime)
+	: m_clock(clock), m_doubleClickTime(doubleClickTime),
+	  m_longPressTime(longPressTime), m_state(ST_IDLE), m_downTime(0),
+	  m_x(0), m_y(0)
+{
+}
+
+
+
+ClickGesture::Gesture ClickGesture::onButtonDown(Button button, int x, int y)
+{
+	if (button != BT_LEFT)
+		return GS_NONE; // The other buttons count when they're released.
+
+	if (m_state == ST_WAITING_FOR_SECOND)
+	{
+		m_state = ST_WAITING_FOR_RELEASE;
+		return GS_DOUBLE_CLICK;
+	}
+	// If a release went missing, this starts over.
+	m_state = ST_PRESSED;
+	m_downTime = m_clock.getTickCount();
+	m_x = x;
+	m_y = y;
+	return GS_NONE;
+}
+
+
+
+ClickGesture::Gesture ClickGesture::onButtonUp(Button button, int x, int y)
+{
+	if (button != BT_LEFT)
+	{
+		m_state = ST_IDLE; // Whatever the left button was up to.
+		m_x = x;
+		m_y = y;
+		return (button == BT_MIDDLE) ? GS_MIDDLE_CLICK : GS_RIGHT_CLICK;
+	}
+
+	switch (m_state)
+	{
+	case ST_PRESSED:
+		// Held past the double-click time, so no second click can come.
+		if (m_clock.getTickCount() >= m_downTime + m_doubleClickTime)
+		{
+			m_state = ST_IDLE;
+			return GS_CLICK;
+		}
+		m_state = ST_WAITING_FOR_SECOND;
+		return GS_NONE;
+	case ST_WAITING_FOR_RELEASE:
+		m_state = ST_IDLE;
+		return GS_NONE;
+	default:
+		return GS_NONE;
+	}
+}
+
+
+
+ClickGesture::Gesture ClickGesture::onDoubleClick(Button button, int x, int y)
+{
+	if (button != BT_LEFT)
+		return GS_NONE;
+	if (m_state == ST_IDLE)
+	{
+		// The first click went somewhere else.
+		m_x = x;
+		m_y = y;
+	}
+	m_state = ST_WAITING_FOR_RELEASE;
+	return GS_DOUBLE_CLICK;
+}
+
+
+
+// Timers are often late, and may also be early, so go by the clock.
+ClickGesture::Gesture ClickGesture::onTimer()
+{
+	const ULONGLONG deadline = getDeadline();
+	if (deadline == 0 || m_clock.getTickCount() < deadline)
+		return GS_NONE;
+
+	if (m_state == ST_PRESSED)
+	{
+		m_state = ST_WAITING_FOR_RELEASE;
+		return GS_LONG_PRESS;
+	}
+	m_state = ST_IDLE;
+	return GS_CLICK;
+}
+
+
+
+UINT ClickGesture::getTimeout() const
+{
+	const ULONGLONG deadline = getDeadline();
+	if (deadline == 0)
+		return 0;
+	const ULONGLONG now = m_clock.getTickCount();
+	return (deadline > now) ? (UINT) (deadline - now) : 1;
+}
+
+
+
+// Zero if there is nothing to wait for.
+ULONGLONG ClickGesture::getDeadline() const
+{
+	switch (m_state)
+	{
+	case ST_PRESSED:
+		return (m_longPressTime == 0) ? 0 : m_downTime + m_longPressTime;
+	case ST_WAITING_FOR_SECOND:
+		return m_downTime + m_doubleClickTime;
+	default:
+		return 0;
+	}
+}
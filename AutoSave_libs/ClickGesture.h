@@ -0,0 +1,72 @@
+// ClickGesture.h : Tells single clicks, double clicks, long presses and
+// clicks of the other buttons on the notification area icon apart.
+// A single click is only certain once the double-click time has passed
+// without a second one, and a long press once the button has been held
+// long enough; so after each button event, the caller sets a one-shot
+// timer for getTimeout() milliseconds and calls onTimer when it fires.
+// Every call says which gesture, if any, has just been recognized.
+// Doesn't know about timers or windows; time comes from a Clock, so it
+// can be driven by anything.
+// Never throws exceptions.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+
+class ClickGesture
+{
+public:
+	enum Button {
+		BT_LEFT,
+		BT_MIDDLE,
+		BT_RIGHT
+	};
+
+	enum Gesture {
+		GS_NONE,
+		GS_CLICK,        // Left button, once.
+		GS_DOUBLE_CLICK,
+		GS_LONG_PRESS,   // Left button, held for the long-press time.
+		GS_MIDDLE_CLICK,
+		GS_RIGHT_CLICK
+	};
+
+	// Times in milliseconds. A long-press time of zero turns long presses
+	// off; then holding the button is just a slow click.
+	ClickGesture(const Clock& clock, UINT doubleClickTime, UINT longPressTime);
+
+	inline void setDoubleClickTime(UINT time) { m_doubleClickTime = time; }
+	inline void setLongPressTime(UINT time) { m_longPressTime = time; }
+
+	Gesture onButtonDown(Button button, int x, int y);
+	Gesture onButtonUp(Button button, int x, int y);
+	// For systems that send a double-click message instead of the second
+	// button-down message.
+	Gesture onDoubleClick(Button button, int x, int y);
+	Gesture onTimer();
+
+	// Zero if no timer is needed; otherwise at least one.
+	UINT getTimeout() const;
+	// Where the button went down for the last recognized gesture.
+	inline int getX() const { return m_x; }
+	inline int getY() const { return m_y; }
+
+private:
+	enum State {
+		ST_IDLE,
+		ST_PRESSED,             // Down once; could become anything.
+		ST_WAITING_FOR_SECOND,  // Up again; a click unless there's a second.
+		ST_WAITING_FOR_RELEASE  // Recognized; ignore the rest of it.
+	};
+
+	ULONGLONG getDeadline() const;
+
+	const Clock& m_clock;
+	UINT m_doubleClickTime;
+	UINT m_longPressTime;
+	State m_state;
+	ULONGLONG m_downTime;
+	int m_x;
+	int m_y;
+};
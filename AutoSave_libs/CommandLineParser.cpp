@@ -15,6 +15,13 @@ CommandLineParser::~CommandLineParser()
 
 
 void CommandLineParser::parse(const wstring& commandLine)
+{
+	tryParse(commandLine).throwIfError<CLIException>();
+}
+
+
+
+ErrorCode CommandLineParser::tryParse(const wstring& commandLine)
 {
 	clear();
 	vector<wstring> args = split(commandLine);
@@ -29,7 +36,8 @@ void CommandLineParser::parse(const wstring& commandLine)
 			if (currentKey == 0)
 			{
 				// First step of kwarg consumption.
-				checkValidKey(arg);
+				if (!isValidKeyArgument(arg))
+					return reject();
 				currentKey = arg.at(1);
 			}
 			else {
@@ -44,7 +52,9 @@ void CommandLineParser::parse(const wstring& commandLine)
 			m_largs.push_back(arg);
 		}
 	}
-	checkMissingValue(currentKey);
+	if (currentKey != 0)
+		return reject();
+	return ErrorCode();
 }
 
 
@@ -55,6 +65,7 @@ vector<wstring> CommandLineParser::split(const wstring& commandLine)
 	if (commandLine.empty())
 		return result;
 
+#ifdef _WIN32
 	int nArgs = 0;
 	LPWSTR* argList = CommandLineToArgvW(commandLine.data(), &nArgs);
 	if (argList == NULL)
@@ -65,42 +76,125 @@ vector<wstring> CommandLineParser::split(const wstring& commandLine)
 		result.push_back(argList[i]);
 	}
 	LocalFree(argList);
+#else
+	splitLikeWindows(commandLine, &result);
+#endif
 	return result;
 }
 
 
 
-bool CommandLineParser::isKeyArgument(const wstring& keyArg)
+// Follows the rules of CommandLineToArgvW, including its quirks:
+// The first argument ends at the next quote or whitespace, and isn't
+// unescaped. In all others, 2n backslashes followed by a quote become
+// n backslashes and toggle quoting; 2n+1 backslashes followed by a
+// quote become n backslashes and a literal quote. A doubled quote
+// inside quotes is a literal quote.
+void CommandLineParser::splitLikeWindows(
+	const wstring& commandLine, vector<wstring>* pArgs)
 {
-	return keyArg.length() > 1 && keyArg[0] == L'/';
+	auto isBlank = [](wchar_t c) { return c == L' ' || c == L'\t'; };
+	auto pos = commandLine.cbegin();
+	const auto end = commandLine.cend();
+
+	// The first argument.
+	wstring arg;
+	if (*pos == L'"')
+	{
+		++pos;
+		while (pos != end && *pos != L'"')
+			arg.push_back(*pos++);
+		if (pos != end)
+			++pos;
+	}
+	else {
+		while (pos != end && !isBlank(*pos))
+			arg.push_back(*pos++);
+	}
+	pArgs->push_back(arg);
+	while (pos != end && isBlank(*pos))
+		++pos;
+
+	// All the others.
+	arg.clear();
+	bool hasArg = false;
+	int quoteCount = 0;
+	size_t backslashCount = 0;
+	while (pos != end)
+	{
+		if (isBlank(*pos) && quoteCount == 0)
+		{
+			pArgs->push_back(arg);
+			arg.clear();
+			hasArg = false;
+			backslashCount = 0;
+			while (pos != end && isBlank(*pos))
+				++pos;
+			continue;
+		}
+
+		hasArg = true;
+		if (*pos == L'\\')
+		{
+			arg.push_back(*pos++);
+			++backslashCount;
+		}
+		else if (*pos == L'"')
+		{
+			arg.erase(arg.size() - backslashCount / 2);
+			if (backslashCount % 2 == 0)
+			{
+				++quoteCount;
+			}
+			else {
+				arg.back() = L'"';
+			}
+			++pos;
+			backslashCount = 0;
+
+			// Consecutive quotes.
+			while (pos != end && *pos == L'"')
+			{
+				if (++quoteCount == 3)
+				{
+					arg.push_back(L'"');
+					quoteCount = 0;
+				}
+				++pos;
+			}
+			if (quoteCount == 2)
+				quoteCount = 0;
+		}
+		else {
+			arg.push_back(*pos++);
+			backslashCount = 0;
+		}
+	}
+	if (hasArg)
+		pArgs->push_back(arg);
 }
 
 
 
-bool CommandLineParser::isValidKeyArgument(const wstring& keyArg) const
+bool CommandLineParser::isKeyArgument(const wstring& keyArg)
 {
-	return isKeyArgument(keyArg) && keyArg.length() == 2 &&
-		(m_allowedKeys.find(keyArg[1]) != wstring::npos);
+	return keyArg.length() > 1 && keyArg[0] == L'/';
 }
 
 
 
-void CommandLineParser::checkValidKey(const wstring& arg)
+bool CommandLineParser::isValidKeyArgument(const wstring& keyArg) const
 {
-	if (!isValidKeyArgument(arg)) {
-		clear();
-		throw CLIException(E_INVALIDARG);
-	}
+	return isKeyArgument(keyArg) && keyArg.length() == 2 &&
+		(m_allowedKeys.find(keyArg[1]) != wstring::npos);
 }
 
 
 
-void CommandLineParser::checkMissingValue(wchar_t currentKey)
+ErrorCode CommandLineParser::reject()
 {
-	if (currentKey != 0) {
-		clear();
-		throw CLIException(E_INVALIDARG);
-	}
+	clear();
+	return ErrorCode(E_INVALIDARG);
 }
 
 
@@ -1,12 +1,14 @@
 // CommandLineParser.h : Object that parses command lines of the style
 // LR"(/A 10 /B "key-word argument" /C 42 "list argument" arg arg)".
-// Functions may throw CLIException.
+// Functions may throw CLIException, except tryParse, which returns
+// E_INVALIDARG instead, for callers that sift through many command lines.
 // The function getIntKwarg may additionally throw if std::stoi throws.
 
 #pragma once
 
 #include "stdafx.h"
 #include "AutoSaveException.h"
+#include "Expected.h"
 
 using std::wstring;
 using std::vector;
@@ -21,6 +23,8 @@ public:
 	// Changing the object state.
 	inline void clear() { m_kwargs.clear(); m_largs.clear(); }
 	void parse(const wstring& commandLine); //throws CLIException
+	// Leaves the object cleared on failure.
+	ErrorCode tryParse(const wstring& commandLine);
 
 	// Modifiers for the parsing process.
 	inline wstring getAllowedKeys() const { return m_allowedKeys; }
@@ -52,11 +56,12 @@ public:
 	static vector<wstring> split(const wstring& commandLine);
 
 private:
+	static void splitLikeWindows(const wstring& commandLine,
+		vector<wstring>* pArgs);
 	static bool isKeyArgument(const wstring& key);
 	bool isValidKeyArgument(const wstring& key) const;
 
-	void checkValidKey(const wstring& arg);
-	void checkMissingValue(wchar_t currentKey);
+	ErrorCode reject();
 
 	unordered_map<wchar_t, wstring> m_kwargs;
 	vector<wstring> m_largs;
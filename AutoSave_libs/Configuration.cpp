@@ -1,14 +1,18 @@
 #include "stdafx.h"
 #include "Configuration.h"
+#include "MemoryConfigStore.h"
 
 
 // Constructor
 Configuration::Configuration()
-	: m_settings(),
+	: isEnabled(true),
+	  isFirstSession(false),
+	  controlRequest(),
+	  isHeadless(false),
+	  m_settings(),
 	  m_filter(L"SAI - ", L"\\.psd| gimp|sai - | - paint", false),
 	  m_ac(),
-	  isEnabled(true),
-	  isFirstSession(false)
+	  m_isStoreUpToDate(false)
 {
 }
 
@@ -24,11 +28,14 @@ Configuration::~Configuration()
 
 // Copy constructor
 Configuration::Configuration(const Configuration &other)
-	: m_settings(other.m_settings),
+	: isEnabled(other.isEnabled),
+	  isFirstSession(other.isFirstSession),
+	  controlRequest(other.controlRequest),
+	  isHeadless(other.isHeadless),
+	  m_settings(other.m_settings),
 	  m_filter(other.m_filter),
 	  m_ac(other.m_ac),
-	  isEnabled(other.isEnabled),
-	  isFirstSession(other.isFirstSession)
+	  m_isStoreUpToDate(other.m_isStoreUpToDate)
 {
 }
 
@@ -44,6 +51,9 @@ Configuration& Configuration::operator=(const Configuration &other)
 		m_ac = other.m_ac;
 		isEnabled = other.isEnabled;
 		isFirstSession = other.isFirstSession;
+		controlRequest = other.controlRequest;
+		isHeadless = other.isHeadless;
+		m_isStoreUpToDate = other.m_isStoreUpToDate;
 	}
 	return *this;
 }
@@ -74,6 +84,13 @@ void Configuration::loadFromCommandLine(const wstring& commandLine)
 	if (!cli.gotArgs())
 		return;
 
+	if (cli.kwArgsContain(L'Q')) {
+		controlRequest = cli.getStringKwArg(L'Q');
+		return;
+	}
+
+	if (cli.kwArgsContain(L'S'))
+		isHeadless = cli.getIntKwArg(L'S') != 0;
 	m_settings.loadFromCommandLine(cli);
 
 	if (cli.kwArgsContain(L'R')) {
@@ -90,39 +107,244 @@ void Configuration::loadFromCommandLine(const wstring& commandLine)
 
 
 
+bool Configuration::isHeadlessCommandLine(const wstring& commandLine)
+{
+	CommandLineParser cli;
+	cli.setAllowedKeys(getAllowedKeys());
+	try {
+		cli.parse(commandLine);
+		return cli.kwArgsContain(L'S') && !cli.kwArgsContain(L'Q') &&
+			cli.getIntKwArg(L'S') != 0;
+	}
+	catch (AutoSaveException&) {
+		return false;
+	}
+}
+
+
+
+bool Configuration::isConnectingCommandLine(const wstring& commandLine)
+{
+	CommandLineParser cli;
+	cli.setAllowedKeys(getAllowedKeys());
+	if (cli.tryParse(commandLine).isError())
+		return false;
+	return cli.gotLArgs() && !cli.kwArgsContain(L'Q') &&
+		!cli.kwArgsContain(L'R') && !cli.kwArgsContain(L'F');
+}
+
+
+
 void Configuration::loadFromRegistry(LPCTSTR keyName)
 {
-	isFirstSession = !RegistryAccess::keyExists(keyName);
+	isFirstSession = !Platform::configStoreExists(keyName);
 	if (isFirstSession)
 		return;
 
-	RegistryAccess ra;
-	ra.access(keyName);
-	m_settings.setHotkey(LOWORD(ra.readInt(L"hotkey")));
-	m_settings.setInterval(ra.readInt(L"interval"));
-	m_settings.setVerbosity(ra.readInt(L"verbosity"));
-	filter.setPhrase(ra.readString(L"filterPhrase"));
-	filter.setRegex(ra.readString(L"filterRegex"));
-	filter.useRegex(ra.readInt(L"isFilterByRegex") != 0);
+	loadFromStore(*Platform::openConfigStore(keyName));
 }
 
 
 
 void Configuration::saveToRegistry(LPCTSTR keyName)
 {
-	RegistryAccess ra;
-	ra.access(keyName);
-	ra.writeInt(L"hotkey", m_settings.getHotkey());
-	ra.writeInt(L"interval", m_settings.getInterval());
-	ra.writeInt(L"verbosity", (UINT)m_settings.getVerbosity());
-	ra.writeString(L"filterPhrase", filter.getPhrase());
-	ra.writeString(L"filterRegex", filter.getRegex());
-	ra.writeInt(L"isFilterByRegex", (UINT)filter.isRegex());
+	// E.g. the uninstaller has removed it.
+	if (!Platform::configStoreExists(keyName))
+		forgetStore();
+	saveChangesToStore(*Platform::openConfigStore(keyName));
+}
+
+
+
+void Configuration::learnPacing(LPCTSTR keyName, const PacingProfile& profile)
+{
+	m_settings.setEventDelay(profile.executable, profile.eventDelay);
+	if (!Platform::configStoreExists(keyName))
+		return;
+
+	unique_ptr<ConfigStore> pStore = Platform::openConfigStore(keyName);
+	Expected<vector<wstring>> stored = pStore->tryReadMultiString(L"pacingProfiles");
+	MiscSettings merged;
+	if (stored)
+		merged.setPacingProfiles(parsePacingProfiles(stored.value()));
+	merged.setEventDelay(profile.executable, profile.eventDelay);
+	pStore->writeMultiString(L"pacingProfiles",
+		formatPacingProfiles(merged.getPacingProfiles()));
+}
+
+
+
+void Configuration::loadFromStore(const ConfigStore& store)
+{
+	m_settings.setHotkey(LOWORD(store.readInt(L"hotkey")));
+	m_settings.setInterval(store.readInt(L"interval"));
+	m_settings.setVerbosity(store.readInt(L"verbosity"));
+	m_settings.setSaveCheckTimeout(readIntOr(store, L"saveCheckTimeout", 0));
+	m_settings.setIntervalAdaptive(
+		readIntOr(store, L"isIntervalAdaptive", 0) != 0);
+	AdaptivePolicy policy = MiscSettings().getAdaptivePolicy();
+	policy.minInterval = readIntOr(store, L"adaptiveMinInterval", policy.minInterval);
+	policy.maxInterval = readIntOr(store, L"adaptiveMaxInterval", policy.maxInterval);
+	policy.growthPercent = readIntOr(store, L"adaptiveGrowth", policy.growthPercent);
+	policy.maxBusyPercent = readIntOr(store, L"adaptiveMaxBusy", policy.maxBusyPercent);
+	m_settings.setAdaptivePolicy(policy);
+	const MiscSettings defaults;
+	m_settings.setTriggers(readIntOr(store, L"saveTriggers", defaults.getTriggers()));
+	m_settings.setBackgroundDelay(readIntOr(store, L"backgroundDelay",
+		defaults.getBackgroundDelay()));
+	m_settings.setTriggerDedupe(readIntOr(store, L"triggerDedupe",
+		defaults.getTriggerDedupe()));
+	RetentionPolicy retention = defaults.getRetentionPolicy();
+	retention.keepLast = readIntOr(store, L"backupKeepLast", retention.keepLast);
+	retention.keepDaily = readIntOr(store, L"backupKeepDaily", retention.keepDaily);
+	m_settings.setRetentionPolicy(retention);
+	// Macros that no longer parse fall back on the hotkey.
+	Expected<wstring> keyMacro = store.tryReadString(L"keyMacro");
+	if (keyMacro)
+		m_settings.setKeyMacro(keyMacro.value());
+	Expected<vector<wstring>> pacing = store.tryReadMultiString(L"pacingProfiles");
+	if (pacing)
+		m_settings.setPacingProfiles(parsePacingProfiles(pacing.value()));
+	filter.setPhrase(store.readString(L"filterPhrase"));
+	filter.setRegex(store.readString(L"filterRegex"));
+	filter.useRegex(store.readInt(L"isFilterByRegex") != 0);
+	m_settings.markClean();
+	m_filter.markClean();
+	m_isStoreUpToDate = true;
+}
+
+
+
+void Configuration::saveToStore(ConfigStore& store) const
+{
+	store.writeInt(L"hotkey", m_settings.getHotkey());
+	store.writeInt(L"interval", m_settings.getInterval());
+	store.writeInt(L"verbosity", (UINT)m_settings.getVerbosity());
+	store.writeInt(L"saveCheckTimeout", m_settings.getSaveCheckTimeout());
+	store.writeInt(L"isIntervalAdaptive", (UINT)m_settings.isIntervalAdaptive());
+	const AdaptivePolicy& policy = m_settings.getAdaptivePolicy();
+	store.writeInt(L"adaptiveMinInterval", policy.minInterval);
+	store.writeInt(L"adaptiveMaxInterval", policy.maxInterval);
+	store.writeInt(L"adaptiveGrowth", policy.growthPercent);
+	store.writeInt(L"adaptiveMaxBusy", policy.maxBusyPercent);
+	store.writeInt(L"saveTriggers", m_settings.getTriggers());
+	store.writeInt(L"backgroundDelay", m_settings.getBackgroundDelay());
+	store.writeInt(L"triggerDedupe", m_settings.getTriggerDedupe());
+	store.writeInt(L"backupKeepLast", m_settings.getRetentionPolicy().keepLast);
+	store.writeInt(L"backupKeepDaily", m_settings.getRetentionPolicy().keepDaily);
+	store.writeString(L"keyMacro", m_settings.getKeyMacro().toString());
+	store.writeMultiString(L"pacingProfiles",
+		formatPacingProfiles(m_settings.getPacingProfiles()));
+	store.writeString(L"filterPhrase", m_filter.getPhrase());
+	store.writeString(L"filterRegex", m_filter.getRegex());
+	store.writeInt(L"isFilterByRegex", (UINT)m_filter.isRegex());
+}
+
+
+
+void Configuration::saveChangesToStore(ConfigStore& store)
+{
+	if (!m_isStoreUpToDate)
+	{
+		saveToStore(store);
+	}
+	else {
+		const int changed = m_settings.getDirtyMask();
+		if (changed & MiscSettings::ATT_HOTKEY)
+			store.writeInt(L"hotkey", m_settings.getHotkey());
+		if (changed & MiscSettings::ATT_INTERVAL)
+			store.writeInt(L"interval", m_settings.getInterval());
+		if (changed & MiscSettings::ATT_VERBOSITY)
+			store.writeInt(L"verbosity", (UINT)m_settings.getVerbosity());
+		if (changed & MiscSettings::ATT_SAVECHECK)
+			store.writeInt(L"saveCheckTimeout", m_settings.getSaveCheckTimeout());
+		if (changed & MiscSettings::ATT_ADAPTIVE)
+		{
+			const AdaptivePolicy& policy = m_settings.getAdaptivePolicy();
+			store.writeInt(L"isIntervalAdaptive", (UINT)m_settings.isIntervalAdaptive());
+			store.writeInt(L"adaptiveMinInterval", policy.minInterval);
+			store.writeInt(L"adaptiveMaxInterval", policy.maxInterval);
+			store.writeInt(L"adaptiveGrowth", policy.growthPercent);
+			store.writeInt(L"adaptiveMaxBusy", policy.maxBusyPercent);
+		}
+		if (changed & MiscSettings::ATT_TRIGGERS)
+		{
+			store.writeInt(L"saveTriggers", m_settings.getTriggers());
+			store.writeInt(L"backgroundDelay", m_settings.getBackgroundDelay());
+			store.writeInt(L"triggerDedupe", m_settings.getTriggerDedupe());
+		}
+		if (changed & MiscSettings::ATT_BACKUP)
+		{
+			store.writeInt(L"backupKeepLast", m_settings.getRetentionPolicy().keepLast);
+			store.writeInt(L"backupKeepDaily", m_settings.getRetentionPolicy().keepDaily);
+		}
+		if (changed & MiscSettings::ATT_MACRO)
+			store.writeString(L"keyMacro", m_settings.getKeyMacro().toString());
+		if (changed & MiscSettings::ATT_PACING)
+			store.writeMultiString(L"pacingProfiles",
+				formatPacingProfiles(m_settings.getPacingProfiles()));
+		const int filterChanged = m_filter.getDirtyMask();
+		if (filterChanged & Matcher::FLD_PHRASE)
+			store.writeString(L"filterPhrase", m_filter.getPhrase());
+		if (filterChanged & Matcher::FLD_REGEX)
+			store.writeString(L"filterRegex", m_filter.getRegex());
+		if (filterChanged & Matcher::FLD_USE_REGEX)
+			store.writeInt(L"isFilterByRegex", (UINT)m_filter.isRegex());
+	}
+	m_settings.markClean();
+	m_filter.markClean();
+	m_isStoreUpToDate = true;
+}
+
+
+
+int Configuration::readIntOr(const ConfigStore& store,
+	const wstring& valueName, int defaultValue)
+{
+	Expected<int> value = store.tryReadInt(valueName);
+	if (!value && value.error().errorCode() == ERROR_FILE_NOT_FOUND)
+		return defaultValue;
+	return value.valueOrThrow<ConfigStoreException>();
+}
+
+
+
+// Skips entries that don't parse.
+vector<PacingProfile> Configuration::parsePacingProfiles(
+	const vector<wstring>& strings)
+{
+	vector<PacingProfile> profiles;
+	PacingProfile profile;
+	for (const wstring& string : strings)
+	{
+		if (PacingProfile::parse(string, &profile))
+			profiles.push_back(profile);
+	}
+	return profiles;
+}
+
+
+
+vector<wstring> Configuration::formatPacingProfiles(
+	const vector<PacingProfile>& profiles)
+{
+	vector<wstring> strings;
+	strings.reserve(profiles.size());
+	for (const PacingProfile& profile : profiles)
+		strings.push_back(profile.toString());
+	return strings;
 }
 
 
 
 bool Configuration::windowMatch(HWND hwnd) const
+{
+	return windowMatch(hwnd, Platform::getWindowEnumerator());
+}
+
+
+
+bool Configuration::windowMatch(HWND hwnd, const WindowEnumerator& windows) const
 {
 	if (!canRun())
 	{
@@ -130,12 +352,10 @@ bool Configuration::windowMatch(HWND hwnd) const
 	}
 	else if (connection.isConnected())
 	{
-		DWORD windowProcessId;
-		GetWindowThreadProcessId(hwnd, &windowProcessId);
-		return windowProcessId == connection.getProcessId();
+		return windows.getWindowProcessId(hwnd) == connection.getProcessId();
 	}
 	else {
-		wstring caption = Matcher::getWindowText(hwnd);
+		wstring caption = windows.getWindowText(hwnd);
 		return caption.empty() ? false : filter.match(caption);
 	}
 }
@@ -143,31 +363,24 @@ bool Configuration::windowMatch(HWND hwnd) const
 
 
 bool Configuration::matchingWindowExists() const
+{
+	return matchingWindowExists(Platform::getWindowEnumerator());
+}
+
+
+
+bool Configuration::matchingWindowExists(const WindowEnumerator& windows) const
 {
 	if (canRun())
 	{
 		bool success = false;
-		MatchingWindowsExistEnumProcArguments lParam = { this, &success };
-		EnumWindows(matchingWindowExistsEnumProc, (LPARAM)&lParam);
+		windows.enumWindows([&](HWND hwnd) {
+			success = windowMatch(hwnd, windows);
+			return !success;
+		});
 		return success;
 	}
 	else {
 		return false;
 	}
 }
-
-BOOL CALLBACK Configuration::matchingWindowExistsEnumProc(
-	HWND hwnd, LPARAM lParam)
-{
-	auto args = (MatchingWindowsExistEnumProcArguments*) lParam;
-	if (args->pThis->windowMatch(hwnd))
-	{
-		*args->pSuccess = true;
-		return FALSE;
-	}
-	else {
-		return TRUE;
-	}
-}
-
-
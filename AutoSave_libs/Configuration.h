@@ -1,17 +1,22 @@
 // Configuration.h : Wraps all options surrounding AutoSave.
 // Throws only if the wrapped functions throw. (E.g. loadFromRegistry
 // may throw RegistryExceptiion.)
+// Window matching uses the platform's WindowEnumerator unless
+// another one is passed.
+// Once the settings have been loaded from or saved to a store,
+// saveChangesToStore only writes the values that have changed since.
 
 #pragma once
 
 #include "stdafx.h"
-#include "RegistryAccess.h"
+#include "Platform.h"
 #include "CommandLineParser.h"
 #include "MiscSettings.h"
 #include "AppConnection.h"
 #include "Matcher.h"
 
 using std::wstring;
+using std::vector;
 
 class Configuration
 {
@@ -26,14 +31,33 @@ public:
 	bool operator!=(const Configuration& other) const;
 
 	void loadFromCommandLine(const wstring& commandLine);
-	inline static const wchar_t* getAllowedKeys() { return L"HIVRP"; }
+	inline static const wchar_t* getAllowedKeys() { return L"HIVRPCAQSMTBDK"; }
+	// Whether "/S 1" is on the command line, without loading anything.
+	// False if the command line is invalid; the window says so then.
+	static bool isHeadlessCommandLine(const wstring& commandLine);
+	// Whether loadFromCommandLine would start an application to connect
+	// to, which goes through the shell and so needs COM.
+	static bool isConnectingCommandLine(const wstring& commandLine);
 
 	void loadFromRegistry(LPCTSTR keyName);
 	void saveToRegistry(LPCTSTR keyName);
+	void loadFromStore(const ConfigStore& store);
+	void saveToStore(ConfigStore& store) const;
+	void saveChangesToStore(ConfigStore& store);
+	// The next save writes all values, e.g. because the store is gone.
+	inline void forgetStore() { m_isStoreUpToDate = false; }
+	// Sets a program's pacing, e.g. as found by PacingCalibrator, both
+	// here and in the store, even if the other settings came from a
+	// command line: it's about the program, not about this session.
+	// Profiles stored by others in the meantime are kept. Without a
+	// store, it waits for the next save like any other change.
+	void learnPacing(LPCTSTR keyName, const PacingProfile& profile);
 
 	// Window matching
 	bool windowMatch(HWND hwnd) const;
+	bool windowMatch(HWND hwnd, const WindowEnumerator& windows) const;
 	bool matchingWindowExists() const;
+	bool matchingWindowExists(const WindowEnumerator& windows) const;
 
 	// Wrappers for other objects
 	MiscSettings& settings = m_settings;
@@ -47,16 +71,22 @@ public:
 	// Variables that are not saved between sessions.
 	bool isEnabled; // similar to canRun, but may be set from outside.
 	bool isFirstSession;
+	// Set by /Q: send this to the running instance (see ControlService)
+	// instead of running. Nothing else on the command line counts then.
+	wstring controlRequest;
+	// Set by /S: run as a HeadlessService, without window or icon.
+	bool isHeadless;
 
 private:
-	// Window matching, internal stuff.
-	static BOOL CALLBACK matchingWindowExistsEnumProc(HWND hwnd, LPARAM lParam);
-	struct MatchingWindowsExistEnumProcArguments {
-		const Configuration* pThis;
-		bool* pSuccess;
-	};
+	// For values that older versions didn't save.
+	static int readIntOr(const ConfigStore& store, const wstring& valueName,
+		int defaultValue);
+	static vector<PacingProfile> parsePacingProfiles(const vector<wstring>& strings);
+	static vector<wstring> formatPacingProfiles(const vector<PacingProfile>& profiles);
 
 	MiscSettings m_settings;
 	Matcher m_filter;
 	AppConnection m_ac;
+	// Whether the store has all values, so that the changed ones suffice.
+	bool m_isStoreUpToDate;
 };
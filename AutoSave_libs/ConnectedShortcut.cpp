@@ -115,20 +115,56 @@ bool ConnectedShortcut::isConnected(const wstring& filePath)
 		return false;
 	try {
 		ConnectedShortcut csc;
-		csc.load(filePath, STGM_READ);
-		return csc.isConnected();
+		return csc.tryIsConnected(filePath).valueOr(false);
 	}
 	catch (std::exception&) {
+		// The shell link object couldn't be created.
 		return false;
 	}
 }
 
 
 
+Expected<bool> ConnectedShortcut::tryIsConnected(const wstring& filePath)
+{
+	if (PathMatchSpec(filePath.data(), L"*.lnk") == FALSE)
+		return false;
+	clearConnectedCache();
+	ErrorCode error = tryLoad(filePath, STGM_READ);
+	if (error.isError())
+		return error;
+	return tryComputeIsConnected();
+}
+
+
+
 bool ConnectedShortcut::computeIsConnected() const
 {
-	return !getLArgs().empty() &&
-		(_tcsicmp(getSelfPath().data(), getPath().data()) == 0);
+	return tryComputeIsConnected().valueOrThrow<OleException>();
+}
+
+
+
+// Most shortcuts don't point to AutoSave, so look at the path before
+// parsing the arguments.
+Expected<bool> ConnectedShortcut::tryComputeIsConnected() const
+{
+	Expected<wstring> path = tryGetPath();
+	if (!path)
+		return path.error();
+	if (!m_customSelfPath.empty())
+	{
+		if (_tcsicmp(m_customSelfPath.data(), path.value().data()) != 0)
+			return false;
+	}
+	else if (!OleUtils::isSelf(path.value())) {
+		return false;
+	}
+
+	Expected<wstring> arguments = tryGetArguments();
+	if (!arguments)
+		return arguments.error();
+	return !parseLArgs(arguments.value()).empty();
 }
 
 
@@ -156,16 +192,19 @@ wstring ConnectedShortcut::disconnectFileName(const wstring& shortcutName)
 
 
 vector<wstring> ConnectedShortcut::getLArgs() const
+{
+	return parseLArgs(getArguments());
+}
+
+
+
+vector<wstring> ConnectedShortcut::parseLArgs(const wstring& arguments)
 {
 	CommandLineParser cli;
 	cli.allowAllKeys();
-	try {
-		cli.parse(getArguments());
-		return cli.getLArgs();
-	}
-	catch (CLIException&) {
+	if (cli.tryParse(arguments).isError())
 		return {};
-	}
+	return cli.getLArgs();
 }
 
 
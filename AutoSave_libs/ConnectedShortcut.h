@@ -30,6 +30,9 @@ public:
 	// the static version silently returns false on failure.
 	bool isConnected();
 	static bool isConnected(const wstring& shortcutPath);
+	// Loads the file and returns whether it is connected, or why it
+	// couldn't be read. To look at many files, use one object for all.
+	Expected<bool> tryIsConnected(const wstring& shortcutPath);
 
 	// Careful: Results of isConnected are cached for each object.
 	inline void clearConnectedCache() { m_hasIsConnectedBeenCached = false; }
@@ -48,9 +51,12 @@ protected:
 	static wstring m_customSelfPath;
 
 	bool computeIsConnected() const;
+	Expected<bool> tryComputeIsConnected() const;
 	bool m_isConnectedCachedResult;
 	bool m_hasIsConnectedBeenCached;
 
 	vector<wstring> getLArgs() const;
+	// Empty if the arguments can't be parsed.
+	static vector<wstring> parseLArgs(const wstring& arguments);
 	static bool startsWith(const wstring& tested, const wstring& prefix);
 };
@@ -0,0 +1,68 @@
+#include "stdafx.h"
+#include "ContentChunker.h"
+
+
+namespace {
+	// Random numbers for each byte value, made the same everywhere by
+	// the splitmix64 generator; changing them moves every cut.
+	struct GearTable
+	{
+		ULONGLONG values[256];
+
+		GearTable()
+		{
+			ULONGLONG state = 0x4175746f53617665ULL; // "AutoSave"
+			for (int i = 0; i < 256; ++i)
+			{
+				ULONGLONG z = (state += 0x9e3779b97f4a7c15ULL);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+				values[i] = z ^ (z >> 31);
+			}
+		}
+	};
+
+	const GearTable gear;
+}
+
+
+
+ContentChunker::ContentChunker(size_t minSize, size_t averageSize,
+	size_t maxSize)
+{
+	m_minSize = __max(minSize, (size_t) 64);
+	size_t spread = 1;
+	int bits = 0;
+	while (m_minSize + spread < averageSize && bits < 48)
+	{
+		spread <<= 1;
+		++bits;
+	}
+	m_averageSize = m_minSize + spread;
+	m_maxSize = __max(maxSize, m_averageSize);
+	// The hash shifts left with each byte, so its top bits depend on the
+	// most bytes; a bit further down would only see the last few.
+	m_cutMask = (bits == 0) ? 0 : ~0ULL << (64 - bits);
+}
+
+
+
+size_t ContentChunker::findCut(const BYTE* pData, size_t size) const
+{
+	const size_t end = __min(size, m_maxSize);
+	if (end <= m_minSize)
+		return end;
+
+	// Bytes before the minimum can't cut, but the 64 before it make up
+	// the hash that decides the first possible cut.
+	ULONGLONG hash = 0;
+	for (size_t i = m_minSize - 64; i < m_minSize; ++i)
+		hash = (hash << 1) + gear.values[pData[i]];
+	for (size_t i = m_minSize; i < end; ++i)
+	{
+		hash = (hash << 1) + gear.values[pData[i]];
+		if ((hash & m_cutMask) == 0)
+			return i + 1;
+	}
+	return end;
+}
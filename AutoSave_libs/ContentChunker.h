@@ -0,0 +1,37 @@
+// ContentChunker.h : Splits data into chunks where the content says so,
+// rather than at fixed offsets, so that an edit only changes the chunks
+// around it: the chunks of two versions of a document line up again
+// right after the bytes that differ (see BackupStore).
+// A rolling "gear" hash over the last 64 bytes decides where to cut;
+// chunks are at least minSize and at most maxSize bytes long, and about
+// averageSize on average. The same settings always cut the same data
+// the same way, on any platform.
+// Never throws exceptions.
+
+#pragma once
+
+#include "stdafx.h"
+
+class ContentChunker
+{
+public:
+	// averageSize is rounded up so that averageSize - minSize is a power
+	// of two. Sizes are brought into order: 64 <= min <= average <= max.
+	ContentChunker(size_t minSize = 64 * 1024, size_t averageSize = 256 * 1024,
+		size_t maxSize = 1024 * 1024);
+
+	inline size_t getMinSize() const { return m_minSize; }
+	inline size_t getAverageSize() const { return m_averageSize; }
+	inline size_t getMaxSize() const { return m_maxSize; }
+
+	// The length of the chunk that starts at pData. Unless the data ends
+	// after size bytes, size must be at least getMaxSize(): the result
+	// is never more than either.
+	size_t findCut(const BYTE* pData, size_t size) const;
+
+private:
+	size_t m_minSize;
+	size_t m_averageSize;
+	size_t m_maxSize;
+	ULONGLONG m_cutMask;
+};
@@ -0,0 +1,160 @@
+#include "stdafx.h"
+#include "ControlService.h"
+
+#include <cctype>
+
+
+namespace {
+	const char* const commandNames[] = {
+		"", "status", "metrics", "pause", "resume", "save", "reload",
+		"calibrate", "quit"
+	};
+
+	void appendValue(string& text, const char* key, const string& value)
+	{
+		text.append(key).append("=").append(value).append("\n");
+	}
+
+	void appendValue(string& text, const char* key, ULONGLONG value)
+	{
+		appendValue(text, key, std::to_string(value));
+	}
+}
+
+
+
+ControlService::ControlService(const Metrics& metrics, const Clock& clock,
+	const CommandHandler& onCommand)
+	: m_metrics(metrics), m_clock(clock), m_onCommand(onCommand)
+{
+	m_status.isEnabled = false;
+	m_status.isPaused = false;
+	m_status.isConnected = false;
+	m_status.interval = 0;
+	m_status.secondsLeft = 0;
+	m_status.lastSaveTime = 0;
+	m_status.isCalibrating = false;
+}
+
+
+
+void ControlService::setStatus(const Status& status)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_status = status;
+}
+
+
+
+string ControlService::handle(const string& request)
+{
+	Command command = parseCommand(request);
+	switch (command)
+	{
+	case CMD_STATUS:
+		return "ok\n" + formatStatus();
+	case CMD_METRICS:
+		return "ok\n" + m_metrics.takeSnapshot().format();
+	case CMD_UNKNOWN:
+		return "error unknown command\n";
+	default:
+		if (m_onCommand)
+			m_onCommand(command);
+		return "ok\n";
+	}
+}
+
+
+
+ControlService::Command ControlService::parseCommand(const string& request)
+{
+	size_t begin = 0;
+	size_t end = request.size();
+	while (begin < end && isspace((unsigned char) request[begin]))
+		++begin;
+	while (end > begin && isspace((unsigned char) request[end - 1]))
+		--end;
+
+	string word;
+	for (size_t i = begin; i < end; ++i)
+		word.push_back((char) tolower((unsigned char) request[i]));
+
+	for (int command = CMD_STATUS; command <= CMD_QUIT; ++command)
+	{
+		if (word == commandNames[command])
+			return (Command) command;
+	}
+	return CMD_UNKNOWN;
+}
+
+
+
+const char* ControlService::getCommandName(Command command)
+{
+	return (command >= CMD_UNKNOWN && command <= CMD_QUIT)
+		? commandNames[command] : "";
+}
+
+
+
+string ControlService::toUtf8(const wstring& wide)
+{
+	string utf8;
+	for (size_t i = 0; i < wide.size(); ++i)
+	{
+		unsigned long c = (unsigned long) wide[i];
+		// Join surrogate pairs where wchar_t is 16 bits wide.
+		if (c >= 0xd800 && c < 0xdc00 && i + 1 < wide.size() &&
+			(unsigned long) wide[i + 1] >= 0xdc00 &&
+			(unsigned long) wide[i + 1] < 0xe000)
+		{
+			c = 0x10000 + ((c - 0xd800) << 10) + ((unsigned long) wide[++i] - 0xdc00);
+		}
+		if ((c >= 0xd800 && c < 0xe000) || c > 0x10ffff)
+			c = 0xfffd;
+
+		if (c < 0x80) {
+			utf8.push_back((char) c);
+		} else if (c < 0x800) {
+			utf8.push_back((char) (0xc0 | (c >> 6)));
+			utf8.push_back((char) (0x80 | (c & 0x3f)));
+		} else if (c < 0x10000) {
+			utf8.push_back((char) (0xe0 | (c >> 12)));
+			utf8.push_back((char) (0x80 | ((c >> 6) & 0x3f)));
+			utf8.push_back((char) (0x80 | (c & 0x3f)));
+		} else {
+			utf8.push_back((char) (0xf0 | (c >> 18)));
+			utf8.push_back((char) (0x80 | ((c >> 12) & 0x3f)));
+			utf8.push_back((char) (0x80 | ((c >> 6) & 0x3f)));
+			utf8.push_back((char) (0x80 | (c & 0x3f)));
+		}
+	}
+	return utf8;
+}
+
+
+
+string ControlService::formatStatus() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	string text;
+	appendValue(text, "enabled", m_status.isEnabled ? 1 : 0);
+	appendValue(text, "paused", m_status.isPaused ? 1 : 0);
+	appendValue(text, "connected", m_status.isConnected ? 1 : 0);
+	// Line breaks would end the value early.
+	string target = toUtf8(m_status.target);
+	for (char& c : target)
+	{
+		if (c == '\n' || c == '\r')
+			c = ' ';
+	}
+	appendValue(text, "target", target);
+	appendValue(text, "interval", m_status.interval);
+	appendValue(text, "seconds_left", m_status.secondsLeft);
+	const ULONGLONG now = m_clock.getTickCount();
+	if (m_status.lastSaveTime != 0 && m_status.lastSaveTime <= now)
+		appendValue(text, "seconds_since_save", (now - m_status.lastSaveTime) / 1000);
+	if (m_status.isCalibrating)
+		appendValue(text, "calibrating", 1);
+	return text;
+}
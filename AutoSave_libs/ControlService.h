@@ -0,0 +1,81 @@
+// ControlService.h : What a running AutoSave answers on its control
+// endpoint (see ControlServer in Platform.h), so that it can be checked
+// and controlled from scripts, e.g. with "AutoSave.exe /Q status".
+// The protocol is line-based. The client sends one command:
+//   status, metrics, pause, resume, save, reload, calibrate, quit
+// The first line of the answer is "ok" or "error <reason>". For status,
+// "key=value" lines follow; for metrics, the table that autosave_metrics
+// prints. While a calibration runs, status has "calibrating=1". Commands
+// that change something are only handed on to the CommandHandler; "ok"
+// means that they have been accepted.
+// handle() runs on the server's thread. Status is set from the thread
+// that owns the application, so the two only share a mutex.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+#include "Metrics.h"
+
+#include <mutex>
+
+using std::string;
+using std::wstring;
+
+class ControlService
+{
+public:
+	enum Command {
+		CMD_UNKNOWN,
+		CMD_STATUS,
+		CMD_METRICS,
+		CMD_PAUSE,
+		CMD_RESUME,
+		CMD_SAVE,   // Lets the countdown run out now.
+		CMD_RELOAD, // Reads the settings again.
+		CMD_CALIBRATE, // Finds the foreground program's pacing.
+		CMD_QUIT
+	};
+
+	struct Status
+	{
+		bool isEnabled;
+		bool isPaused;
+		bool isConnected;
+		wstring target;         // Filter phrase or regex; empty if connected.
+		UINT interval;          // In seconds, as currently counted down.
+		UINT secondsLeft;
+		ULONGLONG lastSaveTime; // In Clock ticks, zero if there was none.
+		bool isCalibrating;     // See PacingCalibrator.
+	};
+
+	// Called on the server's thread. Must not block, e.g. only post a
+	// message to the application's window.
+	typedef std::function<void(Command)> CommandHandler;
+
+	ControlService(const Metrics& metrics, const Clock& clock,
+		const CommandHandler& onCommand);
+
+	// Every running AutoSave tries to serve this name; the first one wins.
+	inline static const wchar_t* getEndpointName() { return SHORT_APP_NAME; }
+
+	void setStatus(const Status& status);
+	string handle(const string& request);
+
+	// Ignores surrounding white space and case.
+	static Command parseCommand(const string& request);
+	static const char* getCommandName(Command command);
+
+	static string toUtf8(const wstring& wide);
+
+private:
+	string formatStatus() const;
+
+	const Metrics& m_metrics;
+	const Clock& m_clock;
+	CommandHandler m_onCommand;
+
+	mutable std::mutex m_lock;
+	Status m_status;
+};
@@ -0,0 +1,93 @@
+#include "stdafx.h"
+#include "Countdown.h"
+
+
+void Countdown::start()
+{
+	m_isStarted = true;
+	m_isPaused = false;
+	m_mainSecondsLeft = m_interval;
+}
+
+
+
+void Countdown::stop()
+{
+	m_isStarted = false;
+	m_isPaused = false;
+	m_mainSecondsLeft = 0;
+}
+
+
+
+bool Countdown::pause()
+{
+	if (m_isStarted && !m_isPaused)
+	{
+		m_isPaused = true;
+		return true;
+	}
+	return false;
+}
+
+
+
+bool Countdown::resume()
+{
+	if (m_isPaused)
+	{
+		m_isPaused = false;
+		return true;
+	}
+	return false;
+}
+
+
+
+Countdown::Event Countdown::step()
+{
+	if (m_isPaused || !m_isStarted)
+		return EV_NONE;
+
+	if (m_delaySecondsLeft > 0)
+	{
+		// If a delay has been specified, wait before
+		// doing the actual countdown.
+		--m_delaySecondsLeft;
+		return (m_delaySecondsLeft == 0) ? EV_DELAYATZERO : EV_NONE;
+	}
+
+	// Actual countdown.
+	if (m_mainSecondsLeft > 0)
+		--m_mainSecondsLeft;
+
+	if (m_mainSecondsLeft <= 0)
+		return EV_ATZERO;
+	else if (m_mainSecondsLeft < 5)
+		return EV_LESSTHANFIVELEFT;
+	else if (m_mainSecondsLeft == 5)
+		return EV_FIVESECONDSLEFT;
+	else
+		return EV_NONE;
+}
+
+
+
+void Countdown::resetCountdown()
+{
+	m_mainSecondsLeft = m_interval;
+}
+
+
+
+void Countdown::resetDelay()
+{
+	m_delaySecondsLeft = delayTime;
+}
+
+
+
+void Countdown::shortenTo(UINT secondsLeft)
+{
+	m_mainSecondsLeft = __min(m_mainSecondsLeft, secondsLeft);
+}
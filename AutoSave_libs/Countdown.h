@@ -0,0 +1,57 @@
+// Countdown.h : The second-by-second logic behind PeriodicSender.
+// Counts down from the interval to zero, optionally after a short
+// delay, and tells the caller what happened with each step.
+// Doesn't know about timers or windows, so it can be driven by anything.
+// Never throws exceptions.
+
+#pragma once
+
+#include "stdafx.h"
+
+class Countdown
+{
+public:
+	enum Event {
+		EV_NONE,
+		EV_DELAYATZERO,
+		EV_FIVESECONDSLEFT,
+		EV_LESSTHANFIVELEFT, // getSecondsLeft() says how many.
+		EV_ATZERO
+	};
+
+	Countdown(UINT interval)
+		: m_interval(interval), m_isStarted(false), m_isPaused(false),
+		  m_mainSecondsLeft(0), m_delaySecondsLeft(0) {}
+
+	inline UINT getInterval() const { return m_interval; }
+	inline void setInterval(UINT interval) { m_interval = interval; }
+
+	inline bool isStarted() const { return m_isStarted; }
+	inline bool isPaused() const { return m_isPaused; }
+	inline bool isRunning() const { return m_isStarted && !m_isPaused; }
+	inline UINT getSecondsLeft() const { return m_mainSecondsLeft; }
+	inline UINT getDelaySecondsLeft() const { return m_delaySecondsLeft; }
+
+	void start();
+	void stop();
+	Event step(); // To be called once per second.
+
+	// Both return false if nothing changed.
+	bool pause();
+	bool resume();
+
+	void resetCountdown();
+	void resetDelay();
+	// Leaves no more than the given seconds until zero.
+	void shortenTo(UINT secondsLeft);
+
+	static const UINT delayTime = 2;
+
+private:
+	UINT m_interval;
+
+	bool m_isStarted;
+	bool m_isPaused;
+	UINT m_mainSecondsLeft;
+	UINT m_delaySecondsLeft;
+};
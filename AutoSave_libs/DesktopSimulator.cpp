@@ -0,0 +1,583 @@
+#include "stdafx.h"
+#include "DesktopSimulator.h"
+
+
+HWND SimulatedDesktop::openWindow(const wstring& title, DWORD processId,
+	bool isVisible)
+{
+	HWND hwnd = (HWND) ++m_lastHwnd;
+	m_windows.push_back({ hwnd, title, processId, isVisible, L"", false, false,
+		0, 0, 0, getTime() });
+	changeForeground(hwnd);
+	return hwnd;
+}
+
+
+
+void SimulatedDesktop::closeWindow(HWND hwnd)
+{
+	auto it = std::find_if(m_windows.begin(), m_windows.end(),
+		[hwnd](const Window& window) { return window.hwnd == hwnd; });
+	if (it != m_windows.end())
+		m_windows.erase(it);
+	if (m_foreground == hwnd)
+		changeForeground(0);
+}
+
+
+
+void SimulatedDesktop::setTitle(HWND hwnd, const wstring& title)
+{
+	Window* pWindow = find(hwnd);
+	if (pWindow != NULL)
+		pWindow->title = title;
+}
+
+
+
+void SimulatedDesktop::setExecutable(HWND hwnd, const wstring& executable)
+{
+	Window* pWindow = find(hwnd);
+	if (pWindow != NULL)
+		pWindow->executable = executable;
+}
+
+
+
+void SimulatedDesktop::setForeground(HWND hwnd)
+{
+	Window* pWindow = find(hwnd);
+	if (pWindow != NULL)
+		pWindow->isMinimized = false;
+	changeForeground((pWindow != NULL) ? hwnd : 0);
+}
+
+
+
+void SimulatedDesktop::minimizeWindow(HWND hwnd)
+{
+	Window* pWindow = find(hwnd);
+	if (pWindow == NULL)
+		return;
+	pWindow->isMinimized = true;
+	if (m_foreground == hwnd)
+		changeForeground(0);
+}
+
+
+
+void SimulatedDesktop::setHung(HWND hwnd, bool isHung)
+{
+	Window* pWindow = find(hwnd);
+	if (pWindow != NULL)
+		pWindow->isHung = isHung;
+}
+
+
+
+void SimulatedDesktop::setResponseTime(HWND hwnd, DWORD responseTime)
+{
+	Window* pWindow = find(hwnd);
+	if (pWindow != NULL)
+		pWindow->responseTime = responseTime;
+}
+
+
+
+void SimulatedDesktop::setCpuLoad(HWND hwnd, UINT percent)
+{
+	Window* pWindow = find(hwnd);
+	if (pWindow == NULL)
+		return;
+	pWindow->cpuTime = getProcessCpuTime(hwnd);
+	pWindow->cpuSince = getTime();
+	pWindow->cpuLoad = percent;
+}
+
+
+
+void SimulatedDesktop::enumWindows(const std::function<bool(HWND)>& callback) const
+{
+	for (const Window& window : m_windows)
+	{
+		if (!callback(window.hwnd))
+			break;
+	}
+}
+
+
+
+wstring SimulatedDesktop::getWindowText(HWND hwnd) const
+{
+	const Window* pWindow = find(hwnd);
+	if (pWindow == NULL)
+		return L"";
+	if (pWindow->isHung)
+	{
+		if (std::find(m_unresponsive.begin(), m_unresponsive.end(), hwnd) ==
+			m_unresponsive.end())
+		{
+			m_unresponsive.push_back(hwnd);
+		}
+		return L"";
+	}
+	return pWindow->title;
+}
+
+
+
+vector<HWND> SimulatedDesktop::takeUnresponsiveWindows() const
+{
+	vector<HWND> windows;
+	windows.swap(m_unresponsive);
+	return windows;
+}
+
+
+
+DWORD SimulatedDesktop::getWindowProcessId(HWND hwnd) const
+{
+	const Window* pWindow = find(hwnd);
+	return (pWindow != NULL) ? pWindow->processId : 0;
+}
+
+
+
+wstring SimulatedDesktop::getWindowExecutable(HWND hwnd) const
+{
+	const Window* pWindow = find(hwnd);
+	return (pWindow != NULL) ? pWindow->executable : L"";
+}
+
+
+
+bool SimulatedDesktop::isWindowVisible(HWND hwnd) const
+{
+	const Window* pWindow = find(hwnd);
+	return (pWindow != NULL) && pWindow->isVisible;
+}
+
+
+
+bool SimulatedDesktop::isWindowMinimized(HWND hwnd) const
+{
+	const Window* pWindow = find(hwnd);
+	return (pWindow != NULL) && pWindow->isMinimized;
+}
+
+
+
+bool SimulatedDesktop::isWindowResponding(HWND hwnd, DWORD timeout) const
+{
+	const Window* pWindow = find(hwnd);
+	return (pWindow != NULL) && !pWindow->isHung && pWindow->responseTime <= timeout;
+}
+
+
+
+ULONGLONG SimulatedDesktop::getProcessCpuTime(HWND hwnd) const
+{
+	const Window* pWindow = find(hwnd);
+	if (pWindow == NULL)
+		return 0;
+	return pWindow->cpuTime + (getTime() - pWindow->cpuSince) * pWindow->cpuLoad / 100;
+}
+
+
+
+const SimulatedDesktop::Window* SimulatedDesktop::find(HWND hwnd) const
+{
+	for (const Window& window : m_windows)
+	{
+		if (window.hwnd == hwnd)
+			return &window;
+	}
+	return NULL;
+}
+
+
+
+SimulatedDesktop::Window* SimulatedDesktop::find(HWND hwnd)
+{
+	const SimulatedDesktop* pThis = this;
+	return const_cast<Window*>(pThis->find(hwnd));
+}
+
+
+
+void SimulatedDesktop::changeForeground(HWND hwnd)
+{
+	if (hwnd == m_foreground)
+		return;
+	m_foreground = hwnd;
+	if (m_onForeground)
+		m_onForeground(hwnd);
+}
+
+
+
+UINT RecordingInputSink::send(const vector<KeyEvent>& events)
+{
+	m_records.push_back({ m_clock.getTickCount(),
+		m_windows.getForegroundWindow(), events, 0 });
+	if (m_onSend)
+		m_onSend(m_records.back());
+	return (UINT) events.size();
+}
+
+
+
+void RecordingInputSink::wait(DWORD milliseconds)
+{
+	if (!m_records.empty())
+		m_records.back().waitAfter += milliseconds;
+}
+
+
+
+void RecordingInputSink::pressKey(WORD key)
+{
+	simulateInput();
+	if (std::find(m_pressedKeys.begin(), m_pressedKeys.end(), key) ==
+		m_pressedKeys.end())
+	{
+		m_pressedKeys.push_back(key);
+	}
+}
+
+
+
+void RecordingInputSink::releaseKey(WORD key)
+{
+	simulateInput();
+	m_pressedKeys.erase(
+		std::remove(m_pressedKeys.begin(), m_pressedKeys.end(), key),
+		m_pressedKeys.end());
+}
+
+
+
+void SimulatedFileSystem::writeFile(const wstring& path, ULONGLONG size)
+{
+	m_files[path] = { true, size, m_clock.getTickCount() };
+	++m_writeCount;
+	bool isWatched = std::find(m_watched.begin(), m_watched.end(), path) !=
+		m_watched.end();
+	bool isReported = std::find(m_changes.begin(), m_changes.end(), path) !=
+		m_changes.end();
+	if (isWatched && !isReported)
+		m_changes.push_back(path);
+}
+
+
+
+bool SimulatedFileSystem::watch(const wstring& path)
+{
+	m_watched.push_back(path);
+	return true;
+}
+
+
+
+vector<wstring> SimulatedFileSystem::takeChanges()
+{
+	vector<wstring> changes;
+	changes.swap(m_changes);
+	return changes;
+}
+
+
+
+FileStamp SimulatedFileSystem::getStamp(const wstring& path) const
+{
+	auto it = m_files.find(path);
+	if (it == m_files.end())
+		return { false, 0, 0 };
+	return it->second;
+}
+
+
+
+SimulatedApplication::SimulatedApplication(SimulatedDesktop& desktop,
+	RecordingInputSink& input, SimulatedFileSystem& files, const wstring& title,
+	const wstring& executable, DWORD processId)
+	: m_desktop(desktop), m_input(input), m_files(files), m_dialog(0),
+	  m_processId(processId), m_latency(0),
+	  m_saveHotkey(MAKEWORD('S', HOTKEYF_CONTROL)), m_lastInputTime(0),
+	  m_saveCount(0), m_dialogCount(0), m_missedCount(0)
+{
+	m_window = desktop.openWindow(title, processId);
+	desktop.setExecutable(m_window, executable);
+	m_input.setSendHandler([this](const RecordingInputSink::Record& record) {
+		onSend(record);
+	});
+}
+
+
+
+void SimulatedApplication::onSend(const RecordingInputSink::Record& record)
+{
+	// The record is the last one; the one before may have waited.
+	const vector<RecordingInputSink::Record>& records = m_input.getRecords();
+	ULONGLONG time = record.time;
+	if (records.size() >= 2)
+		time = __max(time, m_lastInputTime + records[records.size() - 2].waitAfter);
+	m_lastInputTime = time;
+
+	if (record.target != m_window && (record.target != m_dialog || m_dialog == 0))
+		return;
+	for (const KeyEvent& event : record.events)
+	{
+		if (event.isKeyUp)
+			m_modifiersDown.erase(event.key);
+		else
+			onKeyDown(event.key, time);
+	}
+}
+
+
+
+void SimulatedApplication::onKeyDown(WORD key, ULONGLONG time)
+{
+	static const struct { WORD key; BYTE flag; } modifiers[] = {
+		{ VK_CONTROL, HOTKEYF_CONTROL }, { VK_SHIFT, HOTKEYF_SHIFT },
+		{ VK_MENU, HOTKEYF_ALT },
+	};
+	for (const auto& modifier : modifiers)
+	{
+		if (key == modifier.key)
+		{
+			m_modifiersDown[key] = time;
+			return;
+		}
+	}
+
+	if (key == VK_ESCAPE && m_dialog != 0)
+	{
+		m_desktop.closeWindow(m_dialog);
+		m_dialog = 0;
+		m_desktop.setForeground(m_window);
+		return;
+	}
+	if (key != LOBYTE(m_saveHotkey))
+		return;
+
+	BYTE flags = 0;
+	for (const auto& modifier : modifiers)
+	{
+		auto it = m_modifiersDown.find(modifier.key);
+		if (it != m_modifiersDown.end() && it->second + m_latency <= time)
+			flags |= modifier.flag;
+	}
+	if (flags == (HIBYTE(m_saveHotkey) & ~HOTKEYF_EXT))
+		save();
+	else
+		++m_missedCount;
+}
+
+
+
+void SimulatedApplication::save()
+{
+	++m_saveCount;
+	if (!m_document.empty())
+	{
+		// A new size, so that every save changes the stamp.
+		m_files.writeFile(m_document, 1000 + m_saveCount);
+	}
+	else if (m_dialog == 0)
+	{
+		++m_dialogCount;
+		m_dialog = m_desktop.openWindow(L"Save As", m_processId);
+	}
+}
+
+
+
+DesktopSimulator::DesktopSimulator(const Configuration& cfg)
+	: m_cfg(cfg),
+	  m_desktop(&m_clock),
+	  m_input(m_clock, m_desktop),
+	  m_fileSystem(m_clock),
+	  m_verifier(m_fileSystem, m_clock),
+	  m_countdown(cfg.settings.getInterval()),
+	  m_scheduler(m_cfg, m_countdown, m_clock, m_desktop, m_input, *this),
+	  m_nextTick(0),
+	  m_isTimerAsleep(false),
+	  m_indicator(IND_IDLE),
+	  m_isAlertShown(false),
+	  m_alertCount(0),
+	  m_saveFailedCount(0)
+{
+}
+
+
+
+void DesktopSimulator::verifySaves(const vector<wstring>& files,
+	ULONGLONG timeout, UINT maxRetries)
+{
+	m_verifier.setTimeout(timeout);
+	m_verifier.setMaxRetries(maxRetries);
+	m_verifier.setFiles(files);
+	m_scheduler.setVerifier(m_verifier.isActive() ? &m_verifier : NULL);
+}
+
+
+
+void DesktopSimulator::reportForegroundChanges(bool isReported,
+	ULONGLONG delivery)
+{
+	m_scheduler.setForegroundReported(isReported);
+	if (!isReported)
+	{
+		m_desktop.stopWatching();
+		if (m_isTimerAsleep)
+		{
+			m_isTimerAsleep = false;
+			m_nextTick = m_clock.getTickCount() + 1000;
+		}
+		return;
+	}
+	m_desktop.startWatching([this, delivery](HWND hwnd) {
+		at(m_clock.getTickCount() + delivery, [this, hwnd]() {
+			onForegroundChanged(hwnd);
+		});
+	});
+}
+
+
+
+void DesktopSimulator::start()
+{
+	m_countdown.setInterval(m_cfg.settings.getInterval());
+	m_countdown.start();
+	m_nextTick = m_clock.getTickCount() + 1000;
+	m_isTimerAsleep = false;
+	m_indicator = IND_IDLE;
+}
+
+
+
+void DesktopSimulator::stop()
+{
+	m_countdown.stop();
+}
+
+
+
+void DesktopSimulator::pause()
+{
+	m_countdown.pause();
+}
+
+
+
+void DesktopSimulator::resume()
+{
+	if (m_countdown.resume())
+	{
+		m_nextTick = m_clock.getTickCount() + 1000;
+		m_isTimerAsleep = false;
+	}
+}
+
+
+
+void DesktopSimulator::at(ULONGLONG time, const std::function<void()>& action)
+{
+	m_actions.emplace(time, action);
+}
+
+
+
+void DesktopSimulator::runUntil(ULONGLONG time)
+{
+	while (true)
+	{
+		const bool isActionDue = !m_actions.empty() &&
+			m_actions.begin()->first <= time;
+		const bool isTickDue = isTimerSet() && m_nextTick <= time;
+		if (!isActionDue && !isTickDue)
+			break;
+
+		if (isActionDue && (!isTickDue || m_actions.begin()->first <= m_nextTick))
+		{
+			auto it = m_actions.begin();
+			if (it->first > m_clock.getTickCount())
+				m_clock.setTime(it->first);
+			std::function<void()> action = it->second;
+			m_actions.erase(it);
+			action();
+		}
+		else {
+			m_clock.setTime(m_nextTick);
+			m_nextTick += 1000;
+			m_scheduler.onTick();
+			m_scheduler.handle(m_countdown.step());
+			m_isTimerAsleep = m_scheduler.canIdleAtZero();
+		}
+	}
+	if (time > m_clock.getTickCount())
+		m_clock.setTime(time);
+}
+
+
+
+bool DesktopSimulator::isTimerSet() const
+{
+	return m_countdown.isRunning() && !m_isTimerAsleep;
+}
+
+
+
+// Like Application, asks again shortly while a key is held down.
+void DesktopSimulator::onForegroundChanged(HWND hwnd)
+{
+	if (m_scheduler.onForegroundChanged(hwnd))
+	{
+		at(m_clock.getTickCount() + Scheduler::getForegroundRetryDelay(), [this]() {
+			onForegroundChanged(m_desktop.getForegroundWindow());
+		});
+	}
+	if (m_isTimerAsleep && !m_scheduler.canIdleAtZero())
+	{
+		m_isTimerAsleep = false;
+		m_nextTick = m_clock.getTickCount() + 1000;
+	}
+}
+
+
+
+void DesktopSimulator::showIndicator(Indicator indicator)
+{
+	m_indicator = indicator;
+}
+
+
+
+void DesktopSimulator::showFiveSecondsAlert()
+{
+	m_isAlertShown = true;
+	++m_alertCount;
+}
+
+
+
+void DesktopSimulator::clearAlert()
+{
+	m_isAlertShown = false;
+}
+
+
+
+void DesktopSimulator::showSaveFailedAlert()
+{
+	++m_saveFailedCount;
+}
+
+
+
+void DesktopSimulator::onSaveConfirmed(const vector<wstring>& files)
+{
+	m_confirmedSaves.push_back(files);
+}
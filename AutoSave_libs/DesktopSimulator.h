@@ -0,0 +1,350 @@
+// DesktopSimulator.h : Runs the Scheduler against a scripted desktop in
+// virtual time, so that its behavior can be tested and measured without
+// Windows and without waiting.
+// VirtualClock, SimulatedDesktop, RecordingInputSink, and
+// SimulatedFileSystem implement the Platform.h interfaces; they can also
+// be used on their own.
+// Time is in milliseconds. Like PeriodicSender's timer, the countdown is
+// stepped once per second, starting one second after start().
+// Scripted actions run before a timer tick that is due at the same time.
+// Never throws exceptions (except std::bad_alloc), but scripted actions
+// may throw; the exception is passed on to the caller of runUntil().
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+#include "Countdown.h"
+#include "Configuration.h"
+#include "Scheduler.h"
+#include "SaveVerifier.h"
+
+using std::wstring;
+using std::vector;
+
+class VirtualClock : public Clock
+{
+public:
+	VirtualClock() : m_now(0) {}
+
+	virtual ULONGLONG getTickCount() const { return m_now; }
+
+	inline void setTime(ULONGLONG now) { m_now = now; }
+	inline void advance(ULONGLONG milliseconds) { m_now += milliseconds; }
+
+private:
+	ULONGLONG m_now;
+};
+
+
+
+// Windows are enumerated in the order they were opened. A newly opened
+// window becomes the foreground window. Closing the foreground window
+// leaves no foreground window, i.e. getForegroundWindow() returns 0, and
+// so does minimizing it; bringing a minimized window to the foreground
+// restores it.
+// Each change of the foreground window is reported to the watcher's
+// handler right away. The caption of a hung window is empty, as the
+// WindowEnumerator interface has it.
+// Each window stands for a process of its own, which keeps the given
+// share of a core busy as the clock goes on. Without a clock, processes
+// use no processor time.
+class SimulatedDesktop : public WindowEnumerator, public ForegroundWatcher
+{
+public:
+	SimulatedDesktop(const Clock* pClock = NULL)
+		: m_pClock(pClock), m_lastHwnd(0), m_foreground(0) {}
+	virtual ~SimulatedDesktop() {}
+
+	HWND openWindow(const wstring& title, DWORD processId = 0,
+		bool isVisible = true);
+	void closeWindow(HWND hwnd);
+	void setTitle(HWND hwnd, const wstring& title);
+	void setExecutable(HWND hwnd, const wstring& executable);
+	void setForeground(HWND hwnd);
+	void minimizeWindow(HWND hwnd);
+	// Like a program that stops answering messages, and recovers again.
+	void setHung(HWND hwnd, bool isHung);
+	// How long the window's program takes to handle a message, in
+	// milliseconds, e.g. in the middle of a render.
+	void setResponseTime(HWND hwnd, DWORD responseTime);
+	// Of one core; may be more than 100 for several.
+	void setCpuLoad(HWND hwnd, UINT percent);
+	inline size_t getWindowCount() const { return m_windows.size(); }
+
+	virtual void enumWindows(const std::function<bool(HWND)>& callback) const;
+	virtual wstring getWindowText(HWND hwnd) const;
+	virtual vector<HWND> takeUnresponsiveWindows() const;
+	virtual DWORD getWindowProcessId(HWND hwnd) const;
+	virtual wstring getWindowExecutable(HWND hwnd) const;
+	virtual bool isOwnedWindow(HWND hwnd) const { return false; }
+	virtual bool isWindowVisible(HWND hwnd) const;
+	virtual bool isWindowMinimized(HWND hwnd) const;
+	virtual HWND getForegroundWindow() const { return m_foreground; }
+	virtual bool isWindowResponding(HWND hwnd, DWORD timeout) const;
+	virtual ULONGLONG getProcessCpuTime(HWND hwnd) const;
+
+	virtual bool startWatching(const Handler& handler) {
+		m_onForeground = handler;
+		return true;
+	}
+	virtual void stopWatching() { m_onForeground = Handler(); }
+
+private:
+	struct Window
+	{
+		HWND hwnd;
+		wstring title;
+		DWORD processId;
+		bool isVisible;
+		wstring executable;
+		bool isMinimized;
+		bool isHung;
+		DWORD responseTime;
+		UINT cpuLoad;       // In percent of a core.
+		ULONGLONG cpuTime;  // Used up to cpuSince.
+		ULONGLONG cpuSince;
+	};
+
+	const Window* find(HWND hwnd) const;
+	Window* find(HWND hwnd);
+	void changeForeground(HWND hwnd);
+
+	inline ULONGLONG getTime() const {
+		return (m_pClock != NULL) ? m_pClock->getTickCount() : 0;
+	}
+
+	const Clock* m_pClock;
+	vector<Window> m_windows;
+	UINT_PTR m_lastHwnd;
+	HWND m_foreground;
+	Handler m_onForeground;
+	mutable vector<HWND> m_unresponsive;
+};
+
+
+
+// Keeps everything that is sent, together with the time and the
+// foreground window at that moment. Waiting doesn't take any time; it
+// is added to the last record instead. Keys can be held down by hand, and
+// the user can be made to type. Sent input doesn't count as user input.
+// A send handler can play the application that receives the input.
+class RecordingInputSink : public InputSink
+{
+public:
+	struct Record
+	{
+		ULONGLONG time;
+		HWND target;
+		vector<KeyEvent> events;
+		DWORD waitAfter;
+	};
+	typedef std::function<void(const Record&)> SendHandler;
+
+	RecordingInputSink(const Clock& clock, const WindowEnumerator& windows)
+		: m_clock(clock), m_windows(windows), m_lastInputTime(0) {}
+	virtual ~RecordingInputSink() {}
+
+	virtual UINT send(const vector<KeyEvent>& events);
+	virtual void wait(DWORD milliseconds);
+	virtual bool isAnyKeyPressed() const { return !m_pressedKeys.empty(); }
+	virtual ULONGLONG getLastInputTime() const { return m_lastInputTime; }
+
+	void pressKey(WORD key);
+	void releaseKey(WORD key);
+	// Any input from the user, as far as getLastInputTime() is concerned.
+	inline void simulateInput() { m_lastInputTime = m_clock.getTickCount(); }
+
+	inline void setSendHandler(const SendHandler& handler) { m_onSend = handler; }
+
+	inline const vector<Record>& getRecords() const { return m_records; }
+	inline void clearRecords() { m_records.clear(); }
+
+private:
+	const Clock& m_clock;
+	const WindowEnumerator& m_windows;
+	vector<WORD> m_pressedKeys;
+	ULONGLONG m_lastInputTime;
+	vector<Record> m_records;
+	SendHandler m_onSend;
+};
+
+
+
+// Files that exist only as a stamp. Writing a file changes its stamp
+// and reports the change to watchers, as the system would.
+class SimulatedFileSystem : public FileWatcher
+{
+public:
+	SimulatedFileSystem(const Clock& clock) : m_clock(clock), m_writeCount(0) {}
+	virtual ~SimulatedFileSystem() {}
+
+	// Creates the file if necessary. The new modification time is the
+	// clock's time.
+	void writeFile(const wstring& path, ULONGLONG size);
+	inline ULONGLONG getWriteCount() const { return m_writeCount; }
+
+	virtual bool watch(const wstring& path);
+	virtual void unwatchAll() { m_watched.clear(); m_changes.clear(); }
+	virtual vector<wstring> takeChanges();
+	virtual FileStamp getStamp(const wstring& path) const;
+
+private:
+	const Clock& m_clock;
+	std::map<wstring, FileStamp> m_files;
+	vector<wstring> m_watched;
+	vector<wstring> m_changes;
+	ULONGLONG m_writeCount;
+};
+
+
+
+// Plays a program that saves its document when it gets its save hotkey,
+// to see how the input AutoSave sends comes across. Like some real
+// programs, it reads the modifiers only once the key comes in, and
+// misses those that went down less than its input latency before. The
+// waits in between count as time, although the clock doesn't move (see
+// RecordingInputSink). Without a document, saving brings up a Save As
+// dialog of the same process instead, which Escape closes again.
+// Opens its window on construction and takes over the sink's send
+// handler.
+class SimulatedApplication
+{
+public:
+	SimulatedApplication(SimulatedDesktop& desktop, RecordingInputSink& input,
+		SimulatedFileSystem& files, const wstring& title,
+		const wstring& executable, DWORD processId);
+
+	inline HWND getWindow() const { return m_window; }
+	// Zero if the dialog isn't open.
+	inline HWND getDialog() const { return m_dialog; }
+
+	// In milliseconds. Zero takes any input.
+	inline void setInputLatency(DWORD latency) { m_latency = latency; }
+	// Ctrl+S unless set otherwise.
+	inline void setSaveHotkey(WORD hotkey) { m_saveHotkey = hotkey; }
+	// Empty for an untitled document. The file is written with each save.
+	inline void setDocument(const wstring& path) { m_document = path; }
+
+	inline UINT getSaveCount() const { return m_saveCount; }
+	inline UINT getDialogCount() const { return m_dialogCount; }
+	// Save keys that came without all their modifiers.
+	inline UINT getMissedCount() const { return m_missedCount; }
+
+private:
+	SimulatedApplication(const SimulatedApplication&);
+	SimulatedApplication& operator=(const SimulatedApplication&);
+
+	void onSend(const RecordingInputSink::Record& record);
+	void onKeyDown(WORD key, ULONGLONG time);
+	void save();
+
+	SimulatedDesktop& m_desktop;
+	RecordingInputSink& m_input;
+	SimulatedFileSystem& m_files;
+	HWND m_window;
+	HWND m_dialog;
+	DWORD m_processId;
+	DWORD m_latency;
+	WORD m_saveHotkey;
+	wstring m_document;
+
+	// When the last input came, waits included.
+	ULONGLONG m_lastInputTime;
+	std::map<WORD, ULONGLONG> m_modifiersDown;
+	UINT m_saveCount;
+	UINT m_dialogCount;
+	UINT m_missedCount;
+};
+
+
+
+class DesktopSimulator : private SchedulerListener
+{
+public:
+	DesktopSimulator(const Configuration& cfg);
+
+	// Parts of the simulation. Changing them between runs is fine.
+	inline Configuration& getConfiguration() { return m_cfg; }
+	inline VirtualClock& getClock() { return m_clock; }
+	inline SimulatedDesktop& getDesktop() { return m_desktop; }
+	inline RecordingInputSink& getInput() { return m_input; }
+	inline SimulatedFileSystem& getFileSystem() { return m_fileSystem; }
+	inline SaveVerifier& getVerifier() { return m_verifier; }
+	inline const Countdown& getCountdown() const { return m_countdown; }
+	inline const Metrics& getMetrics() const { return m_scheduler.getMetrics(); }
+	// Records against the virtual clock, if the log was made with it.
+	inline void setEventLog(EventLog* pEventLog) { m_scheduler.setEventLog(pEventLog); }
+
+	// Checks saves to the given files, like Application does for
+	// Connected Shortcuts. Turned off by an empty list.
+	void verifySaves(const vector<wstring>& files, ULONGLONG timeout,
+		UINT maxRetries = 1);
+	// Hands the desktop's foreground changes to the Scheduler, each
+	// after the given delay, like a ForegroundWatcher would through the
+	// message loop. The timer then stops while the Scheduler can idle
+	// at zero, and starts again with the change that ends the wait.
+	void reportForegroundChanges(bool isReported, ULONGLONG delivery = 0);
+
+	// Like switching AutoSave on and off. Starting restarts the timer.
+	void start();
+	void stop();
+	// Like opening and closing the context menu.
+	void pause();
+	void resume();
+
+	// Runs action once the virtual clock reaches time. Actions that are
+	// due at the same time run in the order they were added.
+	void at(ULONGLONG time, const std::function<void()>& action);
+
+	void runUntil(ULONGLONG time);
+	inline void runFor(ULONGLONG milliseconds) {
+		runUntil(m_clock.getTickCount() + milliseconds);
+	}
+
+	// What the user would have seen.
+	inline Indicator getIndicator() const { return m_indicator; }
+	inline bool isAlertShown() const { return m_isAlertShown; }
+	inline UINT getAlertCount() const { return m_alertCount; }
+	inline UINT getSaveFailedCount() const { return m_saveFailedCount; }
+	// What the listener was told, one list of files per confirmed save.
+	inline const vector<vector<wstring>>& getConfirmedSaves() const {
+		return m_confirmedSaves;
+	}
+
+	// Save attempts, i.e. hotkeys sent. A macro that waits, or that is
+	// paced for the target, makes several records per save.
+	inline const vector<RecordingInputSink::Record>& getSaves() const {
+		return m_input.getRecords();
+	}
+
+private:
+	// Implement SchedulerListener.
+	virtual void showIndicator(Indicator indicator);
+	virtual void showFiveSecondsAlert();
+	virtual void clearAlert();
+	virtual void showSaveFailedAlert();
+	virtual void onSaveConfirmed(const vector<wstring>& files);
+
+	bool isTimerSet() const;
+	void onForegroundChanged(HWND hwnd);
+
+	Configuration m_cfg;
+	VirtualClock m_clock;
+	SimulatedDesktop m_desktop;
+	RecordingInputSink m_input;
+	SimulatedFileSystem m_fileSystem;
+	SaveVerifier m_verifier;
+	Countdown m_countdown;
+	Scheduler m_scheduler;
+
+	ULONGLONG m_nextTick;
+	bool m_isTimerAsleep;
+	std::multimap<ULONGLONG, std::function<void()>> m_actions;
+
+	Indicator m_indicator;
+	bool m_isAlertShown;
+	UINT m_alertCount;
+	UINT m_saveFailedCount;
+	vector<vector<wstring>> m_confirmedSaves;
+};
@@ -0,0 +1,449 @@
+#include "stdafx.h"
+#include "EventLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+
+namespace {
+	const char fileMagic[] = "ASEV";
+	const unsigned char fileVersion = 1;
+	const size_t fileHeaderSize = 8;
+	const size_t flushBatch = 256;
+
+	size_t roundUpToPowerOfTwo(size_t value)
+	{
+		size_t result = 1;
+		while (result < value)
+			result <<= 1;
+		return result;
+	}
+
+	void putNumber(char* pBytes, ULONGLONG value, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			pBytes[i] = (char) (value & 0xff);
+			value >>= 8;
+		}
+	}
+
+	ULONGLONG getNumber(const char* pBytes, size_t size)
+	{
+		ULONGLONG value = 0;
+		for (size_t i = size; i > 0; --i)
+			value = (value << 8) | (unsigned char) pBytes[i - 1];
+		return value;
+	}
+}
+
+
+
+void EventRecord::encode(char* pBytes) const
+{
+	putNumber(pBytes, time, 8);
+	putNumber(pBytes + 8, id, 4);
+	putNumber(pBytes + 12, arg0, 4);
+	putNumber(pBytes + 16, arg1, 8);
+	putNumber(pBytes + 24, arg2, 8);
+}
+
+
+
+EventRecord EventRecord::decode(const char* pBytes)
+{
+	EventRecord event;
+	event.time = getNumber(pBytes, 8);
+	event.id = (UINT) getNumber(pBytes + 8, 4);
+	event.arg0 = (UINT) getNumber(pBytes + 12, 4);
+	event.arg1 = getNumber(pBytes + 16, 8);
+	event.arg2 = getNumber(pBytes + 24, 8);
+	return event;
+}
+
+
+
+RotatingFileSink::RotatingFileSink(const wstring& path,
+	ULONGLONG maxFileSize, UINT keptFiles)
+	: m_path(path), m_maxFileSize(__max(maxFileSize, (ULONGLONG) 4096)),
+	  m_keptFiles(keptFiles), m_pFile(NULL), m_fileSize(0)
+{
+	open();
+}
+
+
+
+RotatingFileSink::~RotatingFileSink()
+{
+	if (m_pFile != NULL)
+		fclose(m_pFile);
+}
+
+
+
+void RotatingFileSink::write(const EventRecord* pRecords, size_t count)
+{
+	char bytes[EventRecord::encodedSize];
+	for (size_t i = 0; i < count && m_pFile != NULL; ++i)
+	{
+		if (m_fileSize + EventRecord::encodedSize > m_maxFileSize)
+			rotate();
+		if (m_pFile == NULL)
+			break;
+		pRecords[i].encode(bytes);
+		if (fwrite(bytes, 1, sizeof(bytes), m_pFile) == sizeof(bytes))
+			m_fileSize += sizeof(bytes);
+	}
+}
+
+
+
+void RotatingFileSink::flush()
+{
+	if (m_pFile != NULL)
+		fflush(m_pFile);
+}
+
+
+
+string RotatingFileSink::getFileHeader()
+{
+	string header(fileMagic);
+	header.push_back((char) fileVersion);
+	header.resize(fileHeaderSize, '\0');
+	return header;
+}
+
+
+
+// Carries on with an existing file.
+void RotatingFileSink::open()
+{
+	m_pFile = Platform::openFile(m_path, L"ab");
+	if (m_pFile == NULL)
+		return;
+	fseek(m_pFile, 0, SEEK_END);
+	long size = ftell(m_pFile);
+	m_fileSize = (size > 0) ? (ULONGLONG) size : 0;
+	if (m_fileSize == 0)
+	{
+		const string header = getFileHeader();
+		fwrite(header.data(), 1, header.size(), m_pFile);
+		m_fileSize = header.size();
+	}
+}
+
+
+
+void RotatingFileSink::rotate()
+{
+	fclose(m_pFile);
+	m_pFile = NULL;
+	if (m_keptFiles > 0)
+	{
+		for (UINT number = m_keptFiles; number > 1; --number)
+			Platform::renameFile(getKeptPath(number - 1), getKeptPath(number));
+		Platform::renameFile(m_path, getKeptPath(1));
+	}
+	else {
+		Platform::removeFile(m_path);
+	}
+	open();
+}
+
+
+
+wstring RotatingFileSink::getKeptPath(UINT number) const
+{
+	return m_path + L"." + std::to_wstring(number);
+}
+
+
+
+EventLog::EventLog(const Clock& clock, size_t capacity)
+	: m_clock(clock),
+	  m_slots(roundUpToPowerOfTwo(__max(capacity, (size_t) 2))),
+	  m_mask(m_slots.size() - 1),
+	  m_head(0), m_dropped(0), m_tail(0), m_reportedDropped(0),
+	  m_isStopping(false), m_pSink(NULL)
+{
+	for (size_t i = 0; i < m_slots.size(); ++i)
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+
+
+EventLog::~EventLog()
+{
+	stopFlushing();
+}
+
+
+
+// A bounded queue after Dmitry Vyukov's: each slot's sequence number says
+// whether it's free for the producer at that position, or ready for the
+// consumer.
+bool EventLog::push(const EventRecord& event)
+{
+	ULONGLONG position = m_head.load(std::memory_order_relaxed);
+	Slot* pSlot;
+	for (;;)
+	{
+		pSlot = &m_slots[position & m_mask];
+		const ULONGLONG sequence = pSlot->sequence.load(std::memory_order_acquire);
+		const long long difference = (long long) (sequence - position);
+		if (difference == 0)
+		{
+			if (m_head.compare_exchange_weak(position, position + 1,
+				std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else {
+			position = m_head.load(std::memory_order_relaxed);
+		}
+	}
+	pSlot->event = event;
+	pSlot->sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+
+
+size_t EventLog::drain(EventRecord* pRecords, size_t maxCount)
+{
+	std::lock_guard<std::mutex> guard(m_drainLock);
+	size_t count = 0;
+	while (count < maxCount)
+	{
+		Slot& slot = m_slots[m_tail & m_mask];
+		if (slot.sequence.load(std::memory_order_acquire) != m_tail + 1)
+			break; // Empty, or still being written.
+		pRecords[count++] = slot.event;
+		slot.sequence.store(m_tail + m_slots.size(), std::memory_order_release);
+		++m_tail;
+	}
+	return count;
+}
+
+
+
+void EventLog::startFlushing(EventSink& sink, UINT period)
+{
+	stopFlushing();
+	m_pSink = &sink;
+	m_isStopping = false;
+	m_flushThread = std::thread(&EventLog::flushLoop, this, __max(period, 1U));
+}
+
+
+
+void EventLog::stopFlushing()
+{
+	if (!m_flushThread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> guard(m_flushLock);
+		m_isStopping = true;
+	}
+	m_flushCondition.notify_one();
+	m_flushThread.join();
+	m_pSink = NULL;
+}
+
+
+
+void EventLog::flushTo(EventSink& sink)
+{
+	writeAll(sink);
+}
+
+
+
+// Recording never wakes this thread up, so that it stays cheap.
+void EventLog::flushLoop(UINT period)
+{
+	std::unique_lock<std::mutex> lock(m_flushLock);
+	while (!m_isStopping)
+	{
+		m_flushCondition.wait_for(lock, std::chrono::milliseconds(period));
+		lock.unlock();
+		writeAll(*m_pSink);
+		lock.lock();
+	}
+}
+
+
+
+void EventLog::writeAll(EventSink& sink)
+{
+	EventRecord batch[flushBatch];
+	size_t count;
+	bool hasWritten = false;
+	while ((count = drain(batch, flushBatch)) != 0)
+	{
+		sink.write(batch, count);
+		hasWritten = true;
+	}
+
+	// Say where the gap is, after what made it.
+	const ULONGLONG dropped = getDroppedCount();
+	if (dropped != m_reportedDropped)
+	{
+		EventRecord event = { m_clock.getTickCount(), EV_DROPPED, 0,
+			dropped - m_reportedDropped, 0 };
+		m_reportedDropped = dropped;
+		sink.write(&event, 1);
+		hasWritten = true;
+	}
+	if (hasWritten)
+		sink.flush();
+}
+
+
+
+const char* EventLog::getName(EventId id)
+{
+	switch (id)
+	{
+	case EV_STARTED: return "started";
+	case EV_TICK: return "tick";
+	case EV_MATCH: return "match";
+	case EV_RESET: return "reset";
+	case EV_SEND: return "send";
+	case EV_RETRY: return "retry";
+	case EV_SAVE_CONFIRMED: return "save_confirmed";
+	case EV_SAVE_FAILED: return "save_failed";
+	case EV_INTERVAL_CHANGED: return "interval_changed";
+	case EV_CONNECTED: return "connected";
+	case EV_DISCONNECTED: return "disconnected";
+	case EV_EXCEPTION: return "exception";
+	case EV_FATAL: return "fatal";
+	case EV_DROPPED: return "dropped";
+	case EV_STARTUP: return "startup";
+	case EV_TRIGGER: return "trigger";
+	case EV_UNRESPONSIVE: return "unresponsive";
+	case EV_DEFER: return "defer";
+	default: return "";
+	}
+}
+
+
+
+const char* EventLog::getPhaseName(StartupPhase phase)
+{
+	switch (phase)
+	{
+	case SP_CREATED: return "created";
+	case SP_CONFIGURATION: return "configuration";
+	case SP_EVENT_LOG: return "event_log";
+	case SP_COUNTDOWN: return "countdown";
+	case SP_CONTROL_SERVER: return "control_server";
+	case SP_OLE: return "ole";
+	case SP_MENU: return "menu";
+	case SP_SHORTCUTS: return "shortcuts";
+	default: return "";
+	}
+}
+
+
+
+string EventLog::format(const EventRecord& event)
+{
+	char line[160];
+	const unsigned long long arg1 = event.arg1;
+	const unsigned long long arg2 = event.arg2;
+	int length = snprintf(line, sizeof(line), "%10llu.%03u %-16s",
+		(unsigned long long) (event.time / 1000), (UINT) (event.time % 1000),
+		event.id < EV_EVENT_COUNT && event.id != EV_NONE
+		? getName((EventId) event.id) : "unknown");
+	char* pArgs = line + length;
+	const size_t argsSize = sizeof(line) - length;
+
+	switch (event.id)
+	{
+	case EV_STARTED:
+	case EV_CONNECTED:
+	case EV_DISCONNECTED:
+		snprintf(pArgs, argsSize, " pid=%u", event.arg0);
+		break;
+	case EV_TICK:
+	case EV_RESET:
+		snprintf(pArgs, argsSize, " seconds_left=%u", event.arg0);
+		break;
+	case EV_MATCH:
+		snprintf(pArgs, argsSize, " window=0x%llx", arg1);
+		break;
+	case EV_SEND:
+		snprintf(pArgs, argsSize, " keys=%u us=%llu window=0x%llx",
+			event.arg0, arg1, arg2);
+		break;
+	case EV_SAVE_CONFIRMED:
+		snprintf(pArgs, argsSize, " ms=%llu", arg1);
+		break;
+	case EV_INTERVAL_CHANGED:
+		snprintf(pArgs, argsSize, " seconds=%u", event.arg0);
+		break;
+	case EV_EXCEPTION:
+	case EV_FATAL:
+		snprintf(pArgs, argsSize, " error=%u", event.arg0);
+		break;
+	case EV_DROPPED:
+		snprintf(pArgs, argsSize, " count=%llu", arg1);
+		break;
+	case EV_STARTUP:
+		if (event.arg0 < SP_PHASE_COUNT)
+		{
+			snprintf(pArgs, argsSize, " phase=%s ms=%llu",
+				getPhaseName((StartupPhase) event.arg0), arg1);
+		}
+		else {
+			snprintf(pArgs, argsSize, " phase=%u ms=%llu", event.arg0, arg1);
+		}
+		break;
+	case EV_TRIGGER:
+		snprintf(pArgs, argsSize, " trigger=%u seconds_left=%llu",
+			event.arg0, arg1);
+		break;
+	case EV_UNRESPONSIVE:
+		snprintf(pArgs, argsSize, " pid=%u window=0x%llx", event.arg0, arg1);
+		break;
+	case EV_DEFER:
+		snprintf(pArgs, argsSize, " readiness=%u ms=%llu window=0x%llx",
+			event.arg0, arg1, arg2);
+		break;
+	case EV_RETRY:
+	case EV_SAVE_FAILED:
+		break;
+	default:
+		snprintf(pArgs, argsSize, " id=%u %u %llu %llu",
+			event.id, event.arg0, arg1, arg2);
+		break;
+	}
+
+	// Trailing spaces from the padded name.
+	string result(line);
+	result.erase(result.find_last_not_of(' ') + 1);
+	return result;
+}
+
+
+
+bool EventLog::decodeFile(const string& bytes, vector<EventRecord>* pRecords)
+{
+	if (bytes.compare(0, fileHeaderSize, RotatingFileSink::getFileHeader()) != 0)
+		return false;
+	pRecords->clear();
+	for (size_t pos = fileHeaderSize; pos + EventRecord::encodedSize <= bytes.size();
+		pos += EventRecord::encodedSize)
+	{
+		pRecords->push_back(EventRecord::decode(bytes.data() + pos));
+	}
+	return true;
+}
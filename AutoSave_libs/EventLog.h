@@ -0,0 +1,201 @@
+// EventLog.h : A structured log of what AutoSave does, for finding out
+// afterwards why it did or didn't save.
+// Events are fixed-size binary records that go into a ring buffer which
+// is allocated up front. Recording one takes a few nanoseconds, never
+// allocates, and never blocks; if the buffer is full, the event is
+// dropped and counted. A thread of the log's own moves the records to an
+// EventSink every so often, e.g. a RotatingFileSink, and the
+// autosave_events tool (see AutoSave_tools/EventLogViewer.cpp) turns
+// such files back into text.
+// Any number of threads may record; only the flushing thread, or whoever
+// calls drain, takes records out.
+// Never throws exceptions (except std::bad_alloc and std::system_error
+// when starting the thread).
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+using std::string;
+using std::wstring;
+using std::vector;
+
+struct EventRecord
+{
+	ULONGLONG time;  // Clock ticks, in milliseconds.
+	UINT id;         // An EventLog::EventId.
+	UINT arg0;       // What the arguments mean depends on the event.
+	ULONGLONG arg1;
+	ULONGLONG arg2;
+
+	// How a record is stored in files, little-endian.
+	static const size_t encodedSize = 32;
+	void encode(char* pBytes) const;
+	static EventRecord decode(const char* pBytes);
+};
+
+
+
+class EventSink
+{
+public:
+	virtual ~EventSink() {}
+
+	virtual void write(const EventRecord* pRecords, size_t count) = 0;
+	virtual void flush() {}
+};
+
+
+
+// Appends to a file, and starts a new one when it gets too big. The old
+// ones are kept as "path.1" (the newest) to "path.N". Every file starts
+// with a header, so that each can be decoded on its own.
+class RotatingFileSink : public EventSink
+{
+public:
+	RotatingFileSink(const wstring& path, ULONGLONG maxFileSize, UINT keptFiles);
+	virtual ~RotatingFileSink();
+
+	// Returns false if the file can't be opened; then writing does nothing.
+	inline bool isOpen() const { return m_pFile != NULL; }
+
+	virtual void write(const EventRecord* pRecords, size_t count);
+	virtual void flush();
+
+	static string getFileHeader();
+
+private:
+	RotatingFileSink(const RotatingFileSink&);
+	RotatingFileSink& operator=(const RotatingFileSink&);
+
+	void open();
+	void rotate();
+	wstring getKeptPath(UINT number) const;
+
+	wstring m_path;
+	ULONGLONG m_maxFileSize;
+	UINT m_keptFiles;
+	FILE* m_pFile;
+	ULONGLONG m_fileSize;
+};
+
+
+
+class EventLog
+{
+public:
+	enum EventId {
+		EV_NONE,
+		EV_STARTED,          // arg0: process ID.
+		EV_TICK,             // arg0: seconds left in the countdown.
+		EV_MATCH,            // At zero, a matching window is in front. arg1: window.
+		EV_RESET,            // No matching window. arg0: seconds left when found out.
+		EV_SEND,             // arg0: key presses, arg1: microseconds, arg2: window.
+		EV_RETRY,            // The last save didn't change the file.
+		EV_SAVE_CONFIRMED,   // arg1: milliseconds from input to file change.
+		EV_SAVE_FAILED,
+		EV_INTERVAL_CHANGED, // arg0: new interval in seconds.
+		EV_CONNECTED,        // arg0: process ID of the connected application.
+		EV_DISCONNECTED,     // arg0: process ID of the connected application.
+		EV_EXCEPTION,        // arg0: error code.
+		EV_FATAL,            // The message loop failed. arg0: error code.
+		EV_DROPPED,          // arg1: events lost since the last flush.
+		EV_STARTUP,          // arg0: StartupPhase done, arg1: milliseconds since start.
+		EV_TRIGGER,          // A save is due early. arg0: MiscSettings::Trigger,
+		                     // arg1: seconds that were left in the countdown.
+		EV_UNRESPONSIVE,     // A window's caption couldn't be read in time.
+		                     // arg0: process ID, arg1: window.
+		EV_DEFER,            // The save waits for its target. arg0:
+		                     // ReadinessProbe::Readiness, arg1: milliseconds
+		                     // since the first deferral, arg2: window.
+		EV_EVENT_COUNT
+	};
+
+	// In the order in which they usually happen. Those after
+	// SP_CONTROL_SERVER are put off until first needed.
+	enum StartupPhase {
+		SP_CREATED,
+		SP_CONFIGURATION,
+		SP_EVENT_LOG,
+		SP_COUNTDOWN,
+		SP_CONTROL_SERVER,
+		SP_OLE,
+		SP_MENU,
+		SP_SHORTCUTS,
+		SP_PHASE_COUNT
+	};
+
+	// Capacity is rounded up to a power of two.
+	EventLog(const Clock& clock, size_t capacity = 4096);
+	~EventLog();
+
+	inline void record(EventId id, UINT arg0 = 0, ULONGLONG arg1 = 0,
+		ULONGLONG arg2 = 0)
+	{
+		EventRecord event = { m_clock.getTickCount(), (UINT) id, arg0, arg1, arg2 };
+		push(event);
+	}
+
+	// Returns false, and counts the event as dropped, if the buffer is full.
+	bool push(const EventRecord& event);
+
+	// Takes out up to maxCount of the oldest records, and returns how many.
+	size_t drain(EventRecord* pRecords, size_t maxCount);
+
+	inline size_t getCapacity() const { return m_slots.size(); }
+	inline ULONGLONG getDroppedCount() const {
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+	// Writes everything to the sink every period milliseconds until
+	// stopFlushing is called. Doesn't take ownership.
+	void startFlushing(EventSink& sink, UINT period);
+	// Writes what's left and stops the thread.
+	void stopFlushing();
+	// Writes everything to the sink right away, on this thread. Only
+	// while not flushing.
+	void flushTo(EventSink& sink);
+
+	static const char* getName(EventId id);
+	static const char* getPhaseName(StartupPhase phase);
+	// One line, without line break.
+	static string format(const EventRecord& event);
+	// Returns false if bytes are no event log file. Decodes as many
+	// records as there are, even if the last one has been cut off.
+	static bool decodeFile(const string& bytes, vector<EventRecord>* pRecords);
+
+private:
+	EventLog(const EventLog&);
+	EventLog& operator=(const EventLog&);
+
+	struct Slot
+	{
+		std::atomic<ULONGLONG> sequence;
+		EventRecord event;
+	};
+
+	void flushLoop(UINT period);
+	void writeAll(EventSink& sink);
+
+	const Clock& m_clock;
+	vector<Slot> m_slots;
+	size_t m_mask;
+	std::atomic<ULONGLONG> m_head;
+	std::atomic<ULONGLONG> m_dropped;
+
+	std::mutex m_drainLock; // Between consumers only.
+	ULONGLONG m_tail;
+	ULONGLONG m_reportedDropped;
+
+	std::mutex m_flushLock;
+	std::condition_variable m_flushCondition;
+	bool m_isStopping;
+	EventSink* m_pSink;
+	std::thread m_flushThread;
+};
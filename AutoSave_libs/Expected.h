@@ -0,0 +1,78 @@
+// Expected.h : Results that are either a value or the error that kept
+// it from being computed, for paths where failure is common and cheap,
+// such as looking at every shortcut in a folder or reading settings that
+// older versions never wrote. Throwing and catching an AutoSaveException
+// for each of those costs more than the work itself.
+// Errors are HRESULTs, like AutoSaveException::hResult, so that code
+// near the UI can still turn them into exceptions with valueOrThrow or
+// throwIfError and show them the usual way.
+// Nothing here throws, except valueOrThrow and throwIfError.
+
+#pragma once
+
+#include "stdafx.h"
+#include "AutoSaveException.h"
+
+class ErrorCode
+{
+public:
+	// No error.
+	ErrorCode() : m_hResult(S_OK) {}
+	explicit ErrorCode(HRESULT hResult) : m_hResult(hResult) {}
+	static inline ErrorCode fromWin32(DWORD errorCode) {
+		return ErrorCode(HRESULT_FROM_WIN32(errorCode));
+	}
+
+	inline bool isError() const { return FAILED(m_hResult); }
+	inline HRESULT hResult() const { return m_hResult; }
+	// Same as AutoSaveException::errorCode, e.g. ERROR_FILE_NOT_FOUND.
+	inline long errorCode() const { return HRESULT_CODE(m_hResult); }
+
+	template<typename E>
+	inline void throwIfError() const { throwOnFailure<E>(m_hResult); }
+
+private:
+	HRESULT m_hResult;
+};
+
+
+
+// T must be default-constructible; an error holds T().
+template<typename T>
+class Expected
+{
+public:
+	Expected(const T& value) : m_value(value) {}
+	Expected(T&& value) : m_value(std::move(value)) {}
+	// error must be an error.
+	Expected(ErrorCode error) : m_value(), m_error(error) {
+		assert(error.isError());
+	}
+
+	inline bool hasValue() const { return !m_error.isError(); }
+	inline explicit operator bool() const { return hasValue(); }
+	// ErrorCode() if there is a value.
+	inline ErrorCode error() const { return m_error; }
+
+	// Only if there is a value.
+	inline const T& value() const { assert(hasValue()); return m_value; }
+	inline T& value() { assert(hasValue()); return m_value; }
+	inline T valueOr(const T& fallback) const {
+		return hasValue() ? m_value : fallback;
+	}
+
+	template<typename E>
+	inline T& valueOrThrow() {
+		m_error.throwIfError<E>();
+		return m_value;
+	}
+	template<typename E>
+	inline const T& valueOrThrow() const {
+		m_error.throwIfError<E>();
+		return m_value;
+	}
+
+private:
+	T m_value;
+	ErrorCode m_error;
+};
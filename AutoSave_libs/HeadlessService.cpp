@@ -0,0 +1,237 @@
+#include "stdafx.h"
+#include "HeadlessService.h"
+
+
+HeadlessService::HeadlessService(Configuration& cfg, const Clock& clock,
+	const WindowEnumerator& windows, InputSink& input)
+	: m_cfg(cfg), m_clock(clock), m_windows(windows), m_input(input),
+	  m_countdown(cfg.settings.getInterval()),
+	  m_scheduler(m_cfg, m_countdown, clock, windows, input, *this),
+	  m_control(m_scheduler.getMetrics(), clock,
+		[this](ControlService::Command command) { post(command); }),
+	  m_isStopping(false)
+{
+}
+
+
+
+HeadlessService::~HeadlessService()
+{
+	// The server thread may still be handing on a command.
+	m_pServer.reset();
+}
+
+
+
+int HeadlessService::run()
+{
+	start();
+	if (!m_endpointName.empty())
+	{
+		try {
+			ControlService* pService = &m_control;
+			m_pServer = Platform::startControlServer(m_endpointName,
+				[pService](const string& request) { return pService->handle(request); });
+		}
+		catch (AutoSaveException&) {
+			// Go without, like a second instance would.
+		}
+	}
+
+	ULONGLONG nextTick = m_clock.getTickCount() + 1000;
+	std::unique_lock<std::mutex> lock(m_lock);
+	while (!m_isStopping)
+	{
+		const ULONGLONG now = m_clock.getTickCount();
+		if (now < nextTick && m_commands.empty())
+		{
+			m_wakeUp.wait_for(lock, std::chrono::milliseconds(nextTick - now));
+			continue;
+		}
+		lock.unlock();
+
+		bool keepRunning;
+		if (now >= nextTick)
+		{
+			// After the system has been suspended, don't catch up.
+			nextTick += 1000;
+			if (nextTick <= now)
+				nextTick = now + 1000;
+			keepRunning = tick();
+		}
+		else {
+			keepRunning = handleCommands();
+			updateStatus();
+		}
+
+		lock.lock();
+		if (!keepRunning)
+			break;
+	}
+	lock.unlock();
+
+	m_pServer.reset();
+	m_countdown.stop();
+	return 0;
+}
+
+
+
+void HeadlessService::stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_isStopping = true;
+	}
+	m_wakeUp.notify_one();
+}
+
+
+
+void HeadlessService::post(ControlService::Command command)
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_commands.push_back(command);
+	}
+	m_wakeUp.notify_one();
+}
+
+
+
+void HeadlessService::start()
+{
+	m_countdown.setInterval(m_cfg.settings.getInterval());
+	m_countdown.start();
+	updateStatus();
+}
+
+
+
+bool HeadlessService::tick()
+{
+	if (!handleCommands() || isConnectionLost())
+		return false;
+	// Saves wait while the calibration sends its own.
+	if (isCalibrating())
+	{
+		stepCalibration();
+	}
+	else {
+		m_scheduler.onTick();
+		m_scheduler.handle(m_countdown.step());
+	}
+	updateStatus();
+	return true;
+}
+
+
+
+bool HeadlessService::handleCommands()
+{
+	vector<ControlService::Command> commands;
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		commands.swap(m_commands);
+	}
+	for (ControlService::Command command : commands)
+	{
+		if (command == ControlService::CMD_QUIT)
+			return false;
+		handle(command);
+	}
+	return true;
+}
+
+
+
+void HeadlessService::handle(ControlService::Command command)
+{
+	switch (command)
+	{
+	case ControlService::CMD_PAUSE:
+		m_countdown.pause();
+		break;
+	case ControlService::CMD_RESUME:
+		m_countdown.resume();
+		break;
+	case ControlService::CMD_SAVE:
+		m_countdown.shortenTo(0);
+		break;
+	case ControlService::CMD_RELOAD:
+		// A connected application's settings come from the command line.
+		if (!m_cfg.connection.isConnected())
+		{
+			try {
+				m_cfg.loadFromRegistry(DEFAULT_REGISTRY_KEY);
+			}
+			catch (AutoSaveException&) {
+				break; // Keep the old settings.
+			}
+			start();
+		}
+		break;
+	case ControlService::CMD_CALIBRATE:
+		startCalibration();
+		break;
+	default:
+		break;
+	}
+}
+
+
+
+// Only a window that would be saved is worth calibrating for.
+void HeadlessService::startCalibration()
+{
+	const HWND target = m_windows.getForegroundWindow();
+	if (!m_cfg.windowMatch(target, m_windows))
+		return;
+	if (!m_pCalibrator)
+	{
+		m_pFileWatcher = Platform::createFileWatcher();
+		m_pCalibrator.reset(new PacingCalibrator(m_clock, m_windows, m_input,
+			*m_pFileWatcher));
+	}
+	m_pCalibrator->start(target, m_cfg.settings.getSaveMacro(),
+		m_cfg.connection.getArguments());
+}
+
+
+
+void HeadlessService::stepCalibration()
+{
+	if (m_pCalibrator->step() != PacingCalibrator::PC_DONE)
+		return;
+	try {
+		m_cfg.learnPacing(DEFAULT_REGISTRY_KEY, m_pCalibrator->getProfile());
+	}
+	catch (AutoSaveException&) {
+		// The settings have it, for this session at least.
+	}
+}
+
+
+
+void HeadlessService::updateStatus()
+{
+	ControlService::Status status;
+	status.isEnabled = m_cfg.canRun();
+	status.isPaused = m_countdown.isPaused();
+	status.isConnected = m_cfg.connection.isConnected();
+	status.target = status.isConnected ? L"" : m_cfg.filter.getFilter();
+	status.interval = m_countdown.getInterval();
+	status.secondsLeft = m_countdown.getSecondsLeft();
+	status.lastSaveTime =
+		m_scheduler.getMetrics().getCounter(Metrics::MC_SAVES) == 0
+		? 0 : m_scheduler.getLastSaveTime();
+	status.isCalibrating = isCalibrating();
+	m_control.setStatus(status);
+}
+
+
+
+bool HeadlessService::isConnectionLost() const
+{
+	return m_cfg.connection.isConnected() && !m_cfg.connection.isConnectionAlive();
+}
@@ -0,0 +1,103 @@
+// HeadlessService.h : Runs AutoSave without a window, an icon, or a
+// message loop: only the countdown, the Scheduler, and the control
+// endpoint (see ControlService). Selected by "/S 1" on Windows, and what
+// the autosave executable of the CMake build always runs.
+// Everything comes from the Configuration it is given and from control
+// commands; there is nobody to show alerts to, so the Scheduler's
+// indicators and alerts go nowhere.
+// "calibrate" runs a PacingCalibrator on the foreground window, if it
+// matches; the countdown holds still meanwhile. The result goes into
+// the settings and the registry (see Configuration::learnPacing).
+// run() blocks the calling thread and ticks once per second until
+// stop() is called, a "quit" command comes in, or the connected
+// application exits. post() and stop() may be called from any thread;
+// everything else only from the thread that calls run(), or, in tests,
+// instead of run().
+// Never throws exceptions (except std::bad_alloc and std::system_error).
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+#include "Configuration.h"
+#include "Countdown.h"
+#include "Scheduler.h"
+#include "ControlService.h"
+#include "PacingCalibrator.h"
+
+#include <mutex>
+#include <condition_variable>
+
+using std::wstring;
+using std::vector;
+using std::unique_ptr;
+
+class HeadlessService : private SchedulerListener
+{
+public:
+	// Doesn't take ownership. The configuration may change through
+	// "reload".
+	HeadlessService(Configuration& cfg, const Clock& clock,
+		const WindowEnumerator& windows, InputSink& input);
+	~HeadlessService();
+
+	// Serve ControlService on this endpoint while running. If empty, or
+	// if another instance serves it already, there is none.
+	inline void setEndpointName(const wstring& name) { m_endpointName = name; }
+	inline void setEventLog(EventLog* pEventLog) { m_scheduler.setEventLog(pEventLog); }
+
+	// Returns the exit code.
+	int run();
+	void stop();
+	void post(ControlService::Command command);
+
+	// What run() does: start the countdown, and then, once per second,
+	// handle posted commands and step the countdown. tick() returns
+	// false once it's time to quit.
+	void start();
+	bool tick();
+
+	inline const Countdown& getCountdown() const { return m_countdown; }
+	inline const Metrics& getMetrics() const { return m_scheduler.getMetrics(); }
+	inline ControlService& getControlService() { return m_control; }
+
+private:
+	HeadlessService(const HeadlessService&);
+	HeadlessService& operator=(const HeadlessService&);
+
+	// Implement SchedulerListener.
+	virtual void showIndicator(Indicator indicator) {}
+	virtual void showFiveSecondsAlert() {}
+	virtual void clearAlert() {}
+	virtual void showSaveFailedAlert() {}
+	virtual void onSaveConfirmed(const vector<wstring>& files) {}
+
+	// Returns false if one of them was "quit".
+	bool handleCommands();
+	void handle(ControlService::Command command);
+	void startCalibration();
+	void stepCalibration();
+	inline bool isCalibrating() const {
+		return m_pCalibrator && m_pCalibrator->isProbing();
+	}
+	void updateStatus();
+	bool isConnectionLost() const;
+
+	Configuration& m_cfg;
+	const Clock& m_clock;
+	const WindowEnumerator& m_windows;
+	InputSink& m_input;
+	Countdown m_countdown;
+	Scheduler m_scheduler;
+	ControlService m_control;
+	wstring m_endpointName;
+	unique_ptr<ControlServer> m_pServer;
+	// Made on the first "calibrate".
+	unique_ptr<FileWatcher> m_pFileWatcher;
+	unique_ptr<PacingCalibrator> m_pCalibrator;
+
+	std::mutex m_lock;
+	std::condition_variable m_wakeUp;
+	vector<ControlService::Command> m_commands;
+	bool m_isStopping;
+};
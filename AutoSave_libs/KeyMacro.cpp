@@ -0,0 +1,301 @@
+#include "stdafx.h"
+#include "KeyMacro.h"
+
+
+namespace {
+	struct KeyName
+	{
+		const wchar_t* name;
+		WORD key;
+	};
+
+	// Besides letters, digits, and f1 to f24. toString uses the first
+	// name of a key.
+	const KeyName keyNames[] = {
+		{ L"ctrl", VK_CONTROL }, { L"control", VK_CONTROL },
+		{ L"shift", VK_SHIFT },
+		{ L"alt", VK_MENU },
+		{ L"win", VK_LWIN },
+		{ L"enter", VK_RETURN }, { L"return", VK_RETURN },
+		{ L"esc", VK_ESCAPE }, { L"escape", VK_ESCAPE },
+		{ L"tab", VK_TAB },
+		{ L"space", VK_SPACE },
+		{ L"backspace", VK_BACK },
+		{ L"delete", VK_DELETE }, { L"del", VK_DELETE },
+		{ L"insert", VK_INSERT }, { L"ins", VK_INSERT },
+		{ L"home", VK_HOME },
+		{ L"end", VK_END },
+		{ L"pageup", VK_PRIOR },
+		{ L"pagedown", VK_NEXT },
+		{ L"up", VK_UP },
+		{ L"down", VK_DOWN },
+		{ L"left", VK_LEFT },
+		{ L"right", VK_RIGHT },
+	};
+
+	const wchar_t waitPrefix[] = L"wait";
+
+
+
+	wstring trim(const wstring& text)
+	{
+		const size_t first = text.find_first_not_of(L" \t");
+		if (first == wstring::npos)
+			return L"";
+		return text.substr(first, text.find_last_not_of(L" \t") - first + 1);
+	}
+
+
+
+	vector<wstring> split(const wstring& text, wchar_t separator)
+	{
+		vector<wstring> parts;
+		size_t start = 0;
+		size_t end;
+		while ((end = text.find(separator, start)) != wstring::npos)
+		{
+			parts.push_back(trim(text.substr(start, end - start)));
+			start = end + 1;
+		}
+		parts.push_back(trim(text.substr(start)));
+		return parts;
+	}
+
+
+
+	// Digits only, and not too many of them to overflow.
+	bool parseNumber(const wstring& text, DWORD* pNumber)
+	{
+		if (text.empty() || text.size() > 9)
+			return false;
+		DWORD number = 0;
+		for (wchar_t c : text)
+		{
+			if (c < L'0' || c > L'9')
+				return false;
+			number = 10 * number + (c - L'0');
+		}
+		*pNumber = number;
+		return true;
+	}
+
+
+
+	// name must be in lower case.
+	bool parseKey(const wstring& name, WORD* pKey)
+	{
+		if (name.size() == 1 && ((name[0] >= L'a' && name[0] <= L'z') ||
+			(name[0] >= L'0' && name[0] <= L'9')))
+		{
+			*pKey = (WORD) towupper(name[0]);
+			return true;
+		}
+
+		DWORD number;
+		if (name.size() > 1 && name[0] == L'f' &&
+			parseNumber(name.substr(1), &number))
+		{
+			if (number < 1 || number > 24)
+				return false;
+			*pKey = (WORD) (VK_F1 + number - 1);
+			return true;
+		}
+
+		if (name.size() > 2 && name.size() <= 4 && name.compare(0, 2, L"0x") == 0)
+		{
+			const wstring digits = name.substr(2);
+			if (digits.find_first_not_of(L"0123456789abcdef") != wstring::npos)
+				return false;
+			number = wcstoul(digits.c_str(), NULL, 16);
+			if (number == 0 || number == 0xff)
+				return false;
+			*pKey = (WORD) number;
+			return true;
+		}
+
+		for (const KeyName& keyName : keyNames)
+		{
+			if (name == keyName.name)
+			{
+				*pKey = keyName.key;
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+
+	wstring keyToString(WORD key)
+	{
+		if ((key >= L'A' && key <= L'Z') || (key >= L'0' && key <= L'9'))
+			return wstring(1, (wchar_t) towlower(key));
+		if (key >= VK_F1 && key <= VK_F24)
+			return L"f" + std::to_wstring(key - VK_F1 + 1);
+		for (const KeyName& keyName : keyNames)
+		{
+			if (key == keyName.key)
+				return keyName.name;
+		}
+		wchar_t buffer[8];
+		swprintf(buffer, 8, L"0x%02x", (UINT) key);
+		return buffer;
+	}
+
+
+
+	// step must be in lower case.
+	bool parseWait(const wstring& step, DWORD* pMilliseconds)
+	{
+		const size_t prefixLength = wcslen(waitPrefix);
+		if (step.compare(0, prefixLength, waitPrefix) != 0)
+			return false;
+		const wstring rest = step.substr(prefixLength);
+		if (rest.empty() || (rest[0] != L' ' && rest[0] != L'\t'))
+			return false;
+		DWORD milliseconds;
+		if (!parseNumber(trim(rest), &milliseconds) ||
+			milliseconds > KeyMacro::getMaxWait())
+			return false;
+		*pMilliseconds = milliseconds;
+		return true;
+	}
+}
+
+
+
+KeyMacro KeyMacro::fromHotkey(WORD hotkey)
+{
+	WORD keys[KeySequence::maxHotkeyKeys];
+	const size_t keyCount = KeySequence::getHotkeyKeys(hotkey, keys);
+	KeyMacro macro;
+	if (keyCount != 0)
+		macro.appendChord(keys, keyCount);
+	return macro;
+}
+
+
+
+Expected<KeyMacro> KeyMacro::parse(const wstring& text)
+{
+	wstring lowerText = text;
+	for (wchar_t& c : lowerText)
+		c = (wchar_t) towlower(c);
+
+	KeyMacro macro;
+	if (trim(lowerText).empty())
+		return std::move(macro);
+
+	vector<WORD> keys;
+	for (const wstring& step : split(lowerText, L','))
+	{
+		DWORD milliseconds;
+		if (parseWait(step, &milliseconds))
+		{
+			macro.appendWait(milliseconds);
+			continue;
+		}
+
+		keys.clear();
+		for (const wstring& name : split(step, L'+'))
+		{
+			WORD key;
+			if (!parseKey(name, &key))
+				return ErrorCode(E_INVALIDARG);
+			keys.push_back(key);
+		}
+		macro.appendChord(keys.data(), keys.size());
+	}
+	return std::move(macro);
+}
+
+
+
+// A wait after the last event would only hold up the caller.
+UINT KeyMacro::sendTo(InputSink& input, DWORD eventDelay) const
+{
+	UINT eventsSent = 0;
+	vector<KeyEvent> single(1);
+	for (size_t i = 0; i < m_batches.size(); ++i)
+	{
+		const Batch& batch = m_batches[i];
+		const bool isLastBatch = (i + 1 == m_batches.size());
+		if (eventDelay == 0)
+		{
+			if (!batch.events.empty())
+				eventsSent += input.send(batch.events);
+		}
+		else {
+			for (size_t j = 0; j < batch.events.size(); ++j)
+			{
+				single[0] = batch.events[j];
+				eventsSent += input.send(single);
+				if (!isLastBatch || j + 1 < batch.events.size())
+					input.wait(eventDelay);
+			}
+		}
+		if (batch.waitAfter != 0 && !isLastBatch)
+			input.wait(batch.waitAfter);
+	}
+	return eventsSent;
+}
+
+
+
+// Chords that follow each other without a wait share a batch.
+void KeyMacro::appendChord(const WORD* keys, size_t keyCount)
+{
+	if (m_batches.empty() || m_batches.back().waitAfter != 0)
+		m_batches.push_back({ vector<KeyEvent>(), 0 });
+	KeySequence::appendChord(keys, keyCount, &m_batches.back().events);
+
+	if (!m_text.empty())
+		m_text.append(L", ");
+	for (size_t i = 0; i < keyCount; ++i)
+	{
+		if (i != 0)
+			m_text.push_back(L'+');
+		m_text.append(keyToString(keys[i]));
+	}
+}
+
+
+
+void KeyMacro::appendWait(DWORD milliseconds)
+{
+	if (m_batches.empty())
+		m_batches.push_back({ vector<KeyEvent>(), 0 });
+	m_batches.back().waitAfter += milliseconds;
+
+	if (!m_text.empty())
+		m_text.append(L", ");
+	m_text.append(waitPrefix);
+	m_text.push_back(L' ');
+	m_text.append(std::to_wstring(milliseconds));
+}
+
+
+
+wstring PacingProfile::toString() const
+{
+	return executable + L"=" + std::to_wstring(eventDelay);
+}
+
+
+
+bool PacingProfile::parse(const wstring& text, PacingProfile* pProfile)
+{
+	const size_t separator = text.rfind(L'=');
+	if (separator == wstring::npos)
+		return false;
+	wstring name = trim(text.substr(0, separator));
+	DWORD delay;
+	if (name.empty() || !parseNumber(trim(text.substr(separator + 1)), &delay) ||
+		delay > getMaxEventDelay())
+		return false;
+	for (wchar_t& c : name)
+		c = (wchar_t) towlower(c);
+	pProfile->executable = name;
+	pProfile->eventDelay = delay;
+	return true;
+}
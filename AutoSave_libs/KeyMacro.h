@@ -0,0 +1,94 @@
+// KeyMacro.h : What AutoSave types to save a document: key chords and
+// pauses, written like "ctrl+s, wait 500, enter". A macro is parsed and
+// compiled once, when the settings change, into batches of key events
+// that go to InputSink::send as they are; a batch ends where the macro
+// waits. The hotkey from MiscSettings is a macro of one chord.
+// Keys are letters, digits, names like "enter" or "f5" (see KeyMacro.cpp),
+// or virtual-key codes like "0xba". Case doesn't matter.
+// PacingProfile says how a program wants its input: all at once, which
+// is what most programs cope with best, or one event at a time with a
+// pause after each, for the few that miss modifiers otherwise.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+#include "KeySequence.h"
+#include "Expected.h"
+
+using std::wstring;
+using std::vector;
+
+class KeyMacro
+{
+public:
+	struct Batch
+	{
+		vector<KeyEvent> events;
+		DWORD waitAfter; // In milliseconds.
+	};
+
+	// Sends nothing.
+	KeyMacro() {}
+	// Empty if the hotkey has no key.
+	static KeyMacro fromHotkey(WORD hotkey);
+	// An empty text is an empty macro. Returns E_INVALIDARG if a key is
+	// unknown, a step is empty, or a wait is longer than getMaxWait().
+	static Expected<KeyMacro> parse(const wstring& text);
+
+	// Sending blocks while it waits, so waits are kept short.
+	inline static DWORD getMaxWait() { return 5 * 1000; }
+
+	// What parse would make the same macro from, spelled the same way
+	// for equal macros.
+	inline const wstring& toString() const { return m_text; }
+	inline bool isEmpty() const { return m_batches.empty(); }
+	inline const vector<Batch>& getBatches() const { return m_batches; }
+
+	// Sends each batch at once and waits after it. With an eventDelay,
+	// sends every event on its own and waits that long after each.
+	// Doesn't wait after the last event. Returns the number of events sent.
+	UINT sendTo(InputSink& input, DWORD eventDelay) const;
+
+	inline bool operator==(const KeyMacro& other) const {
+		return m_text == other.m_text;
+	}
+	inline bool operator!=(const KeyMacro& other) const {
+		return !(*this == other);
+	}
+
+private:
+	// Doesn't check its arguments.
+	void appendChord(const WORD* keys, size_t keyCount);
+	void appendWait(DWORD milliseconds);
+
+	vector<Batch> m_batches;
+	wstring m_text;
+};
+
+
+
+// How input is paced for one program.
+struct PacingProfile
+{
+	// File name only, in lower case; see WindowEnumerator::getWindowExecutable.
+	wstring executable;
+	// Milliseconds after every single event. Zero sends batches at once.
+	DWORD eventDelay;
+
+	inline static DWORD getMaxEventDelay() { return 1000; }
+
+	// As "illustrator.exe=10".
+	wstring toString() const;
+	// Returns false, and leaves *pProfile alone, if text isn't in the
+	// form toString returns.
+	static bool parse(const wstring& text, PacingProfile* pProfile);
+
+	inline bool operator==(const PacingProfile& other) const {
+		return executable == other.executable && eventDelay == other.eventDelay;
+	}
+	inline bool operator!=(const PacingProfile& other) const {
+		return !(*this == other);
+	}
+};
@@ -0,0 +1,42 @@
+#include "stdafx.h"
+#include "KeySequence.h"
+
+
+vector<KeyEvent> KeySequence::fromHotkey(WORD hotkey)
+{
+	WORD keys[maxHotkeyKeys];
+	const size_t keyCount = getHotkeyKeys(hotkey, keys);
+	vector<KeyEvent> events;
+	events.reserve(2 * keyCount);
+	appendChord(keys, keyCount, &events);
+	return events;
+}
+
+
+
+size_t KeySequence::getHotkeyKeys(WORD hotkey, WORD* keys)
+{
+	if (LOBYTE(hotkey) == 0)
+		return 0;
+
+	size_t keyCount = 0;
+	if (HIBYTE(hotkey) & HOTKEYF_CONTROL)
+		keys[keyCount++] = VK_CONTROL;
+	if (HIBYTE(hotkey) & HOTKEYF_SHIFT)
+		keys[keyCount++] = VK_SHIFT;
+	if (HIBYTE(hotkey) & HOTKEYF_ALT)
+		keys[keyCount++] = VK_MENU;
+	keys[keyCount++] = LOBYTE(hotkey);
+	return keyCount;
+}
+
+
+
+void KeySequence::appendChord(const WORD* keys, size_t keyCount,
+	vector<KeyEvent>* pEvents)
+{
+	for (size_t i = 0; i < keyCount; ++i)
+		pEvents->push_back({ keys[i], false });
+	for (size_t i = keyCount; i > 0; --i)
+		pEvents->push_back({ keys[i - 1], true });
+}
@@ -0,0 +1,38 @@
+// KeySequence.h : Turns a hotkey as stored in MiscSettings (virtual key
+// in the low byte, HOTKEYF_* modifiers in the high byte) into the
+// sequence of key presses and releases that an InputSink sends.
+// KeyMacro builds longer sequences from the same chords.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+
+using std::vector;
+
+struct KeyEvent
+{
+	WORD key;
+	bool isKeyUp;
+
+	inline bool operator==(const KeyEvent& other) const {
+		return key == other.key && isKeyUp == other.isKeyUp;
+	}
+};
+
+namespace KeySequence
+{
+	// Presses the modifiers (ctrl, shift, alt), then the key, then
+	// releases everything in reverse order.
+	// Returns an empty sequence if the hotkey has no key.
+	vector<KeyEvent> fromHotkey(WORD hotkey);
+
+	// The modifiers, then the key; none if the hotkey has no key.
+	// keys must have room for maxHotkeyKeys.
+	const size_t maxHotkeyKeys = 4;
+	size_t getHotkeyKeys(WORD hotkey, WORD* keys);
+
+	// Presses the keys in order, then releases them in reverse order.
+	void appendChord(const WORD* keys, size_t keyCount,
+		vector<KeyEvent>* pEvents);
+}
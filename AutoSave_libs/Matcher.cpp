@@ -1,14 +1,18 @@
 #include "stdafx.h"
 #include "Matcher.h"
+#include "RegexAnalyzer.h"
+#include "Platform.h"
 
 
 Matcher::Matcher()
 	: m_phrase(),
 	  m_regex(),
 	  m_loweredPhrase(),
-	  m_regexObject(),
+	  m_boundedRegex(),
 	  m_isFilterByRegex(false),
-	  m_isRegexBad(false)
+	  m_dirtyMask(FLD_NONE),
+	  m_isRegexBad(false),
+	  m_regexBadReason()
 {
 }
 
@@ -17,16 +21,18 @@ Matcher::Matcher()
 Matcher::Matcher(const wstring& filter, bool isRegex) : Matcher()
 {
 	setFilter(filter, isRegex);
+	markClean();
 }
 
 
 
 Matcher::Matcher(const wstring& filterPhrase,
-	const wstring& filterRegex, bool isRegex)
+	const wstring& filterRegex, bool isRegex) : Matcher()
 {
 	setPhrase(filterPhrase);
 	setRegex(filterRegex);
 	useRegex(isRegex);
+	markClean();
 }
 
 
@@ -51,30 +57,57 @@ bool Matcher::operator!=(const Matcher& other) const
 
 void Matcher::setPhrase(const wstring& phrase)
 {
+	if (phrase != m_phrase)
+		m_dirtyMask |= FLD_PHRASE;
 	m_phrase.assign(phrase);
 	m_loweredPhrase = toLower(m_phrase);
 }
 
 
 
+// Compiles even an unchanged regex again, since that also forgets that
+// it was too costly.
 void Matcher::setRegex(const wstring& regex)
 {
+	if (regex != m_regex)
+		m_dirtyMask |= FLD_REGEX;
 	m_regex.assign(regex);
+	m_isRegexBad = false;
+	m_regexBadReason.clear();
+	m_boundedRegex.clear();
+
+	// std::regex has the final say on what is valid syntax.
 	try{
-		m_regexObject.assign(m_regex,
-			(std::regex_constants::syntax_option_type) syntaxFlags);
-		m_isRegexBad = false;
+		wregex(m_regex, (std::regex_constants::syntax_option_type) syntaxFlags);
 	}
 	catch (std::regex_error&) {
-		m_isRegexBad = true;
+		markRegexBad(L"The regular expression is invalid.");
+		return;
 	}
+
+	// Only the engine that can't backtrack counts its steps, so it is
+	// the only one that runs. Whatever it can't take might backtrack
+	// for any number of steps, however harmless the analyzer thinks it.
+	unique_ptr<RegexNode> root = RegexParser::parse(m_regex);
+	if (!root)
+	{
+		markRegexBad(L"The regular expression uses syntax that can't be "
+			L"checked for excessive backtracking.");
+		return;
+	}
+	if (m_boundedRegex.compile(*root, true))
+		return;
+	wstring problem = RegexAnalyzer::findCatastrophicBacktracking(*root, true);
+	markRegexBad(!problem.empty() ? problem :
+		L"The regular expression uses lookaheads, backreferences or too "
+		L"many repetitions, so it can't be matched in bounded time.");
 }
 
 
 
 void Matcher::setFilter(const wstring& filter, bool isRegex)
 {
-	m_isFilterByRegex = isRegex;
+	useRegex(isRegex);
 	isRegex ? setRegex(filter) : setPhrase(filter);
 }
 
@@ -92,10 +125,19 @@ bool Matcher::match(const wstring& text) const
 	if (!isValid())
 		return false;
 
+	// A valid regex always has a BoundedRegex.
 	if (m_isFilterByRegex)
 	{
-		return regex_search(text, m_regexObject,
-			(std::regex_constants::match_flag_type) matchFlags);
+		switch (m_boundedRegex.search(text, maxRegexSteps))
+		{
+		case BoundedRegex::MATCH:
+			return true;
+		case BoundedRegex::BUDGET_EXCEEDED:
+			markRegexBad(L"The regular expression took too long to match.");
+			return false;
+		default:
+			return false;
+		}
 	}
 	else {
 		return toLower(text).find(m_loweredPhrase) != wstring::npos;
@@ -106,13 +148,15 @@ bool Matcher::match(const wstring& text) const
 
 wstring Matcher::getWindowText(HWND hwnd)
 {
-	const int textLength = GetWindowTextLength(hwnd);
-	if (textLength == 0)
-		return L"";
+	return Platform::getWindowEnumerator().getWindowText(hwnd);
+}
+
 
-	std::auto_ptr<TCHAR> buffer(new TCHAR[textLength + 1]);
-	GetWindowText(hwnd, buffer.get(), textLength + 1);
-	return buffer.get();
+
+void Matcher::markRegexBad(const wstring& reason) const
+{
+	m_isRegexBad = true;
+	m_regexBadReason = reason;
 }
 
 
@@ -1,10 +1,17 @@
 // Matcher.h : Wraps the switching between regular string
 // matching (phrase) and using regular expressions (regex).
+// Regexes are matched by BoundedRegex, with a step budget. Those it
+// can't take, e.g. with lookaheads or backreferences, are marked bad,
+// with RegexAnalyzer's reason if it finds one; so is a regex that
+// exceeds its step budget, from then on.
+// Remembers which of phrase, regex, and choice between them have been
+// changed since markClean, so that only those need to be saved.
 // Doesn't throw exceptions.
 
 #pragma once
 
 #include "stdafx.h"
+#include "BoundedRegex.h"
 
 using std::wstring;
 using std::wregex;
@@ -36,11 +43,27 @@ public:
 	void setFilter(const Matcher& other); // Copies less than the copy constructor.
 
 	inline bool isRegex() const { return m_isFilterByRegex; }
-	inline void useRegex(bool isRegex) { m_isFilterByRegex = isRegex; }
+	inline void useRegex(bool isRegex) {
+		if (isRegex != m_isFilterByRegex)
+			m_dirtyMask |= FLD_USE_REGEX;
+		m_isFilterByRegex = isRegex;
+	}
+
+	enum Field {
+		FLD_NONE = 0,
+		FLD_PHRASE = 0x1,
+		FLD_REGEX = 0x2,
+		FLD_USE_REGEX = 0x4
+	};
+	// Setting a value to what it already is doesn't count as a change.
+	inline int getDirtyMask() const { return m_dirtyMask; }
+	inline bool isDirty() const { return m_dirtyMask != FLD_NONE; }
+	inline void markClean() { m_dirtyMask = FLD_NONE; }
 
 	// Validity checks.
 	inline bool isEmpty() const { return getFilter() == L""; }
 	inline bool isRegexBad() const { return m_isRegexBad; }
+	inline const wstring& getRegexBadReason() const { return m_regexBadReason; }
 	inline bool isValid() const {
 		return !isEmpty() && (isRegex() ? !isRegexBad() : true);
 	}
@@ -48,7 +71,7 @@ public:
 	// The actually important function.
 	bool match(const wstring& text) const;
 
-	// Utility function: std::wstring wrapper around GetWindowText.
+	// Utility function: the platform's WindowEnumerator::getWindowText.
 	static wstring getWindowText(HWND hwnd);
 
 private:
@@ -57,11 +80,21 @@ private:
 	wstring m_phrase;
 	wstring m_regex;
 
+	void markRegexBad(const wstring& reason) const;
+
 	wstring m_loweredPhrase;
-	wregex m_regexObject;
+	BoundedRegex m_boundedRegex;
 
 	bool m_isFilterByRegex;
-	bool m_isRegexBad;
+	int m_dirtyMask;
+	// These may change during match if the regex turns out too costly.
+	mutable bool m_isRegexBad;
+	mutable wstring m_regexBadReason;
+
+	// Used up in 10-20 ms in pathological cases, on a desktop machine
+	// with an optimized build; window captions usually need a few
+	// thousand steps.
+	static const unsigned long maxRegexSteps = 1000000;
 
 	// Sadly, this is the only way this works
 	enum {
@@ -70,9 +103,5 @@ private:
 		std::regex_constants::collate +
 		std::regex_constants::ECMAScript
 	};
-	enum {
-		matchFlags = std::regex_constants::match_any +
-		std::regex_constants::match_not_null
-	};
 
 };
@@ -0,0 +1,121 @@
+#include "stdafx.h"
+#include "MemoryConfigStore.h"
+
+
+int MemoryConfigStore::readInt(const wstring& valueName) const
+{
+	return find(valueName, TYPE_INT).number;
+}
+
+
+
+void MemoryConfigStore::writeInt(const wstring& valueName, int valueData)
+{
+	m_values[valueName] = { TYPE_INT, valueData, {} };
+}
+
+
+
+wstring MemoryConfigStore::readString(const wstring& valueName) const
+{
+	return find(valueName, TYPE_STRING).strings.front();
+}
+
+
+
+void MemoryConfigStore::writeString(
+	const wstring& valueName, const wstring& valueData)
+{
+	m_values[valueName] = { TYPE_STRING, 0, { valueData } };
+}
+
+
+
+vector<wstring> MemoryConfigStore::readMultiString(const wstring& valueName) const
+{
+	return find(valueName, TYPE_MULTI_STRING).strings;
+}
+
+
+
+void MemoryConfigStore::writeMultiString(
+	const wstring& valueName, const vector<wstring>& strings)
+{
+	m_values[valueName] = { TYPE_MULTI_STRING, 0, strings };
+}
+
+
+
+Expected<int> MemoryConfigStore::tryReadInt(const wstring& valueName) const
+{
+	const Value* pValue;
+	ErrorCode error = lookup(valueName, TYPE_INT, &pValue);
+	if (error.isError())
+		return error;
+	return pValue->number;
+}
+
+
+
+Expected<wstring> MemoryConfigStore::tryReadString(const wstring& valueName) const
+{
+	const Value* pValue;
+	ErrorCode error = lookup(valueName, TYPE_STRING, &pValue);
+	if (error.isError())
+		return error;
+	return pValue->strings.front();
+}
+
+
+
+Expected<vector<wstring>> MemoryConfigStore::tryReadMultiString(
+	const wstring& valueName) const
+{
+	const Value* pValue;
+	ErrorCode error = lookup(valueName, TYPE_MULTI_STRING, &pValue);
+	if (error.isError())
+		return error;
+	return pValue->strings;
+}
+
+
+
+vector<wstring> MemoryConfigStore::getValueNames() const
+{
+	vector<wstring> names;
+	names.reserve(m_values.size());
+	for (const auto& value : m_values)
+		names.push_back(value.first);
+	return names;
+}
+
+
+
+void MemoryConfigStore::deleteValue(const wstring& valueName)
+{
+	m_values.erase(valueName);
+}
+
+
+
+const MemoryConfigStore::Value& MemoryConfigStore::find(
+	const wstring& valueName, ValueType type) const
+{
+	const Value* pValue;
+	lookup(valueName, type, &pValue).throwIfError<ConfigStoreException>();
+	return *pValue;
+}
+
+
+
+ErrorCode MemoryConfigStore::lookup(const wstring& valueName, ValueType type,
+	const Value** ppValue) const
+{
+	auto pValue = m_values.find(valueName);
+	if (pValue == m_values.end())
+		return ErrorCode::fromWin32(ERROR_FILE_NOT_FOUND);
+	if (pValue->second.type != type)
+		return ErrorCode::fromWin32(ERROR_UNSUPPORTED_TYPE);
+	*ppValue = &pValue->second;
+	return ErrorCode();
+}
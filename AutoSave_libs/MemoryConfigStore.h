@@ -0,0 +1,72 @@
+// MemoryConfigStore.h : A ConfigStore that keeps its values in memory.
+// Used where there is no registry, and by tests that shouldn't touch it.
+// Reading a missing value throws ConfigStoreException with
+// ERROR_FILE_NOT_FOUND, reading a value of the wrong type with
+// ERROR_UNSUPPORTED_TYPE, just like the registry does. The tryRead
+// functions return the same codes without throwing.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+#include "AutoSaveException.h"
+
+using std::wstring;
+using std::vector;
+
+class MemoryConfigStore : public ConfigStore
+{
+public:
+	MemoryConfigStore() {}
+	virtual ~MemoryConfigStore() {}
+
+	virtual int readInt(const wstring& valueName) const;
+	virtual void writeInt(const wstring& valueName, int valueData);
+
+	virtual wstring readString(const wstring& valueName) const;
+	virtual void writeString(const wstring& valueName, const wstring& valueData);
+
+	virtual vector<wstring> readMultiString(const wstring& valueName) const;
+	virtual void writeMultiString(const wstring& valueName,
+		const vector<wstring>& strings);
+
+	virtual Expected<int> tryReadInt(const wstring& valueName) const;
+	virtual Expected<wstring> tryReadString(const wstring& valueName) const;
+	virtual Expected<vector<wstring>> tryReadMultiString(
+		const wstring& valueName) const;
+
+	virtual vector<wstring> getValueNames() const;
+	virtual void deleteValue(const wstring& valueName);
+
+	inline bool isEmpty() const { return m_values.empty(); }
+	inline bool contains(const wstring& valueName) const {
+		return m_values.count(valueName) == 1;
+	}
+	inline void clear() { m_values.clear(); }
+
+private:
+	enum ValueType { TYPE_INT, TYPE_STRING, TYPE_MULTI_STRING };
+	struct Value {
+		ValueType type;
+		int number;
+		vector<wstring> strings;
+	};
+
+	const Value& find(const wstring& valueName, ValueType type) const;
+	// Sets *ppValue only on success.
+	ErrorCode lookup(const wstring& valueName, ValueType type,
+		const Value** ppValue) const;
+
+	std::unordered_map<wstring, Value> m_values;
+};
+
+
+
+class ConfigStoreException : public AutoSaveException
+{
+public:
+	ConfigStoreException() : AutoSaveException() {}
+	ConfigStoreException(LONG errorCode) : AutoSaveException(errorCode) {}
+	virtual ~ConfigStoreException() {}
+	virtual inline LPCWSTR exceptionType() const { return L"ConfigStoreException"; }
+};
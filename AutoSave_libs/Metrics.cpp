@@ -0,0 +1,402 @@
+#include "stdafx.h"
+#include "Metrics.h"
+
+#include <cstdio>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace {
+	const ULONGLONG noMin = ~0ULL;
+	const char magic[] = "ASMT";
+	const unsigned char formatVersion = 1;
+
+	inline UINT getHighestBit(ULONGLONG value)
+	{
+#ifdef _MSC_VER
+		// _BitScanReverse64 doesn't exist on x86.
+		unsigned long index;
+		if (_BitScanReverse(&index, (unsigned long) (value >> 32)))
+			return index + 32;
+		_BitScanReverse(&index, (unsigned long) value);
+		return index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	// Unsigned LEB128, so that small numbers take a single byte.
+	void writeNumber(string& bytes, ULONGLONG value)
+	{
+		do {
+			unsigned char byte = value & 0x7f;
+			value >>= 7;
+			if (value != 0)
+				byte |= 0x80;
+			bytes.push_back((char) byte);
+		} while (value != 0);
+	}
+
+	void writeString(string& bytes, const string& s)
+	{
+		writeNumber(bytes, s.size());
+		bytes.append(s);
+	}
+
+	class Reader
+	{
+	public:
+		Reader(const string& bytes) : m_bytes(bytes), m_pos(0) {}
+
+		bool readNumber(ULONGLONG* pValue)
+		{
+			ULONGLONG value = 0;
+			for (UINT shift = 0; shift < 64; shift += 7)
+			{
+				if (m_pos >= m_bytes.size())
+					return false;
+				unsigned char byte = (unsigned char) m_bytes[m_pos++];
+				value |= (ULONGLONG) (byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0)
+				{
+					*pValue = value;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool readString(string* pString)
+		{
+			ULONGLONG size;
+			if (!readNumber(&size) || size > m_bytes.size() - m_pos)
+				return false;
+			pString->assign(m_bytes, m_pos, (size_t) size);
+			m_pos += (size_t) size;
+			return true;
+		}
+
+		bool skip(const string& expected)
+		{
+			if (m_bytes.compare(m_pos, expected.size(), expected) != 0)
+				return false;
+			m_pos += expected.size();
+			return true;
+		}
+
+		inline bool isAtEnd() const { return m_pos == m_bytes.size(); }
+
+	private:
+		const string& m_bytes;
+		size_t m_pos;
+	};
+}
+
+
+
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+
+
+ULONGLONG LatencyHistogram::getMin() const
+{
+	ULONGLONG min = m_min.load(std::memory_order_relaxed);
+	return (min == noMin) ? 0 : min;
+}
+
+
+
+void LatencyHistogram::reset()
+{
+	for (auto& bucket : m_buckets)
+		bucket.store(0, std::memory_order_relaxed);
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_min.store(noMin, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+
+
+UINT LatencyHistogram::getBucketIndex(ULONGLONG value)
+{
+	if (value < linearBuckets)
+		return (UINT) value;
+	// The highest bit is at least 6; keep the five bits below it.
+	const UINT highestBit = getHighestBit(value);
+	const UINT shift = highestBit - 5;
+	const UINT subBucket = (UINT) (value >> shift) - subBuckets;
+	return linearBuckets + (highestBit - 6) * subBuckets + subBucket;
+}
+
+
+
+ULONGLONG LatencyHistogram::getBucketLow(UINT index)
+{
+	if (index < linearBuckets)
+		return index;
+	const UINT k = index - linearBuckets;
+	const UINT shift = k / subBuckets + 1;
+	return (ULONGLONG) (subBuckets + k % subBuckets) << shift;
+}
+
+
+
+ULONGLONG LatencyHistogram::getBucketHigh(UINT index)
+{
+	if (index < linearBuckets)
+		return index;
+	const UINT shift = (index - linearBuckets) / subBuckets + 1;
+	return getBucketLow(index) + ((1ULL << shift) - 1);
+}
+
+
+
+ULONGLONG HistogramSnapshot::getPercentile(double percentile) const
+{
+	if (count == 0)
+		return 0;
+	percentile = __min(__max(percentile, 0.0), 100.0);
+	ULONGLONG rank = (ULONGLONG) std::ceil(percentile / 100.0 * count);
+	rank = __max(rank, 1ULL);
+
+	ULONGLONG seen = 0;
+	for (const auto& bucket : buckets)
+	{
+		seen += bucket.second;
+		if (seen >= rank)
+		{
+			ULONGLONG value = LatencyHistogram::getBucketHigh(bucket.first);
+			return __max(__min(value, max), min);
+		}
+	}
+	return max;
+}
+
+
+
+string MetricsSnapshot::serialize() const
+{
+	string bytes(magic);
+	bytes.push_back((char) formatVersion);
+
+	writeNumber(bytes, counters.size());
+	for (const auto& counter : counters)
+	{
+		writeString(bytes, counter.first);
+		writeNumber(bytes, counter.second);
+	}
+
+	writeNumber(bytes, histograms.size());
+	for (const HistogramSnapshot& histogram : histograms)
+	{
+		writeString(bytes, histogram.name);
+		writeString(bytes, histogram.unit);
+		writeNumber(bytes, histogram.count);
+		writeNumber(bytes, histogram.sum);
+		writeNumber(bytes, histogram.min);
+		writeNumber(bytes, histogram.max);
+		writeNumber(bytes, histogram.buckets.size());
+		// Indices only grow, so store the steps between them.
+		UINT lastIndex = 0;
+		for (const auto& bucket : histogram.buckets)
+		{
+			writeNumber(bytes, bucket.first - lastIndex);
+			writeNumber(bytes, bucket.second);
+			lastIndex = bucket.first;
+		}
+	}
+	return bytes;
+}
+
+
+
+bool MetricsSnapshot::deserialize(const string& bytes, MetricsSnapshot* pSnapshot)
+{
+	Reader reader(bytes);
+	MetricsSnapshot snapshot;
+	ULONGLONG n;
+	if (!reader.skip(magic) || !reader.skip(string(1, (char) formatVersion)))
+		return false;
+
+	if (!reader.readNumber(&n) || n > bytes.size())
+		return false;
+	snapshot.counters.resize((size_t) n);
+	for (auto& counter : snapshot.counters)
+	{
+		if (!reader.readString(&counter.first) || !reader.readNumber(&counter.second))
+			return false;
+	}
+
+	if (!reader.readNumber(&n) || n > bytes.size())
+		return false;
+	snapshot.histograms.resize((size_t) n);
+	for (HistogramSnapshot& histogram : snapshot.histograms)
+	{
+		if (!reader.readString(&histogram.name) ||
+			!reader.readString(&histogram.unit) ||
+			!reader.readNumber(&histogram.count) ||
+			!reader.readNumber(&histogram.sum) ||
+			!reader.readNumber(&histogram.min) ||
+			!reader.readNumber(&histogram.max) ||
+			!reader.readNumber(&n) || n > LatencyHistogram::bucketCount)
+		{
+			return false;
+		}
+		histogram.buckets.resize((size_t) n);
+		ULONGLONG index = 0;
+		for (auto& bucket : histogram.buckets)
+		{
+			ULONGLONG step;
+			if (!reader.readNumber(&step) || !reader.readNumber(&bucket.second))
+				return false;
+			index += step;
+			if (index >= LatencyHistogram::bucketCount)
+				return false;
+			bucket.first = (UINT) index;
+		}
+	}
+
+	if (!reader.isAtEnd())
+		return false;
+	*pSnapshot = snapshot;
+	return true;
+}
+
+
+
+string MetricsSnapshot::format() const
+{
+	string result;
+	char line[160];
+	for (const auto& counter : counters)
+	{
+		snprintf(line, sizeof(line), "%-20s %12llu\n", counter.first.c_str(),
+			(unsigned long long) counter.second);
+		result.append(line);
+	}
+
+	snprintf(line, sizeof(line), "\n%-20s %-4s %8s %8s %8s %8s %8s %8s %8s\n",
+		"histogram", "unit", "count", "min", "p50", "p90", "p99", "p99.9", "max");
+	result.append(line);
+	for (const HistogramSnapshot& h : histograms)
+	{
+		snprintf(line, sizeof(line),
+			"%-20s %-4s %8llu %8llu %8llu %8llu %8llu %8llu %8llu\n",
+			h.name.c_str(), h.unit.c_str(), (unsigned long long) h.count,
+			(unsigned long long) h.min,
+			(unsigned long long) h.getPercentile(50.0),
+			(unsigned long long) h.getPercentile(90.0),
+			(unsigned long long) h.getPercentile(99.0),
+			(unsigned long long) h.getPercentile(99.9),
+			(unsigned long long) h.max);
+		result.append(line);
+	}
+	return result;
+}
+
+
+
+Metrics::Metrics()
+{
+	for (auto& counter : m_counters)
+		counter.store(0, std::memory_order_relaxed);
+}
+
+
+
+const char* Metrics::getName(CounterId id)
+{
+	switch (id)
+	{
+	case MC_TICKS: return "ticks";
+	case MC_SAVES: return "saves";
+	case MC_RETRIES: return "retries";
+	case MC_KEYS_SENT: return "keys_sent";
+	case MC_COUNTDOWN_RESETS: return "countdown_resets";
+	case MC_TICKS_AT_ZERO: return "ticks_at_zero";
+	case MC_SAVES_CONFIRMED: return "saves_confirmed";
+	case MC_SAVES_FAILED: return "saves_failed";
+	case MC_FOREGROUND_CHANGES: return "foreground_changes";
+	case MC_TRIGGERS: return "triggers";
+	case MC_TRIGGERS_DEDUPED: return "triggers_deduped";
+	case MC_UNRESPONSIVE_WINDOWS: return "unresponsive";
+	case MC_DEFERRED_HUNG: return "deferred_hung";
+	case MC_DEFERRED_BUSY: return "deferred_busy";
+	case MC_SAVES_DROPPED: return "saves_dropped";
+	default: return "";
+	}
+}
+
+
+
+const char* Metrics::getName(HistogramId id)
+{
+	switch (id)
+	{
+	case MH_SAVE_LATENCY: return "save_latency";
+	case MH_ZERO_WAIT: return "zero_wait";
+	case MH_SEND_DURATION: return "send_duration";
+	case MH_TICK_INTERVAL: return "tick_interval";
+	case MH_ACTIVATION_DELAY: return "activation_delay";
+	case MH_DEFERRAL: return "deferral";
+	default: return "";
+	}
+}
+
+
+
+const char* Metrics::getUnit(HistogramId id)
+{
+	return (id == MH_SEND_DURATION) ? "us" : "ms";
+}
+
+
+
+MetricsSnapshot Metrics::takeSnapshot() const
+{
+	MetricsSnapshot snapshot;
+	for (int id = 0; id < MC_COUNTER_COUNT; ++id)
+	{
+		snapshot.counters.push_back(std::make_pair(
+			string(getName((CounterId) id)), getCounter((CounterId) id)));
+	}
+	for (int id = 0; id < MH_HISTOGRAM_COUNT; ++id)
+	{
+		const LatencyHistogram& histogram = m_histograms[id];
+		HistogramSnapshot h;
+		h.name = getName((HistogramId) id);
+		h.unit = getUnit((HistogramId) id);
+		h.count = 0;
+		h.sum = histogram.getSum();
+		h.min = histogram.getMin();
+		h.max = histogram.getMax();
+		// Count what's in the buckets, so that percentiles add up even
+		// while someone is recording.
+		for (UINT i = 0; i < LatencyHistogram::bucketCount; ++i)
+		{
+			ULONGLONG n = histogram.getBucket(i);
+			if (n != 0)
+			{
+				h.buckets.push_back(std::make_pair(i, n));
+				h.count += n;
+			}
+		}
+		snapshot.histograms.push_back(h);
+	}
+	return snapshot;
+}
+
+
+
+void Metrics::reset()
+{
+	for (auto& counter : m_counters)
+		counter.store(0, std::memory_order_relaxed);
+	for (auto& histogram : m_histograms)
+		histogram.reset();
+}
@@ -0,0 +1,175 @@
+// Metrics.h : Counters and latency histograms that the Scheduler updates
+// as it goes, so that we can see how long saves take, how long AutoSave
+// waits for a matching window, and how often it gives up.
+// Updating is lock-free and cheap enough to do on every event: counters
+// are relaxed atomics, and histograms are HDR-style, i.e. log-linear
+// buckets with a relative error of at most 1/32 over the whole range.
+// A MetricsSnapshot copies everything out, e.g. to be written to a file
+// and printed later (see AutoSave_tools/MetricsViewer.cpp).
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <atomic>
+
+using std::string;
+using std::vector;
+
+class LatencyHistogram
+{
+public:
+	// Values below 64 get a bucket each; every power of two above is
+	// split into 32 buckets.
+	static const UINT linearBuckets = 64;
+	static const UINT subBuckets = 32;
+	static const UINT bucketCount = linearBuckets + 58 * subBuckets;
+
+	LatencyHistogram();
+
+	inline void record(ULONGLONG value) {
+		m_buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(value, std::memory_order_relaxed);
+		updateMin(value);
+		updateMax(value);
+	}
+
+	inline ULONGLONG getCount() const { return m_count.load(std::memory_order_relaxed); }
+	inline ULONGLONG getSum() const { return m_sum.load(std::memory_order_relaxed); }
+	// Both are zero while the histogram is empty.
+	ULONGLONG getMin() const;
+	inline ULONGLONG getMax() const { return m_max.load(std::memory_order_relaxed); }
+	inline ULONGLONG getBucket(UINT index) const {
+		return m_buckets[index].load(std::memory_order_relaxed);
+	}
+
+	// Not atomic as a whole; records that come in meanwhile may be lost.
+	void reset();
+
+	static UINT getBucketIndex(ULONGLONG value);
+	// The smallest and largest values that end up in the bucket.
+	static ULONGLONG getBucketLow(UINT index);
+	static ULONGLONG getBucketHigh(UINT index);
+
+private:
+	inline void updateMin(ULONGLONG value) {
+		ULONGLONG current = m_min.load(std::memory_order_relaxed);
+		while (value < current && !m_min.compare_exchange_weak(
+			current, value, std::memory_order_relaxed)) {}
+	}
+	inline void updateMax(ULONGLONG value) {
+		ULONGLONG current = m_max.load(std::memory_order_relaxed);
+		while (value > current && !m_max.compare_exchange_weak(
+			current, value, std::memory_order_relaxed)) {}
+	}
+
+	std::atomic<ULONGLONG> m_buckets[bucketCount];
+	std::atomic<ULONGLONG> m_count;
+	std::atomic<ULONGLONG> m_sum;
+	std::atomic<ULONGLONG> m_min;
+	std::atomic<ULONGLONG> m_max;
+};
+
+
+
+struct HistogramSnapshot
+{
+	string name;
+	string unit;
+	ULONGLONG count;
+	ULONGLONG sum;
+	ULONGLONG min;
+	ULONGLONG max;
+	// Only the buckets that aren't empty, by index.
+	vector<std::pair<UINT, ULONGLONG>> buckets;
+
+	// For percentile between 0 and 100. The result is the largest value
+	// of the bucket that holds it, but no more than the maximum.
+	ULONGLONG getPercentile(double percentile) const;
+	inline double getMean() const { return count == 0 ? 0.0 : (double) sum / count; }
+};
+
+
+
+struct MetricsSnapshot
+{
+	vector<std::pair<string, ULONGLONG>> counters;
+	vector<HistogramSnapshot> histograms;
+
+	// A compact binary format that doesn't depend on the platform.
+	string serialize() const;
+	// Returns false if bytes are no serialized snapshot.
+	static bool deserialize(const string& bytes, MetricsSnapshot* pSnapshot);
+
+	// One line per counter and per histogram, with percentiles.
+	string format() const;
+};
+
+
+
+class Metrics
+{
+public:
+	enum CounterId {
+		MC_TICKS,            // Timer ticks seen by the Scheduler.
+		MC_SAVES,            // Scheduled saves, i.e. hotkeys sent at zero.
+		MC_RETRIES,          // Hotkeys sent again after a missing save.
+		MC_KEYS_SENT,        // Complete key presses, including modifiers.
+		MC_COUNTDOWN_RESETS, // No matching window at five seconds or zero.
+		MC_TICKS_AT_ZERO,    // Waiting for a matching foreground window.
+		MC_SAVES_CONFIRMED,
+		MC_SAVES_FAILED,
+		MC_FOREGROUND_CHANGES, // Reported while waiting at zero.
+		MC_TRIGGERS,         // Saves made due by a trigger, e.g. leaving.
+		MC_TRIGGERS_DEDUPED, // Triggers ignored as too soon after another.
+		MC_UNRESPONSIVE_WINDOWS, // Captions not read as their program hung.
+		MC_DEFERRED_HUNG,    // Saves held back as the target didn't respond,
+		MC_DEFERRED_BUSY,    // or as it kept a core busy; once per probe.
+		MC_SAVES_DROPPED,    // The target didn't respond until the deadline.
+		MC_COUNTER_COUNT
+	};
+
+	enum HistogramId {
+		MH_SAVE_LATENCY,     // Milliseconds from input to file change.
+		MH_ZERO_WAIT,        // Milliseconds from zero to sending.
+		MH_SEND_DURATION,    // Microseconds spent sending input.
+		MH_TICK_INTERVAL,    // Milliseconds between timer ticks.
+		MH_ACTIVATION_DELAY, // Milliseconds from a reported matching
+		                     // foreground window to sending at zero.
+		MH_DEFERRAL,         // Milliseconds that a save was held back for
+		                     // a busy or unresponsive target.
+		MH_HISTOGRAM_COUNT
+	};
+
+	Metrics();
+
+	inline void count(CounterId id, ULONGLONG n = 1) {
+		m_counters[id].fetch_add(n, std::memory_order_relaxed);
+	}
+	inline void record(HistogramId id, ULONGLONG value) {
+		m_histograms[id].record(value);
+	}
+
+	inline ULONGLONG getCounter(CounterId id) const {
+		return m_counters[id].load(std::memory_order_relaxed);
+	}
+	inline const LatencyHistogram& getHistogram(HistogramId id) const {
+		return m_histograms[id];
+	}
+
+	static const char* getName(CounterId id);
+	static const char* getName(HistogramId id);
+	static const char* getUnit(HistogramId id);
+
+	MetricsSnapshot takeSnapshot() const;
+	void reset();
+
+private:
+	Metrics(const Metrics&);
+	Metrics& operator=(const Metrics&);
+
+	std::atomic<ULONGLONG> m_counters[MC_COUNTER_COUNT];
+	LatencyHistogram m_histograms[MH_HISTOGRAM_COUNT];
+};
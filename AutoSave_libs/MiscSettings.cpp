@@ -6,8 +6,30 @@
 MiscSettings::MiscSettings()
 	: m_hotkey(MAKEWORD(0x53, HOTKEYF_CONTROL)), // ctrl+s
 	  m_interval(5 * 60), // five minutes
-	  m_verbosity(ALERT_START) // show start, but no 5-second alerts
+	  m_verbosity(ALERT_START), // show start, but no 5-second alerts
+	  m_saveCheckTimeout(0), // don't check
+	  m_isIntervalAdaptive(false),
+	  m_triggers(TRIG_NONE), // only the countdown
+	  m_backgroundDelay(30),
+	  m_triggerDedupe(60),
+	  m_dirtyMask(ATT_NONE)
 {
+	// As often as the default interval while busy, and up to an hour
+	// apart while idle. Slow saves get ten times as long as they take.
+	m_adaptivePolicy.minInterval = 5 * 60;
+	m_adaptivePolicy.maxInterval = 60 * 60;
+	m_adaptivePolicy.growthPercent = 200;
+	m_adaptivePolicy.maxBusyPercent = 10;
+
+	// No backups, but a week of daily versions once they're on.
+	m_retentionPolicy.keepLast = 0;
+	m_retentionPolicy.keepDaily = 7;
+
+	// Illustrator ignores the modifiers if they come all at once.
+	// (Date: 2014-07-09)
+	PacingProfile illustrator = { L"illustrator.exe", 10 };
+	m_pacingProfiles.push_back(illustrator);
+	updateSaveMacro();
 }
 
 
@@ -23,7 +45,16 @@ bool MiscSettings::operator==(const MiscSettings& other) const
 {
 	return m_hotkey == other.m_hotkey &&
 		m_interval == other.m_interval &&
-		m_verbosity == other.m_verbosity;
+		m_verbosity == other.m_verbosity &&
+		m_saveCheckTimeout == other.m_saveCheckTimeout &&
+		m_isIntervalAdaptive == other.m_isIntervalAdaptive &&
+		m_adaptivePolicy == other.m_adaptivePolicy &&
+		m_keyMacro == other.m_keyMacro &&
+		m_pacingProfiles == other.m_pacingProfiles &&
+		m_triggers == other.m_triggers &&
+		m_backgroundDelay == other.m_backgroundDelay &&
+		m_triggerDedupe == other.m_triggerDedupe &&
+		m_retentionPolicy == other.m_retentionPolicy;
 }
 
 bool MiscSettings::operator!=(const MiscSettings& other) const
@@ -38,11 +69,42 @@ void MiscSettings::loadFromCommandLine(const CommandLineParser& cli)
 	if (cli.kwArgsContain(L'H'))
 		setHotkey(LOWORD(cli.getIntKwArg(L'H')));
 
+	if (cli.kwArgsContain(L'M'))
+	{
+		if (!setKeyMacro(cli.getStringKwArg(L'M')))
+			throw CLIException(E_INVALIDARG);
+	}
+	else if (cli.kwArgsContain(L'H')) {
+		setKeyMacro(KeyMacro());
+	}
+
 	if (cli.kwArgsContain(L'I'))
 		setInterval(cli.getIntKwArg(L'I'));
 
 	if (cli.kwArgsContain(L'V'))
 		setVerbosity(cli.getIntKwArg(L'V'));
+
+	if (cli.kwArgsContain(L'C'))
+		setSaveCheckTimeout(__max(cli.getIntKwArg(L'C'), 0));
+
+	if (cli.kwArgsContain(L'A'))
+		setIntervalAdaptive(cli.getIntKwArg(L'A') != 0);
+
+	if (cli.kwArgsContain(L'T'))
+		setTriggers(cli.getIntKwArg(L'T'));
+
+	if (cli.kwArgsContain(L'B'))
+		setBackgroundDelay(__max(cli.getIntKwArg(L'B'), 0));
+
+	if (cli.kwArgsContain(L'D'))
+		setTriggerDedupe(__max(cli.getIntKwArg(L'D'), 0));
+
+	if (cli.kwArgsContain(L'K'))
+	{
+		RetentionPolicy policy = getRetentionPolicy();
+		policy.keepLast = __max(cli.getIntKwArg(L'K'), 0);
+		setRetentionPolicy(policy);
+	}
 }
 
 
@@ -51,29 +113,178 @@ void MiscSettings::loadFromCommandLine(const CommandLineParser& cli)
 // or it ends with a trailing space character.
 wstring MiscSettings::toCommandLine(int attributesMask) const
 {
-	if (attributesMask == ATT_NONE)
-		return L"";
-
-	const int bufferSize = 42;
-	TCHAR buffer[bufferSize];
-	wstring formatString;
-
+	wstring result;
 	if (attributesMask & ATT_INTERVAL)
-		formatString.append(L"/I %1!u! ");
+	{
+		result.append(L"/I ");
+		result.append(std::to_wstring(getInterval()));
+		result.push_back(L' ');
+	}
 	if (attributesMask & ATT_HOTKEY)
-		formatString.append(L"/H 0x%2!04x! ");
+	{
+		wchar_t buffer[8];
+		swprintf(buffer, 8, L"0x%04x", (UINT) getHotkey());
+		result.append(L"/H ");
+		result.append(buffer);
+		result.push_back(L' ');
+	}
+	if ((attributesMask & ATT_MACRO) && !getKeyMacro().isEmpty())
+	{
+		result.append(L"/M ");
+		result.append(CommandLineParser::escapeArgument(getKeyMacro().toString()));
+		result.push_back(L' ');
+	}
 	if (attributesMask & ATT_VERBOSITY)
-		formatString.append(L"/V %3!u! ");
-	INT_PTR args[] = { getInterval(), getHotkey(), getVerbosity() };
-
-	throwIfZero<AutoSaveException>(
-		FormatMessage(
-			FORMAT_MESSAGE_ARGUMENT_ARRAY | FORMAT_MESSAGE_FROM_STRING,
-			formatString.data(), 0, LANG_NEUTRAL,
-			buffer, bufferSize, (va_list*)args)
-		);
-	return buffer;
+	{
+		result.append(L"/V ");
+		result.append(std::to_wstring((UINT) getVerbosity()));
+		result.push_back(L' ');
+	}
+	// Left out while off, which is the default anyway.
+	if ((attributesMask & ATT_SAVECHECK) && getSaveCheckTimeout() != 0)
+	{
+		result.append(L"/C ");
+		result.append(std::to_wstring(getSaveCheckTimeout()));
+		result.push_back(L' ');
+	}
+	if ((attributesMask & ATT_ADAPTIVE) && isIntervalAdaptive())
+	{
+		result.append(L"/A 1 ");
+	}
+	// The delays only matter with triggers.
+	if ((attributesMask & ATT_TRIGGERS) && getTriggers() != TRIG_NONE)
+	{
+		result.append(L"/T ");
+		result.append(std::to_wstring(getTriggers()));
+		result.append(L" /B ");
+		result.append(std::to_wstring(getBackgroundDelay()));
+		result.append(L" /D ");
+		result.append(std::to_wstring(getTriggerDedupe()));
+		result.push_back(L' ');
+	}
+	// Only the number of versions; the days stay in the settings.
+	if ((attributesMask & ATT_BACKUP) && isBackupOn())
+	{
+		result.append(L"/K ");
+		result.append(std::to_wstring(getRetentionPolicy().keepLast));
+		result.push_back(L' ');
+	}
+	return result;
+}
+
+
+
+void MiscSettings::setAdaptivePolicy(const AdaptivePolicy& policy)
+{
+	AdaptivePolicy bounded;
+	bounded.minInterval = __min(__max(policy.minInterval,
+		getMinInterval()), getMaxInterval());
+	bounded.maxInterval = __min(__max(policy.maxInterval,
+		bounded.minInterval), getMaxInterval());
+	bounded.growthPercent = __min(__max(policy.growthPercent,
+		100u), 1000u);
+	bounded.maxBusyPercent = __min(__max(policy.maxBusyPercent,
+		1u), 100u);
+	change(m_adaptivePolicy, bounded, ATT_ADAPTIVE);
+}
+
+
+
+void MiscSettings::setRetentionPolicy(const RetentionPolicy& policy)
+{
+	RetentionPolicy bounded;
+	bounded.keepLast = __min(policy.keepLast, 1000u);
+	bounded.keepDaily = __min(policy.keepDaily, 10u * 365);
+	change(m_retentionPolicy, bounded, ATT_BACKUP);
+}
+
+
+
+void MiscSettings::setHotkey(WORD hotkey)
+{
+	change(m_hotkey, hotkey, ATT_HOTKEY);
+	updateSaveMacro();
+}
+
+
+
+void MiscSettings::setKeyMacro(const KeyMacro& macro)
+{
+	change(m_keyMacro, macro, ATT_MACRO);
+	updateSaveMacro();
+}
+
+
+
+bool MiscSettings::setKeyMacro(const wstring& text)
+{
+	Expected<KeyMacro> macro = KeyMacro::parse(text);
+	if (!macro)
+		return false;
+	setKeyMacro(macro.value());
+	return true;
 }
 
 
 
+void MiscSettings::setPacingProfiles(const vector<PacingProfile>& profiles)
+{
+	vector<PacingProfile> bounded;
+	for (const PacingProfile& profile : profiles)
+	{
+		if (profile.executable.empty())
+			continue;
+		PacingProfile copy = profile;
+		for (wchar_t& c : copy.executable)
+			c = (wchar_t) towlower(c);
+		copy.eventDelay = __min(copy.eventDelay, PacingProfile::getMaxEventDelay());
+
+		auto pSame = std::find_if(bounded.begin(), bounded.end(),
+			[&copy](const PacingProfile& other) {
+			return other.executable == copy.executable;
+		});
+		if (pSame != bounded.end())
+			*pSame = copy;
+		else
+			bounded.push_back(copy);
+	}
+	change(m_pacingProfiles, bounded, ATT_PACING);
+}
+
+
+
+// There are only ever a few profiles, so this doesn't need an index.
+DWORD MiscSettings::getEventDelay(const wstring& executable) const
+{
+	if (executable.empty())
+		return 0;
+	for (const PacingProfile& profile : m_pacingProfiles)
+	{
+		if (profile.executable.size() == executable.size() &&
+			std::equal(executable.begin(), executable.end(),
+				profile.executable.begin(), [](wchar_t a, wchar_t b) {
+			return (wchar_t) towlower(a) == b;
+		}))
+			return profile.eventDelay;
+	}
+	return 0;
+}
+
+
+
+void MiscSettings::setEventDelay(const wstring& executable, DWORD eventDelay)
+{
+	vector<PacingProfile> profiles = m_pacingProfiles;
+	PacingProfile profile = { executable, eventDelay };
+	profiles.push_back(profile);
+	setPacingProfiles(profiles);
+}
+
+
+
+// Compiled here once, rather than each time the macro is sent.
+void MiscSettings::updateSaveMacro()
+{
+	m_saveMacro = m_keyMacro.isEmpty() ?
+		KeyMacro::fromHotkey(m_hotkey) : m_keyMacro;
+}
@@ -1,5 +1,12 @@
 // MiscSettings.h : Contains all settings that don't concern window matching:
-// Sending interval, sent keyboard input, and verbosity.
+// Sending interval and how it adapts to the user (see AdaptiveInterval),
+// sent keyboard input and how it is paced for each program (see KeyMacro),
+// verbosity, how long to wait for a save to show up in the connected
+// document (see SaveVerifier), what else besides the countdown makes
+// a save due (see Scheduler), and which versions of the saved documents
+// to keep (see BackupStore).
+// Remembers which of them have been changed since markClean, by
+// AttributesMask, so that only those need to be saved.
 // Member functions only throw if CommandLineParser throws.
 // Beware: toCommandLine may also throw std::invalid_argument or std::out_of_range!
 
@@ -7,8 +14,12 @@
 
 #include "stdafx.h"
 #include "CommandLineParser.h"
+#include "AdaptiveInterval.h"
+#include "KeyMacro.h"
+#include "BackupStore.h"
 
 using std::wstring;
+using std::vector;
 
 class MiscSettings
 {
@@ -19,7 +30,27 @@ public:
 		ATT_INTERVAL = 0x1,
 		ATT_HOTKEY = 0x2,
 		ATT_VERBOSITY = 0x4,
-		ATT_ALL = ATT_INTERVAL | ATT_HOTKEY | ATT_VERBOSITY
+		ATT_SAVECHECK = 0x8,
+		ATT_ADAPTIVE = 0x10,
+		ATT_MACRO = 0x20,
+		ATT_PACING = 0x40,
+		ATT_TRIGGERS = 0x80,
+		ATT_BACKUP = 0x100,
+		ATT_ALL = ATT_INTERVAL | ATT_HOTKEY | ATT_VERBOSITY | ATT_SAVECHECK |
+			ATT_ADAPTIVE | ATT_MACRO | ATT_PACING | ATT_TRIGGERS | ATT_BACKUP
+	};
+
+	// Events that make a save due before the countdown runs out. Input
+	// only reaches the foreground window, so the save goes out as soon
+	// as a matching window is in front again.
+	enum Trigger {
+		TRIG_NONE = 0,
+		TRIG_LEAVE = 0x1,      // A matching window loses the foreground.
+		TRIG_BACKGROUND = 0x2, // No matching window has been in front
+		                       // for getBackgroundDelay() seconds.
+		TRIG_MINIMIZE = 0x4,   // The matching window that was last in
+		                       // front is minimized.
+		TRIG_ALL = TRIG_LEAVE | TRIG_BACKGROUND | TRIG_MINIMIZE
 	};
 
 	enum Verbosity {
@@ -39,39 +70,141 @@ public:
 	bool operator!=(const MiscSettings& cfg) const;
 
 	// Configuration and command line
+	// A hotkey without a macro on the command line turns the macro off.
+	// Pacing profiles aren't part of the command line.
 	void loadFromCommandLine(const CommandLineParser& cli);
 	wstring toCommandLine(int attributesMask) const;
-	inline static const wchar_t* getAllowedKeys() { return L"HIV"; }
+	inline static const wchar_t* getAllowedKeys() { return L"HIVCAMTBDK"; }
 
 	// Getters and Setters
 
 	inline WORD getHotkey() const { return m_hotkey; }
-	inline void setHotkey(WORD hotkey) { m_hotkey = hotkey; }
+	void setHotkey(WORD hotkey);
+
+	// Sent instead of the hotkey unless it is empty.
+	inline const KeyMacro& getKeyMacro() const { return m_keyMacro; }
+	void setKeyMacro(const KeyMacro& macro);
+	// Returns false, and changes nothing, if the text doesn't parse.
+	bool setKeyMacro(const wstring& text);
+	// What to send to save: the macro, or else the hotkey.
+	inline const KeyMacro& getSaveMacro() const { return m_saveMacro; }
+
+	inline const vector<PacingProfile>& getPacingProfiles() const {
+		return m_pacingProfiles;
+	}
+	// Skips profiles without a name and brings delays into range. Names
+	// are made lower case; the last profile for a name wins.
+	void setPacingProfiles(const vector<PacingProfile>& profiles);
+	// The delay for the given program, or zero if it has no profile.
+	DWORD getEventDelay(const wstring& executable) const;
+	// Adds a profile for the program or changes its delay.
+	void setEventDelay(const wstring& executable, DWORD eventDelay);
 
 	inline static UINT getMinInterval() { return 10; }
 	inline static UINT getMaxInterval() { return 24 * 60 * 60; }
 
 	inline UINT getInterval() const  { return m_interval; }
 	inline void setInterval(UINT interval) {
-		m_interval = __min(__max(interval,
-			getMinInterval()), getMaxInterval());
+		change(m_interval, __min(__max(interval,
+			getMinInterval()), getMaxInterval()), ATT_INTERVAL);
 	}
 
 	inline Verbosity getVerbosity() const { return m_verbosity; }
 	inline bool verbosityExceeds(Verbosity minVerbosity) const {
 		return m_verbosity >= minVerbosity;
 	}
-	inline void setVerbosity(Verbosity verbosity) { m_verbosity = verbosity; }
+	inline void setVerbosity(Verbosity verbosity) {
+		change(m_verbosity, verbosity, ATT_VERBOSITY);
+	}
 	inline void setVerbosity(int verbosity) {
-		m_verbosity = (Verbosity)__min(__max(verbosity,
-			MIN_VERBOSITY), MAX_VERBOSITY);
+		change(m_verbosity, (Verbosity)__min(__max(verbosity,
+			MIN_VERBOSITY), MAX_VERBOSITY), ATT_VERBOSITY);
 	}
 
+	// In seconds. Zero means saves aren't checked.
+	inline static UINT getMaxSaveCheckTimeout() { return 10 * 60; }
+
+	inline UINT getSaveCheckTimeout() const { return m_saveCheckTimeout; }
+	inline void setSaveCheckTimeout(UINT timeout) {
+		change(m_saveCheckTimeout, __min(timeout, getMaxSaveCheckTimeout()),
+			ATT_SAVECHECK);
+	}
+
+	// While adaptive, the interval is only where the countdown starts.
+	inline bool isIntervalAdaptive() const { return m_isIntervalAdaptive; }
+	inline void setIntervalAdaptive(bool isAdaptive) {
+		change(m_isIntervalAdaptive, isAdaptive, ATT_ADAPTIVE);
+	}
+
+	inline const AdaptivePolicy& getAdaptivePolicy() const {
+		return m_adaptivePolicy;
+	}
+	// Brings each value into its range. The bounds must lie between
+	// getMinInterval() and getMaxInterval(). Counts as ATT_ADAPTIVE.
+	void setAdaptivePolicy(const AdaptivePolicy& policy);
+
+	// A combination of Trigger flags; the countdown stays the fallback.
+	inline int getTriggers() const { return m_triggers; }
+	inline void setTriggers(int triggers) {
+		change(m_triggers, triggers & TRIG_ALL, ATT_TRIGGERS);
+	}
+	inline bool isTriggerOn(Trigger trigger) const {
+		return (m_triggers & trigger) != 0;
+	}
+	// In seconds, like the interval.
+	inline UINT getBackgroundDelay() const { return m_backgroundDelay; }
+	inline void setBackgroundDelay(UINT delay) {
+		change(m_backgroundDelay, __min(__max(delay, 1u), getMaxInterval()),
+			ATT_TRIGGERS);
+	}
+	// In seconds. A trigger this soon after a save or after the previous
+	// trigger is ignored, so that switching windows back and forth
+	// doesn't save each time.
+	inline UINT getTriggerDedupe() const { return m_triggerDedupe; }
+	inline void setTriggerDedupe(UINT dedupe) {
+		change(m_triggerDedupe, __min(dedupe, getMaxInterval()), ATT_TRIGGERS);
+	}
+
+	// Backups need save checks, which tell when a document was saved.
+	inline const RetentionPolicy& getRetentionPolicy() const {
+		return m_retentionPolicy;
+	}
+	// Brings each value into its range. Counts as ATT_BACKUP.
+	void setRetentionPolicy(const RetentionPolicy& policy);
+	inline bool isBackupOn() const { return m_retentionPolicy.keepLast > 0; }
+
+	// Setting a value to what it already is doesn't count as a change.
+	inline int getDirtyMask() const { return m_dirtyMask; }
+	inline bool isDirty() const { return m_dirtyMask != ATT_NONE; }
+	inline void markClean() { m_dirtyMask = ATT_NONE; }
+
 
 private:
+	template<typename T>
+	inline void change(T& field, const T& value, AttributesMask attribute) {
+		if (field != value)
+		{
+			field = value;
+			m_dirtyMask |= attribute;
+		}
+	}
+
+	void updateSaveMacro();
+
 	WORD m_hotkey;
+	KeyMacro m_keyMacro;
+	KeyMacro m_saveMacro;
+	vector<PacingProfile> m_pacingProfiles;
 	UINT m_interval;
 	Verbosity m_verbosity;
+	UINT m_saveCheckTimeout;
+	bool m_isIntervalAdaptive;
+	AdaptivePolicy m_adaptivePolicy;
+	int m_triggers;
+	UINT m_backgroundDelay;
+	UINT m_triggerDedupe;
+	RetentionPolicy m_retentionPolicy;
+	int m_dirtyMask;
 
 };
 
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "OleUtils.h"
+#include <mutex>
 
 
 
@@ -11,6 +12,16 @@ namespace {
 	IShellFolder& getDesktopShellFolder();
 	vector<wstring> UnpackHDrop(HDROP dropData);
 
+	struct Self
+	{
+		wstring path;
+		// Either of them may appear in a path to the executable.
+		wstring longName;
+		wstring shortName;
+		OleUtils::FileIdentity identity;
+	};
+	const Self& getSelf();
+
 	// Used by getFileDataObjectWithIcon because that's what it's for.
 	class DragHelper {
 	public:
@@ -22,26 +33,57 @@ namespace {
 
 
 
-wstring OleUtils::getSelfPath()
+OleUtils::FileIdentity OleUtils::getFileIdentity(const wstring& path)
 {
-	wstring selfPath;
-	if (selfPath.empty())
+	FileIdentity identity = { 0, 0 };
+	HANDLE hFile = CreateFile(path.data(), 0,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return identity;
+
+	BY_HANDLE_FILE_INFORMATION info;
+	if (GetFileInformationByHandle(hFile, &info) != FALSE)
 	{
-		TCHAR buffer[MAX_PATH];
-		DWORD size = GetModuleFileName(NULL, buffer, MAX_PATH);
-		if (size == 0 || size == MAX_PATH)
-			throw OleException();
-		selfPath = buffer;
+		identity.volumeSerial = info.dwVolumeSerialNumber;
+		identity.fileIndex =
+			((ULONGLONG) info.nFileIndexHigh << 32) | info.nFileIndexLow;
 	}
-	return selfPath;
+	CloseHandle(hFile);
+	return identity;
 }
 
 
 
+wstring OleUtils::getSelfPath()
+{
+	return getSelf().path;
+}
+
+
+
+OleUtils::FileIdentity OleUtils::getSelfIdentity()
+{
+	return getSelf().identity;
+}
+
+
+
+// Most files that aren't AutoSave don't even have its name, and
+// comparing names is cheaper than opening the file.
 bool OleUtils::isSelf(const wstring& executablePath)
 {
+	const Self& self = getSelf();
+	LPCTSTR fileName = PathFindFileName(executablePath.data());
+	if (_tcsicmp(fileName, self.longName.data()) != 0 &&
+		_tcsicmp(fileName, self.shortName.data()) != 0)
+		return false;
+
+	const FileIdentity identity = getFileIdentity(executablePath);
+	if (identity.isKnown() && self.identity.isKnown())
+		return identity == self.identity;
 	return _tcsicmp(
-		makeAbsolutePath(executablePath).data(), getSelfPath().data()) == 0;
+		makeAbsolutePath(executablePath).data(), self.path.data()) == 0;
 }
 
 
@@ -252,6 +294,34 @@ namespace {
 
 
 
+	// VS2013 doesn't initialize local statics thread-safely, hence call_once.
+	// If the callable throws, the next call tries again.
+	std::once_flag selfFlag;
+	Self cachedSelf;
+
+	const Self& getSelf()
+	{
+		std::call_once(selfFlag, []() {
+			TCHAR buffer[MAX_PATH];
+			DWORD size = GetModuleFileName(NULL, buffer, MAX_PATH);
+			if (size == 0 || size == MAX_PATH)
+				throw OleException();
+			cachedSelf.path = buffer;
+			cachedSelf.longName = PathFindFileName(buffer);
+
+			TCHAR shortBuffer[MAX_PATH];
+			size = GetShortPathName(buffer, shortBuffer, MAX_PATH);
+			if (size == 0 || size >= MAX_PATH)
+				cachedSelf.shortName = cachedSelf.longName;
+			else
+				cachedSelf.shortName = PathFindFileName(shortBuffer);
+			cachedSelf.identity = OleUtils::getFileIdentity(cachedSelf.path);
+		});
+		return cachedSelf;
+	}
+
+
+
 	DragHelper::DragHelper() : pdsh(NULL)
 	{
 		throwOnFailure<OleException>(
@@ -3,6 +3,10 @@
 // Also includes a few utility functions surrounding GetModuleFileName
 // and PathMatchSpec.
 // Functions may throw OleException on failure.
+// What AutoSave's own executable is gets worked out once, by whichever
+// thread asks first. isSelf recognizes it through 8.3 names, junctions
+// and the like by its file identity, which it only looks up when the
+// file name fits, so that scanning many shortcuts stays cheap.
 
 #pragma once
 
@@ -18,7 +22,28 @@ using std::vector;
 
 namespace OleUtils
 {
+	// Tells files on a volume apart however they're named.
+	// All zero if it isn't known.
+	struct FileIdentity
+	{
+		DWORD volumeSerial;
+		ULONGLONG fileIndex;
+
+		inline bool isKnown() const {
+			return volumeSerial != 0 || fileIndex != 0;
+		}
+		inline bool operator==(const FileIdentity& other) const {
+			return volumeSerial == other.volumeSerial && fileIndex == other.fileIndex;
+		}
+	};
+
+	// Never throws; the identity is unknown if the file can't be opened.
+	FileIdentity getFileIdentity(const wstring& path);
+
+	// If GetModuleFileName fails, these throw and try again next time.
 	wstring getSelfPath();
+	FileIdentity getSelfIdentity();
+	// Compares paths where either identity is unknown.
 	bool isSelf(const wstring& executablePath);
 
 	bool isShortcutFile(const wstring& file);
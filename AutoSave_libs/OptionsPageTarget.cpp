@@ -4,7 +4,11 @@
 
 OptionsPageTarget::OptionsPageTarget(Matcher* pFilter)
 	: m_oldMatcher(*pFilter), // This is a reference,
-	  m_newMatcher(m_oldMatcher) // this is a copy.
+	  m_newMatcher(m_oldMatcher), // this is a copy.
+	  m_pWorker(NULL),
+	  m_filterGeneration(0),
+	  m_windowListRows(),
+	  m_windowListRevision(0)
 {
 	loadEmptyString(IDS_TARGET_NOWINDOWS);
 }
@@ -13,6 +17,9 @@ OptionsPageTarget::OptionsPageTarget(Matcher* pFilter)
 
 OptionsPageTarget::~OptionsPageTarget()
 {
+	// Usually, onDestroy has already taken care of this.
+	if (m_pWorker != NULL)
+		m_pWorker->stop();
 }
 
 
@@ -51,6 +58,16 @@ INT_PTR OptionsPageTarget::handleMessage(UINT message, WPARAM wParam, LPARAM lPa
 		onTimer(wParam);
 		return TRUE;
 	}
+	else if (message == WindowListWorker::WM_WINDOWLISTREADY)
+	{
+		onWindowListReady();
+		return TRUE;
+	}
+	else if (message == WM_DESTROY)
+	{
+		onDestroy();
+		return FALSE;
+	}
 	else {
 		return FALSE;
 	}
@@ -158,6 +175,9 @@ void OptionsPageTarget::onButtonClick(UINT ctrlId, HWND ctrlHandle)
 	SetDlgItemText(m_hwnd, IDC_SETTINGS_FILTEREDIT, newText.data());
 	SendDlgItemMessage(m_hwnd, IDC_SETTINGS_FILTEREDIT,
 		WM_SETFONT, (WPARAM) newFont, TRUE);
+
+	++m_filterGeneration;
+	updateWindowList();
 }
 
 // Update the config object when the filter text
@@ -174,6 +194,9 @@ void OptionsPageTarget::onEditChange(UINT ctrlId, HWND ctrlHandle)
 	else {
 		m_newMatcher.setPhrase(filter);
 	}
+
+	++m_filterGeneration;
+	updateWindowList();
 }
 
 
@@ -187,6 +210,8 @@ void OptionsPageTarget::onLinkClicked(LPCWSTR linkUrl)
 
 void OptionsPageTarget::onSetActive()
 {
+	if (m_pWorker == NULL)
+		m_pWorker = WindowListWorker::start(m_hwnd);
 	updateWindowList();
 	updateCurrentWindowCaptionEdit();
 	SetTimer(m_hwnd, listTimerId, 1000, NULL);
@@ -219,7 +244,10 @@ void OptionsPageTarget::onApply(bool fromApplyButton)
 
 	if (errorSize > 0)
 	{
-		MessageBox(GetParent(m_hwnd), errorMsg, APP_NAME, MB_ICONERROR);
+		wstring fullMsg = errorMsg;
+		if (m_newMatcher.isRegex() && !m_newMatcher.getRegexBadReason().empty())
+			fullMsg.append(L"\n\n" + m_newMatcher.getRegexBadReason());
+		MessageBox(GetParent(m_hwnd), fullMsg.data(), APP_NAME, MB_ICONERROR);
 		SetWindowLongPtr(m_hwnd, DWLP_MSGRESULT, PSNRET_INVALID);
 	}
 	else {
@@ -247,6 +275,44 @@ void OptionsPageTarget::onTimer(UINT_PTR timerId)
 
 
 
+// Apply results of the worker thread, unless they are outdated.
+void OptionsPageTarget::onWindowListReady()
+{
+	WindowListWorker::Result result;
+	if (m_pWorker == NULL || !m_pWorker->takeResult(&result))
+		return;
+
+	if (result.generation != m_filterGeneration)
+	{
+		// Computed for a filter that has been edited since.
+		return;
+	}
+	else if (result.baseRevision != m_windowListRevision)
+	{
+		// The diff doesn't fit the list anymore; ask again.
+		updateWindowList();
+		return;
+	}
+
+	if (result.rows.empty())
+		loadEmptyString(IDS_TARGET_NOWINDOWS);
+	applyWindowListDiff(result.diff);
+}
+
+
+
+void OptionsPageTarget::onDestroy()
+{
+	onKillActive();
+	if (m_pWorker != NULL)
+	{
+		m_pWorker->stop();
+		m_pWorker = NULL;
+	}
+}
+
+
+
 void OptionsPageTarget::updateCurrentWindowCaptionEdit()
 {
 	// Naive approach would fuck with the text selection.
@@ -270,69 +336,66 @@ void OptionsPageTarget::updateCurrentWindowCaptionEdit()
 
 
 
-// Catch bad input before iterating over all windows.
+// Catch bad input before bothering the worker thread.
 void OptionsPageTarget::updateWindowList()
 {
-	HWND hList = GetDlgItem(m_hwnd, IDC_SETTINGS_WINDOWLIST);
-	SendMessage(hList, WM_SETREDRAW, FALSE, 0);
-	ListBox_ResetContent(hList);
-
 	if (m_newMatcher.isEmpty())
 	{
 		loadEmptyString(IDS_TARGET_EMPTY);
+		applyWindowListDiff(WindowListDiff(m_windowListRows, {}));
 	}
 	else if (m_newMatcher.isRegex() && m_newMatcher.isRegexBad())
 	{
 		loadEmptyString(IDS_TARGET_BADREGEX);
+		applyWindowListDiff(WindowListDiff(m_windowListRows, {}));
 	}
-	else {
-		fillWindowList(hList, m_newMatcher);
-		if (ListBox_GetCount(hList) == 0)
-			loadEmptyString(IDS_TARGET_NOWINDOWS);
+	else if (m_pWorker != NULL)
+	{
+		m_pWorker->request(m_newMatcher, m_filterGeneration,
+			getWindowListCapacity(), m_windowListRows, m_windowListRevision);
 	}
-	SendMessage(hList, WM_SETREDRAW, TRUE, 0);
-	RedrawWindow(hList, NULL, NULL,
-		RDW_ERASE | RDW_FRAME | RDW_INVALIDATE | RDW_ALLCHILDREN);
 }
 
 
 
-void OptionsPageTarget::fillWindowList(HWND hList, const Matcher& filter)
+// Only touch the rows that have actually changed.
+void OptionsPageTarget::applyWindowListDiff(const WindowListDiff& diff)
 {
-	RECT listRect;
-	GetClientRect(hList, &listRect);
-	const int itemHeight = ListBox_GetItemHeight(hList, 0);
+	HWND hList = GetDlgItem(m_hwnd, IDC_SETTINGS_WINDOWLIST);
+	bool wasEmpty = m_windowListRows.empty();
+	if (!diff.isEmpty())
+	{
+		SendMessage(hList, WM_SETREDRAW, FALSE, 0);
+		for (size_t index : diff.getRemovals())
+		{
+			ListBox_DeleteString(hList, (int) index);
+		}
+		for (const WindowListDiff::Insertion& insertion : diff.getInsertions())
+		{
+			ListBox_InsertString(hList, (int) insertion.index,
+				insertion.text.data());
+		}
+		SendMessage(hList, WM_SETREDRAW, TRUE, 0);
+
+		m_windowListRows = diff.applyTo(m_windowListRows);
+		++m_windowListRevision;
+	}
 
-	fillWindowListEnumProcParameters args = {
-		hList, filter, listRect.bottom / itemHeight
-	};
-	EnumWindows(fillWindowListEnumProc, (LPARAM)&args);
+	// An empty list shows m_windowListEmptyText, which might have changed.
+	if (!diff.isEmpty() || (wasEmpty && m_windowListRows.empty()))
+	{
+		RedrawWindow(hList, NULL, NULL,
+			RDW_ERASE | RDW_FRAME | RDW_INVALIDATE | RDW_ALLCHILDREN);
+	}
 }
 
 
 
-BOOL CALLBACK OptionsPageTarget::fillWindowListEnumProc(HWND hwnd, LPARAM lParam)
+UINT OptionsPageTarget::getWindowListCapacity() const
 {
-	// Ignore owned and invisible windows.
-	bool isUnownedAndVisible = GetParent(hwnd) == 0 && IsWindowVisible(hwnd);
-	if (!isUnownedAndVisible)
-		return TRUE;
-
-	// Ignore windows without caption.
-	auto pArgs = (fillWindowListEnumProcParameters*)lParam;
-	wstring caption = Matcher::getWindowText(hwnd);
-	if (caption.empty())
-		return TRUE;
-
-	// Ignore windows that don't match.
-	if (!pArgs->filter.match(caption))
-		return TRUE;
-
-	// Matching windows reduce the counter.
-	--pArgs->remainingWindows;
-	ListBox_AddString(pArgs->hList,
-		(pArgs->remainingWindows != 0) ? caption.data() : L"[...]");
-	return pArgs->remainingWindows > 0;
+	HWND hList = GetDlgItem(m_hwnd, IDC_SETTINGS_WINDOWLIST);
+	RECT listRect;
+	GetClientRect(hList, &listRect);
+	const int itemHeight = ListBox_GetItemHeight(hList, 0);
+	return (itemHeight > 0) ? listRect.bottom / itemHeight : 0;
 }
-
-
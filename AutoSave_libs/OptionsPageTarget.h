@@ -8,6 +8,7 @@
 #include "GdiUtils.h"
 #include "OptionsPageBase.h"
 #include "Matcher.h"
+#include "WindowListWorker.h"
 #include "..\AutoSave\\Resource.h"
 
 class OptionsPageTarget : public OptionsPageBase
@@ -36,24 +37,28 @@ protected:
 	void onApply(bool fromApplyButton);
 
 	void onTimer(UINT_PTR timerId);
+	void onWindowListReady();
+	void onDestroy();
 
 private:
 	void updateCurrentWindowCaptionEdit();
 
-	// Filling the window list
+	// Filling the window list. The actual work is done by m_pWorker.
 	void updateWindowList();
-	static void fillWindowList(HWND hList, const Matcher& filter);
-	static BOOL CALLBACK fillWindowListEnumProc(HWND hwnd, LPARAM lParam);
-	struct fillWindowListEnumProcParameters {
-		const HWND hList;
-		const Matcher& filter;
-		UINT remainingWindows;
-	};
-
+	void applyWindowListDiff(const WindowListDiff& diff);
+	UINT getWindowListCapacity() const;
 
 	Matcher& m_oldMatcher;
 	Matcher m_newMatcher;
 
+	// Started on first activation, stopped in onDestroy.
+	WindowListWorker* m_pWorker;
+	// Incremented whenever m_newMatcher changes.
+	UINT m_filterGeneration;
+	// Rows currently in the list, and a counter of changes to them.
+	vector<wstring> m_windowListRows;
+	UINT m_windowListRevision;
+
 	const UINT_PTR listTimerId = 1;
 	const UINT_PTR captionTimerId = 2;
 	const static int m_emptyTextMaxSize = 128;
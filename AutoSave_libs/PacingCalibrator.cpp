@@ -0,0 +1,139 @@
+#include "stdafx.h"
+#include "PacingCalibrator.h"
+
+
+bool PacingCalibrator::start(HWND target, const KeyMacro& macro,
+	const vector<wstring>& files)
+{
+	cancel();
+	const wstring executable = m_windows.getWindowExecutable(target);
+	if (target == NULL || executable.empty() || macro.isEmpty())
+		return false;
+
+	m_target = target;
+	m_processId = m_windows.getWindowProcessId(target);
+	m_executable = executable;
+	for (wchar_t& c : m_executable)
+		c = (wchar_t) towlower(c);
+	m_macro = macro;
+	for (const wstring& path : files)
+	{
+		if (m_watcher.getStamp(path).exists && m_watcher.watch(path))
+			m_files.push_back(path);
+	}
+
+	m_eventDelay = m_startDelay;
+	m_status = PC_PROBING;
+	return true;
+}
+
+
+
+void PacingCalibrator::cancel()
+{
+	m_watcher.unwatchAll();
+	m_status = PC_IDLE;
+	m_target = NULL;
+	m_executable.clear();
+	m_files.clear();
+	m_stampsBefore.clear();
+	m_savedInARow = 0;
+	m_isWaiting = false;
+	m_hasResult = false;
+	m_result = 0;
+	m_attempts.clear();
+}
+
+
+
+PacingCalibrator::Status PacingCalibrator::step()
+{
+	if (m_status != PC_PROBING)
+		return m_status;
+
+	if (m_isWaiting)
+	{
+		if (hasSaved())
+			settle(true);
+		else if (m_clock.getTickCount() - m_sentTime >= m_timeout)
+			settle(false);
+	}
+	// A settled attempt leaves room for the next one right away.
+	if (m_status == PC_PROBING && !m_isWaiting)
+		sendAttempt();
+	return m_status;
+}
+
+
+
+// Waits for the user to bring the target back and let go of the keys,
+// as the Scheduler does.
+void PacingCalibrator::sendAttempt()
+{
+	if (!m_windows.isWindowVisible(m_target))
+	{
+		m_status = PC_FAILED;
+		return;
+	}
+	if (m_windows.getForegroundWindow() != m_target || m_input.isAnyKeyPressed())
+		return;
+
+	// Forget about changes from before this attempt.
+	m_watcher.takeChanges();
+	m_stampsBefore.clear();
+	for (const wstring& path : m_files)
+		m_stampsBefore.push_back(m_watcher.getStamp(path));
+	m_macro.sendTo(m_input, m_eventDelay);
+	m_sentTime = m_clock.getTickCount();
+	m_isWaiting = true;
+}
+
+
+
+// Only looks at the files the watcher reported, like SaveVerifier.
+bool PacingCalibrator::hasSaved()
+{
+	vector<wstring> changes = m_watcher.takeChanges();
+	for (size_t i = 0; i < m_files.size(); ++i)
+	{
+		bool isReported = std::find(changes.begin(), changes.end(),
+			m_files[i]) != changes.end();
+		if (isReported && m_watcher.getStamp(m_files[i]) != m_stampsBefore[i])
+			return true;
+	}
+
+	const HWND foreground = m_windows.getForegroundWindow();
+	if (foreground != NULL && foreground != m_target && m_processId != 0 &&
+		m_windows.getWindowProcessId(foreground) == m_processId)
+	{
+		m_input.send(KeySequence::fromHotkey(VK_ESCAPE));
+		return true;
+	}
+	return false;
+}
+
+
+
+void PacingCalibrator::settle(bool isSaved)
+{
+	Attempt attempt = { m_eventDelay, isSaved,
+		isSaved ? m_clock.getTickCount() - m_sentTime : 0 };
+	m_attempts.push_back(attempt);
+	m_isWaiting = false;
+
+	if (!isSaved)
+	{
+		m_status = m_hasResult ? PC_DONE : PC_FAILED;
+		return;
+	}
+	if (++m_savedInARow < m_attemptsPerDelay)
+		return;
+
+	m_savedInARow = 0;
+	m_hasResult = true;
+	m_result = m_eventDelay;
+	if (m_eventDelay == 0)
+		m_status = PC_DONE;
+	else
+		m_eventDelay /= 2;
+}
@@ -0,0 +1,118 @@
+// PacingCalibrator.h : Finds out how fast a program can take the save
+// keys. It sends the save macro again and again, first with a pause
+// after every key event that is long enough for any program, and then
+// with half the pause each time, down to none, i.e. batches sent at once
+// (see KeyMacro). A pause has to save a number of times in a row; the
+// shortest one that did is the result, ready to become the program's
+// PacingProfile. The first attempt that doesn't save ends the search.
+// An attempt has saved when one of the given files is written, or when
+// the program brings up another window of its own, i.e. a Save As
+// dialog, which is then closed with Escape. Without files, only dialogs
+// tell.
+// A program that misses a modifier gets the plain key instead, e.g. an
+// "s" typed into the document, so calibrating is for the user to start,
+// on a document they can spare.
+// Like SaveVerifier, it is stepped by the caller's timer, and only sends
+// while the target is the foreground window and no key is held down.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+#include "KeyMacro.h"
+
+using std::wstring;
+using std::vector;
+
+class PacingCalibrator
+{
+public:
+	enum Status {
+		PC_IDLE,
+		PC_PROBING,
+		PC_DONE,   // getProfile() has the result.
+		PC_FAILED  // The first pause didn't save, or the target went away.
+	};
+
+	struct Attempt
+	{
+		DWORD eventDelay;
+		bool isSaved;
+		ULONGLONG latency; // From sending to the save; zero if none.
+	};
+
+	PacingCalibrator(const Clock& clock, const WindowEnumerator& windows,
+		InputSink& input, FileWatcher& watcher)
+		: m_clock(clock), m_windows(windows), m_input(input), m_watcher(watcher),
+		  m_startDelay(200), m_attemptsPerDelay(3), m_timeout(3000),
+		  m_status(PC_IDLE), m_target(NULL), m_processId(0), m_eventDelay(0),
+		  m_savedInARow(0), m_isWaiting(false), m_sentTime(0),
+		  m_hasResult(false), m_result(0) {}
+	~PacingCalibrator() { m_watcher.unwatchAll(); }
+
+	// In milliseconds, at most PacingProfile::getMaxEventDelay().
+	inline DWORD getStartDelay() const { return m_startDelay; }
+	inline void setStartDelay(DWORD startDelay) {
+		m_startDelay = __min(startDelay, PacingProfile::getMaxEventDelay());
+	}
+	// At least one.
+	inline UINT getAttemptsPerDelay() const { return m_attemptsPerDelay; }
+	inline void setAttemptsPerDelay(UINT attempts) {
+		m_attemptsPerDelay = __max(attempts, 1);
+	}
+	// How long to wait for an attempt to save, in milliseconds.
+	inline ULONGLONG getTimeout() const { return m_timeout; }
+	inline void setTimeout(ULONGLONG timeout) { m_timeout = timeout; }
+
+	// Starts over with the program of target, watching those of the
+	// files that exist. Returns false, and stays idle, if the program
+	// isn't known.
+	bool start(HWND target, const KeyMacro& macro, const vector<wstring>& files);
+	void cancel();
+	// To be called regularly, e.g. once per second.
+	Status step();
+
+	inline Status getStatus() const { return m_status; }
+	inline bool isProbing() const { return m_status == PC_PROBING; }
+	// The target's program, e.g. L"illustrator.exe".
+	inline const wstring& getExecutable() const { return m_executable; }
+	// The shortest pause that saved every time; only once done.
+	inline PacingProfile getProfile() const {
+		PacingProfile profile = { m_executable, m_result };
+		return profile;
+	}
+	inline const vector<Attempt>& getAttempts() const { return m_attempts; }
+
+private:
+	PacingCalibrator(const PacingCalibrator&);
+	PacingCalibrator& operator=(const PacingCalibrator&);
+
+	void sendAttempt();
+	bool hasSaved();
+	void settle(bool isSaved);
+
+	const Clock& m_clock;
+	const WindowEnumerator& m_windows;
+	InputSink& m_input;
+	FileWatcher& m_watcher;
+	DWORD m_startDelay;
+	UINT m_attemptsPerDelay;
+	ULONGLONG m_timeout;
+
+	Status m_status;
+	HWND m_target;
+	DWORD m_processId;
+	wstring m_executable;
+	KeyMacro m_macro;
+	vector<wstring> m_files;
+	vector<FileStamp> m_stampsBefore;
+
+	DWORD m_eventDelay;
+	UINT m_savedInARow;
+	bool m_isWaiting;
+	ULONGLONG m_sentTime;
+	bool m_hasResult;
+	DWORD m_result;
+	vector<Attempt> m_attempts;
+};
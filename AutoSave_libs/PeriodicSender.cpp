@@ -4,7 +4,7 @@
 
 void PeriodicSender::setWindow(HWND hwnd)
 {
-	if (!m_isStarted)
+	if (!m_countdown.isStarted())
 		m_hwnd = hwnd;
 }
 
@@ -16,24 +16,22 @@ void PeriodicSender::start()
 		SetTimer(m_hwnd, timerId, 1000, NULL);
 		PostMessage(m_hwnd, SM_START, 0, 0);
 	}
+	m_isAsleep = false;
 
-	m_isStarted = true;
-	m_isPaused = false;
-	m_mainSecondsLeft = m_interval;
+	m_countdown.start();
 }
 
 
 
 void PeriodicSender::stop()
 {
-	if (m_isStarted)
+	if (m_countdown.isStarted())
 	{
-		if (m_hwnd!= 0 && !m_isPaused)
+		if (m_hwnd!= 0 && !m_countdown.isPaused())
 			KillTimer(m_hwnd, timerId);
+		m_isAsleep = false;
 
-		m_isStarted = false;
-		m_isPaused = false;
-		m_mainSecondsLeft = 0;
+		m_countdown.stop();
 	}
 }
 
@@ -41,57 +39,70 @@ void PeriodicSender::stop()
 
 void PeriodicSender::pause()
 {
-	if (m_isStarted && !m_isPaused)
-	{
-		m_isPaused = true;
-		if (m_hwnd != 0)
-			KillTimer(m_hwnd, timerId);
-	}
+	if (m_countdown.pause() && m_hwnd != 0)
+		KillTimer(m_hwnd, timerId);
 }
 
 
 
 void PeriodicSender::resume()
 {
-	if (m_isPaused)
+	if (m_countdown.resume())
 	{
-		m_isPaused = false;
 		if (m_hwnd != 0)
 			SetTimer(m_hwnd, timerId, 1000, NULL);
+		m_isAsleep = false;
 	}
 }
 
 
 
+void PeriodicSender::sleep()
+{
+	if (!m_countdown.isRunning() || m_isAsleep)
+		return;
+	if (m_hwnd != 0)
+		KillTimer(m_hwnd, timerId);
+	m_isAsleep = true;
+}
+
+
+
+// The next tick is a second from now, as after start().
+void PeriodicSender::wake()
+{
+	if (!m_isAsleep)
+		return;
+	m_isAsleep = false;
+	if (m_countdown.isRunning() && m_hwnd != 0)
+		SetTimer(m_hwnd, timerId, 1000, NULL);
+}
+
+
+
 void PeriodicSender::step()
 {
-	if (m_isPaused || !m_isStarted)
+	Countdown::Event event = m_countdown.step();
+	if (m_hwnd == 0)
 		return;
 
-	if (m_delaySecondsLeft > 0)
-	{
-		// If a delay has been specified, wait before
-		// doing the actual countdown.
-		--m_delaySecondsLeft;
-		if (m_delaySecondsLeft == 0 && m_hwnd != 0)
-			PostMessage(m_hwnd, SM_DELAYATZERO, 0, 0);
-	}
-	else
+	switch (event)
 	{
-		// Actual countdown.
-		if (m_mainSecondsLeft > 0)
-			--m_mainSecondsLeft;
-
-		if (m_hwnd != 0)
-		{
-			if (m_mainSecondsLeft <= 0)
-				PostMessage(m_hwnd, SM_ATZERO, 0, 0);
-			else if (m_mainSecondsLeft < 5)
-				PostMessage(m_hwnd, SM_LESSTHANFIVELEFT,
-							m_mainSecondsLeft, 0);
-			else if (m_mainSecondsLeft == 5)
-				PostMessage(m_hwnd, SM_FIVESECONDSLEFT, 5, 0);
-		}
+	case Countdown::EV_DELAYATZERO:
+		PostMessage(m_hwnd, SM_DELAYATZERO, 0, 0);
+		break;
+	case Countdown::EV_FIVESECONDSLEFT:
+		PostMessage(m_hwnd, SM_FIVESECONDSLEFT, 5, 0);
+		break;
+	case Countdown::EV_LESSTHANFIVELEFT:
+		PostMessage(m_hwnd, SM_LESSTHANFIVELEFT,
+					m_countdown.getSecondsLeft(), 0);
+		break;
+	case Countdown::EV_ATZERO:
+		PostMessage(m_hwnd, SM_ATZERO, 0, 0);
+		break;
+	default:
+		break;
 	}
 }
 
@@ -99,74 +110,26 @@ void PeriodicSender::step()
 
 void PeriodicSender::resetCountdown()
 {
-	m_mainSecondsLeft = m_interval;
+	m_countdown.resetCountdown();
 }
 
 
 
 void PeriodicSender::resetDelay()
 {
-	m_delaySecondsLeft = delayTime;
+	m_countdown.resetDelay();
 }
 
 
 
 UINT PeriodicSender::sendKeys(WORD hotkey)
 {
-	if (LOBYTE(hotkey) == 0)
-		return 0;
-
-	vector<INPUT> inputs;
-	// Get space for up&down events for one key and up to three modifiers.
-	inputs.reserve(8);
-	if (HIBYTE(hotkey) & HOTKEYF_CONTROL)
-		insertKey(&inputs, VK_CONTROL);
-	if (HIBYTE(hotkey) & HOTKEYF_SHIFT)
-		insertKey(&inputs, VK_SHIFT);
-	if (HIBYTE(hotkey) & HOTKEYF_ALT)
-		insertKey(&inputs, VK_MENU);
-	insertKey(&inputs, LOBYTE(hotkey));
-	
-	// Instead of sending all six input events at once, we send them
-	// sequentially because otherwise, Adobe Illustrator seems to
-	// ignore ctrl, shift, and alt. (Date: 2014-07-09)
-	int inputsSent = 0;
-	for (INPUT& input : inputs)
-	{
-		inputsSent += SendInput(1, &input, sizeof(INPUT));
-		Sleep(10);
-	}
-	return inputsSent / 2;
-}
-
-void PeriodicSender::insertKey(vector<INPUT>* pList, WORD key)
-{
-	const size_t middle = pList->size() / 2;
-
-	INPUT input = { 0 };
-	input.type = INPUT_KEYBOARD;
-	input.ki.wVk = key;
-	input.ki.dwFlags = KEYEVENTF_KEYUP;
-	pList->insert(pList->begin() + middle, input);
-	input.ki.dwFlags = 0;
-	pList->insert(pList->begin() + middle, input);
+	return Platform::getInputSink().send(KeySequence::fromHotkey(hotkey)) / 2;
 }
 
 
 
-// Used to make sure the input queue doesn't get confused.
-// Returns false when a key is pressed or an error occurs.
 bool PeriodicSender::noKeyPressed()
 {
-	BYTE lastKeyOfInterest = VK_F24;
-	for (BYTE key = 0; key <= lastKeyOfInterest; ++key)
-	{
-		if ((GetAsyncKeyState(key) & 0x8000) != 0)
-			return false;
-	}
-	return true;
+	return !Platform::getInputSink().isAnyKeyPressed();
 }
-
-
-
-
@@ -1,22 +1,27 @@
 // Sender.h : Interface for a timer and actually sending
 // keyboard input to other applications.
+// The countdown itself lives in Countdown; this class drives it with
+// a window timer and turns its events into SenderMessages.
 // Never throws exceptions.
 
 #pragma once
 
 #include "stdafx.h"
+#include "Countdown.h"
+#include "Platform.h"
 
 using std::vector;
 
 class PeriodicSender
 {
 public:
-	PeriodicSender(UINT interval) : m_hwnd(0), m_interval(interval) {}
+	PeriodicSender(UINT interval)
+		: m_hwnd(0), m_countdown(interval), m_isAsleep(false) {}
 	~PeriodicSender() { stop(); }
 
 	void setWindow(HWND hwnd);
 
-	inline void setInterval(UINT interval) { m_interval = interval; }
+	inline void setInterval(UINT interval) { m_countdown.setInterval(interval); }
 
 	void start();
 	void stop();
@@ -25,9 +30,18 @@ public:
 	void pause();
 	void resume();
 
+	// Stops the timer without pausing the countdown, e.g. while waiting
+	// at zero for a foreground change, until wake(), resume(), or start().
+	void sleep();
+	void wake();
+	inline bool isAsleep() const { return m_isAsleep; }
+
 	void resetCountdown();
 	void resetDelay();
 
+	// For the Scheduler, which resets the countdown itself.
+	inline Countdown& getCountdown() { return m_countdown; }
+
 	static UINT sendKeys(WORD hotkey);
 	static bool noKeyPressed();
 
@@ -40,17 +54,10 @@ public:
 	};
 
 private:
-	static void insertKey(vector<INPUT>* pList, WORD key);
-
 	HWND m_hwnd;
-	UINT m_interval;
-
-	bool m_isStarted;
-	bool m_isPaused;
-	UINT m_mainSecondsLeft;
-	UINT m_delaySecondsLeft;
+	Countdown m_countdown;
+	bool m_isAsleep;
 
-	static const UINT delayTime = 2;
 	static const UINT_PTR timerId = 622;
 };
 
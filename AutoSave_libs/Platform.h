@@ -0,0 +1,278 @@
+// Platform.h : The thin layer between AutoSave's logic and the system
+// it runs on: a clock, window enumeration and foreground changes,
+// keyboard input, settings storage, started processes, and watched files.
+// Win32Platform.cpp implements it with the Windows API, PosixPlatform.cpp
+// with what's needed to build and test the core on other systems.
+// Tests and simulations may pass their own implementations to the
+// functions that accept them.
+// For thrown exceptions, see the individual functions.
+
+#pragma once
+
+#include "stdafx.h"
+#include "KeySequence.h"
+#include "Expected.h"
+
+#include <cstdio>
+
+using std::wstring;
+using std::vector;
+using std::unique_ptr;
+
+
+
+// Milliseconds since some arbitrary, fixed point in time.
+class Clock
+{
+public:
+	virtual ~Clock() {}
+	virtual ULONGLONG getTickCount() const = 0;
+};
+
+
+
+// Top-level windows and what AutoSave needs to know about them.
+// Never throws exceptions.
+class WindowEnumerator
+{
+public:
+	virtual ~WindowEnumerator() {}
+
+	// Calls callback for every top-level window until it returns false.
+	virtual void enumWindows(const std::function<bool(HWND)>& callback) const = 0;
+
+	// The window's caption. Never waits long for the window's program:
+	// if it is hung, or doesn't answer in time, the caption is empty and
+	// the window is kept for takeUnresponsiveWindows().
+	virtual wstring getWindowText(HWND hwnd) const = 0;
+	// The windows whose caption came out empty that way since the last
+	// call, each once. May be called from any thread.
+	virtual vector<HWND> takeUnresponsiveWindows() const = 0;
+	virtual DWORD getWindowProcessId(HWND hwnd) const = 0;
+	// File name of the program the window belongs to, without its
+	// folder, e.g. L"notepad.exe". Empty if unknown.
+	virtual wstring getWindowExecutable(HWND hwnd) const = 0;
+	virtual bool isOwnedWindow(HWND hwnd) const = 0;
+	virtual bool isWindowVisible(HWND hwnd) const = 0;
+	virtual bool isWindowMinimized(HWND hwnd) const = 0;
+	virtual HWND getForegroundWindow() const = 0;
+
+	// Whether the window's thread handles a message within timeout
+	// milliseconds. A hung window isn't even asked.
+	virtual bool isWindowResponding(HWND hwnd, DWORD timeout) const = 0;
+	// Processor time that the window's process has used so far, over all
+	// its threads, in milliseconds. Zero if unknown.
+	virtual ULONGLONG getProcessCpuTime(HWND hwnd) const = 0;
+};
+
+
+
+// Reports each new foreground window as the system switches to it, so
+// that waiting for one takes no polling. Where the system can't report
+// it, watching fails and callers have to poll getForegroundWindow().
+// Never throws exceptions.
+class ForegroundWatcher
+{
+public:
+	typedef std::function<void(HWND)> Handler;
+
+	virtual ~ForegroundWatcher() {}
+
+	// The handler runs on the thread that started watching, from its
+	// message loop, until stopWatching(). Returns false if the changes
+	// can't be reported.
+	virtual bool startWatching(const Handler& handler) = 0;
+	virtual void stopWatching() = 0;
+};
+
+
+
+// Where keyboard input goes.
+// Never throws exceptions.
+class InputSink
+{
+public:
+	virtual ~InputSink() {}
+
+	// Sends the events in one go, so that no other input can come in
+	// between. Returns the number of events that have been sent.
+	virtual UINT send(const vector<KeyEvent>& events) = 0;
+	// Blocks for a while between two sends, for applications that
+	// can't keep up (see KeyMacro).
+	virtual void wait(DWORD milliseconds) = 0;
+
+	// Used to make sure the input queue doesn't get confused.
+	// Returns true when a key is pressed or an error occurs.
+	virtual bool isAnyKeyPressed() const = 0;
+
+	// When the user last pressed a key or moved the mouse, in Clock ticks.
+	// Input sent through send() may count as well. Zero if unknown.
+	virtual ULONGLONG getLastInputTime() const = 0;
+};
+
+
+
+// Named values that survive between sessions. On Windows, these are
+// the values of a registry key.
+// Reading a missing value throws; the exception class depends on the
+// implementation (RegistryException for the registry). The tryRead
+// functions return the error instead, ERROR_FILE_NOT_FOUND for a missing
+// value and ERROR_UNSUPPORTED_TYPE for one of another type; use them
+// where missing values are expected.
+class ConfigStore
+{
+public:
+	virtual ~ConfigStore() {}
+
+	virtual int readInt(const wstring& valueName) const = 0;
+	virtual void writeInt(const wstring& valueName, int valueData) = 0;
+
+	virtual wstring readString(const wstring& valueName) const = 0;
+	virtual void writeString(const wstring& valueName, const wstring& valueData) = 0;
+
+	virtual vector<wstring> readMultiString(const wstring& valueName) const = 0;
+	virtual void writeMultiString(const wstring& valueName,
+		const vector<wstring>& strings) = 0;
+
+	virtual Expected<int> tryReadInt(const wstring& valueName) const = 0;
+	virtual Expected<wstring> tryReadString(const wstring& valueName) const = 0;
+	virtual Expected<vector<wstring>> tryReadMultiString(
+		const wstring& valueName) const = 0;
+
+	// In no particular order.
+	virtual vector<wstring> getValueNames() const = 0;
+	// Deleting a missing value does nothing.
+	virtual void deleteValue(const wstring& valueName) = 0;
+};
+
+
+
+// A process started by AutoSave.
+// Never throws exceptions.
+class ProcessHandle
+{
+public:
+	virtual ~ProcessHandle() {}
+
+	virtual unique_ptr<ProcessHandle> clone() const = 0;
+
+	virtual DWORD getProcessId() const = 0;
+	virtual bool isAlive() const = 0;
+	// Returns 0 on success or WAIT_TIMEOUT.
+	virtual DWORD waitForInputIdle(DWORD timeout) const = 0;
+};
+
+
+
+// Size and modification time of a file.
+struct FileStamp
+{
+	bool exists;
+	ULONGLONG size;
+	ULONGLONG modificationTime; // In the system's own unit.
+
+	inline bool operator==(const FileStamp& other) const {
+		return exists == other.exists && size == other.size &&
+			modificationTime == other.modificationTime;
+	}
+	inline bool operator!=(const FileStamp& other) const {
+		return !(*this == other);
+	}
+};
+
+
+
+// Tells which files have changed, as reported by the system,
+// without polling them.
+// Never throws exceptions.
+class FileWatcher
+{
+public:
+	virtual ~FileWatcher() {}
+
+	// Returns false if the file can't be watched.
+	virtual bool watch(const wstring& path) = 0;
+	virtual void unwatchAll() = 0;
+
+	// Returns the watched files that have been reported changed since
+	// the last call. Never blocks.
+	virtual vector<wstring> takeChanges() = 0;
+
+	virtual FileStamp getStamp(const wstring& path) const = 0;
+};
+
+
+
+// Serves requests on a local endpoint that only the current user can
+// reach: a named pipe on Windows, a Unix domain socket elsewhere.
+// A client sends one line and gets the handler's response back, after
+// which the connection is closed. Everything happens on a thread of the
+// server's own, so the handler must not block or touch any windows.
+// Destroying the server stops the thread.
+class ControlServer
+{
+public:
+	typedef std::function<std::string(const std::string&)> Handler;
+
+	virtual ~ControlServer() {}
+};
+
+
+
+// The implementations for the system AutoSave has been compiled for.
+namespace Platform
+{
+	// Never throw exceptions.
+	Clock& getClock();
+	WindowEnumerator& getWindowEnumerator();
+	InputSink& getInputSink();
+
+	// May throw the same exceptions as ConfigStore.
+	bool configStoreExists(const wstring& keyName);
+	unique_ptr<ConfigStore> openConfigStore(const wstring& keyName);
+	void purgeConfigStore(const wstring& keyName);
+
+	// Opens file with the given arguments. May throw AutoSaveException.
+	unique_ptr<ProcessHandle> startProcess(const wstring& file,
+		const wstring& argLine);
+	// True if opening file would start another AutoSave.
+	// May throw AutoSaveException.
+	bool wouldStartSelf(const wstring& file);
+
+	// Never throws exceptions. Safe to call from any thread.
+	bool fileExists(const wstring& path);
+	// Like fopen, rename and remove, but with the wide paths that Windows
+	// takes as they are. Return NULL or false on failure, with the reason
+	// in GetLastError. renameFile replaces to if it exists.
+	// Never throw exceptions. Safe to call from any thread.
+	FILE* openFile(const wstring& path, const wchar_t* mode);
+	bool renameFile(const wstring& from, const wstring& to);
+	bool removeFile(const wstring& path);
+	// To and from the multibyte encoding of the system, which other
+	// systems use for file names, and consoles for text. Empty if the
+	// text can't be converted.
+	// Never throw exceptions (except std::bad_alloc).
+	std::string toNarrow(const wstring& text);
+	wstring toWide(const std::string& text);
+	// Where AutoSave keeps data of its own for the user, e.g. backups;
+	// it may not exist yet. Empty if the system doesn't say.
+	// Never throws exceptions (except std::bad_alloc).
+	wstring getDataDirectory();
+
+	// Never throws exceptions. Where the system can't report file
+	// changes, the watcher can't watch anything.
+	unique_ptr<FileWatcher> createFileWatcher();
+	// Never throws exceptions. Likewise, the watcher may not be able to
+	// start watching.
+	unique_ptr<ForegroundWatcher> createForegroundWatcher();
+
+	// Returns NULL if another process already serves the name.
+	// May throw AutoSaveException.
+	unique_ptr<ControlServer> startControlServer(const wstring& name,
+		const ControlServer::Handler& handler);
+	// Sends request, without line break, and returns the whole response.
+	// Throws AutoSaveException if nobody serves the name or doesn't
+	// answer within a few seconds.
+	std::string sendControlRequest(const wstring& name,
+		const std::string& request);
+}
@@ -0,0 +1,120 @@
+// PortableTypes.h : Stand-ins for the parts of windows.h that the
+// platform-independent code uses, so that it compiles elsewhere.
+// Only included by stdafx.h when _WIN32 isn't defined.
+// Values are the same as in the Windows SDK, so that hotkeys and error
+// codes mean the same thing on every platform.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <cwctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// Basic types
+
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned int UINT;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef int BOOL;
+typedef int32_t HRESULT;
+typedef uint64_t ULONGLONG;
+typedef intptr_t INT_PTR;
+typedef uintptr_t UINT_PTR;
+typedef intptr_t LPARAM;
+typedef uintptr_t WPARAM;
+typedef wchar_t TCHAR;
+typedef BYTE* LPBYTE;
+typedef const char* LPCSTR;
+typedef const wchar_t* LPCWSTR;
+typedef const wchar_t* LPCTSTR;
+typedef wchar_t* LPWSTR;
+
+// Opaque handles. Only ever compared and passed around.
+typedef struct HWND__* HWND;
+typedef void* HANDLE;
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+#define CALLBACK
+#define MAXWORD 0xffff
+#define MAXUINT ((UINT)~((UINT)0))
+
+// Word and byte manipulation
+
+#define MAKEWORD(a, b) ((WORD)(((BYTE)((a) & 0xff)) | ((WORD)((BYTE)((b) & 0xff))) << 8))
+#define LOWORD(l) ((WORD)(((UINT_PTR)(l)) & 0xffff))
+#define HIWORD(l) ((WORD)((((UINT_PTR)(l)) >> 16) & 0xffff))
+#define LOBYTE(w) ((BYTE)(((UINT_PTR)(w)) & 0xff))
+#define HIBYTE(w) ((BYTE)((((UINT_PTR)(w)) >> 8) & 0xff))
+
+#define __min(a, b) (((a) < (b)) ? (a) : (b))
+#define __max(a, b) (((a) > (b)) ? (a) : (b))
+
+// Hotkeys and virtual keys
+
+#define HOTKEYF_SHIFT 0x01
+#define HOTKEYF_CONTROL 0x02
+#define HOTKEYF_ALT 0x04
+#define HOTKEYF_EXT 0x08
+
+#define VK_BACK 0x08
+#define VK_TAB 0x09
+#define VK_RETURN 0x0D
+#define VK_SHIFT 0x10
+#define VK_CONTROL 0x11
+#define VK_MENU 0x12
+#define VK_ESCAPE 0x1B
+#define VK_SPACE 0x20
+#define VK_PRIOR 0x21
+#define VK_NEXT 0x22
+#define VK_END 0x23
+#define VK_HOME 0x24
+#define VK_LEFT 0x25
+#define VK_UP 0x26
+#define VK_RIGHT 0x27
+#define VK_DOWN 0x28
+#define VK_INSERT 0x2D
+#define VK_DELETE 0x2E
+#define VK_LWIN 0x5B
+#define VK_F1 0x70
+#define VK_F4 0x73
+#define VK_F24 0x87
+
+// Error codes
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+#define ERROR_SUCCESS 0L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_ACCESS_DENIED 5L
+#define ERROR_LOCK_VIOLATION 33L
+#define ERROR_INVALID_NAME 123L
+#define ERROR_FILE_CORRUPT 1392L
+#define ERROR_UNSUPPORTED_TYPE 1630L
+#define WAIT_TIMEOUT 258L
+#define STILL_ACTIVE 259L
+
+#define FACILITY_WIN32 7
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define HRESULT_CODE(hr) ((hr) & 0xFFFF)
+#define HRESULT_FACILITY(hr) (((hr) >> 16) & 0x1fff)
+#define HRESULT_FROM_WIN32(x) ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : \
+	((HRESULT)(((x) & 0x0000FFFF) | (FACILITY_WIN32 << 16) | 0x80000000)))
+
+// There are no system error codes to speak of; errno comes closest.
+inline DWORD GetLastError() { return (DWORD) errno; }
+inline void SetLastError(DWORD errorCode) { errno = (int) errorCode; }
+
+#define _tcslen wcslen
@@ -0,0 +1,755 @@
+// PosixPlatform.cpp : Implements Platform.h for building and testing
+// the core outside of Windows (see CMakeLists.txt).
+// There is no desktop to speak of: no windows are ever found, input goes
+// nowhere, and settings only live as long as the process.
+// Files are watched with inotify on Linux; elsewhere, they can't be.
+// The control endpoint is a Unix domain socket in $XDG_RUNTIME_DIR, or
+// in /tmp with the user ID in its name.
+
+#include "stdafx.h"
+#include "Platform.h"
+#include "MemoryConfigStore.h"
+#include "CommandLineParser.h"
+#include "AutoSaveException.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <climits>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+extern char** environ;
+
+
+namespace {
+	class SteadyClock : public Clock
+	{
+	public:
+		virtual ULONGLONG getTickCount() const
+		{
+			using namespace std::chrono;
+			return duration_cast<milliseconds>(
+				steady_clock::now().time_since_epoch()).count();
+		}
+	};
+
+
+
+	class EmptyWindowEnumerator : public WindowEnumerator
+	{
+	public:
+		virtual void enumWindows(const std::function<bool(HWND)>& callback) const {}
+		virtual wstring getWindowText(HWND hwnd) const { return L""; }
+		virtual vector<HWND> takeUnresponsiveWindows() const { return vector<HWND>(); }
+		virtual DWORD getWindowProcessId(HWND hwnd) const { return 0; }
+		virtual wstring getWindowExecutable(HWND hwnd) const { return L""; }
+		virtual bool isOwnedWindow(HWND hwnd) const { return false; }
+		virtual bool isWindowVisible(HWND hwnd) const { return false; }
+		virtual bool isWindowMinimized(HWND hwnd) const { return false; }
+		virtual HWND getForegroundWindow() const { return 0; }
+		virtual bool isWindowResponding(HWND hwnd, DWORD timeout) const { return true; }
+		virtual ULONGLONG getProcessCpuTime(HWND hwnd) const { return 0; }
+	};
+
+
+
+	// There's no window system to report anything.
+	class NoForegroundWatcher : public ForegroundWatcher
+	{
+	public:
+		virtual bool startWatching(const Handler& handler) { return false; }
+		virtual void stopWatching() {}
+	};
+
+
+
+	class DiscardingInputSink : public InputSink
+	{
+	public:
+		virtual UINT send(const vector<KeyEvent>& events) { return 0; }
+		virtual void wait(DWORD milliseconds) {}
+		virtual bool isAnyKeyPressed() const { return false; }
+		virtual ULONGLONG getLastInputTime() const { return 0; }
+	};
+
+
+
+	// Stores opened under the same name share their values.
+	class SharedConfigStore : public ConfigStore
+	{
+	public:
+		SharedConfigStore(const std::shared_ptr<MemoryConfigStore>& pStore,
+			std::mutex* pLock)
+			: m_pStore(pStore), m_pLock(pLock) {}
+
+		virtual int readInt(const wstring& valueName) const {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			return m_pStore->readInt(valueName);
+		}
+		virtual void writeInt(const wstring& valueName, int valueData) {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			m_pStore->writeInt(valueName, valueData);
+		}
+
+		virtual wstring readString(const wstring& valueName) const {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			return m_pStore->readString(valueName);
+		}
+		virtual void writeString(const wstring& valueName, const wstring& valueData) {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			m_pStore->writeString(valueName, valueData);
+		}
+
+		virtual vector<wstring> readMultiString(const wstring& valueName) const {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			return m_pStore->readMultiString(valueName);
+		}
+		virtual void writeMultiString(const wstring& valueName,
+			const vector<wstring>& strings) {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			m_pStore->writeMultiString(valueName, strings);
+		}
+
+		virtual Expected<int> tryReadInt(const wstring& valueName) const {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			return m_pStore->tryReadInt(valueName);
+		}
+		virtual Expected<wstring> tryReadString(const wstring& valueName) const {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			return m_pStore->tryReadString(valueName);
+		}
+		virtual Expected<vector<wstring>> tryReadMultiString(
+			const wstring& valueName) const {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			return m_pStore->tryReadMultiString(valueName);
+		}
+
+		virtual vector<wstring> getValueNames() const {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			return m_pStore->getValueNames();
+		}
+		virtual void deleteValue(const wstring& valueName) {
+			std::lock_guard<std::mutex> guard(*m_pLock);
+			m_pStore->deleteValue(valueName);
+		}
+
+	private:
+		std::shared_ptr<MemoryConfigStore> m_pStore;
+		std::mutex* m_pLock;
+	};
+
+	std::mutex storesLock;
+	std::unordered_map<wstring, std::shared_ptr<MemoryConfigStore>> stores;
+
+
+
+	class PosixProcessHandle : public ProcessHandle
+	{
+	public:
+		PosixProcessHandle(pid_t pid) : m_pid(pid) {}
+
+		virtual unique_ptr<ProcessHandle> clone() const {
+			return unique_ptr<ProcessHandle>(new PosixProcessHandle(m_pid));
+		}
+
+		virtual DWORD getProcessId() const { return (DWORD) m_pid; }
+
+		virtual bool isAlive() const
+		{
+			// Reap the child if it has exited, or kill(0) would still see it.
+			int status;
+			if (waitpid(m_pid, &status, WNOHANG) == m_pid)
+				return false;
+			return kill(m_pid, 0) == 0;
+		}
+
+		// There is no such thing as "waiting for input".
+		virtual DWORD waitForInputIdle(DWORD timeout) const { return 0; }
+
+	private:
+		pid_t m_pid;
+	};
+
+
+
+	// For the functions that may throw when a name can't be converted.
+	std::string toNarrowOrThrow(const wstring& wide)
+	{
+		std::string narrow = Platform::toNarrow(wide);
+		if (narrow.empty() && !wide.empty())
+			throw AutoSaveException(EILSEQ);
+		return narrow;
+	}
+
+
+
+	// Watches the directories rather than the files, because many
+	// applications save by writing a new file and renaming it.
+	class InotifyFileWatcher : public FileWatcher
+	{
+	public:
+#ifdef __linux__
+		InotifyFileWatcher() : m_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+#else
+		InotifyFileWatcher() : m_fd(-1) {}
+#endif
+		virtual ~InotifyFileWatcher()
+		{
+			if (m_fd >= 0)
+				close(m_fd);
+		}
+
+		virtual bool watch(const wstring& path);
+		virtual void unwatchAll();
+		virtual vector<wstring> takeChanges();
+		virtual FileStamp getStamp(const wstring& path) const;
+
+	private:
+		struct WatchedFile
+		{
+			int wd;
+			std::string name;
+			wstring path;
+		};
+
+		int m_fd;
+		vector<WatchedFile> m_files;
+	};
+
+
+
+	bool InotifyFileWatcher::watch(const wstring& path)
+	{
+#ifdef __linux__
+		if (m_fd < 0)
+			return false;
+		try {
+			std::string narrow = toNarrowOrThrow(path);
+			size_t slash = narrow.rfind('/');
+			std::string directory = (slash == std::string::npos) ? "." :
+				(slash == 0) ? "/" : narrow.substr(0, slash);
+			std::string name = narrow.substr(slash + 1);
+
+			int wd = inotify_add_watch(m_fd, directory.c_str(),
+				IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_MOVED_TO);
+			if (wd < 0)
+				return false;
+			m_files.push_back({ wd, name, path });
+			return true;
+		}
+		catch (AutoSaveException&) {
+			return false;
+		}
+#else
+		return false;
+#endif
+	}
+
+
+
+	void InotifyFileWatcher::unwatchAll()
+	{
+#ifdef __linux__
+		// Files in the same directory share their watch descriptor.
+		for (const WatchedFile& file : m_files)
+			inotify_rm_watch(m_fd, file.wd);
+#endif
+		m_files.clear();
+	}
+
+
+
+	vector<wstring> InotifyFileWatcher::takeChanges()
+	{
+		vector<wstring> changes;
+#ifdef __linux__
+		if (m_fd < 0)
+			return changes;
+
+		alignas(struct inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(m_fd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* p = buffer; p < buffer + length; )
+			{
+				auto pEvent = (const struct inotify_event*) p;
+				p += sizeof(struct inotify_event) + pEvent->len;
+				if (pEvent->len == 0)
+					continue;
+				for (const WatchedFile& file : m_files)
+				{
+					bool isNew = std::find(changes.begin(), changes.end(),
+						file.path) == changes.end();
+					if (file.wd == pEvent->wd && file.name == pEvent->name && isNew)
+						changes.push_back(file.path);
+				}
+			}
+		}
+#endif
+		return changes;
+	}
+
+
+
+	FileStamp InotifyFileWatcher::getStamp(const wstring& path) const
+	{
+		FileStamp stamp = { false, 0, 0 };
+		try {
+			struct stat info;
+			if (stat(toNarrowOrThrow(path).c_str(), &info) == 0 && S_ISREG(info.st_mode))
+			{
+				stamp.exists = true;
+				stamp.size = (ULONGLONG) info.st_size;
+#ifdef __linux__
+				stamp.modificationTime = (ULONGLONG) info.st_mtim.tv_sec *
+					1000000000 + info.st_mtim.tv_nsec;
+#else
+				stamp.modificationTime = (ULONGLONG) info.st_mtime * 1000000000;
+#endif
+			}
+		}
+		catch (AutoSaveException&) {
+		}
+		return stamp;
+	}
+
+
+
+	std::string getRealPath(const std::string& path)
+	{
+		char buffer[PATH_MAX];
+		return realpath(path.c_str(), buffer) ? buffer : "";
+	}
+
+
+
+	const size_t controlRequestLimit = 4096;
+	const int controlReadTimeout = 1000;
+	const int controlAnswerTimeout = 5000;
+
+	sockaddr_un getControlAddress(const wstring& name)
+	{
+		std::string path;
+		const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+		if (runtimeDir && *runtimeDir)
+			path = std::string(runtimeDir) + "/" + toNarrowOrThrow(name) + ".sock";
+		else
+			path = "/tmp/" + toNarrowOrThrow(name) + "-" + std::to_string(getuid()) + ".sock";
+
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path))
+			throw AutoSaveException(ENAMETOOLONG);
+		path.copy(address.sun_path, path.size());
+		return address;
+	}
+
+
+
+	int createSocket()
+	{
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd == -1)
+			throw AutoSaveException(errno);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+		return fd;
+	}
+
+
+
+	// Returns false if the peer went quiet for timeout milliseconds.
+	bool waitForData(int fd, int timeout)
+	{
+		pollfd entry = { fd, POLLIN, 0 };
+		return poll(&entry, 1, timeout) == 1;
+	}
+
+
+
+	bool sendAll(int fd, const std::string& data)
+	{
+		size_t sent = 0;
+		while (sent < data.size())
+		{
+			ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0)
+				return false;
+			sent += (size_t) n;
+		}
+		return true;
+	}
+
+
+
+	class UnixSocketControlServer : public ControlServer
+	{
+	public:
+		// Takes over listenFd, which must be bound and listening.
+		UnixSocketControlServer(int listenFd, const std::string& path,
+			const Handler& handler)
+			: m_listenFd(listenFd), m_path(path), m_handler(handler)
+		{
+			if (pipe(m_stopFds) == -1)
+			{
+				int error = errno;
+				close(m_listenFd);
+				unlink(m_path.c_str());
+				throw AutoSaveException(error);
+			}
+			m_thread = std::thread(&UnixSocketControlServer::serve, this);
+		}
+
+		virtual ~UnixSocketControlServer()
+		{
+			char stop = 0;
+			while (write(m_stopFds[1], &stop, 1) == -1 && errno == EINTR) {}
+			m_thread.join();
+			close(m_stopFds[0]);
+			close(m_stopFds[1]);
+			close(m_listenFd);
+			unlink(m_path.c_str());
+		}
+
+	private:
+		UnixSocketControlServer(const UnixSocketControlServer&);
+		UnixSocketControlServer& operator=(const UnixSocketControlServer&);
+
+		void serve()
+		{
+			for (;;)
+			{
+				pollfd entries[2] = {
+					{ m_listenFd, POLLIN, 0 },
+					{ m_stopFds[0], POLLIN, 0 }
+				};
+				if (poll(entries, 2, -1) == -1)
+				{
+					if (errno == EINTR)
+						continue;
+					return;
+				}
+				if (entries[1].revents != 0)
+					return;
+
+				int clientFd = accept(m_listenFd, NULL, NULL);
+				if (clientFd != -1)
+				{
+					answer(clientFd);
+					close(clientFd);
+				}
+			}
+		}
+
+		// One client at a time is plenty; slow ones are cut off.
+		void answer(int clientFd)
+		{
+			std::string request;
+			char buffer[256];
+			while (request.find('\n') == std::string::npos)
+			{
+				if (request.size() > controlRequestLimit ||
+					!waitForData(clientFd, controlReadTimeout))
+				{
+					return;
+				}
+				ssize_t n = recv(clientFd, buffer, sizeof(buffer), 0);
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					break;
+				request.append(buffer, (size_t) n);
+			}
+			request = request.substr(0, request.find('\n'));
+
+			std::string response;
+			try {
+				response = m_handler(request);
+			} catch (...) {
+				response = "error internal\n";
+			}
+			sendAll(clientFd, response);
+		}
+
+		int m_listenFd;
+		int m_stopFds[2];
+		std::string m_path;
+		Handler m_handler;
+		std::thread m_thread;
+	};
+}
+
+
+
+Clock& Platform::getClock()
+{
+	static SteadyClock clock;
+	return clock;
+}
+
+
+
+WindowEnumerator& Platform::getWindowEnumerator()
+{
+	static EmptyWindowEnumerator enumerator;
+	return enumerator;
+}
+
+
+
+InputSink& Platform::getInputSink()
+{
+	static DiscardingInputSink sink;
+	return sink;
+}
+
+
+
+bool Platform::configStoreExists(const wstring& keyName)
+{
+	std::lock_guard<std::mutex> guard(storesLock);
+	return stores.count(keyName) == 1;
+}
+
+
+
+unique_ptr<ConfigStore> Platform::openConfigStore(const wstring& keyName)
+{
+	if (keyName.empty())
+		throw ConfigStoreException(ERROR_INVALID_NAME);
+
+	std::lock_guard<std::mutex> guard(storesLock);
+	auto& pStore = stores[keyName];
+	if (!pStore)
+		pStore = std::make_shared<MemoryConfigStore>();
+	return unique_ptr<ConfigStore>(new SharedConfigStore(pStore, &storesLock));
+}
+
+
+
+void Platform::purgeConfigStore(const wstring& keyName)
+{
+	std::lock_guard<std::mutex> guard(storesLock);
+	if (stores.erase(keyName) == 0)
+		throw ConfigStoreException(ERROR_FILE_NOT_FOUND);
+}
+
+
+
+unique_ptr<ProcessHandle> Platform::startProcess(
+	const wstring& file, const wstring& argLine)
+{
+	vector<std::string> args = { toNarrowOrThrow(file) };
+	if (!argLine.empty())
+	{
+		// The first argument is parsed differently, so pad it.
+		vector<wstring> wideArgs = CommandLineParser::split(L"x " + argLine);
+		for (auto pArg = wideArgs.begin() + 1; pArg < wideArgs.end(); ++pArg)
+		{
+			args.push_back(toNarrowOrThrow(*pArg));
+		}
+	}
+
+	vector<char*> argv;
+	for (std::string& arg : args)
+	{
+		argv.push_back(&arg[0]);
+	}
+	argv.push_back(NULL);
+
+	pid_t pid;
+	int error = posix_spawnp(&pid, argv[0], NULL, NULL, argv.data(), environ);
+	if (error != 0)
+		throw AutoSaveException(error);
+	return unique_ptr<ProcessHandle>(new PosixProcessHandle(pid));
+}
+
+
+
+bool Platform::wouldStartSelf(const wstring& file)
+{
+	std::string selfPath = getRealPath("/proc/self/exe");
+	return !selfPath.empty() && getRealPath(toNarrowOrThrow(file)) == selfPath;
+}
+
+
+
+bool Platform::fileExists(const wstring& path)
+{
+	struct stat info;
+	const std::string fileName = toNarrow(path);
+	return !fileName.empty() && stat(fileName.c_str(), &info) == 0;
+}
+
+
+
+FILE* Platform::openFile(const wstring& path, const wchar_t* mode)
+{
+	const std::string fileName = toNarrow(path);
+	if (fileName.empty())
+	{
+		errno = path.empty() ? ENOENT : EILSEQ;
+		return NULL;
+	}
+	return fopen(fileName.c_str(), toNarrow(mode).c_str());
+}
+
+
+
+bool Platform::renameFile(const wstring& from, const wstring& to)
+{
+	return rename(toNarrow(from).c_str(), toNarrow(to).c_str()) == 0;
+}
+
+
+
+bool Platform::removeFile(const wstring& path)
+{
+	return unlink(toNarrow(path).c_str()) == 0;
+}
+
+
+
+std::string Platform::toNarrow(const wstring& text)
+{
+	size_t sizeNeeded = wcstombs(NULL, text.c_str(), 0);
+	if (sizeNeeded == (size_t) -1)
+		return std::string();
+	std::string narrow(sizeNeeded, '\0');
+	wcstombs(&narrow[0], text.c_str(), sizeNeeded);
+	return narrow;
+}
+
+
+
+wstring Platform::toWide(const std::string& text)
+{
+	size_t sizeNeeded = mbstowcs(NULL, text.c_str(), 0);
+	if (sizeNeeded == (size_t) -1)
+		return wstring();
+	wstring wide(sizeNeeded, L'\0');
+	mbstowcs(&wide[0], text.c_str(), sizeNeeded);
+	return wide;
+}
+
+
+
+// As the XDG Base Directory Specification has it.
+wstring Platform::getDataDirectory()
+{
+	std::string directory;
+	const char* dataHome = getenv("XDG_DATA_HOME");
+	const char* home = getenv("HOME");
+	if (dataHome != NULL && dataHome[0] == '/')
+		directory = dataHome;
+	else if (home != NULL && home[0] != '\0')
+		directory = std::string(home) + "/.local/share";
+	else
+		return L"";
+	directory.append("/autosave");
+
+	return toWide(directory);
+}
+
+
+
+unique_ptr<FileWatcher> Platform::createFileWatcher()
+{
+	return unique_ptr<FileWatcher>(new InotifyFileWatcher());
+}
+
+
+
+unique_ptr<ForegroundWatcher> Platform::createForegroundWatcher()
+{
+	return unique_ptr<ForegroundWatcher>(new NoForegroundWatcher());
+}
+
+
+
+unique_ptr<ControlServer> Platform::startControlServer(const wstring& name,
+	const ControlServer::Handler& handler)
+{
+	const sockaddr_un address = getControlAddress(name);
+	int fd = createSocket();
+	// Only the user may connect.
+	const mode_t oldMask = umask(0077);
+	int result = bind(fd, (const sockaddr*) &address, sizeof(address));
+	if (result == -1 && errno == EADDRINUSE)
+	{
+		// Either someone serves it, or someone crashed and left it behind.
+		int probeFd = createSocket();
+		bool isServed = connect(probeFd, (const sockaddr*) &address,
+			sizeof(address)) == 0;
+		close(probeFd);
+		if (isServed)
+		{
+			umask(oldMask);
+			close(fd);
+			return NULL;
+		}
+		unlink(address.sun_path);
+		result = bind(fd, (const sockaddr*) &address, sizeof(address));
+	}
+	umask(oldMask);
+	if (result == -1 || listen(fd, 4) == -1)
+	{
+		int error = errno;
+		close(fd);
+		throw AutoSaveException(error);
+	}
+	return unique_ptr<ControlServer>(
+		new UnixSocketControlServer(fd, address.sun_path, handler));
+}
+
+
+
+std::string Platform::sendControlRequest(const wstring& name,
+	const std::string& request)
+{
+	const sockaddr_un address = getControlAddress(name);
+	int fd = createSocket();
+	if (connect(fd, (const sockaddr*) &address, sizeof(address)) == -1 ||
+		!sendAll(fd, request + "\n"))
+	{
+		int error = errno;
+		close(fd);
+		throw AutoSaveException(error);
+	}
+	shutdown(fd, SHUT_WR);
+
+	std::string response;
+	char buffer[1024];
+	for (;;)
+	{
+		if (!waitForData(fd, controlAnswerTimeout))
+		{
+			close(fd);
+			throw AutoSaveException(ETIMEDOUT);
+		}
+		ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+		{
+			int error = errno;
+			close(fd);
+			throw AutoSaveException(error);
+		}
+		if (n == 0)
+			break;
+		response.append(buffer, (size_t) n);
+	}
+	close(fd);
+	return response;
+}
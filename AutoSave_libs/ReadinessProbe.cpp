@@ -0,0 +1,67 @@
+#include "stdafx.h"
+#include "ReadinessProbe.h"
+
+
+void ReadinessProbe::sample(HWND hwnd)
+{
+	m_sampleTime = m_clock.getTickCount();
+	m_sampleProcessId = m_windows.getWindowProcessId(hwnd);
+	m_sampleCpuTime = m_windows.getProcessCpuTime(hwnd);
+}
+
+
+
+ReadinessProbe::Readiness ReadinessProbe::probe(HWND hwnd)
+{
+	const ULONGLONG now = m_clock.getTickCount();
+	const ULONGLONG cpuTime = m_windows.getProcessCpuTime(hwnd);
+	const bool isSameProcess = m_sampleProcessId != 0 &&
+		m_windows.getWindowProcessId(hwnd) == m_sampleProcessId;
+	const ULONGLONG span = now - m_sampleTime;
+
+	bool isBusy = false;
+	if (isSameProcess && span >= minSampleSpan && cpuTime >= m_sampleCpuTime)
+		isBusy = (cpuTime - m_sampleCpuTime) * 100 >= span * busyPercent;
+	// A short span is kept growing until it says something.
+	if (!isSameProcess || span >= minSampleSpan)
+		sample(hwnd);
+
+	if (!m_windows.isWindowResponding(hwnd, responseTimeout))
+		m_readiness = RD_NOT_RESPONDING;
+	else {
+		m_readiness = isBusy ? RD_BUSY : RD_READY;
+	}
+	return m_readiness;
+}
+
+
+
+ReadinessProbe::Decision ReadinessProbe::decide(HWND hwnd)
+{
+	const ULONGLONG now = m_clock.getTickCount();
+	if (m_isDeferring && now < m_nextProbeTime)
+		return DC_WAIT;
+
+	if (probe(hwnd) == RD_READY)
+	{
+		m_isDeferring = false;
+		return DC_SEND;
+	}
+	if (!m_isDeferring)
+	{
+		m_isDeferring = true;
+		m_deferredSince = now;
+		m_probeDelay = minProbeDelay;
+	}
+	else {
+		m_probeDelay = __min(2 * m_probeDelay, maxProbeDelay);
+	}
+
+	if (now - m_deferredSince >= maxDeferral)
+	{
+		m_isDeferring = false;
+		return (m_readiness == RD_BUSY) ? DC_SEND : DC_GIVE_UP;
+	}
+	m_nextProbeTime = now + m_probeDelay;
+	return DC_DEFER;
+}
@@ -0,0 +1,85 @@
+// ReadinessProbe.h : Tells whether the program of a save's target can
+// take input right now. Keys sent to a program that doesn't pump its
+// messages, e.g. in the middle of a long render, wait in its queue and
+// come through at some later moment, maybe into another window. The
+// probe asks the window's thread with a message that does nothing (see
+// WindowEnumerator::isWindowResponding), and compares the processor time
+// of its process with the last sample: a process that kept most of a
+// core busy since then counts as busy.
+// While the target isn't ready, decide() holds the save back and probes
+// again after a delay that doubles each time, up to maxProbeDelay. A
+// target that is still busy after maxDeferral gets its save anyway,
+// since it does take input; one that still doesn't respond doesn't, and
+// the countdown should start over.
+// Never throws exceptions.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+
+class ReadinessProbe
+{
+public:
+	enum Readiness {
+		RD_READY,
+		RD_NOT_RESPONDING,
+		RD_BUSY
+	};
+
+	enum Decision {
+		DC_SEND,
+		DC_DEFER,   // The target was probed and isn't ready.
+		DC_WAIT,    // Deferred, and not yet due for another probe.
+		DC_GIVE_UP  // It hasn't responded for maxDeferral.
+	};
+
+	// In milliseconds.
+	static const DWORD responseTimeout = 100;
+	static const ULONGLONG minProbeDelay = 1000;
+	static const ULONGLONG maxProbeDelay = 8000;
+	static const ULONGLONG maxDeferral = 30000;
+	// Samples closer together than this say too little about the load.
+	static const ULONGLONG minSampleSpan = 500;
+	// Of one core, between two samples.
+	static const UINT busyPercent = 90;
+
+	ReadinessProbe(const Clock& clock, const WindowEnumerator& windows)
+		: m_clock(clock), m_windows(windows), m_sampleTime(0),
+		  m_sampleProcessId(0), m_sampleCpuTime(0), m_isDeferring(false),
+		  m_deferredSince(0), m_probeDelay(0), m_nextProbeTime(0),
+		  m_readiness(RD_READY) {}
+
+	// Remembers the processor time of the window's process, so that the
+	// next probe can tell how busy it has been since.
+	void sample(HWND hwnd);
+	// Asks the window's program, and samples it.
+	Readiness probe(HWND hwnd);
+
+	// Whether a save to hwnd may go out now. Probes only when due.
+	Decision decide(HWND hwnd);
+	// Ends a deferral, e.g. when the countdown starts over.
+	inline void reset() { m_isDeferring = false; }
+	inline bool isDeferring() const { return m_isDeferring; }
+	// Since the first probe that held back the save; zero if none has.
+	inline ULONGLONG getDeferredTime() const {
+		return isDeferring() ? m_clock.getTickCount() - m_deferredSince : 0;
+	}
+	// What the last probe found.
+	inline Readiness getReadiness() const { return m_readiness; }
+
+private:
+	ReadinessProbe(const ReadinessProbe&);
+	ReadinessProbe& operator=(const ReadinessProbe&);
+
+	const Clock& m_clock;
+	const WindowEnumerator& m_windows;
+	ULONGLONG m_sampleTime;
+	DWORD m_sampleProcessId;
+	ULONGLONG m_sampleCpuTime;
+	bool m_isDeferring;
+	ULONGLONG m_deferredSince;
+	ULONGLONG m_probeDelay;
+	ULONGLONG m_nextProbeTime;
+	Readiness m_readiness;
+};
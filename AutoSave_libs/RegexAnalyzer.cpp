@@ -0,0 +1,186 @@
+#include "stdafx.h"
+#include "RegexAnalyzer.h"
+
+
+
+namespace {
+	// The characters a node may start with.
+	struct FirstSet {
+		RegexCharClass chars;
+		bool isAnything;
+		bool isNullable;
+	};
+
+	FirstSet getFirstSet(const RegexNode& node);
+	bool isRepeatedVariably(const RegexNode& node);
+	bool containsRepetition(const RegexNode& node);
+	const RegexNode& skipGroups(const RegexNode& node);
+	bool haveOverlappingAlternatives(const RegexNode& node, bool ignoreCase);
+}
+
+
+
+wstring RegexAnalyzer::findCatastrophicBacktracking(
+	const RegexNode& root, bool ignoreCase)
+{
+	if (isRepeatedVariably(root))
+	{
+		const RegexNode& body = *root.children[0];
+		if (containsRepetition(body))
+		{
+			return L"The pattern contains nested quantifiers, "
+				L"e.g. (a+)+, which may take forever to match.";
+		}
+		const RegexNode& inner = skipGroups(body);
+		if (inner.kind == RegexNode::ALTERNATE &&
+			haveOverlappingAlternatives(inner, ignoreCase))
+		{
+			return L"The pattern repeats alternatives that match "
+				L"the same text, e.g. (a|ab)*, which may take forever to match.";
+		}
+	}
+
+	for (const auto& child : root.children)
+	{
+		wstring problem = findCatastrophicBacktracking(*child, ignoreCase);
+		if (!problem.empty())
+			return problem;
+	}
+	return L"";
+}
+
+
+
+wstring RegexAnalyzer::findCatastrophicBacktracking(
+	const wstring& pattern, bool ignoreCase)
+{
+	unique_ptr<RegexNode> root = RegexParser::parse(pattern);
+	return root ? findCatastrophicBacktracking(*root, ignoreCase) : L"";
+}
+
+
+
+namespace {
+	FirstSet getFirstSet(const RegexNode& node)
+	{
+		FirstSet result = { RegexCharClass(), false, false };
+		switch (node.kind)
+		{
+		case RegexNode::CHAR:
+			result.chars.addChar(node.ch);
+			break;
+
+		case RegexNode::CLASS:
+			// Negated classes can't be merged, so they count as anything.
+			if (node.charClass.isNegated())
+				result.isAnything = true;
+			else
+				result.chars = node.charClass;
+			break;
+
+		case RegexNode::ANY:
+		case RegexNode::BACKREFERENCE:
+			result.isAnything = true;
+			result.isNullable = node.kind == RegexNode::BACKREFERENCE;
+			break;
+
+		case RegexNode::CONCAT:
+			result.isNullable = true;
+			for (const auto& child : node.children)
+			{
+				FirstSet childSet = getFirstSet(*child);
+				result.chars.addClass(childSet.chars);
+				result.isAnything |= childSet.isAnything;
+				if (!childSet.isNullable)
+				{
+					result.isNullable = false;
+					break;
+				}
+			}
+			break;
+
+		case RegexNode::ALTERNATE:
+			for (const auto& child : node.children)
+			{
+				FirstSet childSet = getFirstSet(*child);
+				result.chars.addClass(childSet.chars);
+				result.isAnything |= childSet.isAnything;
+				result.isNullable |= childSet.isNullable;
+			}
+			break;
+
+		case RegexNode::GROUP:
+		case RegexNode::REPEAT:
+			result = getFirstSet(*node.children[0]);
+			result.isNullable |= node.kind == RegexNode::REPEAT && node.min == 0;
+			break;
+
+		default:
+			// Empty nodes and assertions don't consume anything.
+			result.isNullable = true;
+			break;
+		}
+		return result;
+	}
+
+
+
+	// Fixed counts like (ab){3} give a backtracking engine nothing
+	// to choose, neither do optional parts like (ab)?. A fixed count of
+	// something that varies does, e.g. (.*a){12} tries every way of
+	// cutting the text into twelve.
+	bool isRepeatedVariably(const RegexNode& node)
+	{
+		if (node.kind != RegexNode::REPEAT)
+			return false;
+		return node.max == RegexNode::UNBOUNDED || (node.max > 1 &&
+			(node.max > node.min || containsRepetition(*node.children[0])));
+	}
+
+
+
+	bool containsRepetition(const RegexNode& node)
+	{
+		if (isRepeatedVariably(node))
+			return true;
+		for (const auto& child : node.children)
+		{
+			// Lookaheads are matched independently of the outer loop.
+			if (child->kind != RegexNode::LOOKAHEAD && containsRepetition(*child))
+				return true;
+		}
+		return false;
+	}
+
+
+
+	const RegexNode& skipGroups(const RegexNode& node)
+	{
+		const RegexNode* pNode = &node;
+		while (pNode->kind == RegexNode::GROUP)
+			pNode = pNode->children[0].get();
+		return *pNode;
+	}
+
+
+
+	bool haveOverlappingAlternatives(const RegexNode& node, bool ignoreCase)
+	{
+		vector<FirstSet> sets;
+		for (const auto& child : node.children)
+		{
+			sets.push_back(getFirstSet(*child));
+		}
+
+		for (size_t i = 0; i < sets.size(); ++i)
+		{
+			for (size_t j = i + 1; j < sets.size(); ++j)
+			{
+				if (sets[i].isAnything || sets[j].isAnything ||
+					sets[i].chars.mayOverlap(sets[j].chars, ignoreCase))
+					return true;
+			}
+		}
+		return false;
+	}
+}
@@ -0,0 +1,22 @@
+// RegexAnalyzer.h : Looks for constructs that make backtracking regex
+// engines like std::regex take exponential time, such as nested
+// quantifiers, e.g. (a+)+, and repeated alternatives that can match
+// the same text, e.g. (a|ab)*.
+// The analysis is conservative: it may flag harmless patterns, but
+// shouldn't miss the classic catastrophic ones.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "RegexParser.h"
+
+using std::wstring;
+
+namespace RegexAnalyzer
+{
+	// Returns a description of the problem, or an empty string
+	// if the pattern seems safe.
+	wstring findCatastrophicBacktracking(const RegexNode& root, bool ignoreCase);
+	wstring findCatastrophicBacktracking(const wstring& pattern, bool ignoreCase);
+}
@@ -0,0 +1,598 @@
+#include "stdafx.h"
+#include "RegexParser.h"
+
+
+
+void RegexCharClass::addClass(const RegexCharClass& other)
+{
+	m_builtins |= other.m_builtins;
+	m_negatedBuiltins |= other.m_negatedBuiltins;
+	m_ranges.insert(m_ranges.end(), other.m_ranges.begin(), other.m_ranges.end());
+}
+
+
+
+bool RegexCharClass::matches(wchar_t c, bool ignoreCase) const
+{
+	bool result = matchesIgnoringNegation(c);
+	if (!result && ignoreCase)
+	{
+		result = matchesIgnoringNegation((wchar_t) towlower(c)) ||
+			matchesIgnoringNegation((wchar_t) towupper(c));
+	}
+	return result != m_isNegated;
+}
+
+
+
+bool RegexCharClass::mayOverlap(const RegexCharClass& other, bool ignoreCase) const
+{
+	// Anything fancier than a few plain characters is assumed to overlap.
+	const size_t maxTestedChars = 256;
+	const RegexCharClass* classes[] = { this, &other };
+	for (const RegexCharClass* pClass : classes)
+	{
+		if (pClass->m_isNegated || pClass->m_builtins != 0 ||
+			pClass->m_negatedBuiltins != 0)
+			return true;
+	}
+
+	size_t testedChars = 0;
+	for (const auto& range : m_ranges)
+	{
+		testedChars += range.second - range.first + 1;
+		if (testedChars > maxTestedChars)
+			return true;
+		for (wchar_t c = range.first; c <= range.second && c >= range.first; ++c)
+		{
+			if (other.matches(c, ignoreCase))
+				return true;
+		}
+	}
+	return false;
+}
+
+
+
+bool RegexCharClass::isLineTerminator(wchar_t c)
+{
+	return c == L'\n' || c == L'\r' || c == 0x2028 || c == 0x2029;
+}
+
+
+
+bool RegexCharClass::isWordChar(wchar_t c)
+{
+	return (c >= L'a' && c <= L'z') || (c >= L'A' && c <= L'Z') ||
+		(c >= L'0' && c <= L'9') || c == L'_';
+}
+
+
+
+bool RegexCharClass::matchesIgnoringNegation(wchar_t c) const
+{
+	if (m_builtins != 0 && matchesBuiltins(c, m_builtins))
+		return true;
+	if (m_negatedBuiltins != 0)
+	{
+		// [\D\W] matches everything that isn't both a digit and a word char.
+		for (unsigned b = 1; b <= BUILTIN_BLANK; b <<= 1)
+		{
+			if ((m_negatedBuiltins & b) && !matchesBuiltins(c, b))
+				return true;
+		}
+	}
+	for (const auto& range : m_ranges)
+	{
+		if (c >= range.first && c <= range.second)
+			return true;
+	}
+	return false;
+}
+
+
+
+bool RegexCharClass::matchesBuiltins(wchar_t c, unsigned builtins)
+{
+	return ((builtins & BUILTIN_DIGIT) && c >= L'0' && c <= L'9') ||
+		((builtins & BUILTIN_WORD) && isWordChar(c)) ||
+		((builtins & BUILTIN_SPACE) && (iswspace(c) || c == 0xFEFF || c == 0xA0)) ||
+		((builtins & BUILTIN_ALPHA) && iswalpha(c)) ||
+		((builtins & BUILTIN_UPPER) && iswupper(c)) ||
+		((builtins & BUILTIN_LOWER) && iswlower(c)) ||
+		((builtins & BUILTIN_PUNCT) && iswpunct(c)) ||
+		((builtins & BUILTIN_XDIGIT) && iswxdigit(c)) ||
+		((builtins & BUILTIN_CNTRL) && iswcntrl(c)) ||
+		((builtins & BUILTIN_PRINT) && iswprint(c)) ||
+		((builtins & BUILTIN_GRAPH) && iswgraph(c)) ||
+		((builtins & BUILTIN_BLANK) && (c == L' ' || c == L'\t'));
+}
+
+
+
+unique_ptr<RegexNode> RegexParser::parse(const wstring& pattern)
+{
+	RegexParser parser(pattern);
+	unique_ptr<RegexNode> root = parser.parseDisjunction();
+	// A stray closing parenthesis ends the disjunction early.
+	if (!parser.atEnd())
+		return nullptr;
+	return root;
+}
+
+
+
+unique_ptr<RegexNode> RegexParser::parseDisjunction()
+{
+	if (++m_depth > maxDepth)
+		return nullptr;
+
+	unique_ptr<RegexNode> first = parseAlternative();
+	if (!first)
+		return nullptr;
+
+	unique_ptr<RegexNode> result;
+	if (peek() != L'|')
+	{
+		result = std::move(first);
+	}
+	else {
+		result.reset(new RegexNode(RegexNode::ALTERNATE));
+		result->children.push_back(std::move(first));
+		while (peek() == L'|')
+		{
+			++m_pos;
+			unique_ptr<RegexNode> next = parseAlternative();
+			if (!next)
+				return nullptr;
+			result->children.push_back(std::move(next));
+		}
+	}
+	--m_depth;
+	return result;
+}
+
+
+
+unique_ptr<RegexNode> RegexParser::parseAlternative()
+{
+	unique_ptr<RegexNode> result(new RegexNode(RegexNode::CONCAT));
+	while (!atEnd() && peek() != L'|' && peek() != L')')
+	{
+		unique_ptr<RegexNode> term = parseTerm();
+		if (!term)
+			return nullptr;
+		result->children.push_back(std::move(term));
+	}
+
+	if (result->children.empty())
+		return unique_ptr<RegexNode>(new RegexNode(RegexNode::EMPTY));
+	else if (result->children.size() == 1)
+		return std::move(result->children[0]);
+	else
+		return result;
+}
+
+
+
+unique_ptr<RegexNode> RegexParser::parseTerm()
+{
+	// Assertions can't be quantified.
+	unique_ptr<RegexNode> assertion;
+	if (peek() == L'^')
+	{
+		assertion.reset(new RegexNode(RegexNode::LINE_BEGIN));
+		m_pos += 1;
+	}
+	else if (peek() == L'$')
+	{
+		assertion.reset(new RegexNode(RegexNode::LINE_END));
+		m_pos += 1;
+	}
+	else if (lookingAt(L"\\b"))
+	{
+		assertion.reset(new RegexNode(RegexNode::WORD_BOUNDARY));
+		m_pos += 2;
+	}
+	else if (lookingAt(L"\\B"))
+	{
+		assertion.reset(new RegexNode(RegexNode::NOT_WORD_BOUNDARY));
+		m_pos += 2;
+	}
+	else if (lookingAt(L"(?=") || lookingAt(L"(?!"))
+	{
+		assertion.reset(new RegexNode(RegexNode::LOOKAHEAD));
+		assertion->isNegated = m_pattern[m_pos + 2] == L'!';
+		m_pos += 3;
+		unique_ptr<RegexNode> body = parseDisjunction();
+		if (!body || peek() != L')')
+			return nullptr;
+		++m_pos;
+		assertion->children.push_back(std::move(body));
+	}
+
+	if (assertion)
+	{
+		int min, max;
+		size_t oldPos = m_pos;
+		if (parseQuantifier(&min, &max))
+			return nullptr;
+		m_pos = oldPos;
+		return assertion;
+	}
+
+	unique_ptr<RegexNode> atom = parseAtom();
+	if (!atom)
+		return nullptr;
+
+	int min, max;
+	if (!parseQuantifier(&min, &max))
+		return atom;
+	if (max != RegexNode::UNBOUNDED && max < min)
+		return nullptr;
+
+	unique_ptr<RegexNode> repeat(new RegexNode(RegexNode::REPEAT));
+	repeat->min = min;
+	repeat->max = max;
+	repeat->children.push_back(std::move(atom));
+	return repeat;
+}
+
+
+
+unique_ptr<RegexNode> RegexParser::parseAtom()
+{
+	const wchar_t c = peek();
+	unique_ptr<RegexNode> result;
+
+	if (c == L'.')
+	{
+		++m_pos;
+		result.reset(new RegexNode(RegexNode::ANY));
+	}
+	else if (c == L'(')
+	{
+		m_pos += lookingAt(L"(?:") ? 3 : 1;
+		unique_ptr<RegexNode> body = parseDisjunction();
+		if (!body || peek() != L')')
+			return nullptr;
+		++m_pos;
+		result.reset(new RegexNode(RegexNode::GROUP));
+		result->children.push_back(std::move(body));
+	}
+	else if (c == L'[')
+	{
+		++m_pos;
+		result = parseCharClass();
+	}
+	else if (c == L'\\')
+	{
+		++m_pos;
+		result = parseAtomEscape();
+	}
+	else if (c == L'*' || c == L'+' || c == L'?' || c == L'{')
+	{
+		// Nothing to repeat.
+		return nullptr;
+	}
+	else {
+		++m_pos;
+		result.reset(new RegexNode(RegexNode::CHAR));
+		result->ch = c;
+	}
+	return result;
+}
+
+
+
+unique_ptr<RegexNode> RegexParser::parseAtomEscape()
+{
+	if (atEnd())
+		return nullptr;
+
+	const wchar_t c = peek();
+	unique_ptr<RegexNode> result;
+	RegexCharClass builtin;
+
+	if (builtinClassForEscape(c, &builtin))
+	{
+		++m_pos;
+		result.reset(new RegexNode(RegexNode::CLASS));
+		result->charClass = builtin;
+	}
+	else if (c >= L'1' && c <= L'9')
+	{
+		result.reset(new RegexNode(RegexNode::BACKREFERENCE));
+		if (!parseDecimal(&result->min))
+			return nullptr;
+	}
+	else {
+		result.reset(new RegexNode(RegexNode::CHAR));
+		if (!parseCharEscape(&result->ch))
+			return nullptr;
+	}
+	return result;
+}
+
+
+
+unique_ptr<RegexNode> RegexParser::parseCharClass()
+{
+	unique_ptr<RegexNode> result(new RegexNode(RegexNode::CLASS));
+	RegexCharClass& charClass = result->charClass;
+	bool isNegated = false;
+	if (peek() == L'^')
+	{
+		isNegated = true;
+		++m_pos;
+	}
+
+	while (peek() != L']')
+	{
+		if (atEnd())
+			return nullptr;
+
+		if (lookingAt(L"[:"))
+		{
+			if (!parsePosixClass(&charClass))
+				return nullptr;
+			continue;
+		}
+		else if (lookingAt(L"[=") || lookingAt(L"[."))
+		{
+			// Equivalence classes and collating symbols aren't supported.
+			return nullptr;
+		}
+
+		wchar_t first, last;
+		bool isFirstChar, isLastChar;
+		if (!parseClassAtom(&charClass, &first, &isFirstChar))
+			return nullptr;
+
+		const bool isRange = isFirstChar && peek() == L'-' &&
+			m_pos + 1 < m_pattern.size() && m_pattern[m_pos + 1] != L']';
+		if (!isRange)
+		{
+			if (isFirstChar)
+				charClass.addChar(first);
+			continue;
+		}
+
+		++m_pos;
+		if (!parseClassAtom(&charClass, &last, &isLastChar) ||
+			!isLastChar || last < first)
+			return nullptr;
+		charClass.addRange(first, last);
+	}
+	++m_pos;
+
+	if (isNegated)
+		charClass.negate();
+	return result;
+}
+
+
+
+bool RegexParser::parseClassAtom(RegexCharClass* pClass, wchar_t* pChar,
+	bool* pIsChar)
+{
+	if (atEnd())
+		return false;
+
+	*pIsChar = true;
+	const wchar_t c = m_pattern[m_pos++];
+	if (c != L'\\')
+	{
+		*pChar = c;
+		return true;
+	}
+	if (atEnd())
+		return false;
+
+	RegexCharClass builtin;
+	if (builtinClassForEscape(peek(), &builtin))
+	{
+		++m_pos;
+		pClass->addClass(builtin);
+		*pIsChar = false;
+		return true;
+	}
+	else if (peek() == L'b')
+	{
+		// Inside a class, \b is a backspace.
+		++m_pos;
+		*pChar = L'\b';
+		return true;
+	}
+	else {
+		return parseCharEscape(pChar);
+	}
+}
+
+
+
+bool RegexParser::parsePosixClass(RegexCharClass* pClass)
+{
+	static const struct { const wchar_t* name; unsigned builtins; } names[] = {
+		{ L"alnum", RegexCharClass::BUILTIN_ALPHA | RegexCharClass::BUILTIN_DIGIT },
+		{ L"alpha", RegexCharClass::BUILTIN_ALPHA },
+		{ L"blank", RegexCharClass::BUILTIN_BLANK },
+		{ L"cntrl", RegexCharClass::BUILTIN_CNTRL },
+		{ L"digit", RegexCharClass::BUILTIN_DIGIT },
+		{ L"d", RegexCharClass::BUILTIN_DIGIT },
+		{ L"graph", RegexCharClass::BUILTIN_GRAPH },
+		{ L"lower", RegexCharClass::BUILTIN_LOWER },
+		{ L"print", RegexCharClass::BUILTIN_PRINT },
+		{ L"punct", RegexCharClass::BUILTIN_PUNCT },
+		{ L"space", RegexCharClass::BUILTIN_SPACE },
+		{ L"s", RegexCharClass::BUILTIN_SPACE },
+		{ L"upper", RegexCharClass::BUILTIN_UPPER },
+		{ L"w", RegexCharClass::BUILTIN_WORD },
+		{ L"xdigit", RegexCharClass::BUILTIN_XDIGIT },
+	};
+
+	const size_t nameStart = m_pos + 2;
+	const size_t nameEnd = m_pattern.find(L":]", nameStart);
+	if (nameEnd == wstring::npos)
+		return false;
+
+	const wstring name = m_pattern.substr(nameStart, nameEnd - nameStart);
+	for (const auto& entry : names)
+	{
+		if (name == entry.name)
+		{
+			for (unsigned b = 1; b <= RegexCharClass::BUILTIN_BLANK; b <<= 1)
+			{
+				if (entry.builtins & b)
+					pClass->addBuiltin((RegexCharClass::Builtin) b, false);
+			}
+			m_pos = nameEnd + 2;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+bool RegexParser::parseQuantifier(int* pMin, int* pMax)
+{
+	const size_t oldPos = m_pos;
+	const wchar_t c = peek();
+	if (c == L'*')
+	{
+		*pMin = 0;
+		*pMax = RegexNode::UNBOUNDED;
+		++m_pos;
+	}
+	else if (c == L'+')
+	{
+		*pMin = 1;
+		*pMax = RegexNode::UNBOUNDED;
+		++m_pos;
+	}
+	else if (c == L'?')
+	{
+		*pMin = 0;
+		*pMax = 1;
+		++m_pos;
+	}
+	else if (c == L'{')
+	{
+		++m_pos;
+		if (!parseDecimal(pMin))
+		{
+			m_pos = oldPos;
+			return false;
+		}
+		*pMax = *pMin;
+		if (peek() == L',')
+		{
+			++m_pos;
+			if (peek() == L'}')
+				*pMax = RegexNode::UNBOUNDED;
+			else if (!parseDecimal(pMax))
+			{
+				m_pos = oldPos;
+				return false;
+			}
+		}
+		if (peek() != L'}')
+		{
+			m_pos = oldPos;
+			return false;
+		}
+		++m_pos;
+	}
+	else {
+		return false;
+	}
+
+	// Laziness doesn't matter, as we only ask whether there is a match.
+	if (peek() == L'?')
+		++m_pos;
+	return true;
+}
+
+
+
+bool RegexParser::parseCharEscape(wchar_t* pChar)
+{
+	if (atEnd())
+		return false;
+
+	const wchar_t c = m_pattern[m_pos++];
+	switch (c)
+	{
+	case L't': *pChar = L'\t'; return true;
+	case L'n': *pChar = L'\n'; return true;
+	case L'v': *pChar = L'\v'; return true;
+	case L'f': *pChar = L'\f'; return true;
+	case L'r': *pChar = L'\r'; return true;
+	case L'0': *pChar = L'\0'; return true;
+	case L'x': return parseHex(2, pChar);
+	case L'u': return parseHex(4, pChar);
+	case L'c':
+		if (atEnd() || !iswalpha(peek()))
+			return false;
+		*pChar = m_pattern[m_pos++] % 32;
+		return true;
+	default:
+		// Identity escapes are only allowed for non-word characters.
+		if (RegexCharClass::isWordChar(c))
+			return false;
+		*pChar = c;
+		return true;
+	}
+}
+
+
+
+bool RegexParser::parseDecimal(int* pValue)
+{
+	// Large enough for any sensible repetition count.
+	const int maxValue = 100000;
+	if (!iswdigit(peek()))
+		return false;
+
+	int value = 0;
+	while (iswdigit(peek()))
+	{
+		value = __min(value * 10 + (peek() - L'0'), maxValue);
+		++m_pos;
+	}
+	*pValue = value;
+	return true;
+}
+
+
+
+bool RegexParser::parseHex(int digits, wchar_t* pChar)
+{
+	int value = 0;
+	for (int i = 0; i < digits; ++i)
+	{
+		if (!iswxdigit(peek()))
+			return false;
+		const wchar_t c = (wchar_t) towlower(m_pattern[m_pos++]);
+		value = value * 16 + ((c <= L'9') ? c - L'0' : c - L'a' + 10);
+	}
+	*pChar = (wchar_t) value;
+	return true;
+}
+
+
+
+bool RegexParser::builtinClassForEscape(wchar_t escape, RegexCharClass* pClass)
+{
+	switch (escape)
+	{
+	case L'd': pClass->addBuiltin(RegexCharClass::BUILTIN_DIGIT, false); return true;
+	case L'D': pClass->addBuiltin(RegexCharClass::BUILTIN_DIGIT, true); return true;
+	case L'w': pClass->addBuiltin(RegexCharClass::BUILTIN_WORD, false); return true;
+	case L'W': pClass->addBuiltin(RegexCharClass::BUILTIN_WORD, true); return true;
+	case L's': pClass->addBuiltin(RegexCharClass::BUILTIN_SPACE, false); return true;
+	case L'S': pClass->addBuiltin(RegexCharClass::BUILTIN_SPACE, true); return true;
+	default: return false;
+	}
+}
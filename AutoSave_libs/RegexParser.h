@@ -0,0 +1,140 @@
+// RegexParser.h : Parses the ECMAScript regex syntax accepted by Matcher
+// into a syntax tree. The tree is shared by BoundedRegex, which compiles
+// it into a program, and RegexAnalyzer, which looks for patterns that
+// would make a backtracking engine run for ages.
+// Doesn't throw exceptions (except std::bad_alloc); parse returns NULL
+// on syntax it doesn't understand.
+
+#pragma once
+
+#include "stdafx.h"
+
+using std::wstring;
+using std::vector;
+using std::unique_ptr;
+
+// A set of characters, as written in [...] or as \d, \w, \s, and '.'.
+class RegexCharClass
+{
+public:
+	enum Builtin {
+		BUILTIN_NONE = 0,
+		BUILTIN_DIGIT = 0x001,
+		BUILTIN_WORD = 0x002,
+		BUILTIN_SPACE = 0x004,
+		BUILTIN_ALPHA = 0x008,
+		BUILTIN_UPPER = 0x010,
+		BUILTIN_LOWER = 0x020,
+		BUILTIN_PUNCT = 0x040,
+		BUILTIN_XDIGIT = 0x080,
+		BUILTIN_CNTRL = 0x100,
+		BUILTIN_PRINT = 0x200,
+		BUILTIN_GRAPH = 0x400,
+		BUILTIN_BLANK = 0x800
+	};
+
+	RegexCharClass() : m_isNegated(false), m_builtins(0), m_negatedBuiltins(0) {}
+
+	inline void negate() { m_isNegated = !m_isNegated; }
+	inline bool isNegated() const { return m_isNegated; }
+	inline void addChar(wchar_t c) { addRange(c, c); }
+	inline void addRange(wchar_t first, wchar_t last) {
+		m_ranges.push_back({ first, last });
+	}
+	inline void addBuiltin(Builtin b, bool isNegated) {
+		(isNegated ? m_negatedBuiltins : m_builtins) |= b;
+	}
+	void addClass(const RegexCharClass& other); // other must not be negated.
+
+	bool matches(wchar_t c, bool ignoreCase) const;
+
+	// False only if no character matches both classes. Errs on the
+	// side of true; used by RegexAnalyzer to estimate overlaps.
+	bool mayOverlap(const RegexCharClass& other, bool ignoreCase) const;
+
+	static bool isLineTerminator(wchar_t c);
+	static bool isWordChar(wchar_t c);
+
+private:
+	bool matchesIgnoringNegation(wchar_t c) const;
+	static bool matchesBuiltins(wchar_t c, unsigned builtins);
+
+	bool m_isNegated;
+	unsigned m_builtins;
+	unsigned m_negatedBuiltins;
+	vector<std::pair<wchar_t, wchar_t>> m_ranges;
+};
+
+
+
+struct RegexNode
+{
+	enum Kind {
+		EMPTY,
+		CHAR,         // Matches ch.
+		ANY,          // Matches anything but line terminators.
+		CLASS,        // Matches charClass.
+		CONCAT,       // Matches children in order.
+		ALTERNATE,    // Matches any one of children.
+		REPEAT,       // Matches children[0] between min and max times.
+		GROUP,        // Matches children[0]; exists to keep track of parens.
+		LINE_BEGIN,
+		LINE_END,
+		WORD_BOUNDARY,
+		NOT_WORD_BOUNDARY,
+		BACKREFERENCE, // Not supported by BoundedRegex.
+		LOOKAHEAD      // Not supported by BoundedRegex.
+	};
+	enum { UNBOUNDED = -1 };
+
+	explicit RegexNode(Kind k) : kind(k), ch(0), min(0), max(0), isNegated(false) {}
+
+	Kind kind;
+	wchar_t ch;
+	int min;
+	int max;
+	bool isNegated; // Only for LOOKAHEAD.
+	RegexCharClass charClass;
+	vector<unique_ptr<RegexNode>> children;
+};
+
+
+
+class RegexParser
+{
+public:
+	// Returns NULL if the pattern can't be parsed.
+	static unique_ptr<RegexNode> parse(const wstring& pattern);
+
+	// Patterns nesting deeper than this are rejected to keep
+	// the recursive descent's stack usage in check.
+	static const int maxDepth = 200;
+
+private:
+	RegexParser(const wstring& pattern) : m_pattern(pattern), m_pos(0), m_depth(0) {}
+
+	unique_ptr<RegexNode> parseDisjunction();
+	unique_ptr<RegexNode> parseAlternative();
+	unique_ptr<RegexNode> parseTerm();
+	unique_ptr<RegexNode> parseAtom();
+	unique_ptr<RegexNode> parseAtomEscape();
+	unique_ptr<RegexNode> parseCharClass();
+	bool parseClassAtom(RegexCharClass* pClass, wchar_t* pChar, bool* pIsChar);
+	bool parsePosixClass(RegexCharClass* pClass);
+	bool parseQuantifier(int* pMin, int* pMax);
+	bool parseCharEscape(wchar_t* pChar);
+	bool parseDecimal(int* pValue);
+	bool parseHex(int digits, wchar_t* pChar);
+
+	static bool builtinClassForEscape(wchar_t escape, RegexCharClass* pClass);
+
+	inline bool atEnd() const { return m_pos >= m_pattern.size(); }
+	inline wchar_t peek() const { return atEnd() ? 0 : m_pattern[m_pos]; }
+	inline bool lookingAt(const wchar_t* s) const {
+		return m_pattern.compare(m_pos, wcslen(s), s) == 0;
+	}
+
+	const wstring& m_pattern;
+	size_t m_pos;
+	int m_depth;
+};
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "RegistryAccess.h"
+#include "StringListUtils.h"
 
 
 bool RegistryAccess::keyExists(const wstring& keyName)
@@ -94,7 +95,7 @@ void RegistryAccess::writeString(LPCTSTR valueName, const wstring& valueData)
 vector<wstring> RegistryAccess::readMultiString(LPCTSTR valueName) const
 {
 	LPBYTE buffer = read(m_targetKey, L"", valueName, RRF_RT_REG_MULTI_SZ);
-	vector<wstring> results = multiStringToVector((LPCTSTR) buffer);
+	vector<wstring> results = StringListUtils::multiStringToVector((LPCTSTR) buffer);
 	HeapFree(GetProcessHeap(), 0, buffer);
 	return results;
 }
@@ -104,7 +105,7 @@ vector<wstring> RegistryAccess::readMultiString(LPCTSTR valueName) const
 void RegistryAccess::writeMultiString(
 	LPCTSTR valueName, const vector<wstring>& strings)
 {
-	wstring string = vectorToMultiString(strings);
+	wstring string = StringListUtils::vectorToMultiString(strings);
 	DWORD byteCount = (int) string.length() * sizeof(wchar_t);
 	throwOnFailure<RegistryException>(
 		RegSetValueEx(m_targetKey, valueName, 0, REG_MULTI_SZ,
@@ -113,16 +114,93 @@ void RegistryAccess::writeMultiString(
 
 
 
+Expected<int> RegistryAccess::tryReadInt(LPCTSTR valueName) const
+{
+	LPBYTE buffer;
+	ErrorCode error = tryRead(m_targetKey, L"", valueName, RRF_RT_REG_DWORD, &buffer);
+	if (error.isError())
+		return error;
+	int result = *(int*) buffer;
+	HeapFree(GetProcessHeap(), 0, buffer);
+	return result;
+}
+
+
+
+Expected<wstring> RegistryAccess::tryReadString(LPCTSTR valueName) const
+{
+	LPBYTE buffer;
+	ErrorCode error = tryRead(m_targetKey, L"", valueName, RRF_RT_REG_SZ, &buffer);
+	if (error.isError())
+		return error;
+	wstring result = (LPCTSTR) buffer;
+	HeapFree(GetProcessHeap(), 0, buffer);
+	return std::move(result);
+}
+
+
+
+Expected<vector<wstring>> RegistryAccess::tryReadMultiString(LPCTSTR valueName) const
+{
+	LPBYTE buffer;
+	ErrorCode error = tryRead(m_targetKey, L"", valueName, RRF_RT_REG_MULTI_SZ, &buffer);
+	if (error.isError())
+		return error;
+	vector<wstring> results = StringListUtils::multiStringToVector((LPCTSTR) buffer);
+	HeapFree(GetProcessHeap(), 0, buffer);
+	return std::move(results);
+}
+
+
+
+vector<wstring> RegistryAccess::readValueNames() const
+{
+	DWORD valueCount = 0;
+	DWORD maxNameLength = 0;
+	LONG result = RegQueryInfoKey(m_targetKey, NULL, NULL, NULL, NULL, NULL,
+		NULL, &valueCount, &maxNameLength, NULL, NULL, NULL);
+	if (result != ERROR_SUCCESS)
+		throw RegistryException(result);
+
+	vector<wstring> names;
+	names.reserve(valueCount);
+	vector<wchar_t> buffer(maxNameLength + 1);
+	for (DWORD index = 0; index < valueCount; ++index)
+	{
+		DWORD length = (DWORD) buffer.size();
+		result = RegEnumValue(m_targetKey, index, buffer.data(), &length,
+			NULL, NULL, NULL, NULL);
+		if (result == ERROR_NO_MORE_ITEMS)
+			break; // Someone else deleted one.
+		if (result != ERROR_SUCCESS)
+			throw RegistryException(result);
+		names.push_back(wstring(buffer.data(), length));
+	}
+	return names;
+}
+
+
+
+void RegistryAccess::deleteValue(LPCTSTR valueName)
+{
+	LONG result = RegDeleteValue(m_targetKey, valueName);
+	if (result != ERROR_SUCCESS && result != ERROR_FILE_NOT_FOUND)
+		throw RegistryException(result);
+}
+
+
+
 void RegistryAccess::AppendToMultiString(LPCTSTR valueName, const wstring& value)
 {
 	vector<wstring> strings;
-	try {
-		strings = readMultiString(valueName);
+	Expected<vector<wstring>> oldStrings = tryReadMultiString(valueName);
+	if (oldStrings)
+	{
+		strings.swap(oldStrings.value());
 	}
-	catch (RegistryException& exc) {
+	else if (oldStrings.error().errorCode() != ERROR_FILE_NOT_FOUND) {
 		// If the value doesn't exist, we silently create it.
-		if (exc.errorCode() != ERROR_FILE_NOT_FOUND)
-			throw;
+		oldStrings.error().throwIfError<RegistryException>();
 	}
 	strings.push_back(value);
 	writeMultiString(valueName, strings);
@@ -132,17 +210,14 @@ void RegistryAccess::AppendToMultiString(LPCTSTR valueName, const wstring& value
 
 wstring RegistryAccess::readKeyDefaultString(HKEY hBaseKey, LPCTSTR keyPath)
 {
-	try {
-		LPBYTE buffer = read(hBaseKey, keyPath, L"", RRF_RT_REG_SZ);
-		wstring result = (LPCTSTR) buffer;
-		HeapFree(GetProcessHeap(), 0, buffer);
-		return result;
-	}
-	catch (RegistryException& exc) {
-		if (exc.errorCode() != ERROR_FILE_NOT_FOUND)
-			throw;
+	LPBYTE buffer;
+	ErrorCode error = tryRead(hBaseKey, keyPath, L"", RRF_RT_REG_SZ, &buffer);
+	if (error.errorCode() == ERROR_FILE_NOT_FOUND)
 		return L"";
-	}
+	error.throwIfError<RegistryException>();
+	wstring result = (LPCTSTR) buffer;
+	HeapFree(GetProcessHeap(), 0, buffer);
+	return result;
 }
 
 
@@ -175,52 +250,40 @@ void RegistryAccess::purge()
 
 LPBYTE RegistryAccess::read(
 	HKEY hParentKey, LPCTSTR keyName, LPCTSTR valueName, DWORD valueRestriction)
+{
+	LPBYTE buffer;
+	ErrorCode error = tryRead(hParentKey, keyName, valueName, valueRestriction, &buffer);
+	error.throwIfError<RegistryException>();
+	return buffer;
+}
+
+
+
+ErrorCode RegistryAccess::tryRead(HKEY hParentKey, LPCTSTR keyName,
+	LPCTSTR valueName, DWORD valueRestriction, LPBYTE* pBuffer)
 {
 	// Get size of the queried data.
 	DWORD bufferSize = 0;
-	throwOnFailure<RegistryException>(HRESULT_FROM_WIN32(
-		RegGetValue(hParentKey, keyName, valueName, valueRestriction,
-			NULL, NULL, &bufferSize)
-		));
+	LSTATUS regResult = RegGetValue(hParentKey, keyName, valueName,
+		valueRestriction, NULL, NULL, &bufferSize);
+	if (regResult != ERROR_SUCCESS)
+		return ErrorCode::fromWin32(regResult);
 
 	// Get data.
-	LPBYTE buffer = (LPBYTE) throwIfZero<AutoSaveException>(
-		HeapAlloc(GetProcessHeap(), 0, bufferSize));
-	LSTATUS regResult = RegGetValue(hParentKey, keyName, valueName, valueRestriction,
+	LPBYTE buffer = (LPBYTE) HeapAlloc(GetProcessHeap(), 0, bufferSize);
+	if (buffer == NULL)
+		return ErrorCode(E_OUTOFMEMORY);
+	regResult = RegGetValue(hParentKey, keyName, valueName, valueRestriction,
 		NULL, buffer, &bufferSize);
 
-	// Return or throw error.
+	// Return or report error.
 	if (regResult == ERROR_SUCCESS)
 	{
-		return buffer;
+		*pBuffer = buffer;
+		return ErrorCode();
 	}
 	else {
 		HeapFree(GetProcessHeap(), 0, buffer);
-		throw RegistryException(regResult);
+		return ErrorCode::fromWin32(regResult);
 	}
 }
-
-vector<wstring> RegistryAccess::multiStringToVector(LPCTSTR pString)
-{
-	vector<wstring> strings;
-	while (*pString != L'\0')
-	{
-		strings.push_back(pString);
-		pString += _tcslen(pString) + 1;
-	}
-	return strings;
-}
-
-
-
-wstring RegistryAccess::vectorToMultiString(const vector<wstring>& strings)
-{
-	wstring result;
-	for (const wstring& string : strings)
-	{
-		result.append(string);
-		result.push_back(L'\0');
-	}
-	return result;
-}
-
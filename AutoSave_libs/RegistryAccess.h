@@ -1,12 +1,14 @@
 // RegistryAccess.h : A class that grants easy access to subkeys of the
 // HKEY_CURRENT_USER\Software\ key.
 // The constructor never throws. All other functions may throw
-// RegistryException on failure or missing registry value.
+// RegistryException on failure or missing registry value, except the
+// tryRead functions, which return the error instead.
 
 #pragma once
 
 #include "stdafx.h"
 #include "AutoSaveException.h"
+#include "Expected.h"
 
 using std::wstring;
 using std::vector;
@@ -40,6 +42,14 @@ public:
 	vector<wstring> readMultiString(const LPCTSTR valueName) const;
 	void writeMultiString(LPCTSTR valueName, const vector<wstring>& strings);
 
+	Expected<int> tryReadInt(LPCTSTR valueName) const;
+	Expected<wstring> tryReadString(LPCTSTR valueName) const;
+	Expected<vector<wstring>> tryReadMultiString(LPCTSTR valueName) const;
+
+	vector<wstring> readValueNames() const;
+	// Fails silently if the value doesn't exist.
+	void deleteValue(LPCTSTR valueName);
+
 	// Boring functions for extensibility.
 	static inline HKEY getRootKey() { return HKEY_CURRENT_USER; }
 	static inline wstring getKeyPath(const wstring& k) { return L"SOFTWARE\\" + k; }
@@ -53,11 +63,11 @@ public:
 protected:
 	static LPBYTE read(HKEY hParentKey, LPCTSTR keyName, LPCTSTR valueName,
 		DWORD valueRestriction);
+	// On success, *pBuffer must be freed with HeapFree.
+	static ErrorCode tryRead(HKEY hParentKey, LPCTSTR keyName, LPCTSTR valueName,
+		DWORD valueRestriction, LPBYTE* pBuffer);
 
 private:
-	static vector<wstring> multiStringToVector(LPCTSTR pString);
-	static wstring vectorToMultiString(const vector<wstring>& strings);
-
 	HKEY m_targetKey;
 	bool m_hasCreatedKey;
 	wstring m_keyName;
@@ -0,0 +1,102 @@
+#include "stdafx.h"
+#include "SaveVerifier.h"
+
+
+size_t SaveVerifier::setFiles(const vector<wstring>& candidates)
+{
+	m_watcher.unwatchAll();
+	m_files.clear();
+	m_stampsBefore.clear();
+	m_savedFiles.clear();
+	m_change = CH_UNKNOWN;
+	m_isWaiting = false;
+	m_isRetryDue = false;
+	for (const wstring& path : candidates)
+	{
+		if (m_watcher.getStamp(path).exists && m_watcher.watch(path))
+			m_files.push_back(path);
+	}
+	return m_files.size();
+}
+
+
+
+void SaveVerifier::startVerification()
+{
+	if (!isActive())
+		return;
+
+	if (m_isRetryDue)
+	{
+		m_isRetryDue = false;
+		++m_retryCount;
+	}
+	else {
+		m_retriesLeft = m_maxRetries;
+	}
+
+	// Forget about changes from before this save.
+	m_watcher.takeChanges();
+	vector<FileStamp> stamps;
+	for (const wstring& path : m_files)
+		stamps.push_back(m_watcher.getStamp(path));
+	if (m_stampsBefore.empty())
+		m_change = CH_UNKNOWN;
+	else
+		m_change = (stamps != m_stampsBefore) ? CH_CHANGED : CH_UNCHANGED;
+	m_stampsBefore.swap(stamps);
+	m_sentTime = m_clock.getTickCount();
+	m_isWaiting = true;
+}
+
+
+
+SaveVerifier::Status SaveVerifier::step()
+{
+	if (m_isRetryDue)
+		return SV_RETRY;
+	if (!m_isWaiting)
+	{
+		// Don't let the user's own saves pile up.
+		m_watcher.takeChanges();
+		return SV_IDLE;
+	}
+
+	if (hasAnyFileChanged())
+	{
+		m_isWaiting = false;
+		m_latencies.push_back(m_clock.getTickCount() - m_sentTime);
+		return SV_CONFIRMED;
+	}
+	else if (m_clock.getTickCount() - m_sentTime < m_timeout)
+	{
+		return SV_WAITING;
+	}
+
+	m_isWaiting = false;
+	if (m_retriesLeft > 0)
+	{
+		--m_retriesLeft;
+		m_isRetryDue = true;
+		return SV_RETRY;
+	}
+	++m_failedCount;
+	return SV_FAILED;
+}
+
+
+
+// Only looks at the files the watcher reported.
+bool SaveVerifier::hasAnyFileChanged()
+{
+	vector<wstring> changes = m_watcher.takeChanges();
+	m_savedFiles.clear();
+	for (size_t i = 0; i < m_files.size(); ++i)
+	{
+		bool isReported = std::find(changes.begin(), changes.end(),
+			m_files[i]) != changes.end();
+		if (isReported && m_watcher.getStamp(m_files[i]) != m_stampsBefore[i])
+			m_savedFiles.push_back(m_files[i]);
+	}
+	return !m_savedFiles.empty();
+}
@@ -0,0 +1,92 @@
+// SaveVerifier.h : Checks whether sent keyboard input actually saved a
+// document, by waiting for the system to report a change to the file
+// and comparing its size and modification time with those from before.
+// Only works where the documents are known, i.e. for Connected
+// Shortcuts. A save that isn't confirmed within the timeout may be
+// retried a number of times before it counts as failed.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+
+using std::wstring;
+using std::vector;
+
+class SaveVerifier
+{
+public:
+	enum Status {
+		SV_IDLE,
+		SV_WAITING,
+		SV_CONFIRMED,
+		SV_RETRY,  // Call startVerification() and send the input again.
+		SV_FAILED  // All retries timed out.
+	};
+
+	enum Change {
+		CH_UNKNOWN, // There was no previous save, or no files.
+		CH_UNCHANGED,
+		CH_CHANGED
+	};
+
+	SaveVerifier(FileWatcher& watcher, const Clock& clock)
+		: m_watcher(watcher), m_clock(clock), m_timeout(0), m_maxRetries(1),
+		  m_change(CH_UNKNOWN), m_isWaiting(false), m_isRetryDue(false),
+		  m_retriesLeft(0), m_sentTime(0), m_retryCount(0), m_failedCount(0) {}
+	~SaveVerifier() { m_watcher.unwatchAll(); }
+
+	// Watches those of the files that exist. Returns how many they are.
+	size_t setFiles(const vector<wstring>& candidates);
+	inline const vector<wstring>& getFiles() const { return m_files; }
+	// Those of the files that the last confirmed save wrote.
+	inline const vector<wstring>& getSavedFiles() const { return m_savedFiles; }
+
+	// In milliseconds. Zero turns verification off.
+	inline ULONGLONG getTimeout() const { return m_timeout; }
+	inline void setTimeout(ULONGLONG timeout) { m_timeout = timeout; }
+	inline UINT getMaxRetries() const { return m_maxRetries; }
+	inline void setMaxRetries(UINT maxRetries) { m_maxRetries = maxRetries; }
+
+	inline bool isActive() const { return m_timeout > 0 && !m_files.empty(); }
+	// Whether a save is still to be confirmed or retried.
+	inline bool isVerifying() const { return m_isWaiting || m_isRetryDue; }
+
+	// To be called right before the input is sent.
+	void startVerification();
+	// Whether any file was written between the previous call to
+	// startVerification() and the latest one, e.g. by the previous save.
+	inline Change getChangeSincePreviousSave() const { return m_change; }
+	// To be called regularly, e.g. once per second.
+	Status step();
+
+	// Statistics. Latencies are in milliseconds, from sending the input
+	// to the reported change, one for each confirmed save.
+	inline const vector<ULONGLONG>& getLatencies() const { return m_latencies; }
+	inline size_t getConfirmedCount() const { return m_latencies.size(); }
+	inline size_t getRetryCount() const { return m_retryCount; }
+	inline size_t getFailedCount() const { return m_failedCount; }
+
+private:
+	bool hasAnyFileChanged();
+
+	FileWatcher& m_watcher;
+	const Clock& m_clock;
+	ULONGLONG m_timeout;
+	UINT m_maxRetries;
+
+	vector<wstring> m_files;
+	vector<FileStamp> m_stampsBefore;
+	vector<wstring> m_savedFiles;
+	Change m_change;
+
+	bool m_isWaiting;
+	bool m_isRetryDue;
+	UINT m_retriesLeft;
+	ULONGLONG m_sentTime;
+
+	vector<ULONGLONG> m_latencies;
+	size_t m_retryCount;
+	size_t m_failedCount;
+};
@@ -0,0 +1,441 @@
+#include "stdafx.h"
+#include "Scheduler.h"
+
+#include <chrono>
+
+
+void Scheduler::onTick()
+{
+	const ULONGLONG now = m_clock.getTickCount();
+	m_metrics.count(Metrics::MC_TICKS);
+	if (m_lastTickTime != 0)
+		m_metrics.record(Metrics::MH_TICK_INTERVAL, now - m_lastTickTime);
+	m_lastTickTime = now;
+	recordEvent(EventLog::EV_TICK, m_countdown.getSecondsLeft());
+	for (HWND hwnd : m_windows.takeUnresponsiveWindows())
+	{
+		m_metrics.count(Metrics::MC_UNRESPONSIVE_WINDOWS);
+		recordEvent(EventLog::EV_UNRESPONSIVE, m_windows.getWindowProcessId(hwnd),
+			(ULONGLONG) (UINT_PTR) hwnd);
+	}
+
+	if (m_cfg.settings.getTriggers() != MiscSettings::TRIG_NONE)
+		followForeground(m_windows.getForegroundWindow());
+	catchUpWithInput();
+	if (m_pVerifier == NULL)
+		return;
+
+	switch (m_pVerifier->step())
+	{
+	case SaveVerifier::SV_CONFIRMED:
+		m_metrics.count(Metrics::MC_SAVES_CONFIRMED);
+		m_metrics.record(Metrics::MH_SAVE_LATENCY,
+			m_pVerifier->getLatencies().back());
+		recordEvent(EventLog::EV_SAVE_CONFIRMED, 0,
+			m_pVerifier->getLatencies().back());
+		m_listener.onSaveConfirmed(m_pVerifier->getSavedFiles());
+		break;
+	case SaveVerifier::SV_RETRY:
+		// Otherwise, try again with the next tick.
+		if (canSendNow() && m_probe.probe(m_windows.getForegroundWindow()) ==
+			ReadinessProbe::RD_READY)
+		{
+			m_metrics.count(Metrics::MC_RETRIES);
+			recordEvent(EventLog::EV_RETRY);
+			save();
+		}
+		break;
+	case SaveVerifier::SV_FAILED:
+		m_metrics.count(Metrics::MC_SAVES_FAILED);
+		recordEvent(EventLog::EV_SAVE_FAILED);
+		m_listener.showSaveFailedAlert();
+		break;
+	default:
+		break;
+	}
+}
+
+
+
+void Scheduler::handle(Countdown::Event event)
+{
+	switch (event)
+	{
+	case Countdown::EV_DELAYATZERO:
+		onDelayAtZero();
+		break;
+	case Countdown::EV_FIVESECONDSLEFT:
+		onFiveSecondsLeft();
+		break;
+	case Countdown::EV_LESSTHANFIVELEFT:
+		onLessThanFiveLeft(m_countdown.getSecondsLeft());
+		break;
+	case Countdown::EV_ATZERO:
+		onAtZero();
+		break;
+	default:
+		break;
+	}
+}
+
+
+
+void Scheduler::onDelayAtZero()
+{
+	m_listener.showIndicator(SchedulerListener::IND_IDLE);
+}
+
+
+
+void Scheduler::onFiveSecondsLeft()
+{
+	// A new countdown; any earlier wait at zero is over.
+	m_isAtZero = false;
+	m_activationTime = 0;
+	m_probe.reset();
+	if (!m_cfg.matchingWindowExists(m_windows))
+	{
+		m_metrics.count(Metrics::MC_COUNTDOWN_RESETS);
+		recordEvent(EventLog::EV_RESET, 5);
+		m_countdown.resetCountdown();
+		m_listener.showIndicator(SchedulerListener::IND_IDLE);
+	}
+	else
+	{
+		// So that the probe at zero knows how busy the target has been.
+		m_probe.sample(m_windows.getForegroundWindow());
+		if (m_cfg.settings.verbosityExceeds(MiscSettings::ALERT_FIVE_SECONDS))
+		{
+			m_listener.showFiveSecondsAlert();
+		}
+		if (m_cfg.settings.verbosityExceeds(MiscSettings::SHOW_ICONS))
+		{
+			m_listener.showIndicator(SchedulerListener::IND_COUNT5);
+		}
+	}
+}
+
+
+
+void Scheduler::onLessThanFiveLeft(UINT secondsLeft)
+{
+	if (m_cfg.settings.verbosityExceeds(MiscSettings::SHOW_ICONS))
+	{
+		switch (secondsLeft)
+		{
+		case 4: m_listener.showIndicator(SchedulerListener::IND_COUNT4); break;
+		case 3: m_listener.showIndicator(SchedulerListener::IND_COUNT3); break;
+		case 2: m_listener.showIndicator(SchedulerListener::IND_COUNT2); break;
+		case 1: m_listener.showIndicator(SchedulerListener::IND_COUNT1); break;
+		default: break;
+		}
+	}
+}
+
+
+
+void Scheduler::onAtZero()
+{
+	const ULONGLONG now = m_clock.getTickCount();
+	if (!m_isAtZero)
+	{
+		m_isAtZero = true;
+		m_zeroTime = now;
+	}
+
+	if (canSendNow())
+	{
+		saveWhenReady();
+	}
+	else if (!m_cfg.matchingWindowExists(m_windows))
+	{
+		giveUpAtZero();
+	}
+	else
+	{
+		m_metrics.count(Metrics::MC_TICKS_AT_ZERO);
+		if (m_cfg.settings.verbosityExceeds(MiscSettings::SHOW_ICONS))
+			m_listener.showIndicator(SchedulerListener::IND_COUNT0);
+	}
+}
+
+
+
+// Only the first report of a matching window counts for the delay;
+// asking again while a key is held down doesn't.
+bool Scheduler::onForegroundChanged(HWND hwnd)
+{
+	if (m_cfg.settings.getTriggers() != MiscSettings::TRIG_NONE)
+		followForeground(hwnd);
+	if (!m_isAtZero || !m_countdown.isRunning())
+		return false;
+
+	m_metrics.count(Metrics::MC_FOREGROUND_CHANGES);
+	if (!m_cfg.windowMatch(hwnd, m_windows))
+	{
+		m_activationTime = 0;
+		if (!m_cfg.matchingWindowExists(m_windows))
+			giveUpAtZero();
+		return false;
+	}
+
+	if (m_activationTime == 0)
+		m_activationTime = m_clock.getTickCount();
+	if (canSendNow())
+	{
+		saveWhenReady();
+		return false;
+	}
+	return !noKeyPressed();
+}
+
+
+
+bool Scheduler::canIdleAtZero() const
+{
+	return m_isForegroundReported && m_isAtZero && m_countdown.isRunning() &&
+		!m_probe.isDeferring() &&
+		(m_pVerifier == NULL || !m_pVerifier->isVerifying());
+}
+
+
+
+bool Scheduler::canSendNow() const
+{
+	return noKeyPressed() &&
+		m_cfg.windowMatch(m_windows.getForegroundWindow(), m_windows);
+}
+
+
+
+// With a matching window in front at zero.
+void Scheduler::saveWhenReady()
+{
+	const HWND target = m_windows.getForegroundWindow();
+	const bool wasDeferring = m_probe.isDeferring();
+	const ULONGLONG deferred = m_probe.getDeferredTime();
+	const ReadinessProbe::Decision decision = m_probe.decide(target);
+	if (decision == ReadinessProbe::DC_SEND)
+	{
+		if (wasDeferring)
+			m_metrics.record(Metrics::MH_DEFERRAL, deferred);
+		saveAtZero();
+		return;
+	}
+	if (decision == ReadinessProbe::DC_GIVE_UP)
+	{
+		m_metrics.count(Metrics::MC_SAVES_DROPPED);
+		m_metrics.record(Metrics::MH_DEFERRAL, deferred);
+		giveUpAtZero();
+		return;
+	}
+
+	if (decision == ReadinessProbe::DC_DEFER)
+	{
+		const ReadinessProbe::Readiness readiness = m_probe.getReadiness();
+		m_metrics.count((readiness == ReadinessProbe::RD_BUSY) ?
+			Metrics::MC_DEFERRED_BUSY : Metrics::MC_DEFERRED_HUNG);
+		recordEvent(EventLog::EV_DEFER, readiness, m_probe.getDeferredTime(),
+			(ULONGLONG) (UINT_PTR) target);
+	}
+	if (m_cfg.settings.verbosityExceeds(MiscSettings::SHOW_ICONS))
+		m_listener.showIndicator(SchedulerListener::IND_COUNT0);
+}
+
+
+
+void Scheduler::saveAtZero()
+{
+	const ULONGLONG now = m_clock.getTickCount();
+	m_isAtZero = false;
+	m_metrics.count(Metrics::MC_SAVES);
+	m_metrics.record(Metrics::MH_ZERO_WAIT, now - m_zeroTime);
+	if (m_activationTime != 0)
+	{
+		m_metrics.record(Metrics::MH_ACTIVATION_DELAY, now - m_activationTime);
+		m_activationTime = 0;
+	}
+	recordEvent(EventLog::EV_MATCH, 0,
+		(ULONGLONG) (UINT_PTR) m_windows.getForegroundWindow());
+	adaptInterval(save());
+	m_countdown.resetCountdown();
+	if (m_cfg.settings.verbosityExceeds(MiscSettings::SHOW_ICONS))
+	{
+		m_countdown.resetDelay();
+		// Clear potential five-seconds alert.
+		m_listener.clearAlert();
+		m_listener.showIndicator(SchedulerListener::IND_SAVED);
+	}
+}
+
+
+
+void Scheduler::giveUpAtZero()
+{
+	m_isAtZero = false;
+	m_activationTime = 0;
+	m_probe.reset();
+	m_metrics.count(Metrics::MC_COUNTDOWN_RESETS);
+	recordEvent(EventLog::EV_RESET, 0);
+	m_countdown.resetCountdown();
+	m_listener.clearAlert();
+	m_listener.showIndicator(SchedulerListener::IND_IDLE);
+}
+
+
+
+// Called with every tick and every reported change, so that triggers
+// work by polling where changes aren't reported. Each trigger is pulled
+// at most once while the user stays away from the matching windows.
+void Scheduler::followForeground(HWND foreground)
+{
+	if (m_cfg.windowMatch(foreground, m_windows))
+	{
+		m_frontWindow = foreground;
+		m_pastTriggers = MiscSettings::TRIG_NONE;
+		return;
+	}
+	if (m_frontWindow == NULL)
+		return;
+
+	const ULONGLONG now = m_clock.getTickCount();
+	int happened = MiscSettings::TRIG_LEAVE;
+	if ((m_pastTriggers & MiscSettings::TRIG_LEAVE) == 0)
+		m_leaveTime = now;
+	if (m_windows.isWindowMinimized(m_frontWindow))
+		happened |= MiscSettings::TRIG_MINIMIZE;
+	if (now - m_leaveTime >= m_cfg.settings.getBackgroundDelay() * 1000ULL)
+		happened |= MiscSettings::TRIG_BACKGROUND;
+
+	const int triggers = happened & ~m_pastTriggers &
+		m_cfg.settings.getTriggers();
+	m_pastTriggers |= happened;
+	if (triggers != MiscSettings::TRIG_NONE)
+		trigger(triggers);
+}
+
+
+
+// Lets the countdown run out with the next tick, unless it already has.
+void Scheduler::trigger(int triggers)
+{
+	const UINT secondsLeft = m_countdown.getSecondsLeft();
+	if (!m_countdown.isRunning() || secondsLeft == 0)
+		return;
+
+	const ULONGLONG now = m_clock.getTickCount();
+	if (now - m_lastSaveTime < m_cfg.settings.getTriggerDedupe() * 1000ULL)
+	{
+		m_metrics.count(Metrics::MC_TRIGGERS_DEDUPED);
+		return;
+	}
+	m_metrics.count(Metrics::MC_TRIGGERS);
+	recordEvent(EventLog::EV_TRIGGER, triggers, secondsLeft);
+	m_countdown.shortenTo(0);
+}
+
+
+
+// Returns whether the user had given any input since the last save.
+bool Scheduler::save()
+{
+	const bool hadInput = hadInputSinceSave();
+	if (m_pVerifier != NULL)
+		m_pVerifier->startVerification();
+	sendKeys(m_cfg.settings.getSaveMacro());
+	// Sent input may count as input, but it isn't the user's.
+	if (!hadInput)
+		m_lastSaveTime = m_clock.getTickCount();
+	return hadInput;
+}
+
+
+
+// Retries don't count as saves here; they only repeat the last one.
+void Scheduler::adaptInterval(bool hadInput)
+{
+	if (m_cfg.settings.isIntervalAdaptive())
+	{
+		AdaptiveInterval::Signals signals = {
+			hadInput,
+			AdaptiveInterval::FC_UNKNOWN,
+			getLastSaveDuration()
+		};
+		if (m_pVerifier != NULL)
+		{
+			switch (m_pVerifier->getChangeSincePreviousSave())
+			{
+			case SaveVerifier::CH_CHANGED:
+				signals.fileChange = AdaptiveInterval::FC_CHANGED;
+				break;
+			case SaveVerifier::CH_UNCHANGED:
+				signals.fileChange = AdaptiveInterval::FC_UNCHANGED;
+				break;
+			default:
+				break;
+			}
+		}
+		const UINT interval = AdaptiveInterval::next(
+			m_cfg.settings.getAdaptivePolicy(), m_countdown.getInterval(),
+			signals);
+		if (interval != m_countdown.getInterval())
+		{
+			m_countdown.setInterval(interval);
+			recordEvent(EventLog::EV_INTERVAL_CHANGED, interval);
+		}
+		m_isWaitingForInput = !hadInput;
+	}
+	m_lastSaveTime = m_clock.getTickCount();
+}
+
+
+
+// After a long idle stretch, the user's new work shouldn't have to wait
+// for the grown interval to run out. If the interval grew because the
+// saves didn't write anything, input alone doesn't change that.
+void Scheduler::catchUpWithInput()
+{
+	if (m_isWaitingForInput && m_cfg.settings.isIntervalAdaptive() &&
+		hadInputSinceSave())
+	{
+		m_isWaitingForInput = false;
+		m_countdown.shortenTo(AdaptiveInterval::getBusyInterval(
+			m_cfg.settings.getAdaptivePolicy(), getLastSaveDuration()));
+	}
+}
+
+
+
+bool Scheduler::hadInputSinceSave() const
+{
+	return m_input.getLastInputTime() > m_lastSaveTime;
+}
+
+
+
+ULONGLONG Scheduler::getLastSaveDuration() const
+{
+	if (m_pVerifier == NULL || m_pVerifier->getLatencies().empty())
+		return 0;
+	return m_pVerifier->getLatencies().back();
+}
+
+
+
+UINT Scheduler::sendKeys(const KeyMacro& macro)
+{
+	const HWND target = m_windows.getForegroundWindow();
+	const DWORD eventDelay = m_cfg.settings.getEventDelay(
+		m_windows.getWindowExecutable(target));
+	// Sending takes real time, even in a simulation.
+	auto start = std::chrono::steady_clock::now();
+	UINT keysSent = macro.sendTo(m_input, eventDelay) / 2;
+	auto duration = std::chrono::steady_clock::now() - start;
+	const ULONGLONG microseconds = std::chrono::duration_cast<
+		std::chrono::microseconds>(duration).count();
+	m_metrics.count(Metrics::MC_KEYS_SENT, keysSent);
+	m_metrics.record(Metrics::MH_SEND_DURATION, microseconds);
+	recordEvent(EventLog::EV_SEND, keysSent, microseconds,
+		(ULONGLONG) (UINT_PTR) target);
+	return keysSent;
+}
@@ -0,0 +1,165 @@
+// Scheduler.h : Decides what happens when the countdown reaches five
+// seconds or zero: whether to save, to wait for a matching window to
+// come to the foreground, or to start over because there is none.
+// Talks to the system only through the Platform.h interfaces it is
+// given and reports what the user should see to a SchedulerListener,
+// so that DesktopSimulator can drive it without a desktop.
+// With a SaveVerifier, it also checks that the input has saved the
+// document, and sends it again or raises an alert if it hasn't. The
+// listener learns which files a confirmed save wrote, e.g. to back them up.
+// If the settings say so, it adapts the countdown's interval after each
+// save (see AdaptiveInterval), and cuts it short when the user gets back
+// to work. What it does and how long it takes is counted in its Metrics,
+// and, if it is given an EventLog, recorded there as it happens.
+// Where the system reports foreground changes (see ForegroundWatcher),
+// a matching window that comes to the front at zero is saved right
+// away, and the timer may stop while waiting at zero.
+// The triggers in MiscSettings let the countdown run out early when the
+// user leaves a matching window, stays away from it, or minimizes it.
+// Since input only reaches the foreground window, the save then waits at
+// zero for the user to come back, and goes out before they get back to
+// work. Triggers too soon after a save are ignored.
+// At zero, the save also waits while the target's program is busy or
+// doesn't respond (see ReadinessProbe), and is dropped if it doesn't
+// respond for too long.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "Countdown.h"
+#include "Configuration.h"
+#include "Platform.h"
+#include "SaveVerifier.h"
+#include "ReadinessProbe.h"
+#include "AdaptiveInterval.h"
+#include "Metrics.h"
+#include "EventLog.h"
+
+class SchedulerListener
+{
+public:
+	// What the notification area icon shows.
+	enum Indicator {
+		IND_IDLE,
+		IND_COUNT5,
+		IND_COUNT4,
+		IND_COUNT3,
+		IND_COUNT2,
+		IND_COUNT1,
+		IND_COUNT0,
+		IND_SAVED
+	};
+
+	virtual ~SchedulerListener() {}
+
+	virtual void showIndicator(Indicator indicator) = 0;
+	virtual void showFiveSecondsAlert() = 0;
+	virtual void clearAlert() = 0;
+	virtual void showSaveFailedAlert() = 0;
+	// The verifier saw these files written after a save was sent.
+	virtual void onSaveConfirmed(const vector<wstring>& files) = 0;
+};
+
+
+
+class Scheduler
+{
+public:
+	Scheduler(const Configuration& cfg, Countdown& countdown,
+		const Clock& clock, const WindowEnumerator& windows,
+		InputSink& input, SchedulerListener& listener)
+		: m_cfg(cfg), m_countdown(countdown), m_clock(clock),
+		  m_windows(windows), m_input(input), m_listener(listener),
+		  m_pVerifier(NULL), m_pEventLog(NULL), m_lastSaveTime(clock.getTickCount()),
+		  m_isWaitingForInput(false), m_isForegroundReported(false),
+		  m_lastTickTime(0), m_isAtZero(false), m_zeroTime(0),
+		  m_activationTime(0), m_frontWindow(NULL), m_leaveTime(0),
+		  m_pastTriggers(MiscSettings::TRIG_NONE), m_probe(clock, windows) {}
+
+	// Pass NULL to turn verification off. Doesn't take ownership.
+	inline void setVerifier(SaveVerifier* pVerifier) { m_pVerifier = pVerifier; }
+	inline SaveVerifier* getVerifier() const { return m_pVerifier; }
+	// Pass NULL to stop recording events. Doesn't take ownership.
+	inline void setEventLog(EventLog* pEventLog) { m_pEventLog = pEventLog; }
+	// Whether onForegroundChanged will be called with every change.
+	inline void setForegroundReported(bool isReported) {
+		m_isForegroundReported = isReported;
+	}
+
+	// May be read from other threads.
+	inline Metrics& getMetrics() { return m_metrics; }
+	inline const Metrics& getMetrics() const { return m_metrics; }
+	// When the last save was sent, or when the Scheduler was created.
+	inline ULONGLONG getLastSaveTime() const { return m_lastSaveTime; }
+
+	// To be called once per second, whatever Countdown::step returns.
+	void onTick();
+	// Handles the result of Countdown::step.
+	void handle(Countdown::Event event);
+
+	void onDelayAtZero();
+	void onFiveSecondsLeft();
+	void onLessThanFiveLeft(UINT secondsLeft);
+	void onAtZero();
+	// Pulls a trigger if the user left a matching window. At zero, saves
+	// if hwnd is a matching window, and starts over if there is none
+	// left. Returns true if the window matches but a key is held down,
+	// e.g. Alt after Alt+Tab; call again shortly then.
+	bool onForegroundChanged(HWND hwnd);
+	// Whether the timer may stop until the next foreground change: the
+	// countdown waits at zero, changes are reported, and no save is
+	// left to check.
+	bool canIdleAtZero() const;
+	// In milliseconds.
+	inline static UINT getForegroundRetryDelay() { return 100; }
+
+	// Paced for the foreground window's program.
+	// Returns the number of complete key presses sent.
+	UINT sendKeys(const KeyMacro& macro);
+	inline bool noKeyPressed() const { return !m_input.isAnyKeyPressed(); }
+
+private:
+	bool canSendNow() const;
+	void saveWhenReady();
+	void saveAtZero();
+	void giveUpAtZero();
+	void followForeground(HWND foreground);
+	void trigger(int triggers);
+	bool save();
+	void adaptInterval(bool hadInput);
+	void catchUpWithInput();
+	bool hadInputSinceSave() const;
+	ULONGLONG getLastSaveDuration() const;
+	inline void recordEvent(EventLog::EventId id, UINT arg0 = 0,
+		ULONGLONG arg1 = 0, ULONGLONG arg2 = 0) {
+		if (m_pEventLog != NULL)
+			m_pEventLog->record(id, arg0, arg1, arg2);
+	}
+
+	const Configuration& m_cfg;
+	Countdown& m_countdown;
+	const Clock& m_clock;
+	const WindowEnumerator& m_windows;
+	InputSink& m_input;
+	SchedulerListener& m_listener;
+	SaveVerifier* m_pVerifier;
+	EventLog* m_pEventLog;
+	ULONGLONG m_lastSaveTime;
+	bool m_isWaitingForInput;
+	bool m_isForegroundReported;
+
+	Metrics m_metrics;
+	ULONGLONG m_lastTickTime;
+	bool m_isAtZero;
+	ULONGLONG m_zeroTime;
+	// When a matching window was reported at zero; zero if none was.
+	ULONGLONG m_activationTime;
+	// The matching window that was last in front; NULL if none has been.
+	HWND m_frontWindow;
+	// When it lost the foreground, if it has.
+	ULONGLONG m_leaveTime;
+	// Those of the triggers that have happened since then.
+	int m_pastTriggers;
+	ReadinessProbe m_probe;
+};
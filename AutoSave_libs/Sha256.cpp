@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include "Sha256.h"
+
+
+namespace {
+	const DWORD roundConstants[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+	};
+
+	inline DWORD rotateRight(DWORD value, int bits)
+	{
+		return (DWORD) ((value >> bits) | (value << (32 - bits)));
+	}
+
+	int hexValue(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+}
+
+
+
+string Sha256::Digest::toHex() const
+{
+	static const char digits[] = "0123456789abcdef";
+	string hex(2 * digestSize, '0');
+	for (size_t i = 0; i < digestSize; ++i)
+	{
+		hex[2 * i] = digits[bytes[i] >> 4];
+		hex[2 * i + 1] = digits[bytes[i] & 0xf];
+	}
+	return hex;
+}
+
+
+
+bool Sha256::Digest::fromHex(const string& hex, Digest* pDigest)
+{
+	if (hex.size() != 2 * digestSize)
+		return false;
+	Digest digest;
+	for (size_t i = 0; i < digestSize; ++i)
+	{
+		int high = hexValue(hex[2 * i]);
+		int low = hexValue(hex[2 * i + 1]);
+		if (high < 0 || low < 0)
+			return false;
+		digest.bytes[i] = (BYTE) ((high << 4) | low);
+	}
+	*pDigest = digest;
+	return true;
+}
+
+
+
+void Sha256::reset()
+{
+	static const DWORD initialState[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+	memcpy(m_state, initialState, sizeof(m_state));
+	m_blockSize = 0;
+	m_totalSize = 0;
+}
+
+
+
+void Sha256::update(const void* pData, size_t size)
+{
+	const BYTE* pBytes = (const BYTE*) pData;
+	m_totalSize += size;
+	if (m_blockSize > 0)
+	{
+		const size_t taken = __min(size, sizeof(m_block) - m_blockSize);
+		memcpy(m_block + m_blockSize, pBytes, taken);
+		m_blockSize += taken;
+		pBytes += taken;
+		size -= taken;
+		if (m_blockSize < sizeof(m_block))
+			return;
+		compress(m_block);
+		m_blockSize = 0;
+	}
+	// Whole blocks straight from the caller's buffer.
+	for (; size >= sizeof(m_block); pBytes += sizeof(m_block), size -= sizeof(m_block))
+		compress(pBytes);
+	memcpy(m_block, pBytes, size);
+	m_blockSize = size;
+}
+
+
+
+Sha256::Digest Sha256::finish()
+{
+	const ULONGLONG bitCount = m_totalSize * 8;
+	const BYTE one = 0x80;
+	const BYTE zeros[64] = { 0 };
+	update(&one, 1);
+	update(zeros, (m_blockSize <= 56) ? 56 - m_blockSize : 120 - m_blockSize);
+	BYTE length[8];
+	for (int i = 0; i < 8; ++i)
+		length[i] = (BYTE) (bitCount >> (56 - 8 * i));
+	update(length, 8);
+
+	Digest digest;
+	for (int i = 0; i < 8; ++i)
+	{
+		digest.bytes[4 * i] = (BYTE) (m_state[i] >> 24);
+		digest.bytes[4 * i + 1] = (BYTE) (m_state[i] >> 16);
+		digest.bytes[4 * i + 2] = (BYTE) (m_state[i] >> 8);
+		digest.bytes[4 * i + 3] = (BYTE) m_state[i];
+	}
+	reset();
+	return digest;
+}
+
+
+
+Sha256::Digest Sha256::hash(const void* pData, size_t size)
+{
+	Sha256 sha;
+	sha.update(pData, size);
+	return sha.finish();
+}
+
+
+
+void Sha256::compress(const BYTE* pBlock)
+{
+	DWORD w[64];
+	for (int i = 0; i < 16; ++i)
+	{
+		w[i] = ((DWORD) pBlock[4 * i] << 24) | ((DWORD) pBlock[4 * i + 1] << 16) |
+			((DWORD) pBlock[4 * i + 2] << 8) | (DWORD) pBlock[4 * i + 3];
+	}
+	for (int i = 16; i < 64; ++i)
+	{
+		const DWORD s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^
+			(w[i - 15] >> 3);
+		const DWORD s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^
+			(w[i - 2] >> 10);
+		w[i] = (DWORD) (w[i - 16] + s0 + w[i - 7] + s1);
+	}
+
+	DWORD a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+	DWORD e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+	for (int i = 0; i < 64; ++i)
+	{
+		const DWORD s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+		const DWORD choice = (e & f) ^ (~e & g);
+		const DWORD t1 = (DWORD) (h + s1 + choice + roundConstants[i] + w[i]);
+		const DWORD s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+		const DWORD majority = (a & b) ^ (a & c) ^ (b & c);
+		const DWORD t2 = (DWORD) (s0 + majority);
+		h = g;
+		g = f;
+		f = e;
+		e = (DWORD) (d + t1);
+		d = c;
+		c = b;
+		b = a;
+		a = (DWORD) (t1 + t2);
+	}
+	m_state[0] += a; m_state[1] += b; m_state[2] += c; m_state[3] += d;
+	m_state[4] += e; m_state[5] += f; m_state[6] += g; m_state[7] += h;
+}
@@ -0,0 +1,49 @@
+// Sha256.h : The SHA-256 hash (FIPS 180-4), for naming stored content
+// after what it holds (see BackupStore). Fed in pieces of any size; the
+// digest is the same as for all of them at once.
+// Never throws exceptions (except std::bad_alloc in toHex).
+
+#pragma once
+
+#include "stdafx.h"
+
+using std::string;
+
+class Sha256
+{
+public:
+	static const size_t digestSize = 32;
+	struct Digest
+	{
+		BYTE bytes[digestSize];
+
+		inline bool operator==(const Digest& other) const {
+			return memcmp(bytes, other.bytes, digestSize) == 0;
+		}
+		inline bool operator!=(const Digest& other) const {
+			return !(*this == other);
+		}
+		// 64 lower-case hex digits.
+		string toHex() const;
+		// Returns false, and leaves *pDigest alone, unless hex is what
+		// toHex returns, in either case.
+		static bool fromHex(const string& hex, Digest* pDigest);
+	};
+
+	Sha256() { reset(); }
+
+	void reset();
+	void update(const void* pData, size_t size);
+	// Starts over afterwards.
+	Digest finish();
+
+	static Digest hash(const void* pData, size_t size);
+
+private:
+	void compress(const BYTE* pBlock);
+
+	DWORD m_state[8];
+	BYTE m_block[64];
+	size_t m_blockSize;
+	ULONGLONG m_totalSize;
+};
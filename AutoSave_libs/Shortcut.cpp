@@ -27,8 +27,14 @@ Shortcut::~Shortcut()
 
 void Shortcut::load(const wstring& filePath, DWORD mode)
 {
-	throwOnFailure<OleException>(
-		m_pFile->Load(filePath.data(), mode));
+	tryLoad(filePath, mode).throwIfError<OleException>();
+}
+
+
+
+ErrorCode Shortcut::tryLoad(const wstring& filePath, DWORD mode)
+{
+	return ErrorCode(m_pFile->Load(filePath.data(), mode));
 }
 
 
@@ -42,11 +48,19 @@ void Shortcut::save(const wstring& filePath, BOOL remember)
 
 
 wstring Shortcut::getPath() const
+{
+	return tryGetPath().valueOrThrow<OleException>();
+}
+
+
+
+Expected<wstring> Shortcut::tryGetPath() const
 {
 	TCHAR buffer[MAX_PATH];
-	throwOnFailure<OleException>(
-		m_pLink->GetPath(buffer, MAX_PATH, NULL, 0));
-	return buffer;
+	ErrorCode error(m_pLink->GetPath(buffer, MAX_PATH, NULL, 0));
+	if (error.isError())
+		return error;
+	return wstring(buffer);
 }
 
 
@@ -62,13 +76,21 @@ wstring Shortcut::getRawPath() const
 
 
 wstring Shortcut::getArguments() const
+{
+	return tryGetArguments().valueOrThrow<OleException>();
+}
+
+
+
+Expected<wstring> Shortcut::tryGetArguments() const
 {
 	// There is no reason to use this length specifically,
 	// but we hope that this is sufficiently large.
 	TCHAR buffer[INFOTIPSIZE];
-	throwOnFailure<OleException>(
-		m_pLink->GetArguments(buffer, INFOTIPSIZE));
-	return buffer;
+	ErrorCode error(m_pLink->GetArguments(buffer, INFOTIPSIZE));
+	if (error.isError())
+		return error;
+	return wstring(buffer);
 }
 
 
@@ -1,6 +1,7 @@
 // Shortcut.h : class for all handling of shortcut files.
 // Mostly wraps around the CLSID_ShellLink object.
-// Most member functions may throw OleException on failure.
+// Most member functions may throw OleException on failure; the try
+// functions return the error instead.
 // The constructor may throw.
 // Beware: This class expects OleInitialize to have been called already!
 
@@ -8,6 +9,7 @@
 
 #include "stdafx.h"
 #include "OleUtils.h"
+#include "Expected.h"
 #include <ShObjIdl.h>
 #include <ShlObj.h>
 #include <ShlGuid.h>
@@ -26,11 +28,14 @@ public:
 	inline IPersistFile& file() const { return *m_pFile; }
 
 	void load(const wstring& filePath, DWORD mode);
+	ErrorCode tryLoad(const wstring& filePath, DWORD mode);
 	void save(const wstring& filePath, BOOL remember);
 
 	wstring getPath() const;
+	Expected<wstring> tryGetPath() const;
 	wstring getRawPath() const;
 	wstring getArguments() const;
+	Expected<wstring> tryGetArguments() const;
 	wstring getWorkingDirectory() const;
 	wstring getDescription() const; // Fails silently.
 	wstring getIconLocation(int* pIconIndex) const;
@@ -0,0 +1,120 @@
+#include "stdafx.h"
+#include "ShortcutJournal.h"
+#include "StringListUtils.h"
+#include "MemoryConfigStore.h"
+
+
+namespace {
+	// FNV-1a over UTF-16 code units, so that names are the same anywhere.
+	ULONGLONG hashPath(const wstring& path)
+	{
+		ULONGLONG hash = 14695981039346656037ULL;
+		for (wchar_t c : path)
+		{
+			hash = (hash ^ (c & 0xff)) * 1099511628211ULL;
+			hash = (hash ^ ((c >> 8) & 0xff)) * 1099511628211ULL;
+		}
+		return hash;
+	}
+}
+
+
+
+void ShortcutJournal::add(const wstring& file)
+{
+	m_store.writeString(getEntryName(file), file);
+}
+
+
+
+vector<wstring> ShortcutJournal::read() const
+{
+	vector<wstring> files = readList();
+	vector<wstring> journalFiles;
+	for (const wstring& name : findEntryNames())
+	{
+		// Another instance may have compacted it away in the meantime.
+		Expected<wstring> file = m_store.tryReadString(name);
+		if (file)
+			journalFiles.push_back(file.value());
+	}
+	std::sort(journalFiles.begin(), journalFiles.end());
+	StringListUtils::mergeLists(files, journalFiles);
+	return files;
+}
+
+
+
+// A crash between writing and deleting leaves entries that are already
+// in the list; read() takes care of that.
+// Another compaction may have folded in, and deleted, entries that came
+// after ours read the journal; the list is read again right before it
+// is written, so that they stay in it.
+vector<wstring> ShortcutJournal::compact(const Pruner& prune)
+{
+	const vector<wstring> names = findEntryNames();
+	const vector<wstring> files = read();
+	vector<wstring> compactedFiles = prune ? prune(files) : files;
+
+	vector<wstring> foldedByOthers;
+	for (const wstring& file : readList())
+	{
+		if (std::find(files.begin(), files.end(), file) == files.end())
+			foldedByOthers.push_back(file);
+	}
+	StringListUtils::mergeLists(compactedFiles, foldedByOthers);
+	if (names.empty() && compactedFiles == files)
+		return compactedFiles;
+	m_store.writeMultiString(m_listName, compactedFiles);
+	for (const wstring& name : names)
+		m_store.deleteValue(name);
+	return compactedFiles;
+}
+
+
+
+size_t ShortcutJournal::getJournalSize() const
+{
+	return findEntryNames().size();
+}
+
+
+
+wstring ShortcutJournal::getEntryName(const wstring& file) const
+{
+	static const wchar_t digits[] = L"0123456789abcdef";
+	ULONGLONG hash = hashPath(file);
+	wstring name = m_listName + L".0000000000000000";
+	for (size_t i = name.size(); i > m_listName.size() + 1; --i)
+	{
+		name[i - 1] = digits[hash & 0xf];
+		hash >>= 4;
+	}
+	return name;
+}
+
+
+
+vector<wstring> ShortcutJournal::readList() const
+{
+	Expected<vector<wstring>> files = m_store.tryReadMultiString(m_listName);
+	if (files)
+		return std::move(files.value());
+	if (files.error().errorCode() != ERROR_FILE_NOT_FOUND)
+		files.error().throwIfError<ConfigStoreException>();
+	return vector<wstring>();
+}
+
+
+
+vector<wstring> ShortcutJournal::findEntryNames() const
+{
+	const wstring prefix = m_listName + L".";
+	vector<wstring> names;
+	for (const wstring& name : m_store.getValueNames())
+	{
+		if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0)
+			names.push_back(name);
+	}
+	return names;
+}
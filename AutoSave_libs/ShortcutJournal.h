@@ -0,0 +1,56 @@
+// ShortcutJournal.h : The list of Connected Shortcuts that AutoSave has
+// been started from, which the uninstaller offers to clean up.
+// The list used to be one multi-string value that every start read and
+// wrote back whole. Now each start writes one value of its own, named
+// after a hash of the shortcut's path ("<list>.<hash>"), which costs the
+// same however long the list is, and two instances starting at once
+// can't lose each other's entry. compact() moves these journal entries
+// into the list value, and may prune the list on the way (see
+// ShortcutListCompactor); read() sees both either way. Two compactions
+// at once keep what the other one moved, unless the other one writes
+// in the moment between reading the list again and writing it.
+// Throws whatever the ConfigStore throws, except that a missing list
+// value counts as an empty list, and a missing journal entry is skipped.
+// Reading the list fails with ConfigStoreException, whatever the store.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+
+using std::wstring;
+using std::vector;
+
+class ShortcutJournal
+{
+public:
+	typedef std::function<vector<wstring>(const vector<wstring>&)> Pruner;
+
+	// Doesn't take ownership.
+	ShortcutJournal(ConfigStore& store, const wstring& listName)
+		: m_store(store), m_listName(listName) {}
+
+	// Exactly one write. Adding a file twice writes the same value.
+	void add(const wstring& file);
+
+	// The list, followed by journal entries that aren't in it, in the
+	// order of their paths.
+	vector<wstring> read() const;
+	// Writes the list value once, pruned if a pruner is given, and
+	// deletes the journal entries. Doesn't write if nothing changes.
+	// Returns the list as written.
+	vector<wstring> compact(const Pruner& prune = Pruner());
+
+	size_t getJournalSize() const;
+	wstring getEntryName(const wstring& file) const;
+
+private:
+	ShortcutJournal(const ShortcutJournal&);
+	ShortcutJournal& operator=(const ShortcutJournal&);
+
+	vector<wstring> readList() const;
+	vector<wstring> findEntryNames() const;
+
+	ConfigStore& m_store;
+	wstring m_listName;
+};
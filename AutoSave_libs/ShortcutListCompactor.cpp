@@ -0,0 +1,82 @@
+#include "stdafx.h"
+#include "ShortcutListCompactor.h"
+#include "StringListUtils.h"
+#include <atomic>
+#include <thread>
+#include <system_error>
+
+
+ShortcutListCompactor::ShortcutListCompactor(const ExistenceCheck& exists,
+	size_t maxEntries, unsigned threadCount)
+	: m_exists(exists), m_maxEntries(maxEntries), m_threadCount(threadCount)
+{
+	m_threadCount = __min(__max(m_threadCount, 1u), maxThreadCount);
+	m_result.duplicates = m_result.deadFiles = m_result.overflow = 0;
+}
+
+
+
+// Removes duplicates first, so that each file is only checked once.
+vector<wstring> ShortcutListCompactor::compact(const vector<wstring>& files)
+{
+	vector<wstring> uniqueFiles = files;
+	m_result.duplicates = StringListUtils::removeDuplicatePaths(uniqueFiles);
+
+	const vector<char> doesExist = checkExistence(uniqueFiles);
+	vector<wstring> liveFiles;
+	liveFiles.reserve(uniqueFiles.size());
+	for (size_t i = 0; i < uniqueFiles.size(); ++i)
+	{
+		if (doesExist[i])
+			liveFiles.push_back(std::move(uniqueFiles[i]));
+	}
+	m_result.deadFiles = uniqueFiles.size() - liveFiles.size();
+
+	m_result.overflow = 0;
+	if (liveFiles.size() > m_maxEntries)
+	{
+		m_result.overflow = liveFiles.size() - m_maxEntries;
+		liveFiles.erase(liveFiles.begin(), liveFiles.begin() + m_result.overflow);
+	}
+	return liveFiles;
+}
+
+
+
+// Threads take batches off a shared counter, so a slow batch (say, on a
+// network drive that doesn't answer) doesn't hold up the others.
+// The calling thread works along.
+vector<char> ShortcutListCompactor::checkExistence(
+	const vector<wstring>& files) const
+{
+	vector<char> doesExist(files.size(), 0);
+	std::atomic<size_t> nextBatch(0);
+	auto checkBatches = [&]() {
+		for (;;)
+		{
+			const size_t first = nextBatch.fetch_add(batchSize);
+			if (first >= files.size())
+				return;
+			const size_t last = std::min(first + batchSize, files.size());
+			for (size_t i = first; i < last; ++i)
+				doesExist[i] = m_exists(files[i]) ? 1 : 0;
+		}
+	};
+
+	const size_t batchCount = (files.size() + batchSize - 1) / batchSize;
+	const size_t helperCount =
+		std::min<size_t>(m_threadCount, std::max<size_t>(batchCount, 1)) - 1;
+	vector<std::thread> helpers;
+	helpers.reserve(helperCount);
+	try {
+		for (size_t i = 0; i < helperCount; ++i)
+			helpers.push_back(std::thread(checkBatches));
+	}
+	catch (std::system_error&) {
+		// The threads that did start do the work.
+	}
+	checkBatches();
+	for (std::thread& helper : helpers)
+		helper.join();
+	return doesExist;
+}
@@ -0,0 +1,59 @@
+// ShortcutListCompactor.h : Keeps the list of Connected Shortcuts from
+// growing without bounds. Older versions of AutoSave added the starting
+// shortcut on every start, so the list may hold the same path thousands
+// of times, and files that have long been deleted.
+// compact() drops paths that are in the list twice (see
+// StringListUtils::normalizePath), files that don't exist anymore, and,
+// beyond maxEntries, the oldest ones. Finding out which files exist is
+// what takes time, so it's done in batches on several threads.
+// Nothing here throws (except std::bad_alloc), and neither may the
+// existence check.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+
+using std::wstring;
+using std::vector;
+
+class ShortcutListCompactor
+{
+public:
+	// Must be safe to call from several threads at once.
+	typedef std::function<bool(const wstring&)> ExistenceCheck;
+
+	struct Result
+	{
+		size_t duplicates;
+		size_t deadFiles;
+		size_t overflow;
+	};
+
+	ShortcutListCompactor(const ExistenceCheck& exists = Platform::fileExists,
+		size_t maxEntries = defaultMaxEntries,
+		unsigned threadCount = maxThreadCount);
+
+	// Takes and returns the list oldest first, as it's stored.
+	vector<wstring> compact(const vector<wstring>& files);
+
+	inline const Result& getResult() const { return m_result; }
+	inline size_t getMaxEntries() const { return m_maxEntries; }
+	inline unsigned getThreadCount() const { return m_threadCount; }
+
+	static const size_t defaultMaxEntries = 500;
+	// Files checked by a thread before it takes the next batch.
+	static const size_t batchSize = 64;
+	// The checks wait on the disk more than on the processor, so this
+	// many help even on a single core.
+	static const unsigned maxThreadCount = 8;
+
+private:
+	// One flag per file.
+	vector<char> checkExistence(const vector<wstring>& files) const;
+
+	ExistenceCheck m_exists;
+	size_t m_maxEntries;
+	unsigned m_threadCount;
+	Result m_result;
+};
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "ShortcutsDisconnector.h"
+#include "StringListUtils.h"
 
 
 ShortcutsDisconnector::ShortcutsDisconnector()
@@ -179,39 +180,21 @@ void ShortcutsDisconnector::performOperations()
 
 vector<wstring> ShortcutsDisconnector::findShortcuts()
 {
-	vector<wstring> registeredFiles, desktopFiles;
-	try {
-		registeredFiles = findConnectedShortcutsInRegistry();
-	}
-	catch (RegistryException& exc) {
-		// Silently ignore a non-existing registry value.
-		if (exc.errorCode() != ERROR_FILE_NOT_FOUND)
-			throw;
-	}
-	desktopFiles = findConnectedShortcutsOnDesktop();
-	mergeLists(registeredFiles, desktopFiles);
+	vector<wstring> registeredFiles = findConnectedShortcutsInRegistry();
+	vector<wstring> desktopFiles = findConnectedShortcutsOnDesktop();
+	StringListUtils::mergeLists(registeredFiles, desktopFiles);
 	return registeredFiles;
 }
 
 
 
+// Filters the list like compacting would, but only in memory; writing
+// it back is left to compactConnectedShortcuts, off the UI thread.
 vector<wstring> ShortcutsDisconnector::findConnectedShortcutsInRegistry()
 {
-	vector<wstring> registeredFiles, existingFiles;
-	RegistryAccess ra;
-
-	ra.access(DEFAULT_REGISTRY_KEY);
-	registeredFiles = ra.readMultiString(CONNECTED_SHORTCUTS_REGISTRY_VALUE_NAME);
-	ra.close();
-
-	existingFiles.reserve(registeredFiles.size());
-	for (const wstring& file : registeredFiles)
-	{
-		if (PathFileExists(file.data()))
-			existingFiles.push_back(file);
-	}
-
-	return existingFiles;
+	unique_ptr<ConfigStore> pStore = Platform::openConfigStore(DEFAULT_REGISTRY_KEY);
+	ShortcutJournal journal(*pStore, CONNECTED_SHORTCUTS_REGISTRY_VALUE_NAME);
+	return ShortcutListCompactor().compact(journal.read());
 }
 
 
@@ -239,6 +222,9 @@ vector<wstring> ShortcutsDisconnector::findConnectedShortcutsInFolder(wstring di
 	if (dir.back() != L'\\')
 		dir.push_back(L'\\');
 
+	// One shell link object for all files; ones that can't be read
+	// aren't connected.
+	ConnectedShortcut csc;
 	vector<wstring> foundFiles;
 	WIN32_FIND_DATA hit;
 	HANDLE search = FindFirstFile((dir + L"*.lnk").data(), &hit);
@@ -248,7 +234,7 @@ vector<wstring> ShortcutsDisconnector::findConnectedShortcutsInFolder(wstring di
 	do
 	{
 		wstring filePath = dir + hit.cFileName;
-		if (ConnectedShortcut::isConnected(filePath))
+		if (csc.tryIsConnected(filePath).valueOr(false))
 			foundFiles.push_back(filePath);
 	} while (FindNextFile(search, &hit) != FALSE);
 	FindClose(search);
@@ -257,34 +243,32 @@ vector<wstring> ShortcutsDisconnector::findConnectedShortcutsInFolder(wstring di
 
 
 
-// Copies donor's items into acceptor, while avoiding duplicates.
-void ShortcutsDisconnector::mergeLists(
-	vector<wstring>& acceptor, const vector<wstring>& donor)
+void ShortcutsDisconnector::registerConnectedShortcuts(const wstring& file)
 {
-	bool isInAcceptor;
-	for (const wstring& donatedFile : donor)
-	{
-		isInAcceptor = std::find<vector<wstring>::iterator, wstring>(
-			acceptor.begin(), acceptor.end(), donatedFile) != acceptor.end();
-		if (!isInAcceptor)
-			acceptor.push_back(donatedFile);
+	try {
+		if (!ConnectedShortcut::isConnected(file))
+			return;
+		unique_ptr<ConfigStore> pStore = Platform::openConfigStore(DEFAULT_REGISTRY_KEY);
+		ShortcutJournal(*pStore, CONNECTED_SHORTCUTS_REGISTRY_VALUE_NAME).add(file);
 	}
+	catch (std::runtime_error&) {}
 }
 
 
 
-void ShortcutsDisconnector::registerConnectedShortcuts(const wstring& file)
+// Only looks at the files if the journal or the list have grown enough.
+void ShortcutsDisconnector::compactConnectedShortcuts()
 {
 	try {
-		if (!ConnectedShortcut::isConnected(file))
+		unique_ptr<ConfigStore> pStore = Platform::openConfigStore(DEFAULT_REGISTRY_KEY);
+		ShortcutJournal journal(*pStore, CONNECTED_SHORTCUTS_REGISTRY_VALUE_NAME);
+		ShortcutListCompactor compactor;
+		if (journal.getJournalSize() < journalCompactionSize &&
+			journal.read().size() <= compactor.getMaxEntries())
 			return;
-		RegistryAccess ra;
-		ra.access(DEFAULT_REGISTRY_KEY);
-		ra.AppendToMultiString(CONNECTED_SHORTCUTS_REGISTRY_VALUE_NAME, file);
-		ra.close();
+		journal.compact([&compactor](const vector<wstring>& files) {
+			return compactor.compact(files);
+		});
 	}
 	catch (std::runtime_error&) {}
 }
-
-
-
@@ -1,8 +1,14 @@
 // ShortcutsDisconnector.h: Disconnects, deletes, and /finds/ connected shortcuts.
 // Uses Shell file operations to do the renaming as gracefully as possible.
 // Usually throws OleException on failure. Only throws RegistryException
-// when RegistryAccess does.
-// The registerConnectedShortcut function fails silently.
+// or ConfigStoreException when the registry can't be read. Shortcuts that
+// can't be read while finding them are skipped without throwing.
+// The registerConnectedShortcut function fails silently. It only adds to
+// the ShortcutJournal. Finding the shortcuts in the registry filters the
+// list with a ShortcutListCompactor, but doesn't write anything;
+// compactConnectedShortcuts writes the compacted list back. It doesn't
+// need OLE, is meant to run on a thread of its own, and also fails
+// silently.
 
 #pragma once
 
@@ -10,6 +16,8 @@
 #include "OleUtils.h"
 #include "RegistryAccess.h"
 #include "ConnectedShortcut.h"
+#include "ShortcutJournal.h"
+#include "ShortcutListCompactor.h"
 
 class ShortcutsDisconnector : public IFileOperationProgressSink
 {
@@ -66,6 +74,10 @@ public:
 	static vector<wstring> findConnectedShortcutsInFolder(wstring dir);
 
 	static void registerConnectedShortcuts(const wstring& file);
+	static void compactConnectedShortcuts();
+
+	// Journal entries that make compactConnectedShortcuts do its work.
+	static const size_t journalCompactionSize = 16;
 
 private:
 	ShortcutsDisconnector();
@@ -74,9 +86,6 @@ private:
 	bool declareRename(const wstring& filePath);
 	void performOperations();
 
-	static void mergeLists(
-		vector<wstring>& acceptor, const vector<wstring>& donor);
-
 	ULONG m_cRef;
 	UINT m_filesToBeRenamed;
 	IFileOperation* m_pRenameOperation;
@@ -0,0 +1,148 @@
+#include "stdafx.h"
+#include "SortedPathList.h"
+#include "StringListUtils.h"
+
+
+size_t SortedPathList::insert(const wstring& path)
+{
+	wstring key = StringListUtils::normalizePath(path);
+	if (!m_index.insert(key).second)
+		return npos;
+
+	const size_t index = lowerBound(key);
+	m_keys.insert(m_keys.begin() + index, std::move(key));
+	m_paths.insert(m_paths.begin() + index, path);
+	++m_lengthCounts[path.size()];
+	return index;
+}
+
+
+
+size_t SortedPathList::insert(const vector<wstring>& paths)
+{
+	vector<std::pair<wstring, wstring>> newEntries;
+	for (const wstring& path : paths)
+	{
+		wstring key = StringListUtils::normalizePath(path);
+		if (m_index.insert(key).second)
+		{
+			++m_lengthCounts[path.size()];
+			newEntries.push_back(std::make_pair(std::move(key), path));
+		}
+	}
+	if (newEntries.empty())
+		return 0;
+	std::sort(newEntries.begin(), newEntries.end());
+
+	vector<wstring> keys, mergedPaths;
+	keys.reserve(m_keys.size() + newEntries.size());
+	mergedPaths.reserve(keys.capacity());
+	size_t i = 0;
+	for (auto& entry : newEntries)
+	{
+		while (i < m_keys.size() && m_keys[i] < entry.first)
+		{
+			keys.push_back(std::move(m_keys[i]));
+			mergedPaths.push_back(std::move(m_paths[i]));
+			++i;
+		}
+		keys.push_back(std::move(entry.first));
+		mergedPaths.push_back(std::move(entry.second));
+	}
+	for (; i < m_keys.size(); ++i)
+	{
+		keys.push_back(std::move(m_keys[i]));
+		mergedPaths.push_back(std::move(m_paths[i]));
+	}
+	m_keys.swap(keys);
+	m_paths.swap(mergedPaths);
+	return newEntries.size();
+}
+
+
+
+size_t SortedPathList::find(const wstring& path) const
+{
+	const wstring key = StringListUtils::normalizePath(path);
+	if (m_index.count(key) == 0)
+		return npos;
+	return lowerBound(key);
+}
+
+
+
+bool SortedPathList::contains(const wstring& path) const
+{
+	return m_index.count(StringListUtils::normalizePath(path)) == 1;
+}
+
+
+
+bool SortedPathList::erase(const wstring& path)
+{
+	const size_t index = find(path);
+	if (index == npos)
+		return false;
+	return eraseAt(vector<size_t>(1, index)) == 1;
+}
+
+
+
+// Marks first, then moves every survivor once.
+size_t SortedPathList::eraseAt(const vector<size_t>& indices)
+{
+	vector<bool> isErased(m_paths.size(), false);
+	for (size_t index : indices)
+	{
+		if (index < isErased.size())
+			isErased[index] = true;
+	}
+
+	size_t keptCount = 0;
+	for (size_t i = 0; i < m_paths.size(); ++i)
+	{
+		if (isErased[i])
+		{
+			m_index.erase(m_keys[i]);
+			auto pCount = m_lengthCounts.find(m_paths[i].size());
+			if (--pCount->second == 0)
+				m_lengthCounts.erase(pCount);
+		}
+		else {
+			if (keptCount != i)
+			{
+				m_paths[keptCount].swap(m_paths[i]);
+				m_keys[keptCount].swap(m_keys[i]);
+			}
+			++keptCount;
+		}
+	}
+	const size_t erasedCount = m_paths.size() - keptCount;
+	m_paths.resize(keptCount);
+	m_keys.resize(keptCount);
+	return erasedCount;
+}
+
+
+
+void SortedPathList::clear()
+{
+	m_paths.clear();
+	m_keys.clear();
+	m_index.clear();
+	m_lengthCounts.clear();
+}
+
+
+
+size_t SortedPathList::getMaxLength() const
+{
+	return m_lengthCounts.empty() ? 0 : m_lengthCounts.rbegin()->first;
+}
+
+
+
+size_t SortedPathList::lowerBound(const wstring& key) const
+{
+	return std::lower_bound(m_keys.begin(), m_keys.end(), key) - m_keys.begin();
+}
@@ -0,0 +1,60 @@
+// SortedPathList.h : The paths in the uninstaller's list of Connected
+// Shortcuts, sorted without regard to case, as a sorted listbox would
+// show them. Paths that normalize the same (see
+// StringListUtils::normalizePath) are only in it once; a hash index on
+// the normalized paths tells without a scan, binary search finds where
+// they are. Also keeps track of the longest path, for the listbox's
+// horizontal extent.
+// Nothing here throws (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include <unordered_set>
+
+using std::wstring;
+using std::vector;
+
+class SortedPathList
+{
+public:
+	static const size_t npos = (size_t) -1;
+
+	SortedPathList() {}
+
+	// Returns the index the path went to, or npos if it's there already.
+	size_t insert(const wstring& path);
+	// Sorts the new paths and merges them in, instead of moving the rest
+	// of the list for each one. Returns the number inserted.
+	size_t insert(const vector<wstring>& paths);
+	// Returns npos if the path isn't there.
+	size_t find(const wstring& path) const;
+	bool contains(const wstring& path) const;
+
+	bool erase(const wstring& path);
+	// Erases all of them in one pass. Indices may come in any order;
+	// those out of range are ignored. Returns the number erased.
+	size_t eraseAt(const vector<size_t>& indices);
+	void clear();
+
+	inline const wstring& at(size_t index) const { return m_paths[index]; }
+	inline size_t size() const { return m_paths.size(); }
+	inline bool empty() const { return m_paths.empty(); }
+	inline const vector<wstring>& getPaths() const { return m_paths; }
+	// In characters. Zero if the list is empty.
+	size_t getMaxLength() const;
+
+private:
+	SortedPathList(const SortedPathList&);
+	SortedPathList& operator=(const SortedPathList&);
+
+	// Where a path with this key is or would be.
+	size_t lowerBound(const wstring& key) const;
+
+	// Parallel vectors; m_keys holds the normalized paths, sorted.
+	vector<wstring> m_paths;
+	vector<wstring> m_keys;
+	std::unordered_set<wstring> m_index;
+	// How many paths there are of each length.
+	std::map<size_t, size_t> m_lengthCounts;
+};
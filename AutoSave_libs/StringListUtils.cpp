@@ -0,0 +1,80 @@
+#include "stdafx.h"
+#include "StringListUtils.h"
+#include <unordered_set>
+
+
+vector<wstring> StringListUtils::multiStringToVector(const wchar_t* pString)
+{
+	vector<wstring> strings;
+	while (*pString != L'\0')
+	{
+		strings.push_back(pString);
+		pString += wcslen(pString) + 1;
+	}
+	return strings;
+}
+
+
+
+wstring StringListUtils::vectorToMultiString(const vector<wstring>& strings)
+{
+	wstring result;
+	for (const wstring& string : strings)
+	{
+		result.append(string);
+		result.push_back(L'\0');
+	}
+	return result;
+}
+
+
+
+void StringListUtils::mergeLists(
+	vector<wstring>& acceptor, const vector<wstring>& donor)
+{
+	bool isInAcceptor;
+	for (const wstring& donatedFile : donor)
+	{
+		isInAcceptor = std::find(
+			acceptor.begin(), acceptor.end(), donatedFile) != acceptor.end();
+		if (!isInAcceptor)
+			acceptor.push_back(donatedFile);
+	}
+}
+
+
+
+wstring StringListUtils::normalizePath(const wstring& path)
+{
+	wstring result;
+	result.reserve(path.size());
+	for (wchar_t c : path)
+	{
+		if (c == L'/')
+			c = L'\\';
+		if (c == L'\\' && result.size() > 1 && result.back() == L'\\')
+			continue;
+		result.push_back((wchar_t) towlower(c));
+	}
+	return result;
+}
+
+
+
+size_t StringListUtils::removeDuplicatePaths(vector<wstring>& paths)
+{
+	std::unordered_set<wstring> seen;
+	vector<bool> isKept(paths.size());
+	for (size_t i = paths.size(); i > 0; --i)
+		isKept[i - 1] = seen.insert(normalizePath(paths[i - 1])).second;
+
+	size_t keptCount = 0;
+	for (size_t i = 0; i < paths.size(); ++i)
+	{
+		if (isKept[i])
+			paths[keptCount++].swap(paths[i]);
+	}
+	const size_t removedCount = paths.size() - keptCount;
+	paths.resize(keptCount);
+	return removedCount;
+}
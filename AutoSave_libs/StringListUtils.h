@@ -0,0 +1,30 @@
+// StringListUtils.h : Functions on lists of strings, as they are stored
+// in the registry and passed around by ShortcutsDisconnector.
+// Functions defined here never throw (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+
+using std::wstring;
+using std::vector;
+
+namespace StringListUtils
+{
+	// Converts between vectors and REG_MULTI_SZ strings, i.e.
+	// null-separated strings ending with two null characters.
+	// Empty strings can't be represented and end the list.
+	vector<wstring> multiStringToVector(const wchar_t* pString);
+	wstring vectorToMultiString(const vector<wstring>& strings);
+
+	// Copies donor's items into acceptor, while avoiding duplicates.
+	void mergeLists(vector<wstring>& acceptor, const vector<wstring>& donor);
+
+	// Spells paths to the same file the same, as far as that can be told
+	// without asking the file system: lower case, with backslashes, and
+	// without doubled ones (except in front of a UNC path).
+	wstring normalizePath(const wstring& path);
+	// Keeps the last of each set of paths that normalize the same, and
+	// the order of what it keeps. Returns the number of paths removed.
+	size_t removeDuplicatePaths(vector<wstring>& paths);
+}
@@ -7,10 +7,10 @@ TemporaryShortcutFile::TemporaryShortcutFile()
 	const size_t bufferSize = throwIfZero<OleException>(
 		GetTempPath(0, NULL));
 
-	std::auto_ptr<TCHAR> buffer(new TCHAR[bufferSize]);
+	std::vector<TCHAR> buffer(bufferSize);
 	throwIfZero<OleException>(
-		GetTempPath((DWORD)bufferSize, buffer.get()));
-	setSaveDirectory(buffer.get());
+		GetTempPath((DWORD)bufferSize, buffer.data()));
+	setSaveDirectory(buffer.data());
 }
 
 
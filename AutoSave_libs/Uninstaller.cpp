@@ -114,6 +114,13 @@ INT_PTR CALLBACK Uninstaller::handleMessages(
 {
 	Uninstaller* pThis = NULL;
 
+	// Comes before WM_INITDIALOG, so there is no pThis yet.
+	if (uMsg == WM_MEASUREITEM && wParam == IDC_UNINSTALL_FILELIST)
+	{
+		UninstallerShortcutsListbox::measureItem(hwnd, (LPMEASUREITEMSTRUCT) lParam);
+		return TRUE;
+	}
+
 	if (uMsg == WM_INITDIALOG)
 	{
 		const auto pPsp = (PROPSHEETPAGE*)lParam;
@@ -233,6 +240,11 @@ INT_PTR Uninstaller::handleShortcutsPage(HWND hwnd, UINT uMsg, WPARAM wParam, LP
 		default: return FALSE;
 		}
 	}
+	else if (uMsg == WM_DRAWITEM && wParam == IDC_UNINSTALL_FILELIST)
+	{
+		m_usListbox.drawItem(*(LPDRAWITEMSTRUCT) lParam);
+		return TRUE;
+	}
 	else if (uMsg == m_usListbox.LB_REFRESH)
 	{
 		refreshShortcutsPage(hwnd);
@@ -355,14 +367,14 @@ void Uninstaller::removeRegistryEntries()
 
 void Uninstaller::removeConnectedShortcuts()
 {
-	ShortcutsDisconnector::removeShortcuts(m_usListbox.files);
+	ShortcutsDisconnector::removeShortcuts(m_usListbox.getFiles());
 }
 
 
 
 void Uninstaller::convertConnectedShortcuts()
 {
-	ShortcutsDisconnector::disconnectShortcuts(m_usListbox.files);
+	ShortcutsDisconnector::disconnectShortcuts(m_usListbox.getFiles());
 }
 
 
@@ -431,7 +443,7 @@ wstring Uninstaller::getErrorPageText()
 
 void Uninstaller::refreshShortcutsPage(HWND hwnd) const
 {
-	BOOL st = !m_usListbox.files.empty();
+	BOOL st = !m_usListbox.getFiles().empty();
 	EnableWindow(GetDlgItem(hwnd, IDC_UNINSTALL_CONVERT), st);
 	EnableWindow(GetDlgItem(hwnd, IDC_UNINSTALL_DELETE), st);
 }
@@ -114,101 +114,131 @@ LRESULT UninstallerShortcutsListbox::listboxSubclassProc(HWND hwnd, UINT uMsg,
 
 
 
+// Into an empty list, all rows go in at once. Otherwise, they go in
+// one at a time, so that the selection stays where it is.
 bool UninstallerShortcutsListbox::append(const vector<wstring>& newFiles)
 {
-	size_t oldSize = m_files.size();
+	vector<wstring> connectedFiles;
 	for (const wstring& file : newFiles)
 	{
-		if (ConnectedShortcut::isConnected(file) && !contains(file))
+		if (!m_files.contains(file) && ConnectedShortcut::isConnected(file))
 		{
-			m_files.push_back(file);
+			connectedFiles.push_back(file);
 		}
 		else if (PathIsDirectory(file.data()) != FALSE)
 		{
-			appendDirectory(file);
+			vector<wstring> folderFiles =
+				ShortcutsDisconnector::findConnectedShortcutsInFolder(file);
+			connectedFiles.insert(connectedFiles.end(),
+				folderFiles.begin(), folderFiles.end());
 		}
 	}
-	bool hasGrown = m_files.size() - oldSize != 0;
+
+	size_t addedCount = 0;
+	if (m_files.empty())
+	{
+		addedCount = m_files.insert(connectedFiles);
+		SendMessage(m_listbox, LB_SETCOUNT, m_files.size(), 0);
+	}
+	else {
+		SendMessage(m_listbox, WM_SETREDRAW, FALSE, 0);
+		for (const wstring& file : connectedFiles)
+		{
+			size_t index = m_files.insert(file);
+			if (index != SortedPathList::npos)
+			{
+				insertRow(index);
+				++addedCount;
+			}
+		}
+		SendMessage(m_listbox, WM_SETREDRAW, TRUE, 0);
+	}
+
+	bool hasGrown = addedCount != 0;
 	if (hasGrown)
-		updateListbox();
+	{
+		updateExtent();
+		RedrawWindow(m_listbox, NULL, NULL,
+			RDW_ERASE | RDW_FRAME | RDW_INVALIDATE | RDW_ALLCHILDREN);
+	}
 	return hasGrown;
 }
 
 
 
-void UninstallerShortcutsListbox::appendDirectory(const wstring& dir)
+// Gets all selected rows in one message and erases them in one pass.
+// Nothing stays selected, so the count can simply be set again.
+UINT UninstallerShortcutsListbox::eraseSelected()
 {
-	vector<wstring> files =
-		ShortcutsDisconnector::findConnectedShortcutsInFolder(dir);
-	for (const wstring& file : files)
+	int selectedCount = ListBox_GetSelCount(m_listbox);
+	if (selectedCount <= 0)
+		return 0;
+	vector<int> selectedRows(selectedCount);
+	selectedCount = ListBox_GetSelItems(m_listbox, selectedCount, selectedRows.data());
+	if (selectedCount <= 0)
+		return 0;
+	selectedRows.resize(selectedCount);
+
+	size_t erasedCount = m_files.eraseAt(
+		vector<size_t>(selectedRows.begin(), selectedRows.end()));
+	if (erasedCount > 0)
 	{
-		if (!contains(file))
-			m_files.push_back(file);
+		int topIndex = ListBox_GetTopIndex(m_listbox);
+		SendMessage(m_listbox, LB_SETCOUNT, m_files.size(), 0);
+		ListBox_SetTopIndex(m_listbox, topIndex);
+		updateExtent();
 	}
+	return (UINT) erasedCount;
 }
 
 
 
-UINT UninstallerShortcutsListbox::eraseSelected()
+void UninstallerShortcutsListbox::insertRow(size_t index)
 {
-	UINT itemCount = ListBox_GetCount(m_listbox);
-	TCHAR buffer[MAX_PATH];
-	for (UINT i = 0; i < itemCount; ++i)
-	{
-		if (ListBox_GetSel(m_listbox, i) > 0)
-		{
-			ListBox_GetText(m_listbox, i, buffer);
-			erase(buffer);
-		}
-	}
-	UINT diff = itemCount - (UINT) m_files.size();
-	if (diff > 0)
-		updateListbox();
-	return diff;
+	// A no-data listbox ignores lParam.
+	SendMessage(m_listbox, LB_INSERTSTRING, index, 0);
 }
 
 
 
-bool UninstallerShortcutsListbox::contains(const wstring& file) const
+void UninstallerShortcutsListbox::updateExtent()
 {
-	for (const wstring& f : m_files)
-	{
-		if (_tcsicmp(f.data(), file.data()) == 0)
-			return true;
-	}
-	return false;
+	size_t maxLength = m_files.getMaxLength();
+	if (maxLength == m_extentLength)
+		return;
+	m_extentLength = maxLength;
+	ListBox_SetHorizontalExtent(m_listbox, getTextWidth(m_dialogbox, maxLength));
 }
 
 
 
-void UninstallerShortcutsListbox::erase(const wstring& file)
+void UninstallerShortcutsListbox::drawItem(const DRAWITEMSTRUCT& dis) const
 {
-	for (auto pItem = m_files.begin(); pItem < m_files.end(); ++pItem)
+	if (dis.itemID < m_files.size())
 	{
-		if (_tcsicmp(pItem->data(), file.data()) == 0)
-		{
-			m_files.erase(pItem);
-			return;
-		}
+		const bool isSelected = (dis.itemState & ODS_SELECTED) != 0;
+		SetBkColor(dis.hDC, GetSysColor(
+			isSelected ? COLOR_HIGHLIGHT : COLOR_WINDOW));
+		SetTextColor(dis.hDC, GetSysColor(
+			isSelected ? COLOR_HIGHLIGHTTEXT : COLOR_WINDOWTEXT));
+		const wstring& file = m_files.at(dis.itemID);
+		ExtTextOut(dis.hDC, dis.rcItem.left + 2, dis.rcItem.top,
+			ETO_OPAQUE | ETO_CLIPPED, &dis.rcItem,
+			file.data(), (UINT) file.size(), NULL);
 	}
+	if ((dis.itemState & ODS_FOCUS) != 0)
+		DrawFocusRect(dis.hDC, &dis.rcItem);
 }
 
 
 
-void UninstallerShortcutsListbox::updateListbox() const
+// One line of text is eight dialog units high.
+void UninstallerShortcutsListbox::measureItem(
+	HWND hwndDialogbox, MEASUREITEMSTRUCT* pmis)
 {
-	SendMessage(m_listbox, WM_SETREDRAW, FALSE, 0);
-	ListBox_ResetContent(m_listbox);
-	size_t maxWidth = 0;
-	for (const wstring& file : m_files)
-	{
-		ListBox_AddString(m_listbox, file.data());
-		maxWidth = __max(maxWidth, file.size());
-	}
-	ListBox_SetHorizontalExtent(m_listbox, getTextWidth(m_dialogbox, maxWidth));
-	SendMessage(m_listbox, WM_SETREDRAW, TRUE, 0);
-	RedrawWindow(m_listbox, NULL, NULL,
-		RDW_ERASE | RDW_FRAME | RDW_INVALIDATE | RDW_ALLCHILDREN);
+	RECT extent = { 0, 0, 1, 8 };
+	MapDialogRect(hwndDialogbox, &extent);
+	pmis->itemHeight = extent.bottom;
 }
 
 
@@ -1,5 +1,9 @@
 // UninstallerShortcutsListbox.h : Manages the listbox on the
 // Connected Shortcuts page of the Uninstall wizard.
+// The listbox is a no-data one (LBS_NODATA): it only knows how many items
+// there are and which are selected, and the dialog forwards WM_DRAWITEM
+// and WM_MEASUREITEM here. The paths live in a SortedPathList, so
+// adding and erasing rows doesn't refill the listbox.
 // Instead of throwing messages, this class posts
 // UninstallerShortcutsListbox::LB_EXCEPTIONTHROWN messages to the
 // dialog and sets its lastException member accordingly.
@@ -12,6 +16,7 @@
 #include "OleUtils.h"
 #include "ShortcutsDisconnector.h"
 #include "UninstallerShortcutsListTooltip.h"
+#include "SortedPathList.h"
 
 using std::vector;
 using std::wstring;
@@ -44,31 +49,33 @@ public:
 		LB_EXCEPTIONTHROWN
 	};
 
-	UninstallerShortcutsListbox() : m_cRef(1), m_listbox(0) {}
+	UninstallerShortcutsListbox() : m_cRef(1), m_listbox(0), m_extentLength(0) {}
 	~UninstallerShortcutsListbox() { RevokeDragDrop(m_listbox); }
 
 	// If anything inside this object throws an exception,
 	// the lastException member will be set and a message will be posted
 	// to hwndParent.
 	void connect(HWND hwndParent, HWND hwndListbox);
-	const vector<wstring>& files = m_files;
+	inline const vector<wstring>& getFiles() const { return m_files.getPaths(); }
 	const HWND& listbox = m_listbox;
 	const AutoSaveException& lastException = m_lastException;
 
+	// To be called by the dialog procedure.
+	void drawItem(const DRAWITEMSTRUCT& dis) const;
+	static void measureItem(HWND hwndDialogbox, MEASUREITEMSTRUCT* pmis);
+
 protected:
 	static LRESULT CALLBACK listboxSubclassProc(HWND hwnd, UINT uMsg,
 		WPARAM wParam, LPARAM lParam, UINT_PTR scid, DWORD_PTR refData);
 
 	// Can only throw if ConnectedShortcut::isConnected throws.
 	bool append(const vector<wstring>& newFiles);
-	void appendDirectory(const wstring& dir);
 
 	// These functions don't throw.
 	UINT eraseSelected();
-	bool contains(const wstring& file) const;
-	void erase(const wstring& file);
+	void insertRow(size_t index);
 
-	void updateListbox() const;
+	void updateExtent();
 	static int getTextWidth(HWND hwndDialogbox, const wstring& text);
 	static int getTextWidth(HWND hwndDialogbox, size_t cchText);
 
@@ -77,7 +84,8 @@ private:
 	HWND m_dialogbox;
 	HWND m_listbox;
 	UninstallerShortcutsListTooltip m_tooltip;
-	vector<wstring> m_files;
+	SortedPathList m_files;
+	size_t m_extentLength; // In characters.
 	AutoSaveException m_lastException;
 	LPCTSTR m_emptyText = L"Couldn't find any connected shortcuts.\n"
 		L"Please continue by clicking Next.";
@@ -0,0 +1,975 @@
+// Win32Platform.cpp : Implements Platform.h with the Windows API.
+// Only part of the Visual Studio build.
+
+#include "stdafx.h"
+#include "Platform.h"
+#include "RegistryAccess.h"
+#include "OleUtils.h"
+#include "AutoSaveException.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+
+namespace {
+	class Win32Clock : public Clock
+	{
+	public:
+		virtual ULONGLONG getTickCount() const { return GetTickCount64(); }
+	};
+
+
+
+	// Room for most captions. Each thread has its own, so that reading
+	// a caption doesn't allocate more than the string it returns.
+	const int captionBufferSize = 512;
+	__declspec(thread) wchar_t t_caption[captionBufferSize];
+
+
+
+	class Win32WindowEnumerator : public WindowEnumerator
+	{
+	public:
+		virtual void enumWindows(const std::function<bool(HWND)>& callback) const
+		{
+			EnumWindows(enumProc, (LPARAM) &callback);
+		}
+
+		// Other programs' captions come from the system's copy, which
+		// InternalGetWindowText reads without a message, so that a hung
+		// program can't hold up the caller. Only a visible window without
+		// one is asked with WM_GETTEXT, in case its program keeps the
+		// caption itself, and not for longer than captionTimeout. Our own
+		// windows, e.g. edit controls, are asked directly.
+		virtual wstring getWindowText(HWND hwnd) const
+		{
+			if (getWindowProcessId(hwnd) == GetCurrentProcessId())
+				return getOwnWindowText(hwnd);
+			if (IsHungAppWindow(hwnd))
+			{
+				addUnresponsive(hwnd);
+				return L"";
+			}
+
+			int length = InternalGetWindowText(hwnd, t_caption, captionBufferSize);
+			if (length >= captionBufferSize - 1)
+				return getLongCaption(hwnd);
+			if (length > 0 || !IsWindowVisible(hwnd))
+				return wstring(t_caption, length);
+
+			DWORD_PTR result = 0;
+			if (!SendMessageTimeout(hwnd, WM_GETTEXT, captionBufferSize, (LPARAM) t_caption,
+				SMTO_NORMAL | SMTO_ABORTIFHUNG | SMTO_ERRORONEXIT, captionTimeout, &result))
+			{
+				if (GetLastError() == ERROR_TIMEOUT)
+					addUnresponsive(hwnd);
+				return L"";
+			}
+			return wstring(t_caption, std::min<size_t>(result, captionBufferSize - 1));
+		}
+
+		virtual vector<HWND> takeUnresponsiveWindows() const
+		{
+			vector<HWND> windows;
+			std::lock_guard<std::mutex> guard(m_unresponsiveLock);
+			windows.swap(m_unresponsive);
+			return windows;
+		}
+
+		virtual DWORD getWindowProcessId(HWND hwnd) const
+		{
+			DWORD processId = 0;
+			GetWindowThreadProcessId(hwnd, &processId);
+			return processId;
+		}
+
+		virtual wstring getWindowExecutable(HWND hwnd) const
+		{
+			HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION,
+				FALSE, getWindowProcessId(hwnd));
+			if (hProcess == NULL)
+				return L"";
+			TCHAR buffer[MAX_PATH];
+			DWORD length = MAX_PATH;
+			BOOL isSuccess = QueryFullProcessImageName(hProcess, 0, buffer, &length);
+			CloseHandle(hProcess);
+			return isSuccess ? PathFindFileName(buffer) : L"";
+		}
+
+		virtual bool isOwnedWindow(HWND hwnd) const
+		{
+			return GetParent(hwnd) != 0;
+		}
+
+		virtual bool isWindowVisible(HWND hwnd) const
+		{
+			return IsWindowVisible(hwnd) != FALSE;
+		}
+
+		virtual bool isWindowMinimized(HWND hwnd) const
+		{
+			return IsIconic(hwnd) != FALSE;
+		}
+
+		virtual HWND getForegroundWindow() const
+		{
+			return GetForegroundWindow();
+		}
+
+		// WM_NULL does nothing; only whether it gets through counts.
+		virtual bool isWindowResponding(HWND hwnd, DWORD timeout) const
+		{
+			if (IsHungAppWindow(hwnd))
+				return false;
+			DWORD_PTR result = 0;
+			return SendMessageTimeout(hwnd, WM_NULL, 0, 0,
+				SMTO_NORMAL | SMTO_ABORTIFHUNG | SMTO_ERRORONEXIT, timeout, &result) != 0;
+		}
+
+		virtual ULONGLONG getProcessCpuTime(HWND hwnd) const
+		{
+			HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION,
+				FALSE, getWindowProcessId(hwnd));
+			if (hProcess == NULL)
+				return 0;
+			FILETIME creation, exit, kernel, user;
+			BOOL isSuccess = GetProcessTimes(hProcess, &creation, &exit, &kernel, &user);
+			CloseHandle(hProcess);
+			if (!isSuccess)
+				return 0;
+			// In units of 100 nanoseconds.
+			const ULONGLONG kernelTime = ((ULONGLONG) kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+			const ULONGLONG userTime = ((ULONGLONG) user.dwHighDateTime << 32) | user.dwLowDateTime;
+			return (kernelTime + userTime) / 10000;
+		}
+
+	private:
+		static BOOL CALLBACK enumProc(HWND hwnd, LPARAM lParam)
+		{
+			auto pCallback = (const std::function<bool(HWND)>*) lParam;
+			return (*pCallback)(hwnd) ? TRUE : FALSE;
+		}
+
+		// The text of one of our windows, however long.
+		static wstring getOwnWindowText(HWND hwnd)
+		{
+			const int length = GetWindowText(hwnd, t_caption, captionBufferSize);
+			if (length < captionBufferSize - 1)
+				return wstring(t_caption, length);
+			vector<wchar_t> buffer(GetWindowTextLength(hwnd) + 1);
+			return wstring(buffer.data(),
+				GetWindowText(hwnd, buffer.data(), (int) buffer.size()));
+		}
+
+		static wstring getLongCaption(HWND hwnd)
+		{
+			vector<wchar_t> buffer(captionBufferSize);
+			int length = 0;
+			do {
+				buffer.resize(buffer.size() * 2);
+				length = InternalGetWindowText(hwnd, buffer.data(), (int) buffer.size());
+			} while (length >= (int) buffer.size() - 1 && buffer.size() < maxCaptionLength);
+			return wstring(buffer.data(), length);
+		}
+
+		void addUnresponsive(HWND hwnd) const
+		{
+			std::lock_guard<std::mutex> guard(m_unresponsiveLock);
+			if (m_unresponsive.size() < maxUnresponsive &&
+				std::find(m_unresponsive.begin(), m_unresponsive.end(), hwnd) ==
+				m_unresponsive.end())
+			{
+				m_unresponsive.push_back(hwnd);
+			}
+		}
+
+		// In milliseconds.
+		static const UINT captionTimeout = 100;
+		static const size_t maxCaptionLength = 64 * 1024;
+		// Until someone takes them; enough for every hung program at once.
+		static const size_t maxUnresponsive = 64;
+
+		mutable std::mutex m_unresponsiveLock;
+		mutable vector<HWND> m_unresponsive;
+	};
+
+
+
+	class Win32InputSink : public InputSink
+	{
+	public:
+		// Applications that need their input spaced out, like Adobe
+		// Illustrator, get it one event at a time from KeyMacro.
+		virtual UINT send(const vector<KeyEvent>& events)
+		{
+			if (events.empty())
+				return 0;
+			// Reused, so that sending doesn't allocate.
+			m_inputs.resize(events.size());
+			for (size_t i = 0; i < events.size(); ++i)
+			{
+				INPUT& input = m_inputs[i];
+				ZeroMemory(&input, sizeof(INPUT));
+				input.type = INPUT_KEYBOARD;
+				input.ki.wVk = events[i].key;
+				input.ki.dwFlags = events[i].isKeyUp ? KEYEVENTF_KEYUP : 0;
+			}
+			return SendInput((UINT) m_inputs.size(), m_inputs.data(), sizeof(INPUT));
+		}
+
+		virtual void wait(DWORD milliseconds)
+		{
+			Sleep(milliseconds);
+		}
+
+		virtual bool isAnyKeyPressed() const
+		{
+			BYTE lastKeyOfInterest = VK_F24;
+			for (BYTE key = 0; key <= lastKeyOfInterest; ++key)
+			{
+				if ((GetAsyncKeyState(key) & 0x8000) != 0)
+					return true;
+			}
+			return false;
+		}
+
+		virtual ULONGLONG getLastInputTime() const
+		{
+			LASTINPUTINFO info = { sizeof(LASTINPUTINFO) };
+			if (!GetLastInputInfo(&info))
+				return 0;
+			// The 32-bit tick count wraps after 49 days, so go back from now.
+			DWORD age = GetTickCount() - info.dwTime;
+			return GetTickCount64() - age;
+		}
+
+	private:
+		vector<INPUT> m_inputs;
+	};
+
+
+
+	class RegistryConfigStore : public ConfigStore
+	{
+	public:
+		RegistryConfigStore(const wstring& keyName) { m_ra.access(keyName); }
+
+		virtual int readInt(const wstring& valueName) const {
+			return m_ra.readInt(valueName.data());
+		}
+		virtual void writeInt(const wstring& valueName, int valueData) {
+			m_ra.writeInt(valueName.data(), valueData);
+		}
+
+		virtual wstring readString(const wstring& valueName) const {
+			return m_ra.readString(valueName.data());
+		}
+		virtual void writeString(const wstring& valueName, const wstring& valueData) {
+			m_ra.writeString(valueName.data(), valueData);
+		}
+
+		virtual vector<wstring> readMultiString(const wstring& valueName) const {
+			return m_ra.readMultiString(valueName.data());
+		}
+		virtual void writeMultiString(const wstring& valueName,
+			const vector<wstring>& strings) {
+			m_ra.writeMultiString(valueName.data(), strings);
+		}
+
+		virtual Expected<int> tryReadInt(const wstring& valueName) const {
+			return m_ra.tryReadInt(valueName.data());
+		}
+		virtual Expected<wstring> tryReadString(const wstring& valueName) const {
+			return m_ra.tryReadString(valueName.data());
+		}
+		virtual Expected<vector<wstring>> tryReadMultiString(
+			const wstring& valueName) const {
+			return m_ra.tryReadMultiString(valueName.data());
+		}
+
+		virtual vector<wstring> getValueNames() const {
+			return m_ra.readValueNames();
+		}
+		virtual void deleteValue(const wstring& valueName) {
+			m_ra.deleteValue(valueName.data());
+		}
+
+	private:
+		RegistryAccess m_ra;
+	};
+
+
+
+	class Win32ProcessHandle : public ProcessHandle
+	{
+	public:
+		// Takes ownership of hProcess.
+		Win32ProcessHandle(HANDLE hProcess)
+			: m_hProcess(hProcess), m_processId(GetProcessId(hProcess)) {}
+		virtual ~Win32ProcessHandle() { CloseHandle(m_hProcess); }
+
+		virtual unique_ptr<ProcessHandle> clone() const
+		{
+			// Explicitly duplicate handles for reference count purposes.
+			HANDLE hDuplicate = 0;
+			DuplicateHandle(
+				GetCurrentProcess(), m_hProcess,
+				GetCurrentProcess(), &hDuplicate,
+				0, FALSE, DUPLICATE_SAME_ACCESS);
+			return unique_ptr<ProcessHandle>(new Win32ProcessHandle(hDuplicate));
+		}
+
+		virtual DWORD getProcessId() const { return m_processId; }
+
+		virtual bool isAlive() const
+		{
+			DWORD exitCode = 0;
+			return GetExitCodeProcess(m_hProcess, &exitCode) != FALSE &&
+				exitCode == STILL_ACTIVE;
+		}
+
+		virtual DWORD waitForInputIdle(DWORD timeout) const
+		{
+			return WaitForInputIdle(m_hProcess, timeout);
+		}
+
+	private:
+		HANDLE m_hProcess;
+		DWORD m_processId;
+	};
+
+
+
+	// Out of context, so that the callback runs on the thread that
+	// started watching, from its message loop, and the process does
+	// nothing in between. The callback only gets the hook handle, so
+	// the one watcher that is watching is kept in a static.
+	class WinEventForegroundWatcher : public ForegroundWatcher
+	{
+	public:
+		WinEventForegroundWatcher() : m_hHook(NULL) {}
+		virtual ~WinEventForegroundWatcher() { stopWatching(); }
+
+		virtual bool startWatching(const Handler& handler)
+		{
+			stopWatching();
+			if (s_pWatching != NULL)
+				return false;
+			m_hHook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND,
+				EVENT_SYSTEM_FOREGROUND, NULL, onWinEvent, 0, 0,
+				WINEVENT_OUTOFCONTEXT);
+			if (m_hHook == NULL)
+				return false;
+			m_handler = handler;
+			s_pWatching = this;
+			return true;
+		}
+
+		virtual void stopWatching()
+		{
+			if (m_hHook == NULL)
+				return;
+			UnhookWinEvent(m_hHook);
+			m_hHook = NULL;
+			s_pWatching = NULL;
+		}
+
+	private:
+		static void CALLBACK onWinEvent(HWINEVENTHOOK hHook, DWORD event,
+			HWND hwnd, LONG idObject, LONG idChild, DWORD eventThread,
+			DWORD eventTime)
+		{
+			if (s_pWatching != NULL && s_pWatching->m_hHook == hHook &&
+				idObject == OBJID_WINDOW)
+				s_pWatching->m_handler(hwnd);
+		}
+
+		static WinEventForegroundWatcher* s_pWatching;
+		HWINEVENTHOOK m_hHook;
+		Handler m_handler;
+	};
+
+	WinEventForegroundWatcher* WinEventForegroundWatcher::s_pWatching = NULL;
+
+
+
+	// Watches the directories rather than the files, because many
+	// applications save by writing a new file and renaming it.
+	// Each directory has one overlapped ReadDirectoryChangesW pending,
+	// whose results are collected without waiting.
+	class Win32FileWatcher : public FileWatcher
+	{
+	public:
+		virtual ~Win32FileWatcher() { unwatchAll(); }
+
+		virtual bool watch(const wstring& path)
+		{
+			size_t separator = path.find_last_of(L"\\/");
+			if (separator == wstring::npos)
+				return false;
+			wstring directoryPath = path.substr(0, separator);
+			wstring fileName = path.substr(separator + 1);
+
+			Directory* pDirectory = findDirectory(directoryPath);
+			if (pDirectory == NULL)
+			{
+				pDirectory = openDirectory(directoryPath);
+				if (pDirectory == NULL)
+					return false;
+			}
+			pDirectory->files.push_back({ fileName, path });
+			return true;
+		}
+
+		virtual void unwatchAll()
+		{
+			for (auto& pDirectory : m_directories)
+			{
+				DWORD bytes;
+				CancelIoEx(pDirectory->hDirectory, &pDirectory->overlapped);
+				GetOverlappedResult(pDirectory->hDirectory,
+					&pDirectory->overlapped, &bytes, TRUE);
+				CloseHandle(pDirectory->overlapped.hEvent);
+				CloseHandle(pDirectory->hDirectory);
+			}
+			m_directories.clear();
+		}
+
+		virtual vector<wstring> takeChanges()
+		{
+			vector<wstring> changes;
+			for (auto& pDirectory : m_directories)
+			{
+				DWORD bytes = 0;
+				if (!GetOverlappedResult(pDirectory->hDirectory,
+					&pDirectory->overlapped, &bytes, FALSE))
+				{
+					continue; // ERROR_IO_INCOMPLETE, or the directory is gone.
+				}
+				collectChanges(*pDirectory, bytes, &changes);
+				requestChanges(*pDirectory);
+			}
+			return changes;
+		}
+
+		virtual FileStamp getStamp(const wstring& path) const
+		{
+			FileStamp stamp = { false, 0, 0 };
+			WIN32_FILE_ATTRIBUTE_DATA data;
+			if (GetFileAttributesEx(path.data(), GetFileExInfoStandard, &data) &&
+				(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+			{
+				stamp.exists = true;
+				stamp.size = ((ULONGLONG) data.nFileSizeHigh << 32) |
+					data.nFileSizeLow;
+				stamp.modificationTime =
+					((ULONGLONG) data.ftLastWriteTime.dwHighDateTime << 32) |
+					data.ftLastWriteTime.dwLowDateTime;
+			}
+			return stamp;
+		}
+
+	private:
+		struct WatchedFile
+		{
+			wstring name;
+			wstring path;
+		};
+
+		struct Directory
+		{
+			wstring path;
+			HANDLE hDirectory;
+			OVERLAPPED overlapped;
+			DWORD buffer[4096]; // DWORD-aligned, as required.
+			vector<WatchedFile> files;
+		};
+
+		Directory* findDirectory(const wstring& directoryPath)
+		{
+			for (auto& pDirectory : m_directories)
+			{
+				if (lstrcmpi(pDirectory->path.data(), directoryPath.data()) == 0)
+					return pDirectory.get();
+			}
+			return NULL;
+		}
+
+		Directory* openDirectory(const wstring& directoryPath)
+		{
+			HANDLE hDirectory = CreateFile(directoryPath.data(),
+				FILE_LIST_DIRECTORY,
+				FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING,
+				FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+			if (hDirectory == INVALID_HANDLE_VALUE)
+				return NULL;
+
+			unique_ptr<Directory> pDirectory(new Directory());
+			pDirectory->path = directoryPath;
+			pDirectory->hDirectory = hDirectory;
+			pDirectory->overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+			if (!requestChanges(*pDirectory))
+			{
+				CloseHandle(pDirectory->overlapped.hEvent);
+				CloseHandle(hDirectory);
+				return NULL;
+			}
+			m_directories.push_back(std::move(pDirectory));
+			return m_directories.back().get();
+		}
+
+		static bool requestChanges(Directory& directory)
+		{
+			ResetEvent(directory.overlapped.hEvent);
+			return ReadDirectoryChangesW(directory.hDirectory,
+				directory.buffer, sizeof(directory.buffer), FALSE,
+				FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE |
+				FILE_NOTIFY_CHANGE_LAST_WRITE,
+				NULL, &directory.overlapped, NULL) != FALSE;
+		}
+
+		// If the buffer overflowed, every file might have changed.
+		static void collectChanges(const Directory& directory, DWORD bytes,
+			vector<wstring>* pChanges)
+		{
+			for (const WatchedFile& file : directory.files)
+			{
+				bool isChanged = (bytes == 0);
+				auto pInfo = (const BYTE*) directory.buffer;
+				while (!isChanged && bytes != 0)
+				{
+					auto pNotify = (const FILE_NOTIFY_INFORMATION*) pInfo;
+					wstring name(pNotify->FileName,
+						pNotify->FileNameLength / sizeof(WCHAR));
+					isChanged = lstrcmpi(name.data(), file.name.data()) == 0;
+					if (pNotify->NextEntryOffset == 0)
+						break;
+					pInfo += pNotify->NextEntryOffset;
+				}
+				if (isChanged)
+					pChanges->push_back(file.path);
+			}
+		}
+
+		vector<unique_ptr<Directory>> m_directories;
+	};
+
+
+
+	HANDLE shellExecute(const wstring& file, const wstring& argLine)
+	{
+		STARTUPINFO si;
+		GetStartupInfo(&si);
+
+		SHELLEXECUTEINFO see = { 0 };
+		see.cbSize = sizeof(see);
+		see.fMask = SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_LOG_USAGE;
+		see.lpVerb = L"open";
+		see.lpFile = file.data();
+		see.lpParameters = argLine.data();
+		see.lpDirectory = NULL;
+		see.nShow = si.wShowWindow;
+
+		throwIfZero<AutoSaveException, BOOL>(
+			ShellExecuteEx(&see));
+		return see.hProcess;
+	}
+
+
+
+	wstring findExecutable(const wstring& documentPath)
+	{
+		if (OleUtils::isExecutable(documentPath))
+			return documentPath;
+
+		TCHAR buffer[MAX_PATH];
+		HINSTANCE feResult = FindExecutable(documentPath.data(), NULL, buffer);
+		if ((int) feResult <= 32)
+			throw AutoSaveException();
+		return buffer;
+	}
+
+
+
+	const DWORD controlRequestLimit = 4096;
+	const DWORD controlReadTimeout = 1000;
+	const DWORD controlAnswerTimeout = 5000;
+
+	// Every session gets a pipe of its own, like every user elsewhere.
+	wstring getPipeName(const wstring& name)
+	{
+		DWORD sessionId = 0;
+		ProcessIdToSessionId(GetCurrentProcessId(), &sessionId);
+		return L"\\\\.\\pipe\\" + name + L"-" + std::to_wstring(sessionId);
+	}
+
+
+
+	// Returns false if the operation failed or didn't finish in time,
+	// in which case it has been cancelled.
+	bool finishOverlapped(HANDLE hPipe, OVERLAPPED& overlapped, BOOL isDone,
+		DWORD timeout, DWORD* pBytes)
+	{
+		if (!isDone && GetLastError() != ERROR_IO_PENDING)
+			return false;
+		if (WaitForSingleObject(overlapped.hEvent, timeout) != WAIT_OBJECT_0)
+		{
+			CancelIoEx(hPipe, &overlapped);
+			GetOverlappedResult(hPipe, &overlapped, pBytes, TRUE);
+			return false;
+		}
+		return GetOverlappedResult(hPipe, &overlapped, pBytes, FALSE) != FALSE;
+	}
+
+
+
+	class NamedPipeControlServer : public ControlServer
+	{
+	public:
+		// Takes over hPipe, which must have been created for overlapped I/O.
+		NamedPipeControlServer(HANDLE hPipe, const Handler& handler)
+			: m_hPipe(hPipe), m_handler(handler),
+			m_hStop(CreateEvent(NULL, TRUE, FALSE, NULL))
+		{
+			if (m_hStop == NULL)
+			{
+				DWORD error = GetLastError();
+				CloseHandle(m_hPipe);
+				throw AutoSaveException(error);
+			}
+			m_thread = std::thread(&NamedPipeControlServer::serve, this);
+		}
+
+		virtual ~NamedPipeControlServer()
+		{
+			SetEvent(m_hStop);
+			m_thread.join();
+			CloseHandle(m_hStop);
+			CloseHandle(m_hPipe);
+		}
+
+	private:
+		NamedPipeControlServer(const NamedPipeControlServer&);
+		NamedPipeControlServer& operator=(const NamedPipeControlServer&);
+
+		void serve()
+		{
+			OVERLAPPED overlapped = { 0 };
+			overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+			if (overlapped.hEvent == NULL)
+				return;
+
+			for (;;)
+			{
+				ResetEvent(overlapped.hEvent);
+				BOOL isConnected = ConnectNamedPipe(m_hPipe, &overlapped);
+				if (!isConnected && GetLastError() == ERROR_PIPE_CONNECTED)
+					SetEvent(overlapped.hEvent);
+				else if (!isConnected && GetLastError() != ERROR_IO_PENDING)
+					break;
+
+				HANDLE handles[] = { m_hStop, overlapped.hEvent };
+				if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0 + 1)
+				{
+					DWORD bytes;
+					CancelIoEx(m_hPipe, &overlapped);
+					GetOverlappedResult(m_hPipe, &overlapped, &bytes, TRUE);
+					break;
+				}
+				answer(overlapped);
+				DisconnectNamedPipe(m_hPipe);
+			}
+			CloseHandle(overlapped.hEvent);
+		}
+
+		// One client at a time is plenty; slow ones are cut off.
+		void answer(OVERLAPPED& overlapped)
+		{
+			std::string request;
+			char buffer[256];
+			while (request.find('\n') == std::string::npos &&
+				request.size() <= controlRequestLimit)
+			{
+				DWORD bytes = 0;
+				ResetEvent(overlapped.hEvent);
+				BOOL isDone = ReadFile(m_hPipe, buffer, sizeof(buffer), NULL, &overlapped);
+				if (!finishOverlapped(m_hPipe, overlapped, isDone, controlReadTimeout, &bytes))
+				{
+					if (GetLastError() != ERROR_BROKEN_PIPE || request.empty())
+						return;
+					break;
+				}
+				request.append(buffer, bytes);
+			}
+			request = request.substr(0, request.find('\n'));
+
+			std::string response;
+			try {
+				response = m_handler(request);
+			} catch (...) {
+				response = "error internal\n";
+			}
+			DWORD bytes = 0;
+			ResetEvent(overlapped.hEvent);
+			BOOL isDone = WriteFile(m_hPipe, response.data(), (DWORD) response.size(),
+				NULL, &overlapped);
+			if (finishOverlapped(m_hPipe, overlapped, isDone, controlReadTimeout, &bytes))
+				FlushFileBuffers(m_hPipe);
+		}
+
+		HANDLE m_hPipe;
+		Handler m_handler;
+		HANDLE m_hStop;
+		std::thread m_thread;
+	};
+}
+
+
+
+Clock& Platform::getClock()
+{
+	static Win32Clock clock;
+	return clock;
+}
+
+
+
+WindowEnumerator& Platform::getWindowEnumerator()
+{
+	static Win32WindowEnumerator enumerator;
+	return enumerator;
+}
+
+
+
+InputSink& Platform::getInputSink()
+{
+	static Win32InputSink sink;
+	return sink;
+}
+
+
+
+bool Platform::configStoreExists(const wstring& keyName)
+{
+	return RegistryAccess::keyExists(keyName);
+}
+
+
+
+unique_ptr<ConfigStore> Platform::openConfigStore(const wstring& keyName)
+{
+	return unique_ptr<ConfigStore>(new RegistryConfigStore(keyName));
+}
+
+
+
+void Platform::purgeConfigStore(const wstring& keyName)
+{
+	RegistryAccess ra;
+	ra.access(keyName);
+	ra.purge();
+}
+
+
+
+unique_ptr<ProcessHandle> Platform::startProcess(
+	const wstring& file, const wstring& argLine)
+{
+	HANDLE hProcess = shellExecute(file, argLine);
+	if (GetProcessId(hProcess) == 0)
+	{
+		CloseHandle(hProcess);
+		throw AutoSaveException();
+	}
+	return unique_ptr<ProcessHandle>(new Win32ProcessHandle(hProcess));
+}
+
+
+
+bool Platform::wouldStartSelf(const wstring& file)
+{
+	return OleUtils::isSelf(findExecutable(file));
+}
+
+
+
+bool Platform::fileExists(const wstring& path)
+{
+	return PathFileExists(path.c_str()) != FALSE;
+}
+
+
+
+FILE* Platform::openFile(const wstring& path, const wchar_t* mode)
+{
+	FILE* pFile = NULL;
+	return _wfopen_s(&pFile, path.c_str(), mode) == 0 ? pFile : NULL;
+}
+
+
+
+bool Platform::renameFile(const wstring& from, const wstring& to)
+{
+	return MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+}
+
+
+
+bool Platform::removeFile(const wstring& path)
+{
+	return DeleteFileW(path.c_str()) != FALSE;
+}
+
+
+
+std::string Platform::toNarrow(const wstring& text)
+{
+	if (text.empty())
+		return std::string();
+	const int size = WideCharToMultiByte(CP_ACP, 0, text.data(), (int) text.size(),
+		NULL, 0, NULL, NULL);
+	if (size <= 0)
+		return std::string();
+	std::string narrow(size, '\0');
+	WideCharToMultiByte(CP_ACP, 0, text.data(), (int) text.size(),
+		&narrow[0], size, NULL, NULL);
+	return narrow;
+}
+
+
+
+wstring Platform::toWide(const std::string& text)
+{
+	if (text.empty())
+		return wstring();
+	const int size = MultiByteToWideChar(CP_ACP, 0, text.data(), (int) text.size(),
+		NULL, 0);
+	if (size <= 0)
+		return wstring();
+	wstring wide(size, L'\0');
+	MultiByteToWideChar(CP_ACP, 0, text.data(), (int) text.size(), &wide[0], size);
+	return wide;
+}
+
+
+
+// Local rather than roaming: backups are large and belong to this machine.
+wstring Platform::getDataDirectory()
+{
+	LPWSTR appData;
+	if (FAILED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, NULL, &appData)))
+		return L"";
+	wstring directory = appData;
+	directory.append(L"\\" SHORT_APP_NAME);
+	CoTaskMemFree(appData);
+	return directory;
+}
+
+
+
+unique_ptr<FileWatcher> Platform::createFileWatcher()
+{
+	return unique_ptr<FileWatcher>(new Win32FileWatcher());
+}
+
+
+
+unique_ptr<ForegroundWatcher> Platform::createForegroundWatcher()
+{
+	return unique_ptr<ForegroundWatcher>(new WinEventForegroundWatcher());
+}
+
+
+
+unique_ptr<ControlServer> Platform::startControlServer(const wstring& name,
+	const ControlServer::Handler& handler)
+{
+	// The default security only lets the user (and administrators) in.
+	HANDLE hPipe = CreateNamedPipe(getPipeName(name).data(),
+		PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE | FILE_FLAG_OVERLAPPED,
+		PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+		1, 4096, 4096, 0, NULL);
+	if (hPipe == INVALID_HANDLE_VALUE)
+	{
+		if (GetLastError() == ERROR_ACCESS_DENIED)
+			return NULL; // Another instance got there first.
+		throw AutoSaveException();
+	}
+	return unique_ptr<ControlServer>(new NamedPipeControlServer(hPipe, handler));
+}
+
+
+
+std::string Platform::sendControlRequest(const wstring& name,
+	const std::string& request)
+{
+	const wstring pipeName = getPipeName(name);
+	HANDLE hPipe = CreateFile(pipeName.data(), GENERIC_READ | GENERIC_WRITE,
+		0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+	if (hPipe == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PIPE_BUSY)
+	{
+		// Someone else is being served.
+		throwIfZero<AutoSaveException, BOOL>(
+			WaitNamedPipe(pipeName.data(), controlAnswerTimeout));
+		hPipe = CreateFile(pipeName.data(), GENERIC_READ | GENERIC_WRITE,
+			0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+	}
+	if (hPipe == INVALID_HANDLE_VALUE)
+		throw AutoSaveException();
+
+	OVERLAPPED overlapped = { 0 };
+	overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (overlapped.hEvent == NULL)
+	{
+		DWORD error = GetLastError();
+		CloseHandle(hPipe);
+		throw AutoSaveException(error);
+	}
+
+	// A hung server mustn't hang the caller: the whole exchange gets
+	// controlAnswerTimeout.
+	const ULONGLONG deadline = GetTickCount64() + controlAnswerTimeout;
+	auto getTimeLeft = [deadline]() -> DWORD {
+		const ULONGLONG now = GetTickCount64();
+		return (now < deadline) ? (DWORD) (deadline - now) : 0;
+	};
+
+	const std::string line = request + "\n";
+	DWORD bytes = 0;
+	DWORD error = ERROR_SUCCESS;
+	BOOL isDone = WriteFile(hPipe, line.data(), (DWORD) line.size(), NULL, &overlapped);
+	if (!finishOverlapped(hPipe, overlapped, isDone, getTimeLeft(), &bytes))
+		error = GetLastError();
+
+	// The server closes the pipe when it's done.
+	std::string response;
+	char buffer[1024];
+	while (error == ERROR_SUCCESS)
+	{
+		const DWORD timeLeft = getTimeLeft();
+		if (timeLeft == 0)
+		{
+			error = ERROR_TIMEOUT;
+			break;
+		}
+		ResetEvent(overlapped.hEvent);
+		isDone = ReadFile(hPipe, buffer, sizeof(buffer), NULL, &overlapped);
+		if (!finishOverlapped(hPipe, overlapped, isDone, timeLeft, &bytes))
+		{
+			error = GetLastError();
+			break;
+		}
+		response.append(buffer, bytes);
+	}
+	// Cancelled at the deadline.
+	if (error == ERROR_OPERATION_ABORTED)
+		error = ERROR_TIMEOUT;
+	CloseHandle(overlapped.hEvent);
+	CloseHandle(hPipe);
+	if (error != ERROR_BROKEN_PIPE && error != ERROR_PIPE_NOT_CONNECTED)
+		throw AutoSaveException(error);
+	return response;
+}
@@ -0,0 +1,61 @@
+#include "stdafx.h"
+#include "WindowListDiff.h"
+
+
+// Both lists are at most as long as a listbox is high, so the
+// quadratic longest-common-subsequence table stays tiny.
+WindowListDiff::WindowListDiff(
+	const vector<wstring>& oldRows, const vector<wstring>& newRows)
+{
+	const size_t nOld = oldRows.size();
+	const size_t nNew = newRows.size();
+
+	// lcs[i][j] is the LCS length of oldRows[i:] and newRows[j:].
+	vector<vector<size_t>> lcs(nOld + 1, vector<size_t>(nNew + 1, 0));
+	for (size_t i = nOld; i-- > 0;)
+	{
+		for (size_t j = nNew; j-- > 0;)
+		{
+			lcs[i][j] = (oldRows[i] == newRows[j]) ?
+				lcs[i + 1][j + 1] + 1 :
+				__max(lcs[i + 1][j], lcs[i][j + 1]);
+		}
+	}
+
+	// Walk the table; everything not in the LCS is removed or inserted.
+	size_t i = 0, j = 0;
+	while (i < nOld || j < nNew)
+	{
+		if (i < nOld && j < nNew && oldRows[i] == newRows[j])
+		{
+			++i;
+			++j;
+		}
+		else if (j < nNew && (i == nOld || lcs[i][j + 1] >= lcs[i + 1][j]))
+		{
+			m_insertions.push_back({ j, newRows[j] });
+			++j;
+		}
+		else {
+			m_removals.push_back(i);
+			++i;
+		}
+	}
+	std::reverse(m_removals.begin(), m_removals.end());
+}
+
+
+
+vector<wstring> WindowListDiff::applyTo(const vector<wstring>& oldRows) const
+{
+	vector<wstring> rows = oldRows;
+	for (size_t index : m_removals)
+	{
+		rows.erase(rows.begin() + index);
+	}
+	for (const Insertion& insertion : m_insertions)
+	{
+		rows.insert(rows.begin() + insertion.index, insertion.text);
+	}
+	return rows;
+}
@@ -0,0 +1,44 @@
+// WindowListDiff.h : Computes which rows have to be removed from and
+// inserted into a list of window captions to turn it into another one.
+// Used to update listboxes without clearing and refilling them.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+
+using std::wstring;
+using std::vector;
+
+class WindowListDiff
+{
+public:
+	struct Insertion {
+		size_t index;
+		wstring text;
+	};
+
+	WindowListDiff() {}
+	WindowListDiff(const vector<wstring>& oldRows, const vector<wstring>& newRows);
+	~WindowListDiff() {}
+
+	// Indices into the old list, sorted in descending order.
+	// Apply these first, so that no index is invalidated.
+	inline const vector<size_t>& getRemovals() const { return m_removals; }
+
+	// Indices into the new list, sorted in ascending order.
+	// Apply these after all removals.
+	inline const vector<Insertion>& getInsertions() const { return m_insertions; }
+
+	inline bool isEmpty() const {
+		return m_removals.empty() && m_insertions.empty();
+	}
+
+	// Applies the diff to a copy of oldRows. Mostly useful for
+	// bookkeeping and testing.
+	vector<wstring> applyTo(const vector<wstring>& oldRows) const;
+
+private:
+	vector<size_t> m_removals;
+	vector<Insertion> m_insertions;
+};
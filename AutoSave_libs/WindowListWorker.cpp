@@ -0,0 +1,196 @@
+#include "stdafx.h"
+#include "WindowListWorker.h"
+
+
+WindowListWorker::WindowListWorker(HWND hwndNotify)
+	: m_cRef(1),
+	  m_hwndNotify(hwndNotify),
+	  m_hWakeEvent(CreateEvent(NULL, FALSE, FALSE, NULL)),
+	  m_isStopping(false),
+	  m_hasRequest(false),
+	  m_request(),
+	  m_hasResult(false),
+	  m_result()
+{
+	InitializeCriticalSection(&m_lock);
+}
+
+
+
+WindowListWorker::~WindowListWorker()
+{
+	if (m_hWakeEvent != NULL)
+		CloseHandle(m_hWakeEvent);
+	DeleteCriticalSection(&m_lock);
+}
+
+
+
+WindowListWorker* WindowListWorker::start(HWND hwndNotify)
+{
+	auto pWorker = new WindowListWorker(hwndNotify);
+	if (pWorker->m_hWakeEvent == NULL)
+	{
+		delete pWorker;
+		return NULL;
+	}
+
+	// One reference for the caller, one for the thread.
+	pWorker->m_cRef = 2;
+	HANDLE hThread = CreateThread(NULL, 0, threadProc, pWorker, 0, NULL);
+	if (hThread == NULL)
+	{
+		delete pWorker;
+		return NULL;
+	}
+	CloseHandle(hThread);
+	return pWorker;
+}
+
+
+
+void WindowListWorker::stop()
+{
+	EnterCriticalSection(&m_lock);
+	m_isStopping = true;
+	m_hwndNotify = 0;
+	LeaveCriticalSection(&m_lock);
+	SetEvent(m_hWakeEvent);
+	release();
+}
+
+
+
+void WindowListWorker::release()
+{
+	if (InterlockedDecrement(&m_cRef) == 0)
+		delete this;
+}
+
+
+
+void WindowListWorker::request(const Matcher& filter, UINT generation,
+	UINT maxRows, const vector<wstring>& currentRows, UINT baseRevision)
+{
+	EnterCriticalSection(&m_lock);
+	m_request.filter.setFilter(filter);
+	m_request.generation = generation;
+	m_request.maxRows = maxRows;
+	m_request.baseRows = currentRows;
+	m_request.baseRevision = baseRevision;
+	m_hasRequest = true;
+	LeaveCriticalSection(&m_lock);
+	SetEvent(m_hWakeEvent);
+}
+
+
+
+bool WindowListWorker::takeResult(Result* pResult)
+{
+	EnterCriticalSection(&m_lock);
+	bool hadResult = m_hasResult;
+	if (hadResult)
+	{
+		*pResult = std::move(m_result);
+		m_hasResult = false;
+	}
+	LeaveCriticalSection(&m_lock);
+	return hadResult;
+}
+
+
+
+DWORD CALLBACK WindowListWorker::threadProc(LPVOID lParam)
+{
+	auto pThis = (WindowListWorker*) lParam;
+	pThis->run();
+	pThis->release();
+	return 0;
+}
+
+
+
+void WindowListWorker::run()
+{
+	Request current;
+	while (true)
+	{
+		WaitForSingleObject(m_hWakeEvent, INFINITE);
+
+		EnterCriticalSection(&m_lock);
+		bool isStopping = m_isStopping;
+		bool hasRequest = m_hasRequest;
+		if (hasRequest && !isStopping)
+		{
+			current.filter.setFilter(m_request.filter);
+			current.generation = m_request.generation;
+			current.maxRows = m_request.maxRows;
+			current.baseRows.swap(m_request.baseRows);
+			current.baseRevision = m_request.baseRevision;
+			m_hasRequest = false;
+		}
+		LeaveCriticalSection(&m_lock);
+
+		if (isStopping)
+			return;
+		if (!hasRequest)
+			continue;
+
+		// The expensive part happens outside of the lock.
+		Result result;
+		result.generation = current.generation;
+		result.baseRevision = current.baseRevision;
+		result.rows = findMatchingCaptions(current.filter, current.maxRows);
+		result.diff = WindowListDiff(current.baseRows, result.rows);
+
+		EnterCriticalSection(&m_lock);
+		HWND hwndNotify = m_hwndNotify;
+		if (!m_isStopping)
+		{
+			m_result = std::move(result);
+			m_hasResult = true;
+		}
+		LeaveCriticalSection(&m_lock);
+
+		if (hwndNotify != 0)
+			PostMessage(hwndNotify, WM_WINDOWLISTREADY, 0, 0);
+	}
+}
+
+
+
+vector<wstring> WindowListWorker::findMatchingCaptions(
+	const Matcher& filter, UINT maxRows)
+{
+	EnumProcArgs args = { filter, maxRows, {} };
+	if (maxRows > 0)
+		EnumWindows(findMatchingCaptionsEnumProc, (LPARAM) &args);
+	return args.rows;
+}
+
+
+
+BOOL CALLBACK WindowListWorker::findMatchingCaptionsEnumProc(
+	HWND hwnd, LPARAM lParam)
+{
+	// Ignore owned and invisible windows.
+	bool isUnownedAndVisible = GetParent(hwnd) == 0 && IsWindowVisible(hwnd);
+	if (!isUnownedAndVisible)
+		return TRUE;
+
+	// Ignore windows without caption.
+	auto pArgs = (EnumProcArgs*) lParam;
+	wstring caption = Matcher::getWindowText(hwnd);
+	if (caption.empty())
+		return TRUE;
+
+	// Ignore windows that don't match.
+	if (!pArgs->filter.match(caption))
+		return TRUE;
+
+	// Matching windows reduce the counter.
+	--pArgs->remainingRows;
+	pArgs->rows.push_back(
+		(pArgs->remainingRows != 0) ? caption : L"[...]");
+	return pArgs->remainingRows > 0;
+}
@@ -0,0 +1,83 @@
+// WindowListWorker.h : Enumerates and filters top-level windows on a
+// background thread for OptionsPageTarget, so that slow captions or
+// pathological regexes can't freeze the options window.
+// Results are announced by posting WM_WINDOWLISTREADY to the notified
+// window. Each request carries a generation number, which lets the
+// receiver drop results computed for an outdated filter.
+// Never throws exceptions (except std::bad_alloc).
+
+#pragma once
+
+#include "stdafx.h"
+#include "Matcher.h"
+#include "WindowListDiff.h"
+
+using std::wstring;
+using std::vector;
+
+class WindowListWorker
+{
+public:
+	enum { WM_WINDOWLISTREADY = WM_USER + 0x0020 };
+
+	struct Result {
+		UINT generation;
+		UINT baseRevision;
+		vector<wstring> rows;
+		WindowListDiff diff;
+	};
+
+	// Returns NULL if the thread couldn't be started.
+	static WindowListWorker* start(HWND hwndNotify);
+
+	// Doesn't wait for the thread. If it is busy, it will clean up
+	// after itself once it's done. The pointer is invalid afterwards.
+	void stop();
+
+	// Replaces any request that hasn't been picked up yet.
+	// The diff of the result will be relative to currentRows,
+	// which is identified by baseRevision.
+	void request(const Matcher& filter, UINT generation, UINT maxRows,
+		const vector<wstring>& currentRows, UINT baseRevision);
+
+	// Returns false if there is no new result.
+	bool takeResult(Result* pResult);
+
+private:
+	WindowListWorker(HWND hwndNotify);
+	~WindowListWorker();
+
+	void release();
+
+	static DWORD CALLBACK threadProc(LPVOID lParam);
+	void run();
+
+	static vector<wstring> findMatchingCaptions(const Matcher& filter,
+		UINT maxRows);
+	static BOOL CALLBACK findMatchingCaptionsEnumProc(HWND hwnd, LPARAM lParam);
+	struct EnumProcArgs {
+		const Matcher& filter;
+		UINT remainingRows;
+		vector<wstring> rows;
+	};
+
+	struct Request {
+		Matcher filter;
+		UINT generation;
+		UINT maxRows;
+		vector<wstring> baseRows;
+		UINT baseRevision;
+	};
+
+	LONG m_cRef;
+	HWND m_hwndNotify;
+	HANDLE m_hWakeEvent;
+	CRITICAL_SECTION m_lock;
+
+	// Guarded by m_lock.
+	bool m_isStopping;
+	bool m_hasRequest;
+	Request m_request;
+	bool m_hasResult;
+	Result m_result;
+};
@@ -0,0 +1,190 @@
+#include "stdafx.h"
+#include "WriteBehindStore.h"
+#include "MemoryConfigStore.h"
+
+
+WriteBehindStore::WriteBehindStore(unique_ptr<ConfigStore> pStore)
+	: m_pStore(std::move(pStore))
+{
+}
+
+
+
+int WriteBehindStore::readInt(const wstring& valueName) const
+{
+	const Pending* pPending = NULL;
+	lookupPending(valueName, OP_INT, &pPending).throwIfError<ConfigStoreException>();
+	if (pPending == NULL)
+		return m_pStore->readInt(valueName);
+	return pPending->number;
+}
+
+
+
+void WriteBehindStore::writeInt(const wstring& valueName, int valueData)
+{
+	Pending pending = { OP_INT, valueData, {} };
+	m_pending[valueName] = pending;
+}
+
+
+
+wstring WriteBehindStore::readString(const wstring& valueName) const
+{
+	const Pending* pPending = NULL;
+	lookupPending(valueName, OP_STRING, &pPending).throwIfError<ConfigStoreException>();
+	if (pPending == NULL)
+		return m_pStore->readString(valueName);
+	return pPending->strings.front();
+}
+
+
+
+void WriteBehindStore::writeString(const wstring& valueName,
+	const wstring& valueData)
+{
+	Pending pending = { OP_STRING, 0, { valueData } };
+	m_pending[valueName] = pending;
+}
+
+
+
+vector<wstring> WriteBehindStore::readMultiString(const wstring& valueName) const
+{
+	const Pending* pPending = NULL;
+	lookupPending(valueName, OP_MULTI_STRING, &pPending).throwIfError<ConfigStoreException>();
+	if (pPending == NULL)
+		return m_pStore->readMultiString(valueName);
+	return pPending->strings;
+}
+
+
+
+void WriteBehindStore::writeMultiString(const wstring& valueName,
+	const vector<wstring>& strings)
+{
+	Pending pending = { OP_MULTI_STRING, 0, strings };
+	m_pending[valueName] = pending;
+}
+
+
+
+Expected<int> WriteBehindStore::tryReadInt(const wstring& valueName) const
+{
+	const Pending* pPending = NULL;
+	ErrorCode error = lookupPending(valueName, OP_INT, &pPending);
+	if (error.isError())
+		return error;
+	if (pPending == NULL)
+		return m_pStore->tryReadInt(valueName);
+	return pPending->number;
+}
+
+
+
+Expected<wstring> WriteBehindStore::tryReadString(const wstring& valueName) const
+{
+	const Pending* pPending = NULL;
+	ErrorCode error = lookupPending(valueName, OP_STRING, &pPending);
+	if (error.isError())
+		return error;
+	if (pPending == NULL)
+		return m_pStore->tryReadString(valueName);
+	return pPending->strings.front();
+}
+
+
+
+Expected<vector<wstring>> WriteBehindStore::tryReadMultiString(
+	const wstring& valueName) const
+{
+	const Pending* pPending = NULL;
+	ErrorCode error = lookupPending(valueName, OP_MULTI_STRING, &pPending);
+	if (error.isError())
+		return error;
+	if (pPending == NULL)
+		return m_pStore->tryReadMultiString(valueName);
+	return pPending->strings;
+}
+
+
+
+vector<wstring> WriteBehindStore::getValueNames() const
+{
+	vector<wstring> names;
+	for (const wstring& name : m_pStore->getValueNames())
+	{
+		if (m_pending.count(name) == 0)
+			names.push_back(name);
+	}
+	for (const auto& pending : m_pending)
+	{
+		if (pending.second.operation != OP_DELETE)
+			names.push_back(pending.first);
+	}
+	return names;
+}
+
+
+
+void WriteBehindStore::deleteValue(const wstring& valueName)
+{
+	Pending pending = { OP_DELETE, 0, {} };
+	m_pending[valueName] = pending;
+}
+
+
+
+size_t WriteBehindStore::flush()
+{
+	size_t count = 0;
+	while (!m_pending.empty())
+	{
+		auto pFirst = m_pending.begin();
+		apply(pFirst->first, pFirst->second);
+		m_pending.erase(pFirst);
+		++count;
+	}
+	return count;
+}
+
+
+
+// A pending deletion reads like a missing value.
+ErrorCode WriteBehindStore::lookupPending(const wstring& valueName,
+	Operation operation, const Pending** ppPending) const
+{
+	auto pPending = m_pending.find(valueName);
+	if (pPending == m_pending.end())
+	{
+		*ppPending = NULL;
+		return ErrorCode();
+	}
+	if (pPending->second.operation == OP_DELETE)
+		return ErrorCode::fromWin32(ERROR_FILE_NOT_FOUND);
+	if (pPending->second.operation != operation)
+		return ErrorCode::fromWin32(ERROR_UNSUPPORTED_TYPE);
+	*ppPending = &pPending->second;
+	return ErrorCode();
+}
+
+
+
+void WriteBehindStore::apply(const wstring& valueName, const Pending& pending)
+{
+	switch (pending.operation)
+	{
+	case OP_INT:
+		m_pStore->writeInt(valueName, pending.number);
+		break;
+	case OP_STRING:
+		m_pStore->writeString(valueName, pending.strings.front());
+		break;
+	case OP_MULTI_STRING:
+		m_pStore->writeMultiString(valueName, pending.strings);
+		break;
+	case OP_DELETE:
+		m_pStore->deleteValue(valueName);
+		break;
+	}
+}
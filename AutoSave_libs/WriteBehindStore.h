@@ -0,0 +1,68 @@
+// WriteBehindStore.h : A ConfigStore in front of another one that holds
+// writes back until flush(). A value that is written several times in
+// between is written to the other store only once, with its last data,
+// so that saving settings doesn't cost a registry write per change and
+// can wait until the user is done.
+// Reads see what is pending, and fall back on the other store.
+// May throw whatever the other store throws; writing and deleting only
+// throw std::bad_alloc. If flushing fails, what hasn't been written yet
+// stays pending.
+
+#pragma once
+
+#include "stdafx.h"
+#include "Platform.h"
+
+using std::wstring;
+using std::vector;
+using std::unique_ptr;
+
+class WriteBehindStore : public ConfigStore
+{
+public:
+	WriteBehindStore(unique_ptr<ConfigStore> pStore);
+	// Doesn't flush; anything still pending is lost.
+	virtual ~WriteBehindStore() {}
+
+	virtual int readInt(const wstring& valueName) const;
+	virtual void writeInt(const wstring& valueName, int valueData);
+
+	virtual wstring readString(const wstring& valueName) const;
+	virtual void writeString(const wstring& valueName, const wstring& valueData);
+
+	virtual vector<wstring> readMultiString(const wstring& valueName) const;
+	virtual void writeMultiString(const wstring& valueName,
+		const vector<wstring>& strings);
+
+	virtual Expected<int> tryReadInt(const wstring& valueName) const;
+	virtual Expected<wstring> tryReadString(const wstring& valueName) const;
+	virtual Expected<vector<wstring>> tryReadMultiString(
+		const wstring& valueName) const;
+
+	virtual vector<wstring> getValueNames() const;
+	virtual void deleteValue(const wstring& valueName);
+
+	// Returns the number of values written or deleted.
+	size_t flush();
+	inline size_t getPendingCount() const { return m_pending.size(); }
+
+private:
+	WriteBehindStore(const WriteBehindStore&);
+	WriteBehindStore& operator=(const WriteBehindStore&);
+
+	enum Operation { OP_INT, OP_STRING, OP_MULTI_STRING, OP_DELETE };
+	struct Pending {
+		Operation operation;
+		int number;
+		vector<wstring> strings;
+	};
+
+	// Sets *ppPending only on success, to NULL if nothing is pending.
+	ErrorCode lookupPending(const wstring& valueName, Operation operation,
+		const Pending** ppPending) const;
+	void apply(const wstring& valueName, const Pending& pending);
+
+	unique_ptr<ConfigStore> m_pStore;
+	// Ordered, so that values are flushed in a predictable order.
+	std::map<wstring, Pending> m_pending;
+};
@@ -5,7 +5,9 @@
 
 #pragma once
 
+#ifdef _WIN32
 #include "targetver.h"
+#endif
 
 // Program name and version
 #define APP_NAME L"Broken Pen's AutoSave"
@@ -23,6 +25,7 @@
 #define APP_DATE APP_DATE2(__DATE__)
 
 
+#ifdef _WIN32
 // Exclude rarely-used stuff from Windows headers
 #define WIN32_LEAN_AND_MEAN
 // Windows Header Files:
@@ -32,6 +35,10 @@
 #include <Prsht.h>
 #include <Shellapi.h>
 #include <Shlwapi.h>
+#else
+// The portable core (see CMakeLists.txt) only needs a few definitions.
+#include "PortableTypes.h"
+#endif
 
 
 // C RunTime Header Files
@@ -39,17 +46,24 @@
 #include <regex>
 #include <string>
 #include <vector>
+#include <memory>
+#include <map>
 #include <unordered_map>
-#include <tchar.h>
-#include <Strsafe.h>
+#include <algorithm>
+#include <functional>
+#include <cmath>
 
 #include <exception>
 #include <iostream>
 #include <cassert>
 
+#include <stdlib.h>
+#ifdef _WIN32
+#include <tchar.h>
+#include <Strsafe.h>
 #include <memory.h>
 #include <malloc.h>
-#include <stdlib.h>
+#endif
 
 // Debugging macros
 
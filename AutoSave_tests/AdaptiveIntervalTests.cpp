@@ -0,0 +1,58 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "AdaptiveInterval.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace AdaptiveInterval;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(AdaptiveIntervalTests)
+	{
+	public:
+
+		static AdaptivePolicy makePolicy()
+		{
+			AdaptivePolicy policy = { 60, 3600, 200, 10 };
+			return policy;
+		}
+
+		TEST_METHOD(TestMinimumWhileBusy)
+		{
+			Signals busy = { true, FC_CHANGED, 0 };
+			Assert::AreEqual<UINT>(60, next(makePolicy(), 600, busy));
+			Assert::AreEqual<UINT>(60, next(makePolicy(), 60, busy));
+
+			// Without known files, input alone decides.
+			Signals unknown = { true, FC_UNKNOWN, 0 };
+			Assert::AreEqual<UINT>(60, next(makePolicy(), 600, unknown));
+		}
+
+		TEST_METHOD(TestGrowsWhileIdle)
+		{
+			Signals noInput = { false, FC_CHANGED, 0 };
+			Assert::AreEqual<UINT>(1200, next(makePolicy(), 600, noInput));
+			Assert::AreEqual<UINT>(3600, next(makePolicy(), 3000, noInput));
+
+			// Input elsewhere doesn't help if the save had nothing to write.
+			Signals nothingSaved = { true, FC_UNCHANGED, 0 };
+			Assert::AreEqual<UINT>(1200, next(makePolicy(), 600, nothingSaved));
+		}
+
+		TEST_METHOD(TestSlowSavesLengthenInterval)
+		{
+			// Ten percent busy at most: a 30.5-second save needs 305 seconds.
+			Signals slow = { true, FC_CHANGED, 30500 };
+			Assert::AreEqual<UINT>(305, next(makePolicy(), 120, slow));
+			Assert::AreEqual<UINT>(305, getBusyInterval(makePolicy(), 30500));
+			// Growing starts from there, too.
+			Signals slowIdle = { false, FC_CHANGED, 30500 };
+			Assert::AreEqual<UINT>(305, next(makePolicy(), 100, slowIdle));
+
+			// But never beyond the maximum.
+			Signals verySlow = { true, FC_CHANGED, 1000 * 1000 };
+			Assert::AreEqual<UINT>(3600, next(makePolicy(), 120, verySlow));
+		}
+
+	};
+}
@@ -0,0 +1,420 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "BackupStore.h"
+#include "BackupWorker.h"
+
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <thread>
+#ifndef _WIN32
+#include <dirent.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(BackupStoreTests)
+	{
+	public:
+
+		// The same bytes for the same seed, on every platform.
+		static vector<BYTE> makeData(size_t size, ULONGLONG seed)
+		{
+			vector<BYTE> data(size);
+			ULONGLONG state = seed;
+			for (size_t i = 0; i < size; ++i)
+			{
+				state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+				data[i] = (BYTE) (state >> 56);
+			}
+			return data;
+		}
+
+		static vector<size_t> cutAll(const ContentChunker& chunker,
+			const vector<BYTE>& data)
+		{
+			vector<size_t> sizes;
+			for (size_t offset = 0; offset < data.size(); offset += sizes.back())
+				sizes.push_back(chunker.findCut(&data[offset], data.size() - offset));
+			return sizes;
+		}
+
+		TEST_METHOD(TestSha256Vectors)
+		{
+			// From FIPS 180-4 and NIST's examples.
+			Assert::AreEqual<string>(
+				"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+				Sha256::hash("", 0).toHex());
+			Assert::AreEqual<string>(
+				"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+				Sha256::hash("abc", 3).toHex());
+			const string twoBlocks =
+				"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+			Assert::AreEqual<string>(
+				"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+				Sha256::hash(twoBlocks.data(), twoBlocks.size()).toHex());
+
+			// A million times "a", in pieces that don't fit the blocks.
+			Sha256 sha;
+			const string as(999, 'a');
+			for (int i = 0; i < 1001; ++i)
+				sha.update(as.data(), as.size());
+			sha.update("a", 1);
+			Assert::AreEqual<string>(
+				"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+				sha.finish().toHex());
+			// Finishing starts over.
+			sha.update("abc", 3);
+			Assert::IsTrue(sha.finish() == Sha256::hash("abc", 3));
+		}
+
+		TEST_METHOD(TestSha256DigestFromHex)
+		{
+			const Sha256::Digest digest = Sha256::hash("abc", 3);
+			Sha256::Digest parsed = Sha256::hash("", 0);
+			Assert::IsTrue(Sha256::Digest::fromHex(digest.toHex(), &parsed));
+			Assert::IsTrue(parsed == digest);
+
+			string upper = digest.toHex();
+			for (char& c : upper)
+				c = (char) toupper(c);
+			Assert::IsTrue(Sha256::Digest::fromHex(upper, &parsed));
+			Assert::IsTrue(parsed == digest);
+
+			const Sha256::Digest before = parsed;
+			Assert::IsFalse(Sha256::Digest::fromHex("abc", &parsed));
+			Assert::IsFalse(Sha256::Digest::fromHex(string(64, 'g'), &parsed));
+			Assert::IsTrue(parsed == before);
+		}
+
+		TEST_METHOD(TestChunkerKeepsToBounds)
+		{
+			const ContentChunker chunker(1024, 4000, 16 * 1024);
+			// Rounded so that the spread above the minimum is 4096.
+			Assert::AreEqual<size_t>(1024 + 4096, chunker.getAverageSize());
+
+			const vector<BYTE> data = makeData(4 << 20, 1);
+			const vector<size_t> sizes = cutAll(chunker, data);
+			for (size_t i = 0; i + 1 < sizes.size(); ++i)
+			{
+				Assert::IsTrue(sizes[i] >= chunker.getMinSize());
+				Assert::IsTrue(sizes[i] <= chunker.getMaxSize());
+			}
+			// Somewhere near the average, and not all at the maximum.
+			const size_t average = data.size() / sizes.size();
+			Assert::IsTrue(average > chunker.getMinSize() + 2048);
+			Assert::IsTrue(average < chunker.getMinSize() + 8192);
+			Assert::IsTrue(cutAll(chunker, data) == sizes);
+
+			// Data without any content worth cutting at still ends.
+			const vector<BYTE> zeros(100 * 1024, 0);
+			for (size_t size : cutAll(chunker, zeros))
+				Assert::IsTrue(size <= chunker.getMaxSize());
+		}
+
+		// An insert only changes the chunks around it.
+		TEST_METHOD(TestChunkerRealignsAfterInsert)
+		{
+			const ContentChunker chunker(1024, 4096, 16 * 1024);
+			const vector<BYTE> original = makeData(1 << 20, 2);
+			vector<BYTE> edited = original;
+			const vector<BYTE> inserted = makeData(100, 3);
+			edited.insert(edited.begin() + 300000, inserted.begin(), inserted.end());
+
+			set<string> originalChunks;
+			size_t offset = 0;
+			for (size_t size : cutAll(chunker, original))
+			{
+				originalChunks.insert(Sha256::hash(&original[offset], size).toHex());
+				offset += size;
+			}
+			const vector<size_t> editedSizes = cutAll(chunker, edited);
+			size_t changed = 0;
+			offset = 0;
+			for (size_t size : editedSizes)
+			{
+				if (originalChunks.count(Sha256::hash(&edited[offset], size).toHex()) == 0)
+					++changed;
+				offset += size;
+			}
+			Assert::IsTrue(changed >= 1 && changed <= 2);
+		}
+
+#ifndef _WIN32
+		struct TempDirectory
+		{
+			char path[32];
+
+			TempDirectory()
+			{
+				strcpy(path, "/tmp/autosave_tests_XXXXXX");
+				Assert::IsNotNull(mkdtemp(path));
+			}
+			~TempDirectory()
+			{
+				nftw(path, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+			}
+
+			wstring wide(const string& name = "") const
+			{
+				const string full = name.empty() ? string(path) : string(path) + "/" + name;
+				return wstring(full.begin(), full.end());
+			}
+
+			static int removeEntry(const char* pPath, const struct stat*, int, FTW*)
+			{
+				return remove(pPath);
+			}
+		};
+
+		static void writeData(const wstring& path, const vector<BYTE>& data)
+		{
+			ofstream file(string(path.begin(), path.end()), ios::binary | ios::trunc);
+			file.write((const char*) data.data(), data.size());
+		}
+
+		static vector<BYTE> readData(const wstring& path)
+		{
+			ifstream file(string(path.begin(), path.end()), ios::binary);
+			return vector<BYTE>((istreambuf_iterator<char>(file)),
+				istreambuf_iterator<char>());
+		}
+
+		static ContentChunker smallChunks()
+		{
+			return ContentChunker(1024, 4096, 16 * 1024);
+		}
+
+		TEST_METHOD(TestBackUpAndRestore)
+		{
+			TempDirectory temp;
+			BackupStore store(temp.wide("store"), smallChunks());
+			const wstring document = temp.wide("poster.psd");
+			const vector<BYTE> first = makeData(300 * 1024, 4);
+			writeData(document, first);
+			Assert::IsTrue(store.listVersions(document).empty());
+
+			bool isNew = false;
+			Expected<BackupVersion> version = store.backUp(document, 1000, &isNew);
+			Assert::IsTrue(version.hasValue());
+			Assert::IsTrue(isNew);
+			Assert::AreEqual<ULONGLONG>(1, version.value().id);
+			Assert::AreEqual<ULONGLONG>(first.size(), version.value().size);
+			Assert::AreEqual<ULONGLONG>(first.size(), version.value().newBytes);
+			Assert::AreEqual<size_t>(64, version.value().digest.size());
+
+			// Nothing changed, nothing added.
+			version = store.backUp(document, 2000, &isNew);
+			Assert::IsFalse(isNew);
+			Assert::AreEqual<ULONGLONG>(1, version.value().id);
+			Assert::AreEqual<ULONGLONG>(1000, version.value().time);
+
+			// An edit in the middle only stores the chunks around it.
+			vector<BYTE> second = first;
+			for (size_t i = 150000; i < 150010; ++i)
+				second[i] ^= 0xff;
+			writeData(document, second);
+			version = store.backUp(document, 3000, &isNew);
+			Assert::IsTrue(isNew);
+			Assert::AreEqual<ULONGLONG>(2, version.value().id);
+			Assert::IsTrue(version.value().newBytes <= 2 * 16 * 1024);
+
+			const vector<BackupVersion> versions = store.listVersions(document);
+			Assert::AreEqual<size_t>(2, versions.size());
+			Assert::AreEqual<ULONGLONG>(1000, versions[0].time);
+			Assert::AreEqual(version.value().chunkCount, versions[1].chunkCount);
+			const vector<string> documents = store.listDocuments();
+			Assert::AreEqual<size_t>(1, documents.size());
+			Assert::AreEqual(string(temp.path) + "/poster.psd", documents[0]);
+
+			const wstring restored = temp.wide("restored.psd");
+			Assert::IsFalse(store.restore(document, 1, restored).isError());
+			Assert::IsTrue(readData(restored) == first);
+			Assert::IsFalse(store.restore(document, 2, restored).isError());
+			Assert::IsTrue(readData(restored) == second);
+			Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND,
+				store.restore(document, 3, restored).errorCode());
+			Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND,
+				store.backUp(temp.wide("missing.psd"), 4000).error().errorCode());
+		}
+
+		TEST_METHOD(TestRestoreChecksChunks)
+		{
+			TempDirectory temp;
+			BackupStore store(temp.wide("store"), smallChunks());
+			const wstring document = temp.wide("notes.txt");
+			writeData(document, makeData(50 * 1024, 5));
+			Assert::IsTrue(store.backUp(document, 1000).hasValue());
+
+			// Damage the first chunk.
+			const vector<BYTE> data = readData(document);
+			const ContentChunker chunker = smallChunks();
+			const size_t size = chunker.findCut(data.data(), data.size());
+			const string hex = Sha256::hash(data.data(), size).toHex();
+			const wstring chunk = temp.wide("store/chunks/" + hex.substr(0, 2) + "/" + hex);
+			vector<BYTE> damaged = readData(chunk);
+			Assert::AreEqual(size, damaged.size());
+			damaged[10] ^= 1;
+			writeData(chunk, damaged);
+
+			const wstring restored = temp.wide("restored.txt");
+			Assert::AreEqual<long>(ERROR_FILE_CORRUPT,
+				store.restore(document, 1, restored).errorCode());
+			Assert::AreNotEqual(0, access(string(temp.path).append("/restored.txt").c_str(), F_OK));
+		}
+
+		TEST_METHOD(TestPruneKeepsPolicy)
+		{
+			TempDirectory temp;
+			BackupStore store(temp.wide("store"), smallChunks());
+			const wstring document = temp.wide("report.doc");
+			const ULONGLONG day = 24 * 60 * 60;
+			const ULONGLONG now = 100 * day + 12 * 60 * 60;
+			// Ten and five days ago, the day before yesterday, twice
+			// yesterday, and now.
+			const ULONGLONG times[] = {
+				now - 10 * day, now - 5 * day, now - 2 * day,
+				now - day - 60 * 60, now - day, now
+			};
+			size_t chunkCounts[6];
+			for (int i = 0; i < 6; ++i)
+			{
+				writeData(document, makeData(40 * 1024, 10 + i));
+				Expected<BackupVersion> version = store.backUp(document, times[i]);
+				Assert::IsTrue(version.hasValue());
+				chunkCounts[i] = version.value().chunkCount;
+			}
+
+			RetentionPolicy policy = { 2, 3 };
+			Expected<BackupStore::PruneResult> result = store.prune(policy, now);
+			Assert::IsTrue(result.hasValue());
+			// The last two, and the day before yesterday.
+			Assert::AreEqual<size_t>(3, result.value().versionsRemoved);
+			Assert::AreEqual(chunkCounts[0] + chunkCounts[1] + chunkCounts[3],
+				result.value().chunksRemoved);
+
+			vector<ULONGLONG> ids;
+			for (const BackupVersion& version : store.listVersions(document))
+				ids.push_back(version.id);
+			Assert::IsTrue(ids == vector<ULONGLONG>({ 3, 5, 6 }));
+			const wstring restored = temp.wide("restored.doc");
+			Assert::IsFalse(store.restore(document, 3, restored).isError());
+			Assert::IsTrue(readData(restored) == makeData(40 * 1024, 12));
+
+			// Nothing left to do; the newest version always stays.
+			Assert::AreEqual<size_t>(0, store.prune(policy, now).value().versionsRemoved);
+			policy.keepLast = 0;
+			policy.keepDaily = 0;
+			Assert::AreEqual<size_t>(2, store.prune(policy, now).value().versionsRemoved);
+			Assert::AreEqual<size_t>(1, store.listVersions(document).size());
+		}
+
+		TEST_METHOD(TestPruneWaitsForOtherBackups)
+		{
+			TempDirectory temp;
+			BackupStore store(temp.wide("store"), smallChunks());
+			BackupStore other(temp.wide("store"), smallChunks());
+			const wstring document = temp.wide("draft.odt");
+			const vector<BYTE> first = makeData(200 * 1024, 20);
+			writeData(document, first);
+			Assert::IsTrue(store.backUp(document, 1000).hasValue());
+			writeData(document, makeData(200 * 1024, 21));
+			Assert::IsTrue(store.backUp(document, 2000).hasValue());
+
+			// The other store backs up a copy of the first version through a
+			// pipe: it finds the chunks already stored, and waits halfway for
+			// the rest while the first store prunes.
+			const string pipe = string(temp.path) + "/copy.odt";
+			Assert::AreEqual(0, mkfifo(pipe.c_str(), 0600));
+			bool isCopied = false;
+			thread backup([&]() {
+				isCopied = other.backUp(temp.wide("copy.odt"), 3000).hasValue();
+			});
+			FILE* pPipe = fopen(pipe.c_str(), "wb");
+			// More than the pipe holds, so this waits for the other store.
+			const size_t written = (pPipe != NULL) ?
+				fwrite(first.data(), 1, first.size(), pPipe) : 0;
+			const RetentionPolicy policy = { 1, 0 };
+			Expected<BackupStore::PruneResult> result = store.prune(policy, 3000);
+			if (pPipe != NULL)
+				fclose(pPipe);
+			backup.join();
+			Assert::AreEqual(first.size(), written);
+			Assert::AreEqual<long>(ERROR_LOCK_VIOLATION, result.error().errorCode());
+			Assert::IsTrue(isCopied);
+
+			// Once it is done, the copy keeps the chunks of the first version.
+			result = store.prune(policy, 3000);
+			Assert::IsTrue(result.hasValue());
+			Assert::AreEqual<size_t>(1, result.value().versionsRemoved);
+			Assert::AreEqual<size_t>(0, result.value().chunksRemoved);
+			const wstring restored = temp.wide("restored.odt");
+			Assert::IsFalse(store.restore(temp.wide("copy.odt"), 1, restored).isError());
+			Assert::IsTrue(readData(restored) == first);
+		}
+
+		TEST_METHOD(TestPruneKeepsChunksOfUnreadableVersions)
+		{
+			TempDirectory temp;
+			BackupStore store(temp.wide("store"), smallChunks());
+			const wstring document = temp.wide("sheet.ods");
+			writeData(document, makeData(60 * 1024, 30));
+			Assert::IsTrue(store.backUp(document, 1000).hasValue());
+			const vector<BYTE> second = makeData(60 * 1024, 31);
+			writeData(document, second);
+			Assert::IsTrue(store.backUp(document, 2000).hasValue());
+
+			// Damage the newest version, e.g. by another version of AutoSave.
+			const string docs = string(temp.path) + "/store/docs";
+			DIR* pDir = opendir(docs.c_str());
+			Assert::IsNotNull(pDir);
+			string key;
+			while (const dirent* pEntry = readdir(pDir))
+			{
+				if (pEntry->d_name[0] != '.')
+					key = pEntry->d_name;
+			}
+			closedir(pDir);
+			const wstring manifest = temp.wide("store/docs/" + key + "/0000000002.version");
+			const vector<BYTE> text = readData(manifest);
+			Assert::IsFalse(text.empty());
+			writeData(manifest, vector<BYTE>(text.begin(), text.begin() + 5));
+
+			const RetentionPolicy policy = { 1, 0 };
+			Assert::AreEqual<long>(ERROR_FILE_CORRUPT,
+				store.prune(policy, 3000).error().errorCode());
+			writeData(manifest, text);
+			const wstring restored = temp.wide("restored.ods");
+			Assert::IsFalse(store.restore(document, 2, restored).isError());
+			Assert::IsTrue(readData(restored) == second);
+		}
+
+		TEST_METHOD(TestBackupWorker)
+		{
+			TempDirectory temp;
+			const wstring document = temp.wide("drawing.svg");
+			writeData(document, makeData(20 * 1024, 6));
+			RetentionPolicy policy = { 5, 0 };
+			BackupWorker worker(temp.wide("store"), policy, smallChunks());
+
+			worker.request({ document, document });
+			worker.waitUntilIdle();
+			worker.request({ document, temp.wide("missing.svg") });
+			worker.waitUntilIdle();
+
+			const BackupWorker::Stats stats = worker.getStats();
+			Assert::IsTrue(stats.backups + stats.unchanged == 2);
+			Assert::AreEqual<UINT>(1, stats.backups);
+			Assert::AreEqual<UINT>(1, stats.failures);
+			Assert::AreEqual<ULONGLONG>(20 * 1024, stats.storedBytes);
+			Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND, stats.lastError.errorCode());
+		}
+#endif
+	};
+}
@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "BoundedRegex.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	// Patterns that once tripped up a regex engine somewhere,
+	// plus the usual suspects for catastrophic backtracking.
+	struct RegexCase {
+		const wchar_t* pattern;
+		const wchar_t* text;
+		bool isMatch;
+	};
+
+	static const RegexCase regexCorpus[] = {
+		{ L"abc", L"xxabcxx", true },
+		{ L"abc", L"ABC", true },
+		{ L"^abc", L"xabc", false },
+		{ L"abc$", L"abcx", false },
+		{ L"a.c", L"a\nc", false },
+		{ L"a*", L"bbb", false }, // match_not_null
+		{ L"a*", L"bab", true },
+		{ L"x?", L"", false },
+		{ L"\\bfoo\\b", L"a foo b", true },
+		{ L"\\bfoo\\b", L"afoob", false },
+		{ L"\\Bfoo", L"afoo", true },
+		{ L"[[:alnum:]]+x", L"..9x", true },
+		{ L"[^[:alpha:]]", L"abc", false },
+		{ L"[a-c]{2,3}d", L"abcd", true },
+		{ L"[a-c]{3}d", L"abd", false },
+		{ L"\\d+\\s\\w", L"12 a", true },
+		{ L"\\D\\S\\W", L"a1b", false },
+		{ L"(a|b|c)+", L"xyz", false },
+		{ L"(?:ab)+c", L"ababc", true },
+		{ L"a+?b", L"aaab", true },
+		{ L"\\x41\\u0042", L"ab", true },
+		{ L"[\\]a]", L"]", true },
+		{ L"(a+)+$", L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa!", false },
+		{ L"(a|aa)+$", L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa!", false },
+		{ L"(a|a?)+$", L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa!", false },
+		{ L"(\\w+\\s?)*$", L"An extremely long window caption for sure!", false },
+		{ L"(x+x+)+y", L"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx", false },
+		{ L"(.*a){12}", L"aaaaaaaaaaab", false },
+		{ L"(.*a){12}", L"aaaaaaaaaaaa", true },
+		{ L"^(([a-z])+.)+[A-Z]([a-z])+$", L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaa!", false },
+	};
+
+	TEST_CLASS(BoundedRegexTests)
+	{
+	public:
+
+		TEST_METHOD(TestBoundedRegexCorpus)
+		{
+			for (const auto& c : regexCorpus)
+			{
+				BoundedRegex re;
+				Assert::IsTrue(re.compile(c.pattern, true), c.pattern);
+				auto expected = c.isMatch ? BoundedRegex::MATCH : BoundedRegex::NO_MATCH;
+				Assert::AreEqual<int>(expected, re.search(c.text, 100000), c.pattern);
+			}
+		}
+
+		TEST_METHOD(TestBoundedRegexCorpusAgreesWithStdRegex)
+		{
+			for (const auto& c : regexCorpus)
+			{
+				// Skip the cases that std::regex needs ages for.
+				if (wcslen(c.text) > 12)
+					continue;
+				wregex re(c.pattern, regex_constants::icase | regex_constants::ECMAScript);
+				Assert::AreEqual(c.isMatch, regex_search(c.text, re,
+					regex_constants::match_not_null), c.pattern);
+			}
+		}
+
+		TEST_METHOD(TestBoundedRegexRejectsBacktrackingConstructs)
+		{
+			BoundedRegex re;
+			Assert::IsFalse(re.compile(L"(a)\\1", true));
+			Assert::IsTrue(re.isEmpty());
+			Assert::IsFalse(re.compile(L"a(?=b)", true));
+			Assert::IsFalse(re.compile(L"a(?!b)", true));
+			Assert::IsFalse(re.compile(L"(bad] regex", true));
+			Assert::IsFalse(re.compile(L"a{100000}", true)); // Too big.
+		}
+
+		TEST_METHOD(TestBoundedRegexIsLinear)
+		{
+			BoundedRegex re;
+			Assert::IsTrue(re.compile(L"(a+)+$", true));
+
+			wstring text(1000, L'a');
+			text += L'!';
+			Assert::AreEqual<int>(BoundedRegex::NO_MATCH, re.search(text, 10000000));
+			unsigned long shortSteps = re.getLastStepCount();
+
+			text.insert(0, 9000, L'a');
+			Assert::AreEqual<int>(BoundedRegex::NO_MATCH, re.search(text, 10000000));
+			unsigned long longSteps = re.getLastStepCount();
+
+			// Ten times the text, roughly ten times the work.
+			Assert::IsTrue(longSteps < shortSteps * 12);
+		}
+
+		TEST_METHOD(TestBoundedRegexBudget)
+		{
+			BoundedRegex re;
+			Assert::IsTrue(re.compile(L"a{1000}b", true));
+
+			wstring text(5000, L'a');
+			Assert::AreEqual<int>(BoundedRegex::BUDGET_EXCEEDED, re.search(text, 100000));
+			Assert::IsTrue(re.getLastStepCount() <= 100001);
+			Assert::AreEqual<int>(BoundedRegex::NO_MATCH, re.search(text, 100000000));
+			text += L'b';
+			Assert::AreEqual<int>(BoundedRegex::MATCH, re.search(text, 100000000));
+		}
+
+		// Differential fuzzing: random small patterns over a small alphabet
+		// must match exactly what std::regex matches.
+		TEST_METHOD(TestBoundedRegexFuzzAgainstStdRegex)
+		{
+			m_seed = 12345;
+			for (int i = 0; i < 500; ++i)
+			{
+				wstring pattern = randomAlternative(0);
+				wregex stdRe(pattern, regex_constants::icase |
+					regex_constants::nosubs | regex_constants::ECMAScript);
+				BoundedRegex re;
+				Assert::IsTrue(re.compile(pattern, true), pattern.c_str());
+
+				for (int j = 0; j < 10; ++j)
+				{
+					wstring text = randomText();
+					bool expected = regex_search(text, stdRe,
+						regex_constants::match_any | regex_constants::match_not_null);
+					bool actual = re.search(text, 1000000) == BoundedRegex::MATCH;
+					if (expected != actual)
+					{
+						Assert::Fail((L"Pattern \"" + pattern + L"\", text \"" +
+							text + L"\"").c_str());
+					}
+				}
+			}
+		}
+
+	private:
+		// A tiny LCG, so the sequence is the same with every standard library.
+		unsigned random(unsigned n)
+		{
+			m_seed = m_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+			return (unsigned) ((m_seed >> 33) % n);
+		}
+
+		wstring randomAlternative(int depth)
+		{
+			wstring result;
+			int atoms = 1 + random(3);
+			for (int i = 0; i < atoms; ++i)
+			{
+				result += randomAtom(depth);
+			}
+			if (random(5) == 0)
+				result += L"|" + randomAlternative(depth + 1);
+			return result;
+		}
+
+		wstring randomAtom(int depth)
+		{
+			static const wchar_t* atoms[] = {
+				L"a", L"b", L"c", L".", L"[ab]", L"[^a]", L"\\d", L"x",
+				L"A", L"\\w", L"\\s", L"[a-c]", L"\\b", L"^", L"$"
+			};
+			static const wchar_t* quantifiers[] = {
+				L"", L"", L"", L"*", L"+", L"?", L"{1,2}", L"{2}", L"*?"
+			};
+			wstring atom;
+			if (depth < 3 && random(5) == 0)
+				atom = L"(" + randomAlternative(depth + 1) + L")";
+			else
+				atom = atoms[random(15)];
+			wstring quantifier = quantifiers[random(9)];
+			if (atom != L"^" && atom != L"$" && atom != L"\\b")
+				atom += quantifier;
+			return atom;
+		}
+
+		wstring randomText()
+		{
+			static const wchar_t alphabet[] = L"abcxAB1 _";
+			wstring text;
+			int length = random(8);
+			for (int i = 0; i < length; ++i)
+			{
+				text += alphabet[random(9)];
+			}
+			return text;
+		}
+
+		unsigned long long m_seed;
+	};
+}
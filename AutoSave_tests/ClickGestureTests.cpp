@@ -0,0 +1,111 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ClickGesture.h"
+#include "DesktopSimulator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(ClickGestureTests)
+	{
+	public:
+
+		typedef ClickGesture CG;
+
+		TEST_METHOD(TestSingleClickWaitsForDoubleClickTime)
+		{
+			VirtualClock clock;
+			clock.setTime(10000);
+			CG clicks(clock, 500, 1000);
+			Assert::AreEqual<UINT>(0, clicks.getTimeout());
+
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onButtonDown(CG::BT_LEFT, 3, 4));
+			Assert::AreEqual<UINT>(1000, clicks.getTimeout());
+			clock.advance(100);
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onButtonUp(CG::BT_LEFT, 3, 4));
+			Assert::AreEqual<UINT>(400, clicks.getTimeout());
+
+			// An early timer changes nothing.
+			clock.advance(300);
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onTimer());
+			Assert::AreEqual<UINT>(100, clicks.getTimeout());
+			// A late one still counts.
+			clock.advance(250);
+			Assert::AreEqual<UINT>(1, clicks.getTimeout());
+			Assert::AreEqual<int>(CG::GS_CLICK, clicks.onTimer());
+			Assert::AreEqual(3, clicks.getX());
+			Assert::AreEqual(4, clicks.getY());
+			Assert::AreEqual<UINT>(0, clicks.getTimeout());
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onTimer());
+		}
+
+		TEST_METHOD(TestDoubleClick)
+		{
+			VirtualClock clock;
+			CG clicks(clock, 500, 1000);
+			clicks.onButtonDown(CG::BT_LEFT, 7, 8);
+			clock.advance(80);
+			clicks.onButtonUp(CG::BT_LEFT, 7, 8);
+			clock.advance(80);
+			Assert::AreEqual<int>(CG::GS_DOUBLE_CLICK, clicks.onButtonDown(CG::BT_LEFT, 9, 9));
+			Assert::AreEqual(7, clicks.getX());
+			// Nothing more until the button is back up, however long it takes.
+			Assert::AreEqual<UINT>(0, clicks.getTimeout());
+			clock.advance(5000);
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onTimer());
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onButtonUp(CG::BT_LEFT, 9, 9));
+
+			// The way Windows does it: the second press is a double-click message.
+			clicks.onButtonDown(CG::BT_LEFT, 1, 1);
+			clicks.onButtonUp(CG::BT_LEFT, 1, 1);
+			Assert::AreEqual<int>(CG::GS_DOUBLE_CLICK, clicks.onDoubleClick(CG::BT_LEFT, 1, 1));
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onButtonUp(CG::BT_LEFT, 1, 1));
+			clock.advance(1000);
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onTimer());
+		}
+
+		TEST_METHOD(TestLongPress)
+		{
+			VirtualClock clock;
+			CG clicks(clock, 500, 1000);
+			clicks.onButtonDown(CG::BT_LEFT, 5, 5);
+			clock.advance(1000);
+			Assert::AreEqual<int>(CG::GS_LONG_PRESS, clicks.onTimer());
+			clock.advance(2000);
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onButtonUp(CG::BT_LEFT, 5, 5));
+			Assert::AreEqual<UINT>(0, clicks.getTimeout());
+
+			// Shorter than that, but longer than a double click: just a click.
+			clicks.onButtonDown(CG::BT_LEFT, 5, 5);
+			clock.advance(700);
+			Assert::AreEqual<int>(CG::GS_CLICK, clicks.onButtonUp(CG::BT_LEFT, 5, 5));
+
+			// Without long presses, holding the button is a slow click.
+			clicks.setLongPressTime(0);
+			clicks.onButtonDown(CG::BT_LEFT, 5, 5);
+			Assert::AreEqual<UINT>(0, clicks.getTimeout());
+			clock.advance(3000);
+			Assert::AreEqual<int>(CG::GS_CLICK, clicks.onButtonUp(CG::BT_LEFT, 5, 5));
+		}
+
+		TEST_METHOD(TestOtherButtons)
+		{
+			VirtualClock clock;
+			CG clicks(clock, 500, 1000);
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onButtonDown(CG::BT_MIDDLE, 1, 2));
+			Assert::AreEqual<int>(CG::GS_MIDDLE_CLICK, clicks.onButtonUp(CG::BT_MIDDLE, 1, 2));
+			Assert::AreEqual<int>(CG::GS_RIGHT_CLICK, clicks.onButtonUp(CG::BT_RIGHT, 3, 4));
+			Assert::AreEqual(3, clicks.getX());
+
+			// They cancel a pending left click.
+			clicks.onButtonDown(CG::BT_LEFT, 5, 5);
+			clicks.onButtonUp(CG::BT_LEFT, 5, 5);
+			Assert::AreEqual<int>(CG::GS_RIGHT_CLICK, clicks.onButtonUp(CG::BT_RIGHT, 5, 5));
+			Assert::AreEqual<UINT>(0, clicks.getTimeout());
+			clock.advance(1000);
+			Assert::AreEqual<int>(CG::GS_NONE, clicks.onTimer());
+		}
+
+	};
+}
@@ -68,6 +68,22 @@ namespace AutoSave_tests
 			Assert::IsTrue(cli.getLArgs().empty(), L"empty largs test");
 		}
 
+		TEST_METHOD(TestCLITryParse)
+		{
+			CommandLineParser cli;
+			cli.setAllowedKeys(L"IHF");
+
+			Assert::IsFalse(cli.tryParse(L"/I 10 par1 par2").isError());
+			Assert::AreEqual<size_t>(2, cli.getLArgs().size());
+			Assert::IsTrue(cli.kwArgsContain(L'I'));
+
+			ErrorCode error = cli.tryParse(L"/X 10 par1");
+			Assert::IsTrue(error.hResult() == E_INVALIDARG);
+			Assert::IsFalse(cli.gotArgs(), L"not cleared");
+			Assert::IsTrue(cli.tryParse(L"/I 10 /H").isError());
+			Assert::IsFalse(cli.gotArgs(), L"not cleared");
+		}
+
 		TEST_METHOD(TestCLIGetters)
 		{
 			CommandLineParser cli;
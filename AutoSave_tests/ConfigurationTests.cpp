@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "CppUnitTest.h"
 #include "Configuration.h"
+#include "RegistryAccess.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -87,6 +88,19 @@ namespace AutoSave_tests
 			closeConnectedProcess(cfg);
 		}
 
+		TEST_METHOD(TestCfgIsConnectingCommandLine)
+		{
+			Assert::IsTrue(Configuration::isConnectingCommandLine(
+				LR"(/I 60 C:\Windows\System32\notepad.exe)"));
+			Assert::IsFalse(Configuration::isConnectingCommandLine(L""));
+			Assert::IsFalse(Configuration::isConnectingCommandLine(L"/I 60"));
+			// The filter wins over the application.
+			Assert::IsFalse(Configuration::isConnectingCommandLine(
+				LR"(/R gimp C:\Windows\System32\notepad.exe)"));
+			Assert::IsFalse(Configuration::isConnectingCommandLine(L"/Q status x"));
+			Assert::IsFalse(Configuration::isConnectingCommandLine(L"/I notepad.exe"));
+		}
+
 		TEST_METHOD(TestCfgWindowMatch)
 		{
 			Configuration connectedCfg, filteredCfg;
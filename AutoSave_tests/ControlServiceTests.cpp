@@ -0,0 +1,155 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ControlService.h"
+#include "Configuration.h"
+#include "DesktopSimulator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(ControlServiceTests)
+	{
+	public:
+
+		static ControlService::Status makeStatus()
+		{
+			ControlService::Status status = {
+				true, false, false, L"SAI - ", 300, 42, 0, false
+			};
+			return status;
+		}
+
+		TEST_METHOD(TestParseCommand)
+		{
+			Assert::AreEqual<int>(ControlService::CMD_STATUS,
+				ControlService::parseCommand("status"));
+			Assert::AreEqual<int>(ControlService::CMD_SAVE,
+				ControlService::parseCommand("  SAVE\r"));
+			Assert::AreEqual<int>(ControlService::CMD_RELOAD,
+				ControlService::parseCommand("Reload"));
+			Assert::AreEqual<int>(ControlService::CMD_UNKNOWN,
+				ControlService::parseCommand("save now"));
+			Assert::AreEqual<int>(ControlService::CMD_UNKNOWN,
+				ControlService::parseCommand(""));
+			for (int command = ControlService::CMD_STATUS;
+				command <= ControlService::CMD_QUIT; ++command)
+			{
+				Assert::AreEqual(command, (int) ControlService::parseCommand(
+					ControlService::getCommandName((ControlService::Command) command)));
+			}
+		}
+
+		TEST_METHOD(TestHandleStatusAndMetrics)
+		{
+			Metrics metrics;
+			metrics.count(Metrics::MC_SAVES, 7);
+			VirtualClock clock;
+			clock.setTime(100000);
+			ControlService service(metrics, clock, ControlService::CommandHandler());
+
+			ControlService::Status status = makeStatus();
+			status.target = L"Stra\u00dfe\nzwei";
+			status.lastSaveTime = 40000;
+			service.setStatus(status);
+			Assert::AreEqual(string(
+				"ok\n"
+				"enabled=1\n"
+				"paused=0\n"
+				"connected=0\n"
+				"target=Stra\xc3\x9f" "e zwei\n"
+				"interval=300\n"
+				"seconds_left=42\n"
+				"seconds_since_save=60\n"), service.handle("status"));
+
+			string answer = service.handle("metrics\n");
+			Assert::AreEqual(0, answer.compare(0, 3, "ok\n"));
+			Assert::IsTrue(answer.find("saves") != string::npos);
+			Assert::IsTrue(answer.find(" 7\n") != string::npos);
+
+			Assert::AreEqual(string("error unknown command\n"), service.handle("exit"));
+		}
+
+		TEST_METHOD(TestHandlePassesOnCommands)
+		{
+			Metrics metrics;
+			VirtualClock clock;
+			vector<ControlService::Command> commands;
+			ControlService service(metrics, clock,
+				[&commands](ControlService::Command command) {
+					commands.push_back(command);
+				});
+
+			Assert::AreEqual(string("ok\n"), service.handle("pause"));
+			Assert::AreEqual(string("ok\n"), service.handle("resume"));
+			Assert::AreEqual(string("ok\n"), service.handle("save"));
+			Assert::AreEqual(string("ok\n"), service.handle("reload"));
+			service.handle("status");
+			service.handle("bogus");
+			Assert::AreEqual<size_t>(4, commands.size());
+			Assert::AreEqual<int>(ControlService::CMD_PAUSE, commands[0]);
+			Assert::AreEqual<int>(ControlService::CMD_RELOAD, commands[3]);
+		}
+
+		TEST_METHOD(TestToUtf8)
+		{
+			Assert::AreEqual(string("abc"), ControlService::toUtf8(L"abc"));
+			Assert::AreEqual(string("\xe2\x82\xac"), ControlService::toUtf8(L"\u20ac"));
+			Assert::AreEqual(string("\xf0\x9f\x92\xbe"),
+				ControlService::toUtf8(L"\U0001f4be"));
+			// A lone surrogate can't be encoded.
+			wstring lone(1, (wchar_t) 0xd800);
+			Assert::AreEqual(string("\xef\xbf\xbd"), ControlService::toUtf8(lone));
+		}
+
+		TEST_METHOD(TestRoundTripOverEndpoint)
+		{
+			Metrics metrics;
+			VirtualClock clock;
+			ControlService service(metrics, clock, ControlService::CommandHandler());
+			service.setStatus(makeStatus());
+			// Mustn't meet a running AutoSave, or another test run.
+			const wstring name = L"AutoSave-test-" +
+				to_wstring(Platform::getClock().getTickCount());
+
+			unique_ptr<ControlServer> pServer = Platform::startControlServer(name,
+				[&service](const string& request) { return service.handle(request); });
+			Assert::IsTrue(pServer != NULL);
+
+			string answer = Platform::sendControlRequest(name, "status");
+			Assert::AreEqual(0, answer.compare(0, 3, "ok\n"));
+			Assert::IsTrue(answer.find("seconds_left=42\n") != string::npos);
+			Assert::AreEqual(string("error unknown command\n"),
+				Platform::sendControlRequest(name, "hello"));
+
+			// Only one instance may serve a name.
+			Assert::IsTrue(Platform::startControlServer(name,
+				[](const string&) { return string(); }) == NULL);
+
+			pServer.reset();
+			Assert::ExpectException<AutoSaveException>([&name]() {
+				Platform::sendControlRequest(name, "status");
+			});
+			// And once it's gone, the next one can take over.
+			pServer = Platform::startControlServer(name,
+				[](const string&) { return string("ok\n"); });
+			Assert::IsTrue(pServer != NULL);
+			Assert::AreEqual(string("ok\n"), Platform::sendControlRequest(name, "save"));
+		}
+
+		TEST_METHOD(TestClientModeFromCommandLine)
+		{
+			Configuration cfg;
+			cfg.loadFromCommandLine(L"/Q status /I 322");
+			Assert::AreEqual(wstring(L"status"), cfg.controlRequest);
+			// Nothing else is applied; the request goes to another instance.
+			Assert::AreNotEqual<UINT>(322, cfg.settings.getInterval());
+			Assert::IsFalse(cfg.connection.isConnected());
+
+			Configuration copy(cfg);
+			Assert::AreEqual(wstring(L"status"), copy.controlRequest);
+		}
+
+	};
+}
@@ -0,0 +1,90 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "Countdown.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(CountdownTests)
+	{
+	public:
+
+		TEST_METHOD(TestCountdownDoesNothingUntilStarted)
+		{
+			Countdown countdown(10);
+			Assert::IsFalse(countdown.isStarted());
+			Assert::AreEqual<int>(Countdown::EV_NONE, countdown.step());
+			Assert::AreEqual<UINT>(0, countdown.getSecondsLeft());
+		}
+
+		TEST_METHOD(TestCountdownEvents)
+		{
+			Countdown countdown(7);
+			countdown.start();
+			Assert::AreEqual<UINT>(7, countdown.getSecondsLeft());
+
+			Assert::AreEqual<int>(Countdown::EV_NONE, countdown.step());
+			Assert::AreEqual<int>(Countdown::EV_FIVESECONDSLEFT, countdown.step());
+			for (UINT secondsLeft = 4; secondsLeft > 0; --secondsLeft)
+			{
+				Assert::AreEqual<int>(Countdown::EV_LESSTHANFIVELEFT, countdown.step());
+				Assert::AreEqual(secondsLeft, countdown.getSecondsLeft());
+			}
+			Assert::AreEqual<int>(Countdown::EV_ATZERO, countdown.step());
+
+			// Stays at zero until reset.
+			Assert::AreEqual<int>(Countdown::EV_ATZERO, countdown.step());
+			countdown.resetCountdown();
+			Assert::AreEqual<UINT>(7, countdown.getSecondsLeft());
+		}
+
+		TEST_METHOD(TestCountdownDelay)
+		{
+			Countdown countdown(10);
+			countdown.start();
+			countdown.resetDelay();
+
+			for (UINT i = 1; i < Countdown::delayTime; ++i)
+			{
+				Assert::AreEqual<int>(Countdown::EV_NONE, countdown.step());
+			}
+			Assert::AreEqual<int>(Countdown::EV_DELAYATZERO, countdown.step());
+			Assert::AreEqual<UINT>(10, countdown.getSecondsLeft());
+
+			countdown.step();
+			Assert::AreEqual<UINT>(9, countdown.getSecondsLeft());
+		}
+
+		TEST_METHOD(TestCountdownPauseAndStop)
+		{
+			Countdown countdown(10);
+			Assert::IsFalse(countdown.pause());
+			countdown.start();
+
+			Assert::IsTrue(countdown.pause());
+			Assert::IsFalse(countdown.pause());
+			Assert::IsFalse(countdown.isRunning());
+			countdown.step();
+			Assert::AreEqual<UINT>(10, countdown.getSecondsLeft());
+
+			Assert::IsTrue(countdown.resume());
+			Assert::IsFalse(countdown.resume());
+			countdown.step();
+			Assert::AreEqual<UINT>(9, countdown.getSecondsLeft());
+
+			countdown.stop();
+			Assert::IsFalse(countdown.isStarted());
+			Assert::AreEqual<int>(Countdown::EV_NONE, countdown.step());
+		}
+
+		TEST_METHOD(TestCountdownShortInterval)
+		{
+			Countdown countdown(1);
+			countdown.start();
+			Assert::AreEqual<int>(Countdown::EV_ATZERO, countdown.step());
+		}
+
+	};
+}
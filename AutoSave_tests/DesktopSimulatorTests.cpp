@@ -0,0 +1,672 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "DesktopSimulator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	const ULONGLONG second = 1000;
+	const ULONGLONG minute = 60 * second;
+	const ULONGLONG hour = 60 * minute;
+
+	TEST_CLASS(DesktopSimulatorTests)
+	{
+	public:
+
+		static Configuration makeConfiguration(UINT interval,
+			MiscSettings::Verbosity verbosity = MiscSettings::QUIET)
+		{
+			Configuration cfg;
+			cfg.settings.setInterval(interval);
+			cfg.settings.setHotkey(MAKEWORD('S', HOTKEYF_CONTROL));
+			cfg.settings.setVerbosity(verbosity);
+			cfg.filter.setFilter(L"Notepad", false);
+			return cfg;
+		}
+
+		TEST_METHOD(TestSimulatedDesktop)
+		{
+			SimulatedDesktop desktop;
+			Assert::IsTrue(desktop.getForegroundWindow() == 0);
+			HWND a = desktop.openWindow(L"a", 10);
+			HWND b = desktop.openWindow(L"b", 20, false);
+			Assert::IsTrue(desktop.getForegroundWindow() == b);
+			Assert::AreEqual(wstring(L"a"), desktop.getWindowText(a));
+			Assert::AreEqual<DWORD>(20, desktop.getWindowProcessId(b));
+			Assert::IsFalse(desktop.isWindowVisible(b));
+
+			desktop.setForeground(a);
+			desktop.closeWindow(a);
+			Assert::IsTrue(desktop.getForegroundWindow() == 0);
+			Assert::AreEqual(wstring(), desktop.getWindowText(a));
+
+			vector<HWND> enumerated;
+			desktop.enumWindows([&](HWND hwnd) {
+				enumerated.push_back(hwnd);
+				return true;
+			});
+			Assert::AreEqual<size_t>(1, enumerated.size());
+			Assert::IsTrue(enumerated[0] == b);
+		}
+
+		TEST_METHOD(TestSimulatedDesktopReportsForegroundChanges)
+		{
+			SimulatedDesktop desktop;
+			vector<HWND> reported;
+			Assert::IsTrue(desktop.startWatching([&](HWND hwnd) {
+				reported.push_back(hwnd);
+			}));
+			HWND a = desktop.openWindow(L"a");
+			HWND b = desktop.openWindow(L"b");
+			desktop.setForeground(b);
+			desktop.setForeground(a);
+			desktop.closeWindow(b);
+			desktop.closeWindow(a);
+			desktop.stopWatching();
+			desktop.openWindow(L"c");
+
+			vector<HWND> expected = { a, b, a, 0 };
+			Assert::IsTrue(reported == expected);
+		}
+
+		TEST_METHOD(TestSimulatedDesktopMinimizes)
+		{
+			SimulatedDesktop desktop;
+			HWND a = desktop.openWindow(L"a");
+			HWND b = desktop.openWindow(L"b");
+			desktop.minimizeWindow(a);
+			Assert::IsTrue(desktop.getForegroundWindow() == b);
+			desktop.minimizeWindow(b);
+			Assert::IsTrue(desktop.getForegroundWindow() == 0);
+			Assert::IsTrue(desktop.isWindowMinimized(a));
+			Assert::IsTrue(desktop.isWindowVisible(a));
+
+			desktop.setForeground(a);
+			Assert::IsFalse(desktop.isWindowMinimized(a));
+			Assert::IsTrue(desktop.isWindowMinimized(b));
+		}
+
+		TEST_METHOD(TestSavesEveryIntervalWhileTargetIsForeground)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			HWND notepad = sim.getDesktop().openWindow(L"Untitled - Notepad");
+			sim.start();
+			sim.runFor(hour);
+
+			const auto& saves = sim.getSaves();
+			Assert::AreEqual<size_t>(60, saves.size());
+			for (size_t i = 0; i < saves.size(); ++i)
+			{
+				Assert::AreEqual((i + 1) * minute, saves[i].time);
+				Assert::IsTrue(saves[i].target == notepad);
+				Assert::IsTrue(saves[i].events == KeySequence::fromHotkey(
+					sim.getConfiguration().settings.getHotkey()));
+			}
+		}
+
+		TEST_METHOD(TestPacesInputForTargetProgram)
+		{
+			Configuration cfg = makeConfiguration(60);
+			cfg.filter.setFilter(L"Illustrator", false);
+			DesktopSimulator sim(cfg);
+			HWND illustrator = sim.getDesktop().openWindow(L"poster.ai - Illustrator");
+			sim.getDesktop().setExecutable(illustrator, L"Illustrator.exe");
+			sim.start();
+			sim.runFor(minute);
+
+			// Ctrl+S, one event at a time.
+			const auto& records = sim.getSaves();
+			Assert::AreEqual<size_t>(4, records.size());
+			for (size_t i = 0; i < records.size(); ++i)
+			{
+				Assert::AreEqual<size_t>(1, records[i].events.size());
+				Assert::AreEqual<DWORD>(i < 3 ? 10 : 0, records[i].waitAfter);
+			}
+		}
+
+		TEST_METHOD(TestSendsKeyMacro)
+		{
+			Configuration cfg = makeConfiguration(60);
+			cfg.settings.setKeyMacro(L"ctrl+s, wait 500, enter");
+			DesktopSimulator sim(cfg);
+			sim.getDesktop().openWindow(L"Untitled - Notepad");
+			sim.start();
+			sim.runFor(minute);
+
+			const auto& records = sim.getSaves();
+			Assert::AreEqual<size_t>(2, records.size());
+			Assert::AreEqual<DWORD>(500, records[0].waitAfter);
+			Assert::IsTrue(records[1].events == KeySequence::fromHotkey(VK_RETURN));
+		}
+
+		// The user comes back to Notepad five minutes after zero.
+		static void waitAtZero(DesktopSimulator& sim, ULONGLONG activation)
+		{
+			HWND notepad = sim.getDesktop().openWindow(L"Untitled - Notepad");
+			sim.getDesktop().openWindow(L"Inbox - Mail");
+			sim.start();
+			sim.at(activation, [&sim, notepad]() {
+				sim.getDesktop().setForeground(notepad);
+			});
+			sim.runUntil(activation + 2 * second);
+		}
+
+		TEST_METHOD(TestPollsForegroundAtZeroWithoutEvents)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			const ULONGLONG activation = 6 * minute + 500;
+			waitAtZero(sim, activation);
+
+			Assert::AreEqual<size_t>(1, sim.getSaves().size());
+			Assert::AreEqual<ULONGLONG>(activation + 500, sim.getSaves()[0].time);
+			const Metrics& metrics = sim.getMetrics();
+			Assert::AreEqual<ULONGLONG>(301, metrics.getCounter(Metrics::MC_TICKS_AT_ZERO));
+			Assert::AreEqual<ULONGLONG>(0,
+				metrics.getHistogram(Metrics::MH_ACTIVATION_DELAY).getCount());
+		}
+
+		TEST_METHOD(TestFiresOnForegroundChangeAtZero)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			sim.reportForegroundChanges(true, 15);
+			const ULONGLONG activation = 6 * minute + 500;
+			waitAtZero(sim, activation);
+
+			Assert::AreEqual<size_t>(1, sim.getSaves().size());
+			Assert::AreEqual<ULONGLONG>(activation + 15, sim.getSaves()[0].time);
+			const Metrics& metrics = sim.getMetrics();
+			const LatencyHistogram& delays =
+				metrics.getHistogram(Metrics::MH_ACTIVATION_DELAY);
+			Assert::AreEqual<ULONGLONG>(1, delays.getCount());
+			Assert::AreEqual<ULONGLONG>(0, delays.getMax());
+			// The timer slept through the wait, and ticks again after it.
+			Assert::AreEqual<ULONGLONG>(1, metrics.getCounter(Metrics::MC_TICKS_AT_ZERO));
+			Assert::AreEqual<ULONGLONG>(61, metrics.getCounter(Metrics::MC_TICKS));
+			Assert::AreEqual<UINT>(59, sim.getCountdown().getSecondsLeft());
+		}
+
+		TEST_METHOD(TestWaitsForKeysAfterForegroundChange)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			sim.reportForegroundChanges(true);
+			const ULONGLONG activation = 2 * minute;
+			// Alt+Tab: Alt is still down when the window comes to the front.
+			sim.at(activation - 50, [&sim]() { sim.getInput().pressKey(VK_MENU); });
+			sim.at(activation + 250, [&sim]() { sim.getInput().releaseKey(VK_MENU); });
+			waitAtZero(sim, activation);
+
+			Assert::AreEqual<size_t>(1, sim.getSaves().size());
+			Assert::AreEqual<ULONGLONG>(activation + 300, sim.getSaves()[0].time);
+			Assert::AreEqual<ULONGLONG>(300, sim.getMetrics().getHistogram(
+				Metrics::MH_ACTIVATION_DELAY).getMax());
+		}
+
+		TEST_METHOD(TestGivesUpOnForegroundChangeWithoutMatch)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			sim.reportForegroundChanges(true);
+			HWND notepad = sim.getDesktop().openWindow(L"Untitled - Notepad");
+			HWND mail = sim.getDesktop().openWindow(L"Inbox - Mail");
+			HWND browser = sim.getDesktop().openWindow(L"News - Browser");
+			sim.start();
+			sim.at(2 * minute, [&sim, notepad]() { sim.getDesktop().closeWindow(notepad); });
+			sim.at(3 * minute, [&sim, mail]() { sim.getDesktop().setForeground(mail); });
+			sim.runUntil(3 * minute + 10 * second);
+
+			Assert::AreEqual<size_t>(0, sim.getSaves().size());
+			const Metrics& metrics = sim.getMetrics();
+			Assert::AreEqual<ULONGLONG>(1, metrics.getCounter(Metrics::MC_COUNTDOWN_RESETS));
+			Assert::AreEqual<ULONGLONG>(1, metrics.getCounter(Metrics::MC_FOREGROUND_CHANGES));
+			// Counting down again.
+			Assert::AreEqual<UINT>(50, sim.getCountdown().getSecondsLeft());
+			Assert::IsTrue(browser != 0);
+		}
+
+		static Configuration makeTriggerConfiguration(int triggers)
+		{
+			Configuration cfg = makeConfiguration(10 * 60);
+			cfg.settings.setTriggers(triggers);
+			cfg.settings.setBackgroundDelay(30);
+			cfg.settings.setTriggerDedupe(60);
+			return cfg;
+		}
+
+		// Notepad first, then Mail, and back to Notepad.
+		static void switchAway(DesktopSimulator& sim, ULONGLONG away,
+			ULONGLONG back)
+		{
+			sim.at(away, [&sim]() {
+				sim.getDesktop().setForeground((HWND) 2);
+			});
+			sim.at(back, [&sim]() {
+				sim.getDesktop().setForeground((HWND) 1);
+			});
+		}
+
+		static void openNotepadAndMail(DesktopSimulator& sim)
+		{
+			HWND notepad = sim.getDesktop().openWindow(L"Untitled - Notepad");
+			HWND mail = sim.getDesktop().openWindow(L"Inbox - Mail");
+			sim.getDesktop().setForeground(notepad);
+			Assert::IsTrue(notepad == (HWND) 1 && mail == (HWND) 2);
+		}
+
+		TEST_METHOD(TestSavesOnReturnAfterLeaving)
+		{
+			DesktopSimulator sim(makeTriggerConfiguration(MiscSettings::TRIG_LEAVE));
+			openNotepadAndMail(sim);
+			sim.reportForegroundChanges(true);
+			sim.start();
+			switchAway(sim, 3 * minute, 5 * minute);
+			sim.runUntil(16 * minute);
+
+			// The interval is still the fallback, and starts over with the
+			// triggered save.
+			const auto& saves = sim.getSaves();
+			Assert::AreEqual<size_t>(2, saves.size());
+			Assert::AreEqual(5 * minute, saves[0].time);
+			Assert::IsTrue(saves[0].target == (HWND) 1);
+			Assert::AreEqual(15 * minute, saves[1].time);
+			const Metrics& metrics = sim.getMetrics();
+			Assert::AreEqual<ULONGLONG>(1, metrics.getCounter(Metrics::MC_TRIGGERS));
+			// The timer slept while the save was due.
+			Assert::AreEqual<ULONGLONG>(1, metrics.getCounter(Metrics::MC_TICKS_AT_ZERO));
+		}
+
+		TEST_METHOD(TestIgnoresTriggersTooSoonAfterSave)
+		{
+			DesktopSimulator sim(makeTriggerConfiguration(MiscSettings::TRIG_LEAVE));
+			openNotepadAndMail(sim);
+			sim.reportForegroundChanges(true);
+			sim.start();
+			// Alt+Tab back and forth every ten seconds.
+			for (ULONGLONG away = minute; away < 4 * minute; away += 20 * second)
+				switchAway(sim, away, away + 10 * second);
+			sim.runUntil(4 * minute);
+
+			const auto& saves = sim.getSaves();
+			Assert::AreEqual<size_t>(3, saves.size());
+			Assert::AreEqual(minute + 10 * second, saves[0].time);
+			Assert::AreEqual(2 * minute + 30 * second, saves[1].time);
+			Assert::AreEqual(3 * minute + 50 * second, saves[2].time);
+			const Metrics& metrics = sim.getMetrics();
+			Assert::AreEqual<ULONGLONG>(3, metrics.getCounter(Metrics::MC_TRIGGERS));
+			Assert::AreEqual<ULONGLONG>(6, metrics.getCounter(Metrics::MC_TRIGGERS_DEDUPED));
+		}
+
+		TEST_METHOD(TestSavesAfterStayingInBackground)
+		{
+			// Polled with each tick.
+			DesktopSimulator sim(makeTriggerConfiguration(MiscSettings::TRIG_BACKGROUND));
+			openNotepadAndMail(sim);
+			sim.start();
+			switchAway(sim, minute, minute + 20 * second);
+			switchAway(sim, 3 * minute, 5 * minute);
+			sim.runUntil(6 * minute);
+
+			const auto& saves = sim.getSaves();
+			Assert::AreEqual<size_t>(1, saves.size());
+			Assert::AreEqual(5 * minute, saves[0].time);
+			Assert::AreEqual<ULONGLONG>(1,
+				sim.getMetrics().getCounter(Metrics::MC_TRIGGERS));
+		}
+
+		TEST_METHOD(TestSavesOnRestoreAfterMinimizing)
+		{
+			DesktopSimulator sim(makeTriggerConfiguration(MiscSettings::TRIG_MINIMIZE));
+			openNotepadAndMail(sim);
+			sim.reportForegroundChanges(true, 15);
+			sim.start();
+			switchAway(sim, minute, minute + 10 * second);
+			sim.at(2 * minute, [&sim]() {
+				sim.getDesktop().minimizeWindow((HWND) 1);
+			});
+			sim.at(4 * minute, [&sim]() {
+				sim.getDesktop().setForeground((HWND) 1);
+			});
+			sim.runUntil(5 * minute);
+
+			const auto& saves = sim.getSaves();
+			Assert::AreEqual<size_t>(1, saves.size());
+			Assert::AreEqual(4 * minute + 15, saves[0].time);
+		}
+
+		TEST_METHOD(TestResetsCountdownWithoutMatchingWindow)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			sim.getDesktop().openWindow(L"Calculator");
+			sim.start();
+			sim.runFor(10 * minute);
+			Assert::IsTrue(sim.getSaves().empty());
+			// Restarted at five seconds left every time.
+			Assert::IsTrue(sim.getCountdown().getSecondsLeft() > 5);
+
+			sim.getDesktop().openWindow(L"Untitled - Notepad");
+			const ULONGLONG openedAt = sim.getClock().getTickCount();
+			sim.runFor(2 * minute);
+			Assert::IsFalse(sim.getSaves().empty());
+			Assert::IsTrue(sim.getSaves()[0].time > openedAt);
+			Assert::IsTrue(sim.getSaves()[0].time <= openedAt + minute);
+		}
+
+		TEST_METHOD(TestSkipsHungTargetAndReportsIt)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			SimulatedDesktop& desktop = sim.getDesktop();
+			HWND notepad = desktop.openWindow(L"Untitled - Notepad", 7);
+			desktop.setHung(notepad, true);
+			Assert::AreEqual(wstring(), desktop.getWindowText(notepad));
+			Assert::AreEqual(wstring(), desktop.getWindowText(notepad));
+			// Once, however often it was asked.
+			Assert::AreEqual<size_t>(1, desktop.takeUnresponsiveWindows().size());
+			Assert::IsTrue(desktop.takeUnresponsiveWindows().empty());
+
+			sim.start();
+			sim.runFor(5 * minute);
+			Assert::IsTrue(sim.getSaves().empty());
+			Assert::IsTrue(sim.getMetrics().getCounter(Metrics::MC_UNRESPONSIVE_WINDOWS) > 0);
+
+			desktop.setHung(notepad, false);
+			const ULONGLONG recoveredAt = sim.getClock().getTickCount();
+			sim.runFor(2 * minute);
+			Assert::IsFalse(sim.getSaves().empty());
+			Assert::IsTrue(sim.getSaves()[0].time <= recoveredAt + minute);
+		}
+
+		TEST_METHOD(TestDefersSaveWhileTargetIsBusy)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			SimulatedDesktop& desktop = sim.getDesktop();
+			HWND notepad = desktop.openWindow(L"Untitled - Notepad", 7);
+			desktop.setCpuLoad(notepad, 100);
+			sim.at(70 * second, [&]() { desktop.setCpuLoad(notepad, 0); });
+			sim.start();
+			sim.runFor(90 * second);
+
+			Assert::AreEqual<size_t>(1, sim.getSaves().size());
+			Assert::IsTrue(sim.getSaves()[0].time > 70 * second);
+			Assert::IsTrue(sim.getSaves()[0].time <= 70 * second + ReadinessProbe::maxProbeDelay);
+			const Metrics& metrics = sim.getMetrics();
+			Assert::IsTrue(metrics.getCounter(Metrics::MC_DEFERRED_BUSY) > 0);
+			Assert::AreEqual<ULONGLONG>(0, metrics.getCounter(Metrics::MC_DEFERRED_HUNG));
+			Assert::AreEqual<ULONGLONG>(1, metrics.getHistogram(Metrics::MH_DEFERRAL).getCount());
+			Assert::AreEqual(sim.getSaves()[0].time - minute,
+				metrics.getHistogram(Metrics::MH_DEFERRAL).getSum());
+		}
+
+		TEST_METHOD(TestDropsSaveWhileTargetDoesNotRespond)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			SimulatedDesktop& desktop = sim.getDesktop();
+			HWND notepad = desktop.openWindow(L"Untitled - Notepad", 7);
+			desktop.setResponseTime(notepad, 2000);
+			sim.reportForegroundChanges(true);
+			sim.start();
+			sim.runFor(100 * second);
+
+			Assert::IsTrue(sim.getSaves().empty());
+			const Metrics& metrics = sim.getMetrics();
+			Assert::IsTrue(metrics.getCounter(Metrics::MC_DEFERRED_HUNG) > 1);
+			Assert::AreEqual<ULONGLONG>(1, metrics.getCounter(Metrics::MC_SAVES_DROPPED));
+			// Started over rather than waiting on.
+			Assert::IsTrue(sim.getCountdown().getSecondsLeft() > 0);
+
+			desktop.setResponseTime(notepad, 0);
+			sim.runFor(minute);
+			Assert::AreEqual<size_t>(1, sim.getSaves().size());
+		}
+
+		TEST_METHOD(TestWaitsAtZeroForMatchingForegroundWindow)
+		{
+			DesktopSimulator sim(makeConfiguration(30, MiscSettings::SHOW_ICONS));
+			SimulatedDesktop& desktop = sim.getDesktop();
+			HWND notepad = desktop.openWindow(L"Untitled - Notepad");
+			HWND calc = desktop.openWindow(L"Calculator");
+			sim.start();
+
+			sim.runFor(10 * minute);
+			Assert::IsTrue(sim.getSaves().empty());
+			Assert::AreEqual<UINT>(0, sim.getCountdown().getSecondsLeft());
+			Assert::AreEqual<int>(SchedulerListener::IND_COUNT0, sim.getIndicator());
+
+			sim.at(10 * minute + 2500, [&]() { desktop.setForeground(notepad); });
+			sim.runFor(3 * second);
+			Assert::AreEqual<size_t>(1, sim.getSaves().size());
+			Assert::AreEqual(10 * minute + 3 * second, sim.getSaves()[0].time);
+			Assert::AreEqual<int>(SchedulerListener::IND_SAVED, sim.getIndicator());
+
+			// Back to the idle icon after the delay.
+			sim.runFor(Countdown::delayTime * second);
+			Assert::AreEqual<int>(SchedulerListener::IND_IDLE, sim.getIndicator());
+
+			desktop.setForeground(calc);
+			desktop.closeWindow(notepad);
+			sim.runFor(minute);
+			Assert::AreEqual<size_t>(1, sim.getSaves().size());
+		}
+
+		TEST_METHOD(TestSkipsWhileKeyIsHeld)
+		{
+			DesktopSimulator sim(makeConfiguration(20));
+			sim.getDesktop().openWindow(L"Untitled - Notepad");
+			sim.at(15 * second, [&]() { sim.getInput().pressKey(VK_SHIFT); });
+			sim.at(27 * second + 1, [&]() { sim.getInput().releaseKey(VK_SHIFT); });
+			sim.start();
+			sim.runFor(30 * second);
+
+			Assert::AreEqual<size_t>(1, sim.getSaves().size());
+			Assert::AreEqual(28 * second, sim.getSaves()[0].time);
+		}
+
+		TEST_METHOD(TestPauseStopsTheClock)
+		{
+			DesktopSimulator sim(makeConfiguration(20));
+			sim.getDesktop().openWindow(L"Untitled - Notepad");
+			sim.at(10 * second + 500, [&]() { sim.pause(); });
+			sim.at(40 * second + 500, [&]() { sim.resume(); });
+			sim.start();
+			sim.runFor(minute);
+
+			// 10 seconds before the pause, the remaining 10 after it.
+			Assert::AreEqual<size_t>(1, sim.getSaves().size());
+			Assert::AreEqual(50 * second + 500, sim.getSaves()[0].time);
+		}
+
+		TEST_METHOD(TestFiveSecondsAlert)
+		{
+			DesktopSimulator sim(makeConfiguration(60, MiscSettings::ALERT_FIVE_SECONDS));
+			sim.getDesktop().openWindow(L"Untitled - Notepad");
+			sim.start();
+			sim.runFor(55 * second);
+			Assert::IsTrue(sim.isAlertShown());
+			Assert::AreEqual<int>(SchedulerListener::IND_COUNT5, sim.getIndicator());
+			sim.runFor(5 * second);
+			Assert::IsFalse(sim.isAlertShown());
+			Assert::AreEqual<UINT>(1, sim.getAlertCount());
+		}
+
+		// An artist draws in the morning and in the afternoon, and leaves
+		// the document open over lunch and in the evening. The application
+		// writes the whole file with every save. Returns the number of
+		// writes and the longest time any input waited to be saved.
+		static ULONGLONG simulateDrawingDay(bool isAdaptive,
+			ULONGLONG* pLongestUnsaved)
+		{
+			Configuration cfg = makeConfiguration(300);
+			cfg.settings.setIntervalAdaptive(isAdaptive);
+			DesktopSimulator sim(cfg);
+			SimulatedFileSystem& files = sim.getFileSystem();
+			const wstring path = L"poster.txt";
+			files.writeFile(path, 2ULL << 30);
+			sim.getDesktop().openWindow(L"poster.txt - Notepad");
+			sim.verifySaves({ path }, 30 * second);
+			sim.getInput().setSendHandler([&](const RecordingInputSink::Record&) {
+				files.writeFile(path, 2ULL << 30);
+			});
+
+			vector<ULONGLONG> inputTimes;
+			const ULONGLONG workBegins[] = { 0, 3 * hour };
+			for (ULONGLONG begin : workBegins)
+			{
+				for (ULONGLONG t = begin + 500; t < begin + 2 * hour; t += 20 * second)
+				{
+					inputTimes.push_back(t);
+					sim.at(t, [&sim]() { sim.getInput().simulateInput(); });
+				}
+			}
+			sim.start();
+			sim.runFor(8 * hour);
+
+			const auto& saves = sim.getSaves();
+			*pLongestUnsaved = 0;
+			for (ULONGLONG input : inputTimes)
+			{
+				auto it = std::find_if(saves.begin(), saves.end(),
+					[input](const RecordingInputSink::Record& save) {
+						return save.time > input;
+					});
+				Assert::IsTrue(it != saves.end());
+				*pLongestUnsaved = __max(*pLongestUnsaved, it->time - input);
+			}
+			Assert::AreEqual<UINT>(0, sim.getSaveFailedCount());
+			return files.getWriteCount() - 1;
+		}
+
+		TEST_METHOD(TestAdaptiveIntervalReducesWrites)
+		{
+			ULONGLONG fixedUnsaved, adaptiveUnsaved;
+			ULONGLONG fixedWrites = simulateDrawingDay(false, &fixedUnsaved);
+			ULONGLONG adaptiveWrites = simulateDrawingDay(true, &adaptiveUnsaved);
+			Logger::WriteMessage((L"Writes per day: fixed " +
+				to_wstring(fixedWrites) + L", adaptive " +
+				to_wstring(adaptiveWrites)).c_str());
+
+			Assert::AreEqual<ULONGLONG>(8 * 12, fixedWrites);
+			// Four of the eight hours are idle; only a few saves fall there.
+			Assert::IsTrue(adaptiveWrites * 3 < fixedWrites * 2);
+			// No work waits longer than with the fixed interval.
+			Assert::IsTrue(fixedUnsaved <= 5 * minute);
+			Assert::IsTrue(adaptiveUnsaved <= 5 * minute + second);
+		}
+
+		// The user only scrolls through the document. The application
+		// doesn't write a file without changes, so the input doesn't count.
+		TEST_METHOD(TestAdaptiveIntervalGrowsWhileSavesWriteNothing)
+		{
+			Configuration cfg = makeConfiguration(300);
+			cfg.settings.setIntervalAdaptive(true);
+			DesktopSimulator sim(cfg);
+			sim.getFileSystem().writeFile(L"notes.txt", 100);
+			sim.getDesktop().openWindow(L"notes.txt - Notepad");
+			sim.verifySaves({ L"notes.txt" }, 30 * second, 0);
+			for (ULONGLONG t = 500; t < 2 * hour; t += 20 * second)
+				sim.at(t, [&sim]() { sim.getInput().simulateInput(); });
+			sim.start();
+			sim.runFor(2 * hour);
+
+			// Instead of 24 saves, doubling the interval after the second:
+			// after 5, 10, 20, 40, and 80 minutes, then capped at an hour.
+			const auto& saves = sim.getSaves();
+			Assert::AreEqual<size_t>(5, saves.size());
+			Assert::AreEqual(80 * minute, saves[4].time);
+			Assert::AreEqual<UINT>(3600, sim.getCountdown().getInterval());
+		}
+
+		// Saving takes 40 seconds, so a save may only come every 400.
+		TEST_METHOD(TestAdaptiveIntervalMakesRoomForSlowSaves)
+		{
+			Configuration cfg = makeConfiguration(300);
+			cfg.settings.setIntervalAdaptive(true);
+			DesktopSimulator sim(cfg);
+			SimulatedFileSystem& files = sim.getFileSystem();
+			files.writeFile(L"movie.txt", 100);
+			sim.getDesktop().openWindow(L"movie.txt - Notepad");
+			sim.verifySaves({ L"movie.txt" }, minute);
+			sim.getInput().setSendHandler([&](const RecordingInputSink::Record& save) {
+				sim.at(save.time + 40 * second, [&files]() {
+					files.writeFile(L"movie.txt", 100);
+				});
+			});
+			for (ULONGLONG t = 500; t < 2 * hour; t += 20 * second)
+				sim.at(t, [&sim]() { sim.getInput().simulateInput(); });
+			sim.start();
+			sim.runFor(2 * hour);
+
+			const auto& saves = sim.getSaves();
+			// The first save is the first to be measured.
+			Assert::IsTrue(saves.size() >= 3);
+			Assert::AreEqual(5 * minute, saves[0].time);
+			Assert::AreEqual(10 * minute, saves[1].time);
+			for (size_t i = 2; i < saves.size(); ++i)
+				Assert::IsTrue(saves[i].time - saves[i - 1].time >= 400 * second);
+			Assert::AreEqual<UINT>(0, sim.getSaveFailedCount());
+		}
+
+		// Only the files that a save wrote are reported, e.g. for backups.
+		TEST_METHOD(TestReportsFilesOfConfirmedSaves)
+		{
+			DesktopSimulator sim(makeConfiguration(60));
+			SimulatedFileSystem& files = sim.getFileSystem();
+			files.writeFile(L"notes.txt", 100);
+			files.writeFile(L"todo.txt", 100);
+			sim.getDesktop().openWindow(L"notes.txt - Notepad");
+			sim.verifySaves({ L"notes.txt", L"todo.txt" }, 30 * second);
+			sim.getInput().setSendHandler([&files](const RecordingInputSink::Record&) {
+				files.writeFile(L"todo.txt", 200);
+			});
+			sim.start();
+			sim.runFor(3 * minute + second);
+
+			const vector<vector<wstring>>& confirmed = sim.getConfirmedSaves();
+			Assert::AreEqual<size_t>(3, confirmed.size());
+			for (const vector<wstring>& saved : confirmed)
+				Assert::IsTrue(saved == vector<wstring>({ L"todo.txt" }));
+		}
+
+		// A workday of switching between windows at random.
+		// Saves only ever reach the target, and runs are repeatable.
+		TEST_METHOD(TestWorkdayIsDeterministic)
+		{
+			vector<RecordingInputSink::Record> firstRun;
+			for (int run = 0; run < 2; ++run)
+			{
+				DesktopSimulator sim(makeConfiguration(300));
+				SimulatedDesktop& desktop = sim.getDesktop();
+				vector<HWND> windows = {
+					desktop.openWindow(L"Inbox - Outlook"),
+					desktop.openWindow(L"notes.txt - Notepad"),
+					desktop.openWindow(L"Mozilla Firefox"),
+					desktop.openWindow(L"Calculator"),
+				};
+				unsigned int seed = 12345;
+				for (ULONGLONG t = 0; t < 8 * hour; )
+				{
+					seed = seed * 1103515245 + 12345;
+					t += 1 + (seed >> 8) % (10 * minute);
+					HWND next = windows[(seed >> 4) % windows.size()];
+					sim.at(t, [&desktop, next]() { desktop.setForeground(next); });
+				}
+				sim.start();
+				sim.runFor(8 * hour);
+
+				const auto& saves = sim.getSaves();
+				Assert::IsTrue(saves.size() > 10);
+				Assert::IsTrue(saves.size() <= 8 * 12);
+				for (const auto& save : saves)
+					Assert::IsTrue(save.target == windows[1]);
+
+				if (run == 0)
+				{
+					firstRun = saves;
+					continue;
+				}
+				Assert::AreEqual(firstRun.size(), saves.size());
+				for (size_t i = 0; i < saves.size(); ++i)
+					Assert::AreEqual(firstRun[i].time, saves[i].time);
+			}
+		}
+
+	};
+}
@@ -0,0 +1,242 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "EventLog.h"
+#include "DesktopSimulator.h"
+
+#include <thread>
+#include <fstream>
+#include <iterator>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	class MemorySink : public EventSink
+	{
+	public:
+		MemorySink() : flushCount(0) {}
+		virtual void write(const EventRecord* pRecords, size_t count) {
+			records.insert(records.end(), pRecords, pRecords + count);
+		}
+		virtual void flush() { ++flushCount; }
+
+		vector<EventRecord> records;
+		int flushCount;
+	};
+
+
+
+	TEST_CLASS(EventLogTests)
+	{
+	public:
+
+		TEST_METHOD(TestRecordsComeOutInOrder)
+		{
+			VirtualClock clock;
+			EventLog eventLog(clock, 5);
+			Assert::AreEqual<size_t>(8, eventLog.getCapacity());
+
+			clock.setTime(1234);
+			eventLog.record(EventLog::EV_TICK, 17);
+			clock.advance(1000);
+			eventLog.record(EventLog::EV_SEND, 2, 350, 0x42);
+
+			EventRecord records[4];
+			Assert::AreEqual<size_t>(2, eventLog.drain(records, 4));
+			Assert::AreEqual<ULONGLONG>(1234, records[0].time);
+			Assert::AreEqual<UINT>(EventLog::EV_TICK, records[0].id);
+			Assert::AreEqual<UINT>(17, records[0].arg0);
+			Assert::AreEqual<ULONGLONG>(2234, records[1].time);
+			Assert::AreEqual<ULONGLONG>(350, records[1].arg1);
+			Assert::AreEqual<ULONGLONG>(0x42, records[1].arg2);
+			Assert::AreEqual<size_t>(0, eventLog.drain(records, 4));
+		}
+
+		TEST_METHOD(TestDropsWhenFull)
+		{
+			VirtualClock clock;
+			EventLog eventLog(clock, 8);
+			for (UINT i = 0; i < 10; ++i)
+				eventLog.record(EventLog::EV_TICK, i);
+			Assert::AreEqual<ULONGLONG>(2, eventLog.getDroppedCount());
+
+			// The oldest are kept, and there's room again afterwards.
+			EventRecord records[16];
+			Assert::AreEqual<size_t>(8, eventLog.drain(records, 16));
+			Assert::AreEqual<UINT>(7, records[7].arg0);
+			for (UINT i = 0; i < 20; ++i)
+			{
+				eventLog.record(EventLog::EV_TICK, 100 + i);
+				Assert::AreEqual<size_t>(1, eventLog.drain(records, 16));
+				Assert::AreEqual<UINT>(100 + i, records[0].arg0);
+			}
+
+			MemorySink sink;
+			eventLog.record(EventLog::EV_RETRY);
+			eventLog.flushTo(sink);
+			Assert::AreEqual<size_t>(2, sink.records.size());
+			Assert::AreEqual<UINT>(EventLog::EV_DROPPED, sink.records[1].id);
+			Assert::AreEqual<ULONGLONG>(2, sink.records[1].arg1);
+			// Reported once only.
+			eventLog.flushTo(sink);
+			Assert::AreEqual<size_t>(2, sink.records.size());
+		}
+
+		TEST_METHOD(TestConcurrentProducers)
+		{
+			VirtualClock clock;
+			EventLog eventLog(clock, 1024);
+			const UINT perThread = 50000;
+			vector<thread> threads;
+			for (UINT t = 0; t < 4; ++t)
+			{
+				threads.emplace_back([&eventLog, t, perThread]() {
+					for (UINT i = 0; i < perThread; ++i)
+						eventLog.record(EventLog::EV_TICK, t, i);
+				});
+			}
+
+			MemorySink sink;
+			eventLog.startFlushing(sink, 1);
+			for (thread& t : threads)
+				t.join();
+			eventLog.stopFlushing();
+
+			// Whatever got through is complete and in order per thread.
+			ULONGLONG received = 0;
+			ULONGLONG nextIndex[4] = { 0, 0, 0, 0 };
+			for (const EventRecord& record : sink.records)
+			{
+				if (record.id == EventLog::EV_DROPPED)
+					continue;
+				Assert::AreEqual<UINT>(EventLog::EV_TICK, record.id);
+				Assert::IsTrue(record.arg0 < 4);
+				Assert::IsTrue(record.arg1 >= nextIndex[record.arg0]);
+				nextIndex[record.arg0] = record.arg1 + 1;
+				++received;
+			}
+			Assert::AreEqual<ULONGLONG>(4 * perThread,
+				received + eventLog.getDroppedCount());
+		}
+
+		TEST_METHOD(TestEncodingAndFormat)
+		{
+			EventRecord event = { 3723004, EventLog::EV_SEND, 2,
+				0x123456789aULL, 0xfedcba9876543210ULL };
+			char bytes[EventRecord::encodedSize];
+			event.encode(bytes);
+			Assert::AreEqual<int>(0xfc, (unsigned char) bytes[0]);
+			EventRecord decoded = EventRecord::decode(bytes);
+			Assert::AreEqual(event.time, decoded.time);
+			Assert::AreEqual(event.id, decoded.id);
+			Assert::AreEqual(event.arg0, decoded.arg0);
+			Assert::AreEqual(event.arg1, decoded.arg1);
+			Assert::AreEqual(event.arg2, decoded.arg2);
+
+			Assert::AreEqual(string("      3723.004 send             keys=2 "
+				"us=78187493530 window=0xfedcba9876543210"), EventLog::format(event));
+			EventRecord retry = { 5, EventLog::EV_RETRY, 0, 0, 0 };
+			Assert::AreEqual(string("         0.005 retry"), EventLog::format(retry));
+			EventRecord startup = { 1500, EventLog::EV_STARTUP, EventLog::SP_OLE, 42, 0 };
+			Assert::AreEqual(string("         1.500 startup          phase=ole ms=42"),
+				EventLog::format(startup));
+			startup.arg0 = 99;
+			Assert::AreEqual(string("         1.500 startup          phase=99 ms=42"),
+				EventLog::format(startup));
+			EventRecord unknown = { 0, 999, 1, 2, 3 };
+			Assert::AreEqual(string("         0.000 unknown          id=999 1 2 3"),
+				EventLog::format(unknown));
+
+			string file = RotatingFileSink::getFileHeader() + string(bytes, sizeof(bytes));
+			vector<EventRecord> records;
+			// A record that was cut off is left out.
+			Assert::IsTrue(EventLog::decodeFile(file + "abc", &records));
+			Assert::AreEqual<size_t>(1, records.size());
+			Assert::AreEqual(event.arg2, records[0].arg2);
+			Assert::IsFalse(EventLog::decodeFile(string(bytes, sizeof(bytes)), &records));
+			Assert::IsFalse(EventLog::decodeFile("", &records));
+		}
+
+		TEST_METHOD(TestSchedulerEvents)
+		{
+			Configuration cfg;
+			cfg.settings.setInterval(60);
+			cfg.settings.setVerbosity(MiscSettings::QUIET);
+			cfg.filter.setFilter(L"Notepad", false);
+			DesktopSimulator sim(cfg);
+			EventLog eventLog(sim.getClock(), 1024);
+			sim.setEventLog(&eventLog);
+			SimulatedDesktop& desktop = sim.getDesktop();
+			HWND notepad = desktop.openWindow(L"Untitled - Notepad");
+			// The first countdown finds no Notepad, the second one does.
+			sim.at(1000, [&]() { desktop.closeWindow(notepad); });
+			sim.at(70 * 1000, [&]() {
+				desktop.setForeground(desktop.openWindow(L"Untitled - Notepad"));
+			});
+			sim.start();
+			sim.runFor(2 * 60 * 1000 + 500);
+
+			MemorySink sink;
+			eventLog.flushTo(sink);
+			vector<UINT> ids;
+			for (const EventRecord& record : sink.records)
+			{
+				if (record.id != EventLog::EV_TICK)
+					ids.push_back(record.id);
+			}
+			Assert::AreEqual<size_t>(3, ids.size());
+			Assert::AreEqual<UINT>(EventLog::EV_RESET, ids[0]);
+			Assert::AreEqual<UINT>(EventLog::EV_MATCH, ids[1]);
+			Assert::AreEqual<UINT>(EventLog::EV_SEND, ids[2]);
+			Assert::AreEqual(sim.getMetrics().getCounter(Metrics::MC_TICKS),
+				(ULONGLONG) (sink.records.size() - ids.size()));
+		}
+
+#ifndef _WIN32
+		TEST_METHOD(TestRotatingFileSink)
+		{
+			char directory[] = "/tmp/autosave_tests_XXXXXX";
+			Assert::IsNotNull(mkdtemp(directory));
+			const string path = string(directory) + "/AutoSave.events";
+			const wstring widePath(path.begin(), path.end());
+
+			VirtualClock clock;
+			EventLog eventLog(clock, 256);
+			{
+				// Room for the header and 127 records per file.
+				RotatingFileSink sink(widePath, 4096, 2);
+				Assert::IsTrue(sink.isOpen());
+				for (UINT i = 0; i < 400; ++i)
+				{
+					eventLog.record(EventLog::EV_TICK, i);
+					if (i % 100 == 99)
+						eventLog.flushTo(sink);
+				}
+			}
+
+			// 400 = 127 (rotated away) + 127 + 127 + 19.
+			const char* suffixes[] = { ".2", ".1", "" };
+			const size_t counts[] = { 127, 127, 19 };
+			UINT next = 127;
+			for (int i = 0; i < 3; ++i)
+			{
+				ifstream file(path + suffixes[i], ios::binary);
+				string bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+				vector<EventRecord> records;
+				Assert::IsTrue(EventLog::decodeFile(bytes, &records));
+				Assert::AreEqual(counts[i], records.size());
+				for (const EventRecord& record : records)
+					Assert::AreEqual(next++, record.arg0);
+				unlink((path + suffixes[i]).c_str());
+			}
+			Assert::AreNotEqual(0, access((path + ".3").c_str(), F_OK));
+			rmdir(directory);
+		}
+#endif
+
+	};
+}
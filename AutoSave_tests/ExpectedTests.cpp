@@ -0,0 +1,62 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "Expected.h"
+#include "MemoryConfigStore.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(ExpectedTests)
+	{
+	public:
+
+		TEST_METHOD(TestErrorCode)
+		{
+			Assert::IsFalse(ErrorCode().isError());
+			Assert::IsFalse(ErrorCode(S_FALSE).isError());
+			ErrorCode error = ErrorCode::fromWin32(ERROR_FILE_NOT_FOUND);
+			Assert::IsTrue(error.isError());
+			Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND, error.errorCode());
+			Assert::IsTrue(error.hResult() == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+
+			ErrorCode().throwIfError<ConfigStoreException>();
+			try {
+				error.throwIfError<ConfigStoreException>();
+				Assert::Fail(L"didn't throw");
+			}
+			catch (ConfigStoreException& exc) {
+				Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND, exc.errorCode());
+			}
+		}
+
+		TEST_METHOD(TestExpectedValue)
+		{
+			Expected<wstring> text(wstring(L"text"));
+			Assert::IsTrue(text.hasValue());
+			Assert::IsTrue((bool) text);
+			Assert::IsFalse(text.error().isError());
+			Assert::AreEqual<wstring>(L"text", text.value());
+			Assert::AreEqual<wstring>(L"text", text.valueOr(L"other"));
+			Assert::AreEqual<wstring>(L"text",
+				text.valueOrThrow<ConfigStoreException>());
+		}
+
+		TEST_METHOD(TestExpectedError)
+		{
+			Expected<int> number(ErrorCode(E_INVALIDARG));
+			Assert::IsFalse(number.hasValue());
+			Assert::IsFalse((bool) number);
+			Assert::IsTrue(number.error().hResult() == E_INVALIDARG);
+			Assert::AreEqual(7, number.valueOr(7));
+			try {
+				number.valueOrThrow<ConfigStoreException>();
+				Assert::Fail(L"didn't throw");
+			}
+			catch (ConfigStoreException& exc) {
+				Assert::IsTrue(exc.hResult() == E_INVALIDARG);
+			}
+		}
+	};
+}
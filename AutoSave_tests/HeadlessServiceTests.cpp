@@ -0,0 +1,191 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "HeadlessService.h"
+#include "DesktopSimulator.h"
+
+#include <thread>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(HeadlessServiceTests)
+	{
+	public:
+
+		static Configuration makeConfiguration()
+		{
+			Configuration cfg;
+			cfg.settings.setInterval(60);
+			cfg.settings.setVerbosity(MiscSettings::QUIET);
+			cfg.filter.setFilter(L"Notepad", false);
+			return cfg;
+		}
+
+		TEST_METHOD(TestTicksDriveTheScheduler)
+		{
+			Configuration cfg = makeConfiguration();
+			VirtualClock clock;
+			SimulatedDesktop desktop;
+			desktop.openWindow(L"Untitled - Notepad");
+			RecordingInputSink input(clock, desktop);
+			HeadlessService service(cfg, clock, desktop, input);
+
+			service.start();
+			for (int i = 0; i < 59; ++i)
+			{
+				clock.advance(1000);
+				Assert::IsTrue(service.tick());
+			}
+			Assert::AreEqual<size_t>(0, input.getRecords().size());
+			clock.advance(1000);
+			Assert::IsTrue(service.tick());
+			Assert::AreEqual<size_t>(1, input.getRecords().size());
+			Assert::AreEqual<ULONGLONG>(60, service.getMetrics().getCounter(Metrics::MC_TICKS));
+		}
+
+		TEST_METHOD(TestCommands)
+		{
+			Configuration cfg = makeConfiguration();
+			VirtualClock clock;
+			SimulatedDesktop desktop;
+			desktop.openWindow(L"Untitled - Notepad");
+			RecordingInputSink input(clock, desktop);
+			HeadlessService service(cfg, clock, desktop, input);
+			ControlService& control = service.getControlService();
+			service.start();
+
+			// Commands from the endpoint wait for the next tick.
+			Assert::AreEqual(string("ok\n"), control.handle("pause"));
+			Assert::IsFalse(service.getCountdown().isPaused());
+			for (int i = 0; i < 100; ++i)
+			{
+				clock.advance(1000);
+				Assert::IsTrue(service.tick());
+			}
+			Assert::IsTrue(service.getCountdown().isPaused());
+			Assert::AreEqual<size_t>(0, input.getRecords().size());
+			Assert::IsTrue(control.handle("status").find("paused=1\n") != string::npos);
+
+			service.post(ControlService::CMD_RESUME);
+			service.post(ControlService::CMD_SAVE);
+			clock.advance(1000);
+			Assert::IsTrue(service.tick());
+			Assert::AreEqual<size_t>(1, input.getRecords().size());
+			const string status = control.handle("status");
+			Assert::IsTrue(status.find("paused=0\n") != string::npos);
+			Assert::IsTrue(status.find("seconds_left=60\n") != string::npos);
+			Assert::IsTrue(status.find("target=Notepad\n") != string::npos);
+
+			Assert::AreEqual(string("ok\n"), control.handle("quit"));
+			Assert::IsFalse(service.tick());
+		}
+
+		TEST_METHOD(TestCalibratesPacing)
+		{
+			Configuration cfg = makeConfiguration();
+			cfg.saveToRegistry(DEFAULT_REGISTRY_KEY);
+			VirtualClock clock;
+			SimulatedDesktop desktop;
+			RecordingInputSink input(clock, desktop);
+			SimulatedFileSystem files(clock);
+			// Untitled, so only the Save As dialog tells.
+			SimulatedApplication app(desktop, input, files, L"Untitled - Notepad",
+				L"notepad.exe", 7);
+			app.setInputLatency(20);
+			HeadlessService service(cfg, clock, desktop, input);
+			ControlService& control = service.getControlService();
+			service.start();
+
+			Assert::AreEqual(string("ok\n"), control.handle("calibrate"));
+			clock.advance(1000);
+			Assert::IsTrue(service.tick());
+			Assert::IsTrue(control.handle("status").find("calibrating=1\n") != string::npos);
+			for (int i = 0; i < 100 && control.handle("status").find("calibrating") !=
+				string::npos; ++i)
+			{
+				clock.advance(1000);
+				Assert::IsTrue(service.tick());
+			}
+			Assert::IsTrue(control.handle("status").find("calibrating") == string::npos);
+			Assert::AreEqual<UINT>(12, app.getDialogCount());
+			// The countdown held still meanwhile.
+			Assert::AreEqual<UINT>(60, service.getCountdown().getSecondsLeft());
+
+			Assert::AreEqual<DWORD>(25, cfg.settings.getEventDelay(L"notepad.exe"));
+			vector<wstring> stored = Platform::openConfigStore(DEFAULT_REGISTRY_KEY)
+				->readMultiString(L"pacingProfiles");
+			Assert::IsTrue(std::find(stored.begin(), stored.end(), L"notepad.exe=25") !=
+				stored.end());
+			Platform::purgeConfigStore(DEFAULT_REGISTRY_KEY);
+		}
+
+		TEST_METHOD(TestRunUntilQuit)
+		{
+			Configuration cfg = makeConfiguration();
+			HeadlessService service(cfg, Platform::getClock(),
+				Platform::getWindowEnumerator(), Platform::getInputSink());
+			// Mustn't meet a running AutoSave, or another test run.
+			const wstring name = L"AutoSave-headless-test-" +
+				to_wstring(Platform::getClock().getTickCount());
+			service.setEndpointName(name);
+			int exitCode = -1;
+			thread runner([&service, &exitCode]() { exitCode = service.run(); });
+
+			// The endpoint comes up on the service's thread.
+			string answer;
+			for (int attempt = 0; attempt < 100 && answer.empty(); ++attempt)
+			{
+				try {
+					answer = Platform::sendControlRequest(name, "status");
+				}
+				catch (AutoSaveException&) {
+					this_thread::sleep_for(chrono::milliseconds(20));
+				}
+			}
+			Assert::IsTrue(answer.find("interval=60\n") != string::npos);
+
+			// Doesn't wait for the next tick.
+			const ULONGLONG before = Platform::getClock().getTickCount();
+			Assert::AreEqual(string("ok\n"), Platform::sendControlRequest(name, "quit"));
+			runner.join();
+			Assert::AreEqual(0, exitCode);
+			Assert::IsTrue(Platform::getClock().getTickCount() - before < 900);
+			Assert::ExpectException<AutoSaveException>([&name]() {
+				Platform::sendControlRequest(name, "status");
+			});
+		}
+
+		TEST_METHOD(TestStopBeforeRun)
+		{
+			Configuration cfg = makeConfiguration();
+			VirtualClock clock;
+			SimulatedDesktop desktop;
+			RecordingInputSink input(clock, desktop);
+			HeadlessService service(cfg, clock, desktop, input);
+			service.stop();
+			Assert::AreEqual(0, service.run());
+		}
+
+		TEST_METHOD(TestHeadlessCommandLine)
+		{
+			Assert::IsTrue(Configuration::isHeadlessCommandLine(L"/S 1"));
+			Assert::IsTrue(Configuration::isHeadlessCommandLine(L"/I 30 /S 1 /R Notepad"));
+			Assert::IsFalse(Configuration::isHeadlessCommandLine(L""));
+			Assert::IsFalse(Configuration::isHeadlessCommandLine(L"/S 0"));
+			// /Q always talks to the running instance instead.
+			Assert::IsFalse(Configuration::isHeadlessCommandLine(L"/S 1 /Q status"));
+			Assert::IsFalse(Configuration::isHeadlessCommandLine(L"/S"));
+			Assert::IsFalse(Configuration::isHeadlessCommandLine(L"/X 1 /S 1"));
+
+			Configuration cfg;
+			cfg.loadFromCommandLine(L"/S 1 /I 30 /R Notepad");
+			Assert::IsTrue(cfg.isHeadless);
+			Assert::AreEqual<UINT>(30, cfg.settings.getInterval());
+			Assert::AreEqual(wstring(L"Notepad"), cfg.filter.getFilter());
+		}
+
+	};
+}
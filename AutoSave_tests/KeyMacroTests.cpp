@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "KeyMacro.h"
+#include "DesktopSimulator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(KeyMacroTests)
+	{
+	public:
+
+		static KeyMacro parse(const wstring& text)
+		{
+			Expected<KeyMacro> macro = KeyMacro::parse(text);
+			Assert::IsTrue(macro.hasValue(), text.c_str());
+			return macro.value();
+		}
+
+		TEST_METHOD(TestKeyMacroFromHotkey)
+		{
+			Assert::IsTrue(KeyMacro::fromHotkey(0).isEmpty());
+			const WORD hotkey = MAKEWORD('S', HOTKEYF_CONTROL | HOTKEYF_SHIFT);
+			KeyMacro macro = KeyMacro::fromHotkey(hotkey);
+			Assert::AreEqual<size_t>(1, macro.getBatches().size());
+			Assert::IsTrue(macro.getBatches()[0].events ==
+				KeySequence::fromHotkey(hotkey));
+			Assert::AreEqual<wstring>(L"ctrl+shift+s", macro.toString());
+			Assert::IsTrue(macro == parse(L"Control + Shift + S"));
+		}
+
+		TEST_METHOD(TestKeyMacroParse)
+		{
+			KeyMacro macro = parse(L" Ctrl+S , wait 200,  ENTER, alt+f4");
+			Assert::AreEqual<wstring>(L"ctrl+s, wait 200, enter, alt+f4",
+				macro.toString());
+			Assert::IsTrue(parse(macro.toString()) == macro);
+
+			// Chords without a wait in between share a batch.
+			const vector<KeyMacro::Batch>& batches = macro.getBatches();
+			Assert::AreEqual<size_t>(2, batches.size());
+			vector<KeyEvent> first = {
+				{ VK_CONTROL, false }, { 'S', false }, { 'S', true }, { VK_CONTROL, true },
+			};
+			Assert::IsTrue(batches[0].events == first);
+			Assert::AreEqual<DWORD>(200, batches[0].waitAfter);
+			vector<KeyEvent> second = {
+				{ VK_RETURN, false }, { VK_RETURN, true },
+				{ VK_MENU, false }, { VK_F4, false }, { VK_F4, true }, { VK_MENU, true },
+			};
+			Assert::IsTrue(batches[1].events == second);
+			Assert::AreEqual<DWORD>(0, batches[1].waitAfter);
+
+			Assert::IsTrue(parse(L"").isEmpty());
+			Assert::AreEqual<wstring>(L"0xba, f12, 7", parse(L"0xBA, F12, 7").toString());
+		}
+
+		TEST_METHOD(TestKeyMacroParseErrors)
+		{
+			const wchar_t* invalid[] = {
+				L"ctrl+", L"ctrl+s,", L", enter", L"ctrl+bogus", L"f25", L"f0",
+				L"0x", L"0x100", L"0xg1", L"wait", L"wait -5", L"wait 5001",
+				L"wait200",
+			};
+			for (const wchar_t* text : invalid)
+			{
+				Expected<KeyMacro> macro = KeyMacro::parse(text);
+				Assert::IsFalse(macro.hasValue(), text);
+				Assert::IsTrue(macro.error().hResult() == E_INVALIDARG);
+			}
+			Assert::IsTrue(KeyMacro::parse(L"wait 5000").hasValue());
+		}
+
+		TEST_METHOD(TestKeyMacroSendsBatchesAtOnce)
+		{
+			VirtualClock clock;
+			SimulatedDesktop desktop;
+			RecordingInputSink input(clock, desktop);
+
+			KeyMacro macro = parse(L"ctrl+alt+s, wait 300, enter");
+			Assert::AreEqual<UINT>(8, macro.sendTo(input, 0));
+
+			const auto& records = input.getRecords();
+			Assert::AreEqual<size_t>(2, records.size());
+			Assert::IsTrue(records[0].events == macro.getBatches()[0].events);
+			Assert::AreEqual<DWORD>(300, records[0].waitAfter);
+			Assert::IsTrue(records[1].events == macro.getBatches()[1].events);
+			Assert::AreEqual<DWORD>(0, records[1].waitAfter);
+		}
+
+		TEST_METHOD(TestKeyMacroSpacesEvents)
+		{
+			VirtualClock clock;
+			SimulatedDesktop desktop;
+			RecordingInputSink input(clock, desktop);
+
+			KeyMacro macro = parse(L"ctrl+s, wait 100, enter");
+			Assert::AreEqual<UINT>(6, macro.sendTo(input, 10));
+
+			const auto& records = input.getRecords();
+			Assert::AreEqual<size_t>(6, records.size());
+			vector<KeyEvent> sent;
+			for (const auto& record : records)
+			{
+				Assert::AreEqual<size_t>(1, record.events.size());
+				sent.push_back(record.events[0]);
+			}
+			Assert::AreEqual<DWORD>(10, records[0].waitAfter);
+			// The macro's own wait comes on top of the spacing.
+			Assert::AreEqual<DWORD>(110, records[3].waitAfter);
+			Assert::AreEqual<DWORD>(10, records[4].waitAfter);
+			Assert::AreEqual<DWORD>(0, records[5].waitAfter);
+
+			vector<KeyEvent> expected = macro.getBatches()[0].events;
+			expected.insert(expected.end(), macro.getBatches()[1].events.begin(),
+				macro.getBatches()[1].events.end());
+			Assert::IsTrue(sent == expected);
+		}
+
+		TEST_METHOD(TestPacingProfileStrings)
+		{
+			PacingProfile profile = { L"", 0 };
+			Assert::IsTrue(PacingProfile::parse(L" Illustrator.EXE = 25", &profile));
+			Assert::AreEqual<wstring>(L"illustrator.exe", profile.executable);
+			Assert::AreEqual<DWORD>(25, profile.eventDelay);
+			Assert::AreEqual<wstring>(L"illustrator.exe=25", profile.toString());
+
+			Assert::IsFalse(PacingProfile::parse(L"illustrator.exe", &profile));
+			Assert::IsFalse(PacingProfile::parse(L"=10", &profile));
+			Assert::IsFalse(PacingProfile::parse(L"a.exe=x", &profile));
+			Assert::IsFalse(PacingProfile::parse(L"a.exe=1001", &profile));
+			Assert::AreEqual<wstring>(L"illustrator.exe", profile.executable);
+		}
+	};
+}
@@ -0,0 +1,45 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "KeySequence.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(KeySequenceTests)
+	{
+	public:
+
+		TEST_METHOD(TestKeySequenceWithoutKey)
+		{
+			Assert::IsTrue(KeySequence::fromHotkey(0).empty());
+			Assert::IsTrue(KeySequence::fromHotkey(
+				MAKEWORD(0, HOTKEYF_CONTROL)).empty());
+		}
+
+		TEST_METHOD(TestKeySequenceSingleKey)
+		{
+			vector<KeyEvent> expected = { { 0x45, false }, { 0x45, true } };
+			Assert::IsTrue(expected == KeySequence::fromHotkey(MAKEWORD(0x45, 0)));
+		}
+
+		TEST_METHOD(TestKeySequenceModifiersEnclose)
+		{
+			vector<KeyEvent> expected = {
+				{ VK_CONTROL, false },
+				{ VK_SHIFT, false },
+				{ VK_MENU, false },
+				{ 0x53, false },
+				{ 0x53, true },
+				{ VK_MENU, true },
+				{ VK_SHIFT, true },
+				{ VK_CONTROL, true },
+			};
+			WORD hotkey = MAKEWORD(0x53,
+				HOTKEYF_CONTROL | HOTKEYF_SHIFT | HOTKEYF_ALT);
+			Assert::IsTrue(expected == KeySequence::fromHotkey(hotkey));
+		}
+
+	};
+}
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "CppUnitTest.h"
 #include "Matcher.h"
+#include <chrono>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -62,5 +63,95 @@ namespace AutoSave_tests
 
 		}
 
+		TEST_METHOD(TestMatcherPathologicalRegexIsFast)
+		{
+			Matcher m(L"(a+)+$", true);
+			Assert::IsTrue(m.isValid());
+
+			auto start = std::chrono::steady_clock::now();
+			Assert::IsFalse(m.match(wstring(30, L'a') + L"!"));
+			auto elapsed = std::chrono::steady_clock::now() - start;
+
+			Assert::IsTrue(elapsed < std::chrono::milliseconds(100));
+			Assert::IsFalse(m.isRegexBad());
+			Assert::IsTrue(m.match(L"aaa"));
+		}
+
+		TEST_METHOD(TestMatcherRejectsBacktrackingSyntax)
+		{
+			// Backreferences and lookaheads need std::regex, which has no
+			// budget. Some of these even pass the analyzer.
+			const wchar_t* patterns[] = {
+				L"(a+)+\\1", L"(a)\\1", L"(a+)+(?=b)", L"Sa(?=v)", L"(?=(.*a){12}z)",
+				L"(?=.*.*.*.*.*.*.*.*.*.*.*.*z)"
+			};
+			for (const wchar_t* pattern : patterns)
+			{
+				Matcher m(pattern, true);
+				Assert::IsTrue(m.isRegexBad(), pattern);
+				Assert::IsFalse(m.isValid(), pattern);
+				Assert::IsFalse(m.getRegexBadReason().empty(), pattern);
+
+				auto start = std::chrono::steady_clock::now();
+				Assert::IsFalse(m.match(wstring(120, L'a')), pattern);
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				Assert::IsTrue(elapsed < std::chrono::milliseconds(100), pattern);
+			}
+
+			// The analyzer still names the problem where it sees one.
+			Matcher m(L"(?=(.*a){12}z)", true);
+			Assert::IsTrue(m.getRegexBadReason().find(L"nested") != wstring::npos);
+		}
+
+		TEST_METHOD(TestMatcherRejectsUncheckableSyntax)
+		{
+			// std::regex may take these, but the parser doesn't, so
+			// nothing would keep them from backtracking forever.
+			const wchar_t* patterns[] = { L"(a+)+b\\k", L"(a+)+b{1}{1}" };
+			for (const wchar_t* pattern : patterns)
+			{
+				Matcher m(pattern, true);
+				Assert::IsTrue(m.isRegexBad(), pattern);
+				Assert::IsFalse(m.getRegexBadReason().empty(), pattern);
+
+				auto start = std::chrono::steady_clock::now();
+				Assert::IsFalse(m.match(wstring(30, L'a') + L"!"), pattern);
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				Assert::IsTrue(elapsed < std::chrono::milliseconds(100), pattern);
+			}
+		}
+
+		TEST_METHOD(TestMatcherRegexBudget)
+		{
+			Matcher m(L"a{1000}b", true);
+			Assert::IsTrue(m.isValid());
+
+			Assert::IsFalse(m.match(wstring(5000, L'a')));
+			Assert::IsTrue(m.isRegexBad());
+			Assert::IsFalse(m.getRegexBadReason().empty());
+
+			// Setting the regex again gives it another chance.
+			m.setRegex(L"a{10}b");
+			Assert::IsFalse(m.isRegexBad());
+			Assert::IsTrue(m.match(wstring(50, L'a') + L"b"));
+		}
+
+		TEST_METHOD(TestMatcherDirtyMask)
+		{
+			Matcher m(L"A", L"B", true);
+			Assert::IsFalse(m.isDirty());
+
+			m.setPhrase(L"A");
+			m.useRegex(true);
+			Assert::IsFalse(m.isDirty());
+
+			m.setFilter(L"C", false);
+			Assert::AreEqual<int>(Matcher::FLD_PHRASE | Matcher::FLD_USE_REGEX,
+				m.getDirtyMask());
+			m.markClean();
+			m.setRegex(L"D");
+			Assert::AreEqual<int>(Matcher::FLD_REGEX, m.getDirtyMask());
+		}
+
 	};
 }
\ No newline at end of file
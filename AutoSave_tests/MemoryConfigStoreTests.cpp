@@ -0,0 +1,210 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "MemoryConfigStore.h"
+#include "Configuration.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(MemoryConfigStoreTests)
+	{
+	public:
+
+		TEST_METHOD(TestMemoryStoreValues)
+		{
+			MemoryConfigStore store;
+			Assert::IsTrue(store.isEmpty());
+
+			store.writeInt(L"int", -4);
+			store.writeString(L"string", L"text");
+			store.writeMultiString(L"multi", { L"a", L"", L"c" });
+
+			Assert::AreEqual(-4, store.readInt(L"int"));
+			Assert::AreEqual<wstring>(L"text", store.readString(L"string"));
+			Assert::IsTrue(store.readMultiString(L"multi") ==
+				vector<wstring>({ L"a", L"", L"c" }));
+
+			store.writeInt(L"string", 3);
+			Assert::AreEqual(3, store.readInt(L"string"));
+		}
+
+		TEST_METHOD(TestMemoryStoreErrors)
+		{
+			MemoryConfigStore store;
+			store.writeInt(L"int", 1);
+
+			try {
+				store.readInt(L"missing");
+				Assert::Fail(L"missing value");
+			}
+			catch (ConfigStoreException& exc) {
+				Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND, exc.errorCode());
+			}
+
+			try {
+				store.readString(L"int");
+				Assert::Fail(L"wrong type");
+			}
+			catch (ConfigStoreException& exc) {
+				Assert::AreEqual<long>(ERROR_UNSUPPORTED_TYPE, exc.errorCode());
+			}
+		}
+
+		TEST_METHOD(TestMemoryStoreTryRead)
+		{
+			MemoryConfigStore store;
+			store.writeInt(L"int", 1);
+			store.writeString(L"string", L"text");
+			store.writeMultiString(L"multi", { L"a", L"b" });
+
+			Assert::AreEqual(1, store.tryReadInt(L"int").value());
+			Assert::AreEqual<wstring>(L"text", store.tryReadString(L"string").value());
+			Assert::IsTrue(store.tryReadMultiString(L"multi").value() ==
+				vector<wstring>({ L"a", L"b" }));
+
+			Expected<vector<wstring>> missing = store.tryReadMultiString(L"missing");
+			Assert::IsFalse(missing.hasValue());
+			Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND, missing.error().errorCode());
+			Expected<wstring> wrongType = store.tryReadString(L"int");
+			Assert::IsFalse(wrongType.hasValue());
+			Assert::AreEqual<long>(ERROR_UNSUPPORTED_TYPE, wrongType.error().errorCode());
+		}
+
+		TEST_METHOD(TestConfigurationStoreRoundTrip)
+		{
+			Configuration cfg;
+			cfg.settings.setInterval(77);
+			cfg.settings.setHotkey(0x0444);
+			cfg.settings.setVerbosity(MiscSettings::QUIET);
+			cfg.filter.setFilter(L"x(y|z)", true);
+			cfg.filter.setPhrase(L"phrase");
+			cfg.settings.setSaveCheckTimeout(20);
+			cfg.settings.setKeyMacro(L"ctrl+s, wait 50, enter");
+			PacingProfile gimp = { L"gimp.exe", 20 };
+			cfg.settings.setPacingProfiles({ gimp });
+			cfg.settings.setTriggers(MiscSettings::TRIG_BACKGROUND);
+			cfg.settings.setBackgroundDelay(90);
+			RetentionPolicy retention = { 10, 3 };
+			cfg.settings.setRetentionPolicy(retention);
+
+			MemoryConfigStore store;
+			cfg.saveToStore(store);
+			Assert::AreEqual(77, store.readInt(L"interval"));
+			Assert::IsTrue(store.readMultiString(L"pacingProfiles") ==
+				vector<wstring>({ L"gimp.exe=20" }));
+
+			Configuration otherCfg;
+			Assert::IsTrue(cfg != otherCfg);
+			otherCfg.loadFromStore(store);
+			Assert::IsTrue(cfg == otherCfg);
+			Assert::AreEqual<wstring>(L"phrase", otherCfg.filter.getPhrase());
+		}
+
+		TEST_METHOD(TestConfigurationStoreFromOlderVersion)
+		{
+			Configuration cfg;
+			cfg.settings.setSaveCheckTimeout(20);
+			MemoryConfigStore store;
+			cfg.saveToStore(store);
+			store.clear();
+			store.writeInt(L"hotkey", 0x0253);
+			store.writeInt(L"interval", 60);
+			store.writeInt(L"verbosity", 1);
+			store.writeString(L"filterPhrase", L"");
+			store.writeString(L"filterRegex", L"");
+			store.writeInt(L"isFilterByRegex", 0);
+
+			cfg.settings.setIntervalAdaptive(true);
+			cfg.loadFromStore(store);
+			Assert::AreEqual<UINT>(0, cfg.settings.getSaveCheckTimeout());
+			Assert::IsFalse(cfg.settings.isIntervalAdaptive());
+			Assert::IsTrue(cfg.settings.getAdaptivePolicy() ==
+				MiscSettings().getAdaptivePolicy());
+			Assert::IsTrue(cfg.settings.getKeyMacro().isEmpty());
+			Assert::IsTrue(cfg.settings.getPacingProfiles() ==
+				MiscSettings().getPacingProfiles());
+			Assert::AreEqual<int>(MiscSettings::TRIG_NONE, cfg.settings.getTriggers());
+			Assert::AreEqual(MiscSettings().getTriggerDedupe(),
+				cfg.settings.getTriggerDedupe());
+			Assert::IsFalse(cfg.settings.isBackupOn());
+		}
+
+		TEST_METHOD(TestConfigurationLearnsPacing)
+		{
+			// Mustn't meet a running AutoSave, or another test run.
+			const wstring keyName = L"AutoSave-pacing-test-" +
+				to_wstring(Platform::getClock().getTickCount());
+			Configuration cfg;
+			PacingProfile gimp = { L"gimp.exe", 20 };
+			cfg.learnPacing(keyName.c_str(), gimp);
+			Assert::AreEqual<DWORD>(20, cfg.settings.getEventDelay(L"gimp.exe"));
+			Assert::IsFalse(Platform::configStoreExists(keyName));
+
+			cfg.saveToRegistry(keyName.c_str());
+			{
+				// Another instance learns about another program.
+				Configuration other;
+				PacingProfile krita = { L"krita.exe", 5 };
+				other.learnPacing(keyName.c_str(), krita);
+			}
+			gimp.eventDelay = 15;
+			cfg.learnPacing(keyName.c_str(), gimp);
+
+			Configuration loaded;
+			loaded.loadFromRegistry(keyName.c_str());
+			Assert::AreEqual<DWORD>(15, loaded.settings.getEventDelay(L"gimp.exe"));
+			Assert::AreEqual<DWORD>(5, loaded.settings.getEventDelay(L"krita.exe"));
+			Assert::AreEqual<DWORD>(10, loaded.settings.getEventDelay(L"illustrator.exe"));
+			Platform::purgeConfigStore(keyName);
+		}
+
+		TEST_METHOD(TestConfigurationStoreSkipsBrokenMacro)
+		{
+			Configuration cfg;
+			MemoryConfigStore store;
+			cfg.saveToStore(store);
+			store.writeString(L"keyMacro", L"ctrl+?");
+			store.writeMultiString(L"pacingProfiles", { L"a.exe=5", L"broken" });
+
+			cfg.loadFromStore(store);
+			Assert::IsTrue(cfg.settings.getKeyMacro().isEmpty());
+			Assert::AreEqual<size_t>(1, cfg.settings.getPacingProfiles().size());
+			Assert::AreEqual<DWORD>(5, cfg.settings.getEventDelay(L"a.exe"));
+		}
+
+		TEST_METHOD(TestConfigurationStoreAdaptivePolicy)
+		{
+			Configuration cfg;
+			cfg.settings.setIntervalAdaptive(true);
+			AdaptivePolicy policy = { 120, 7200, 150, 5 };
+			cfg.settings.setAdaptivePolicy(policy);
+			MemoryConfigStore store;
+			cfg.saveToStore(store);
+
+			Configuration otherCfg;
+			otherCfg.loadFromStore(store);
+			Assert::IsTrue(otherCfg.settings.isIntervalAdaptive());
+			Assert::IsTrue(otherCfg.settings.getAdaptivePolicy() == policy);
+			Assert::IsTrue(otherCfg == cfg);
+		}
+
+		TEST_METHOD(TestConfigurationEquality)
+		{
+			Configuration cfg, otherCfg;
+			Assert::IsTrue(cfg == otherCfg);
+
+			otherCfg.filter.useRegex(true);
+			Assert::IsTrue(cfg != otherCfg);
+			otherCfg.filter.useRegex(false);
+
+			otherCfg.settings.setInterval(cfg.settings.getInterval() + 1);
+			Assert::IsTrue(cfg != otherCfg);
+
+			otherCfg = cfg;
+			Assert::IsTrue(cfg == otherCfg);
+		}
+
+	};
+}
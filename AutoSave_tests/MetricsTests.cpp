@@ -0,0 +1,155 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "Metrics.h"
+#include "DesktopSimulator.h"
+
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(MetricsTests)
+	{
+	public:
+
+		TEST_METHOD(TestBucketsCoverAllValues)
+		{
+			Assert::AreEqual<UINT>(0, LatencyHistogram::getBucketIndex(0));
+			Assert::AreEqual<UINT>(63, LatencyHistogram::getBucketIndex(63));
+			Assert::AreEqual<UINT>(LatencyHistogram::bucketCount - 1,
+				LatencyHistogram::getBucketIndex(~0ULL));
+
+			// Each bucket starts right after the previous one ends, and
+			// no bucket is wider than 1/32 of its values.
+			for (UINT i = 1; i < LatencyHistogram::bucketCount; ++i)
+			{
+				ULONGLONG low = LatencyHistogram::getBucketLow(i);
+				ULONGLONG high = LatencyHistogram::getBucketHigh(i);
+				Assert::AreEqual(LatencyHistogram::getBucketHigh(i - 1) + 1, low);
+				Assert::AreEqual(i, LatencyHistogram::getBucketIndex(low));
+				Assert::AreEqual(i, LatencyHistogram::getBucketIndex(high));
+				Assert::IsTrue((high - low) <= low / 32);
+			}
+		}
+
+		TEST_METHOD(TestPercentiles)
+		{
+			Metrics metrics;
+			for (ULONGLONG value = 1; value <= 10000; ++value)
+				metrics.record(Metrics::MH_SAVE_LATENCY, value);
+			metrics.count(Metrics::MC_SAVES, 3);
+
+			MetricsSnapshot snapshot = metrics.takeSnapshot();
+			const HistogramSnapshot& h = snapshot.histograms[Metrics::MH_SAVE_LATENCY];
+			Assert::AreEqual<ULONGLONG>(10000, h.count);
+			Assert::AreEqual<ULONGLONG>(1, h.min);
+			Assert::AreEqual<ULONGLONG>(10000, h.max);
+			Assert::AreEqual(5000.5, h.getMean());
+			Assert::AreEqual<ULONGLONG>(1, h.getPercentile(0.0));
+			Assert::AreEqual<ULONGLONG>(10000, h.getPercentile(100.0));
+			const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+			for (double p : percentiles)
+			{
+				double exact = p * 100.0;
+				double error = (h.getPercentile(p) - exact) / exact;
+				Assert::IsTrue(error >= 0.0 && error <= 1.0 / 32);
+			}
+			Assert::AreEqual<ULONGLONG>(3, snapshot.counters[Metrics::MC_SAVES].second);
+			Assert::AreEqual(string("saves"), snapshot.counters[Metrics::MC_SAVES].first);
+
+			metrics.reset();
+			Assert::AreEqual<ULONGLONG>(0, metrics.getHistogram(Metrics::MH_SAVE_LATENCY).getMin());
+			Assert::AreEqual<ULONGLONG>(0, metrics.getCounter(Metrics::MC_SAVES));
+		}
+
+		TEST_METHOD(TestSerialization)
+		{
+			Metrics metrics;
+			metrics.count(Metrics::MC_TICKS, 123456789);
+			metrics.record(Metrics::MH_SEND_DURATION, 60000);
+			metrics.record(Metrics::MH_SEND_DURATION, 3);
+			metrics.record(Metrics::MH_TICK_INTERVAL, 1000);
+			MetricsSnapshot snapshot = metrics.takeSnapshot();
+			string bytes = snapshot.serialize();
+			// Mostly names; empty buckets aren't stored.
+			Assert::IsTrue(bytes.size() < 400);
+
+			MetricsSnapshot loaded;
+			Assert::IsTrue(MetricsSnapshot::deserialize(bytes, &loaded));
+			Assert::AreEqual(snapshot.format(), loaded.format());
+			const HistogramSnapshot& h = loaded.histograms[Metrics::MH_SEND_DURATION];
+			Assert::AreEqual(string("us"), h.unit);
+			Assert::AreEqual<ULONGLONG>(2, h.count);
+			Assert::AreEqual<ULONGLONG>(60003, h.sum);
+			Assert::AreEqual<size_t>(2, h.buckets.size());
+
+			Assert::IsFalse(MetricsSnapshot::deserialize("", &loaded));
+			Assert::IsFalse(MetricsSnapshot::deserialize(bytes.substr(0, bytes.size() - 1), &loaded));
+			Assert::IsFalse(MetricsSnapshot::deserialize(bytes + "x", &loaded));
+			string wrongMagic = bytes;
+			wrongMagic[0] = 'X';
+			Assert::IsFalse(MetricsSnapshot::deserialize(wrongMagic, &loaded));
+		}
+
+		TEST_METHOD(TestConcurrentUpdates)
+		{
+			Metrics metrics;
+			vector<thread> threads;
+			for (int t = 0; t < 4; ++t)
+			{
+				threads.emplace_back([&metrics, t]() {
+					for (ULONGLONG i = 0; i < 100000; ++i)
+					{
+						metrics.count(Metrics::MC_KEYS_SENT);
+						metrics.record(Metrics::MH_ZERO_WAIT, i + t);
+					}
+				});
+			}
+			for (thread& t : threads)
+				t.join();
+
+			const LatencyHistogram& h = metrics.getHistogram(Metrics::MH_ZERO_WAIT);
+			Assert::AreEqual<ULONGLONG>(400000, metrics.getCounter(Metrics::MC_KEYS_SENT));
+			Assert::AreEqual<ULONGLONG>(400000, h.getCount());
+			Assert::AreEqual<ULONGLONG>(0, h.getMin());
+			Assert::AreEqual<ULONGLONG>(100002, h.getMax());
+		}
+
+		TEST_METHOD(TestSchedulerMetrics)
+		{
+			Configuration cfg;
+			cfg.settings.setInterval(60);
+			cfg.settings.setVerbosity(MiscSettings::QUIET);
+			cfg.filter.setFilter(L"Notepad", false);
+			DesktopSimulator sim(cfg);
+			SimulatedDesktop& desktop = sim.getDesktop();
+			HWND notepad = desktop.openWindow(L"Untitled - Notepad");
+			desktop.openWindow(L"Calculator");
+			// At zero after a minute, but Notepad only comes up 30 s later.
+			sim.at(90 * 1000 + 500, [&]() { desktop.setForeground(notepad); });
+			// Then Notepad is closed for two minutes.
+			sim.at(100 * 1000, [&]() { desktop.closeWindow(notepad); });
+			sim.at(220 * 1000, [&]() { desktop.openWindow(L"Untitled - Notepad"); });
+			sim.start();
+			sim.runFor(5 * 60 * 1000);
+
+			const Metrics& metrics = sim.getMetrics();
+			Assert::AreEqual<ULONGLONG>(300, metrics.getCounter(Metrics::MC_TICKS));
+			Assert::AreEqual<ULONGLONG>(sim.getSaves().size(),
+				metrics.getCounter(Metrics::MC_SAVES));
+			Assert::AreEqual<ULONGLONG>(2 * sim.getSaves().size(),
+				metrics.getCounter(Metrics::MC_KEYS_SENT));
+			Assert::AreEqual<ULONGLONG>(2, metrics.getCounter(Metrics::MC_COUNTDOWN_RESETS));
+			Assert::AreEqual<ULONGLONG>(2, sim.getSaves().size());
+			Assert::AreEqual<ULONGLONG>(31, metrics.getCounter(Metrics::MC_TICKS_AT_ZERO));
+
+			const LatencyHistogram& zeroWait = metrics.getHistogram(Metrics::MH_ZERO_WAIT);
+			Assert::AreEqual<ULONGLONG>(31 * 1000, zeroWait.getMax());
+			Assert::AreEqual<ULONGLONG>(1000,
+				metrics.getHistogram(Metrics::MH_TICK_INTERVAL).getMax());
+		}
+
+	};
+}
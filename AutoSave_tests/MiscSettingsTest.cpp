@@ -9,7 +9,7 @@ namespace Microsoft {
 		namespace CppUnitTestFramework
 		{
 			template<>
-			static std::wstring
+			inline std::wstring
 				ToString<MiscSettings::Verbosity>(const MiscSettings::Verbosity& v)
 			{
 				return ToString<int>((int) v);
@@ -88,6 +88,59 @@ namespace AutoSave_tests
 				ms.toCommandLine(MiscSettings::ATT_ALL));
 		}
 		
+		TEST_METHOD(TestMSSaveCheck)
+		{
+			MiscSettings ms;
+			Assert::AreEqual<UINT>(0, ms.getSaveCheckTimeout());
+			Assert::AreEqual<wstring>(
+				L"", ms.toCommandLine(MiscSettings::ATT_SAVECHECK));
+
+			ms.setSaveCheckTimeout(999999);
+			Assert::AreEqual(ms.getMaxSaveCheckTimeout(), ms.getSaveCheckTimeout());
+			ms.setSaveCheckTimeout(30);
+			Assert::AreEqual<wstring>(
+				L"/C 30 ", ms.toCommandLine(MiscSettings::ATT_SAVECHECK));
+
+			CommandLineParser cli;
+			cli.setAllowedKeys(MiscSettings::getAllowedKeys());
+			cli.parse(L"/C 45");
+			MiscSettings parsed;
+			parsed.loadFromCommandLine(cli);
+			Assert::AreEqual<UINT>(45, parsed.getSaveCheckTimeout());
+			Assert::IsTrue(parsed != MiscSettings());
+		}
+
+		TEST_METHOD(TestMSAdaptiveInterval)
+		{
+			MiscSettings ms;
+			Assert::IsFalse(ms.isIntervalAdaptive());
+			Assert::AreEqual<wstring>(
+				L"", ms.toCommandLine(MiscSettings::ATT_ADAPTIVE));
+			ms.setIntervalAdaptive(true);
+			Assert::AreEqual<wstring>(
+				L"/A 1 ", ms.toCommandLine(MiscSettings::ATT_ADAPTIVE));
+
+			AdaptivePolicy policy = { 1, MAXUINT, 0, 500 };
+			ms.setAdaptivePolicy(policy);
+			Assert::AreEqual(ms.getMinInterval(), ms.getAdaptivePolicy().minInterval);
+			Assert::AreEqual(ms.getMaxInterval(), ms.getAdaptivePolicy().maxInterval);
+			Assert::AreEqual<UINT>(100, ms.getAdaptivePolicy().growthPercent);
+			Assert::AreEqual<UINT>(100, ms.getAdaptivePolicy().maxBusyPercent);
+
+			// The maximum can't be below the minimum.
+			policy.minInterval = 600;
+			policy.maxInterval = 300;
+			ms.setAdaptivePolicy(policy);
+			Assert::AreEqual<UINT>(600, ms.getAdaptivePolicy().maxInterval);
+
+			CommandLineParser cli;
+			cli.setAllowedKeys(MiscSettings::getAllowedKeys());
+			cli.parse(L"/A 1");
+			MiscSettings parsed;
+			parsed.loadFromCommandLine(cli);
+			Assert::IsTrue(parsed.isIntervalAdaptive());
+		}
+
 		TEST_METHOD(TestMSMaxCommandLineLength)
 		{
 			MiscSettings ms;
@@ -98,5 +151,146 @@ namespace AutoSave_tests
 				L"/I 86400 /H 0xffff /V 3 ",
 				ms.toCommandLine(MiscSettings::ATT_ALL));
 		}
+
+		TEST_METHOD(TestMSKeyMacro)
+		{
+			MiscSettings ms;
+			Assert::IsTrue(ms.getKeyMacro().isEmpty());
+			Assert::IsTrue(ms.getSaveMacro() == KeyMacro::fromHotkey(ms.getHotkey()));
+			ms.setHotkey(MAKEWORD('E', HOTKEYF_ALT));
+			Assert::AreEqual<wstring>(L"alt+e", ms.getSaveMacro().toString());
+
+			ms.markClean();
+			Assert::IsFalse(ms.setKeyMacro(L"ctrl+nothing"));
+			Assert::IsFalse(ms.isDirty());
+			Assert::IsTrue(ms.setKeyMacro(L"ctrl+s, wait 100, enter"));
+			Assert::AreEqual<int>(MiscSettings::ATT_MACRO, ms.getDirtyMask());
+			Assert::IsTrue(ms.getSaveMacro() == ms.getKeyMacro());
+			Assert::AreEqual<wstring>(L"/M \"ctrl+s, wait 100, enter\" ",
+				ms.toCommandLine(MiscSettings::ATT_MACRO));
+
+			CommandLineParser cli;
+			cli.setAllowedKeys(MiscSettings::getAllowedKeys());
+			cli.parse(ms.toCommandLine(MiscSettings::ATT_ALL));
+			MiscSettings parsed;
+			parsed.loadFromCommandLine(cli);
+			Assert::IsTrue(parsed == ms);
+
+			// A hotkey on its own replaces the macro.
+			cli.parse(L"/H 0x0444");
+			parsed.loadFromCommandLine(cli);
+			Assert::IsTrue(parsed.getKeyMacro().isEmpty());
+			Assert::IsTrue(parsed.getSaveMacro() == KeyMacro::fromHotkey(0x0444));
+
+			cli.parse(L"/M \"ctrl+\"");
+			Assert::ExpectException<CLIException>([&]() {
+				parsed.loadFromCommandLine(cli);
+			});
+		}
+
+		TEST_METHOD(TestMSPacingProfiles)
+		{
+			MiscSettings ms;
+			Assert::AreEqual<DWORD>(10, ms.getEventDelay(L"Illustrator.exe"));
+			Assert::AreEqual<DWORD>(0, ms.getEventDelay(L"notepad.exe"));
+			Assert::AreEqual<DWORD>(0, ms.getEventDelay(L""));
+
+			PacingProfile gimp = { L"GIMP-2.10.exe", 5 };
+			PacingProfile slow = { L"slow.exe", 99999 };
+			PacingProfile gimpAgain = { L"gimp-2.10.exe", 15 };
+			PacingProfile nameless = { L"", 5 };
+			ms.setPacingProfiles({ gimp, slow, gimpAgain, nameless });
+			Assert::AreEqual<int>(MiscSettings::ATT_PACING, ms.getDirtyMask());
+			Assert::AreEqual<size_t>(2, ms.getPacingProfiles().size());
+			Assert::AreEqual<DWORD>(15, ms.getEventDelay(L"Gimp-2.10.EXE"));
+			Assert::AreEqual(PacingProfile::getMaxEventDelay(),
+				ms.getEventDelay(L"slow.exe"));
+			Assert::AreEqual<DWORD>(0, ms.getEventDelay(L"illustrator.exe"));
+			Assert::AreEqual<wstring>(L"", ms.toCommandLine(MiscSettings::ATT_PACING));
+
+			ms.setEventDelay(L"Slow.exe", 30);
+			ms.setEventDelay(L"new.exe", 0);
+			Assert::AreEqual<size_t>(3, ms.getPacingProfiles().size());
+			Assert::AreEqual<DWORD>(30, ms.getEventDelay(L"slow.exe"));
+			Assert::AreEqual<wstring>(L"new.exe=0", ms.getPacingProfiles()[2].toString());
+		}
+
+		TEST_METHOD(TestMSTriggers)
+		{
+			MiscSettings ms;
+			Assert::AreEqual<int>(MiscSettings::TRIG_NONE, ms.getTriggers());
+			Assert::AreEqual<wstring>(L"", ms.toCommandLine(MiscSettings::ATT_TRIGGERS));
+
+			ms.setTriggers(0xff);
+			Assert::AreEqual<int>(MiscSettings::TRIG_ALL, ms.getTriggers());
+			ms.setBackgroundDelay(0);
+			Assert::AreEqual<UINT>(1, ms.getBackgroundDelay());
+			ms.setTriggerDedupe(MAXUINT);
+			Assert::AreEqual(ms.getMaxInterval(), ms.getTriggerDedupe());
+			Assert::AreEqual<int>(MiscSettings::ATT_TRIGGERS, ms.getDirtyMask());
+
+			ms.setTriggers(MiscSettings::TRIG_LEAVE | MiscSettings::TRIG_MINIMIZE);
+			ms.setBackgroundDelay(45);
+			ms.setTriggerDedupe(0);
+			Assert::IsTrue(ms.isTriggerOn(MiscSettings::TRIG_MINIMIZE));
+			Assert::IsFalse(ms.isTriggerOn(MiscSettings::TRIG_BACKGROUND));
+			Assert::AreEqual<wstring>(L"/T 5 /B 45 /D 0 ",
+				ms.toCommandLine(MiscSettings::ATT_TRIGGERS));
+
+			CommandLineParser cli;
+			cli.setAllowedKeys(MiscSettings::getAllowedKeys());
+			cli.parse(ms.toCommandLine(MiscSettings::ATT_ALL));
+			MiscSettings parsed;
+			parsed.loadFromCommandLine(cli);
+			Assert::IsTrue(parsed == ms);
+		}
+
+		TEST_METHOD(TestMSRetentionPolicy)
+		{
+			MiscSettings ms;
+			Assert::IsFalse(ms.isBackupOn());
+			Assert::AreEqual<UINT>(7, ms.getRetentionPolicy().keepDaily);
+			Assert::AreEqual<wstring>(L"", ms.toCommandLine(MiscSettings::ATT_BACKUP));
+
+			RetentionPolicy policy = { 5000, 30 };
+			ms.setRetentionPolicy(policy);
+			Assert::IsTrue(ms.isBackupOn());
+			Assert::AreEqual<UINT>(1000, ms.getRetentionPolicy().keepLast);
+			Assert::AreEqual<UINT>(30, ms.getRetentionPolicy().keepDaily);
+			Assert::AreEqual<int>(MiscSettings::ATT_BACKUP, ms.getDirtyMask());
+
+			policy.keepLast = 20;
+			ms.setRetentionPolicy(policy);
+			Assert::AreEqual<wstring>(L"/K 20 ", ms.toCommandLine(MiscSettings::ATT_BACKUP));
+
+			// The days don't go on the command line.
+			CommandLineParser cli;
+			cli.setAllowedKeys(MiscSettings::getAllowedKeys());
+			cli.parse(ms.toCommandLine(MiscSettings::ATT_ALL));
+			MiscSettings parsed;
+			parsed.loadFromCommandLine(cli);
+			Assert::AreEqual<UINT>(20, parsed.getRetentionPolicy().keepLast);
+			Assert::AreEqual<UINT>(7, parsed.getRetentionPolicy().keepDaily);
+		}
+
+		TEST_METHOD(TestMSDirtyMask)
+		{
+			MiscSettings ms;
+			Assert::IsFalse(ms.isDirty());
+
+			ms.setInterval(ms.getInterval());
+			ms.setVerbosity(ms.getVerbosity());
+			Assert::IsFalse(ms.isDirty());
+
+			ms.setInterval(ms.getInterval() + 1);
+			ms.setIntervalAdaptive(!ms.isIntervalAdaptive());
+			Assert::AreEqual<int>(MiscSettings::ATT_INTERVAL | MiscSettings::ATT_ADAPTIVE,
+				ms.getDirtyMask());
+
+			ms.markClean();
+			Assert::IsFalse(ms.isDirty());
+			ms.setHotkey(ms.getHotkey() + 1);
+			Assert::AreEqual<int>(MiscSettings::ATT_HOTKEY, ms.getDirtyMask());
+		}
 	};
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "CppUnitTest.h"
 #include "OleUtils.h"
+#include <thread>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace std;
@@ -33,6 +34,38 @@ namespace AutoSave_tests
 			Assert::IsTrue(OleUtils::isSelf(selfAllLowers));
 		}
 
+		TEST_METHOD(TestOleSelfIdentity)
+		{
+			const wstring selfPath = OleUtils::getSelfPath();
+			Assert::IsTrue(OleUtils::getSelfIdentity().isKnown());
+			Assert::IsTrue(OleUtils::getSelfIdentity() ==
+				OleUtils::getFileIdentity(selfPath));
+			Assert::IsFalse(OleUtils::getFileIdentity(notepad) ==
+				OleUtils::getSelfIdentity());
+			Assert::IsFalse(OleUtils::getFileIdentity(nonexisting).isKnown());
+
+			TCHAR shortPath[MAX_PATH];
+			DWORD size = GetShortPathName(selfPath.data(), shortPath, MAX_PATH);
+			Assert::IsTrue(size != 0 && size < MAX_PATH);
+			Assert::IsTrue(OleUtils::isSelf(shortPath));
+			Assert::IsFalse(OleUtils::isSelf(notepad));
+			Assert::IsFalse(OleUtils::isSelf(nonexisting));
+		}
+
+		TEST_METHOD(TestOleSelfPathFromThreads)
+		{
+			vector<wstring> paths(8);
+			vector<std::thread> threads;
+			for (size_t i = 0; i < paths.size(); ++i)
+				threads.push_back(std::thread([&paths, i]() {
+					paths[i] = OleUtils::getSelfPath();
+				}));
+			for (std::thread& thread : threads)
+				thread.join();
+			for (const wstring& path : paths)
+				Assert::AreEqual(OleUtils::getSelfPath(), path);
+		}
+
 		TEST_METHOD(TestOleFileRecognition)
 		{
 			Assert::IsTrue(OleUtils::isExecutable(notepad));
@@ -0,0 +1,155 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "PacingCalibrator.h"
+#include "DesktopSimulator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(PacingCalibratorTests)
+	{
+	public:
+
+		struct Target
+		{
+			VirtualClock clock;
+			SimulatedDesktop desktop;
+			RecordingInputSink input;
+			SimulatedFileSystem files;
+			SimulatedApplication app;
+
+			Target()
+				: input(clock, desktop), files(clock),
+				  app(desktop, input, files, L"poster.ai - Illustrator",
+					L"Illustrator.exe", 42)
+			{
+				clock.setTime(1000);
+				files.writeFile(L"poster.ai", 1000);
+				app.setDocument(L"poster.ai");
+			}
+
+			// Steps once per second until the calibration is over.
+			PacingCalibrator::Status run(PacingCalibrator& calibrator)
+			{
+				for (int i = 0; i < 1000 && calibrator.isProbing(); ++i)
+				{
+					clock.advance(1000);
+					calibrator.step();
+				}
+				return calibrator.getStatus();
+			}
+		};
+
+		static KeyMacro ctrlS() {
+			return KeyMacro::fromHotkey(MAKEWORD('S', HOTKEYF_CONTROL));
+		}
+
+		TEST_METHOD(TestFindsShortestReliableDelay)
+		{
+			Target target;
+			target.app.setInputLatency(20);
+			PacingCalibrator calibrator(target.clock, target.desktop,
+				target.input, target.files);
+			Assert::IsTrue(calibrator.start(target.app.getWindow(), ctrlS(),
+				{ L"poster.ai", L"missing.ai" }));
+
+			Assert::AreEqual<int>(PacingCalibrator::PC_DONE, target.run(calibrator));
+			Assert::AreEqual<wstring>(L"illustrator.exe", calibrator.getExecutable());
+			Assert::AreEqual<DWORD>(25, calibrator.getProfile().eventDelay);
+
+			// 200, 100, 50, and 25 three times each, then 12 once.
+			const vector<PacingCalibrator::Attempt>& attempts = calibrator.getAttempts();
+			Assert::AreEqual<size_t>(13, attempts.size());
+			Assert::AreEqual<DWORD>(200, attempts[0].eventDelay);
+			Assert::IsTrue(attempts[11].isSaved);
+			Assert::AreEqual<DWORD>(12, attempts[12].eventDelay);
+			Assert::IsFalse(attempts[12].isSaved);
+			Assert::AreEqual<UINT>(12, target.app.getSaveCount());
+			Assert::AreEqual<UINT>(1, target.app.getMissedCount());
+		}
+
+		TEST_METHOD(TestWellBehavedProgramTakesBatches)
+		{
+			Target target;
+			PacingCalibrator calibrator(target.clock, target.desktop,
+				target.input, target.files);
+			calibrator.setStartDelay(10);
+			calibrator.setAttemptsPerDelay(2);
+			calibrator.start(target.app.getWindow(), ctrlS(), { L"poster.ai" });
+
+			Assert::AreEqual<int>(PacingCalibrator::PC_DONE, target.run(calibrator));
+			Assert::AreEqual<DWORD>(0, calibrator.getProfile().eventDelay);
+			// 10, 5, 2, 1, 0.
+			Assert::AreEqual<size_t>(10, calibrator.getAttempts().size());
+			Assert::AreEqual<UINT>(0, target.app.getMissedCount());
+			// The last attempts went out as one batch.
+			const auto& records = target.input.getRecords();
+			Assert::AreEqual<size_t>(4, records.back().events.size());
+		}
+
+		TEST_METHOD(TestFailsForTooSlowProgram)
+		{
+			Target target;
+			target.app.setInputLatency(500);
+			PacingCalibrator calibrator(target.clock, target.desktop,
+				target.input, target.files);
+			calibrator.setTimeout(2000);
+			calibrator.start(target.app.getWindow(), ctrlS(), { L"poster.ai" });
+
+			Assert::AreEqual<int>(PacingCalibrator::PC_FAILED, target.run(calibrator));
+			Assert::AreEqual<size_t>(1, calibrator.getAttempts().size());
+			Assert::AreEqual<ULONGLONG>(0, calibrator.getAttempts()[0].latency);
+		}
+
+		TEST_METHOD(TestCountsSaveDialogs)
+		{
+			Target target;
+			target.app.setDocument(L"");
+			target.app.setInputLatency(60);
+			PacingCalibrator calibrator(target.clock, target.desktop,
+				target.input, target.files);
+			calibrator.setAttemptsPerDelay(1);
+			calibrator.start(target.app.getWindow(), ctrlS(), vector<wstring>());
+
+			Assert::AreEqual<int>(PacingCalibrator::PC_DONE, target.run(calibrator));
+			Assert::AreEqual<DWORD>(100, calibrator.getProfile().eventDelay);
+			Assert::AreEqual<UINT>(2, target.app.getDialogCount());
+			// Each dialog was closed again.
+			Assert::IsTrue(target.app.getDialog() == 0);
+			Assert::IsTrue(target.desktop.getForegroundWindow() == target.app.getWindow());
+		}
+
+		TEST_METHOD(TestWaitsForTarget)
+		{
+			Target target;
+			PacingCalibrator calibrator(target.clock, target.desktop,
+				target.input, target.files);
+			Assert::IsFalse(calibrator.start(NULL, ctrlS(), vector<wstring>()));
+			Assert::IsFalse(calibrator.start(target.app.getWindow(), KeyMacro(),
+				vector<wstring>()));
+			Assert::IsTrue(calibrator.start(target.app.getWindow(), ctrlS(),
+				{ L"poster.ai" }));
+
+			HWND other = target.desktop.openWindow(L"Untitled - Notepad");
+			target.input.pressKey(VK_SHIFT);
+			target.clock.advance(1000);
+			calibrator.step();
+			target.desktop.setForeground(target.app.getWindow());
+			target.clock.advance(1000);
+			calibrator.step();
+			Assert::AreEqual<size_t>(0, target.input.getRecords().size());
+
+			target.input.releaseKey(VK_SHIFT);
+			target.clock.advance(1000);
+			calibrator.step();
+			// Ctrl+S, one event at a time.
+			Assert::AreEqual<size_t>(4, target.input.getRecords().size());
+
+			target.desktop.setForeground(other);
+			target.desktop.closeWindow(target.app.getWindow());
+			Assert::AreEqual<int>(PacingCalibrator::PC_FAILED, target.run(calibrator));
+		}
+	};
+}
@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ReadinessProbe.h"
+#include "DesktopSimulator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(ReadinessProbeTests)
+	{
+	public:
+
+		TEST_METHOD(TestTellsBusyFromLoadSinceSample)
+		{
+			VirtualClock clock;
+			SimulatedDesktop desktop(&clock);
+			HWND hwnd = desktop.openWindow(L"render.blend - Blender", 42);
+			ReadinessProbe probe(clock, desktop);
+			Assert::AreEqual<int>(ReadinessProbe::RD_READY, probe.probe(hwnd));
+
+			desktop.setCpuLoad(hwnd, 100);
+			clock.advance(5000);
+			Assert::AreEqual<int>(ReadinessProbe::RD_BUSY, probe.probe(hwnd));
+			// Too soon after the last sample to tell.
+			desktop.setCpuLoad(hwnd, 0);
+			clock.advance(100);
+			Assert::AreEqual<int>(ReadinessProbe::RD_READY, probe.probe(hwnd));
+			clock.advance(900);
+			Assert::AreEqual<int>(ReadinessProbe::RD_READY, probe.probe(hwnd));
+
+			// Several threads of a busy program that still has a core to spare.
+			desktop.setCpuLoad(hwnd, 80);
+			clock.advance(2000);
+			Assert::AreEqual<int>(ReadinessProbe::RD_READY, probe.probe(hwnd));
+			desktop.setCpuLoad(hwnd, 250);
+			clock.advance(2000);
+			Assert::AreEqual<int>(ReadinessProbe::RD_BUSY, probe.probe(hwnd));
+		}
+
+		TEST_METHOD(TestTellsNotResponding)
+		{
+			VirtualClock clock;
+			SimulatedDesktop desktop(&clock);
+			HWND hwnd = desktop.openWindow(L"Untitled - Notepad", 7);
+			ReadinessProbe probe(clock, desktop);
+			desktop.setResponseTime(hwnd, ReadinessProbe::responseTimeout);
+			Assert::AreEqual<int>(ReadinessProbe::RD_READY, probe.probe(hwnd));
+			desktop.setResponseTime(hwnd, ReadinessProbe::responseTimeout + 1);
+			Assert::AreEqual<int>(ReadinessProbe::RD_NOT_RESPONDING, probe.probe(hwnd));
+			desktop.setResponseTime(hwnd, 0);
+			desktop.setHung(hwnd, true);
+			Assert::AreEqual<int>(ReadinessProbe::RD_NOT_RESPONDING, probe.probe(hwnd));
+		}
+
+		TEST_METHOD(TestBacksOffUntilReady)
+		{
+			VirtualClock clock;
+			SimulatedDesktop desktop(&clock);
+			HWND hwnd = desktop.openWindow(L"Untitled - Notepad", 7);
+			desktop.setResponseTime(hwnd, 1000);
+			ReadinessProbe probe(clock, desktop);
+
+			vector<ULONGLONG> probeTimes;
+			for (ULONGLONG time = 0; time < 20000; time += 500)
+			{
+				clock.setTime(time);
+				const ReadinessProbe::Decision decision = probe.decide(hwnd);
+				Assert::AreNotEqual<int>(ReadinessProbe::DC_SEND, decision);
+				if (decision == ReadinessProbe::DC_DEFER)
+					probeTimes.push_back(time);
+			}
+			const vector<ULONGLONG> expected = { 0, 1000, 3000, 7000, 15000 };
+			Assert::IsTrue(expected == probeTimes);
+			Assert::IsTrue(probe.isDeferring());
+			Assert::AreEqual<ULONGLONG>(19500, probe.getDeferredTime());
+
+			desktop.setResponseTime(hwnd, 0);
+			clock.setTime(22999);
+			Assert::AreEqual<int>(ReadinessProbe::DC_WAIT, probe.decide(hwnd));
+			clock.setTime(23000);
+			Assert::AreEqual<int>(ReadinessProbe::DC_SEND, probe.decide(hwnd));
+			Assert::IsFalse(probe.isDeferring());
+		}
+
+		TEST_METHOD(TestGivesUpOnlyWhileNotResponding)
+		{
+			VirtualClock clock;
+			SimulatedDesktop desktop(&clock);
+			HWND hwnd = desktop.openWindow(L"Untitled - Notepad", 7);
+			desktop.setResponseTime(hwnd, 1000);
+			ReadinessProbe probe(clock, desktop);
+			ReadinessProbe::Decision decision = ReadinessProbe::DC_SEND;
+			for (ULONGLONG time = 1000; time <= 60000; time += 1000)
+			{
+				clock.setTime(time);
+				decision = probe.decide(hwnd);
+				if (decision == ReadinessProbe::DC_GIVE_UP)
+					break;
+			}
+			Assert::AreEqual<int>(ReadinessProbe::DC_GIVE_UP, decision);
+			Assert::IsTrue(clock.getTickCount() >= 1000 + ReadinessProbe::maxDeferral);
+			Assert::IsTrue(clock.getTickCount() <= 1000 + ReadinessProbe::maxDeferral +
+				ReadinessProbe::maxProbeDelay);
+			Assert::IsFalse(probe.isDeferring());
+
+			// A busy program still takes input, if late.
+			desktop.setResponseTime(hwnd, 0);
+			desktop.setCpuLoad(hwnd, 100);
+			decision = ReadinessProbe::DC_DEFER;
+			for (ULONGLONG time = 61000; time <= 120000; time += 1000)
+			{
+				clock.setTime(time);
+				decision = probe.decide(hwnd);
+				if (decision != ReadinessProbe::DC_DEFER && decision != ReadinessProbe::DC_WAIT)
+					break;
+			}
+			Assert::AreEqual<int>(ReadinessProbe::DC_SEND, decision);
+			Assert::IsTrue(clock.getTickCount() >= 61000 + ReadinessProbe::maxDeferral);
+		}
+	};
+}
@@ -0,0 +1,59 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "RegexAnalyzer.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(RegexAnalyzerTests)
+	{
+	public:
+
+		TEST_METHOD(TestAnalyzerFlagsNestedQuantifiers)
+		{
+			const wchar_t* patterns[] = {
+				L"(a+)+", L"(a*)*b", L"(x+x+)+y", L"(\\w+\\s?)*$", L"((ab)*)+", L"(a+){2,}",
+				L"(.*a){12}", L"(?=(.*a){12}z)"
+			};
+			for (auto pattern : patterns)
+			{
+				Assert::IsFalse(RegexAnalyzer::findCatastrophicBacktracking(
+					pattern, true).empty(), pattern);
+			}
+		}
+
+		TEST_METHOD(TestAnalyzerFlagsOverlappingAlternatives)
+		{
+			const wchar_t* patterns[] = {
+				L"(a|ab)*c", L"(a|a)+", L"(.|\\s)*", L"(\\d|[0-9a-f])+!", L"(A|a)+"
+			};
+			for (auto pattern : patterns)
+			{
+				Assert::IsFalse(RegexAnalyzer::findCatastrophicBacktracking(
+					pattern, true).empty(), pattern);
+			}
+		}
+
+		TEST_METHOD(TestAnalyzerAcceptsHarmlessPatterns)
+		{
+			const wchar_t* patterns[] = {
+				L"abc", L"a+b+", L"(ab)+", L"(a|b)*", L"Notepad$", L"^(Word|Excel) -",
+				L". Reg[[:alnum:]]x", L"(a)\\1", L"(a+)?", L"(\\d{2}:){2}\\d{2}"
+			};
+			for (auto pattern : patterns)
+			{
+				Assert::AreEqual<wstring>(L"", RegexAnalyzer::findCatastrophicBacktracking(
+					pattern, true), pattern);
+			}
+		}
+
+		TEST_METHOD(TestAnalyzerRespectsCase)
+		{
+			Assert::AreEqual<wstring>(L"",
+				RegexAnalyzer::findCatastrophicBacktracking(L"(A|a)+", false));
+		}
+
+	};
+}
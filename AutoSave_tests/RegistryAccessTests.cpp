@@ -162,13 +162,13 @@ namespace AutoSave_tests
 			if (sizeNeeded == 0)
 				return L"Couldn't retrieve error message";
 
-			std::auto_ptr<wchar_t> wide(new wchar_t[sizeNeeded]);
+			std::vector<wchar_t> wide(sizeNeeded);
 			size_t result = MultiByteToWideChar(
-				CP_ACP, MB_USEGLYPHCHARS, ansi, -1, wide.get(), (int)sizeNeeded);
+				CP_ACP, MB_USEGLYPHCHARS, ansi, -1, wide.data(), (int)sizeNeeded);
 			if (result == 0)
 				return L"Couldn't retrieve error message";
 
-			return wide.get();
+			return wide.data();
 		}
 
 		TEST_METHOD(TestRAReadKeyDefaultString)
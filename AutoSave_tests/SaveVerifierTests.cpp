@@ -0,0 +1,179 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "SaveVerifier.h"
+#include "DesktopSimulator.h"
+
+#ifndef _WIN32
+#include <fstream>
+#include <unistd.h>
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(SaveVerifierTests)
+	{
+	public:
+
+		TEST_METHOD(TestOnlyWatchesExistingFiles)
+		{
+			VirtualClock clock;
+			SimulatedFileSystem files(clock);
+			files.writeFile(L"/home/someone/poster.ai", 100);
+			SaveVerifier verifier(files, clock);
+			verifier.setTimeout(5000);
+
+			Assert::AreEqual<size_t>(1, verifier.setFiles(
+				{ L"/usr/bin/illustrator", L"/home/someone/poster.ai", L"--safe" }));
+			Assert::IsTrue(verifier.isActive());
+			verifier.setTimeout(0);
+			Assert::IsFalse(verifier.isActive());
+		}
+
+		TEST_METHOD(TestConfirmsChangeWithLatency)
+		{
+			VirtualClock clock;
+			SimulatedFileSystem files(clock);
+			files.writeFile(L"doc.txt", 100);
+			SaveVerifier verifier(files, clock);
+			verifier.setTimeout(5000);
+			verifier.setFiles({ L"doc.txt" });
+
+			// The user's own saves don't count.
+			clock.advance(1000);
+			files.writeFile(L"doc.txt", 110);
+			Assert::AreEqual<int>(SaveVerifier::SV_IDLE, verifier.step());
+
+			verifier.startVerification();
+			clock.advance(1000);
+			Assert::AreEqual<int>(SaveVerifier::SV_WAITING, verifier.step());
+			clock.advance(500);
+			files.writeFile(L"doc.txt", 120);
+			Assert::AreEqual<int>(SaveVerifier::SV_CONFIRMED, verifier.step());
+			Assert::AreEqual<size_t>(1, verifier.getConfirmedCount());
+			Assert::AreEqual<ULONGLONG>(1500, verifier.getLatencies()[0]);
+			Assert::AreEqual<int>(SaveVerifier::SV_IDLE, verifier.step());
+		}
+
+		TEST_METHOD(TestTellsWhetherPreviousSaveChangedFile)
+		{
+			VirtualClock clock;
+			SimulatedFileSystem files(clock);
+			files.writeFile(L"doc.txt", 100);
+			SaveVerifier verifier(files, clock);
+			verifier.setTimeout(5000);
+			verifier.setFiles({ L"doc.txt" });
+
+			verifier.startVerification();
+			Assert::AreEqual<int>(SaveVerifier::CH_UNKNOWN,
+				verifier.getChangeSincePreviousSave());
+			clock.advance(1000);
+			files.writeFile(L"doc.txt", 100);
+			verifier.step();
+
+			verifier.startVerification();
+			Assert::AreEqual<int>(SaveVerifier::CH_CHANGED,
+				verifier.getChangeSincePreviousSave());
+			clock.advance(5000);
+			verifier.step();
+
+			verifier.startVerification();
+			Assert::AreEqual<int>(SaveVerifier::CH_UNCHANGED,
+				verifier.getChangeSincePreviousSave());
+		}
+
+		TEST_METHOD(TestRetriesThenFails)
+		{
+			VirtualClock clock;
+			SimulatedFileSystem files(clock);
+			files.writeFile(L"doc.txt", 100);
+			SaveVerifier verifier(files, clock);
+			verifier.setTimeout(3000);
+			verifier.setMaxRetries(1);
+			verifier.setFiles({ L"doc.txt" });
+
+			verifier.startVerification();
+			clock.advance(3000);
+			Assert::AreEqual<int>(SaveVerifier::SV_RETRY, verifier.step());
+			// Stays due until the input has been sent again.
+			clock.advance(1000);
+			Assert::AreEqual<int>(SaveVerifier::SV_RETRY, verifier.step());
+
+			verifier.startVerification();
+			Assert::AreEqual<size_t>(1, verifier.getRetryCount());
+			clock.advance(3000);
+			Assert::AreEqual<int>(SaveVerifier::SV_FAILED, verifier.step());
+			Assert::AreEqual<size_t>(1, verifier.getFailedCount());
+			Assert::AreEqual<int>(SaveVerifier::SV_IDLE, verifier.step());
+		}
+
+		TEST_METHOD(TestSimulatedSwallowedChord)
+		{
+			Configuration cfg;
+			cfg.settings.setInterval(60);
+			cfg.settings.setVerbosity(MiscSettings::QUIET);
+			cfg.filter.setFilter(L"Notepad", false);
+			DesktopSimulator sim(cfg);
+			sim.getDesktop().openWindow(L"doc.txt - Notepad");
+			sim.getFileSystem().writeFile(L"doc.txt", 100);
+			sim.verifySaves({ L"doc.txt" }, 5000, 1);
+
+			// The first save is swallowed, e.g. by a modal dialog, the
+			// retry works; later, the application stops saving at all.
+			UINT received = 0;
+			sim.getInput().setSendHandler([&](const RecordingInputSink::Record&) {
+				if (++received == 1 || received > 3)
+					return;
+				sim.at(sim.getClock().getTickCount() + 800, [&]() {
+					sim.getFileSystem().writeFile(L"doc.txt", 100 + received);
+				});
+			});
+			sim.start();
+			sim.runFor(3 * 60 * 1000 + 10 * 1000);
+
+			const SaveVerifier& verifier = sim.getVerifier();
+			Assert::AreEqual<size_t>(2, verifier.getConfirmedCount());
+			Assert::AreEqual<size_t>(2, verifier.getRetryCount());
+			Assert::AreEqual<size_t>(1, verifier.getFailedCount());
+			Assert::AreEqual<UINT>(1, sim.getSaveFailedCount());
+			// Three intervals, plus one retry each for the first and the last.
+			Assert::AreEqual<size_t>(5, sim.getSaves().size());
+			Assert::AreEqual<ULONGLONG>(60 * 1000 + 5000, sim.getSaves()[1].time);
+		}
+
+#ifndef _WIN32
+		TEST_METHOD(TestPlatformFileWatcher)
+		{
+			char directory[] = "/tmp/autosave_tests_XXXXXX";
+			Assert::IsNotNull(mkdtemp(directory));
+			string path = string(directory) + "/document.txt";
+			wstring widePath(path.begin(), path.end());
+			ofstream(path) << "first";
+
+			unique_ptr<FileWatcher> pWatcher = Platform::createFileWatcher();
+			FileStamp before = pWatcher->getStamp(widePath);
+			Assert::IsTrue(before.exists);
+			Assert::AreEqual<ULONGLONG>(5, before.size);
+#ifdef __linux__
+			Assert::IsTrue(pWatcher->watch(widePath));
+			Assert::IsTrue(pWatcher->takeChanges().empty());
+
+			// Saved by renaming a new file, as many applications do.
+			ofstream(path + ".tmp") << "second";
+			rename((path + ".tmp").c_str(), path.c_str());
+			vector<wstring> changes = pWatcher->takeChanges();
+			Assert::AreEqual<size_t>(1, changes.size());
+			Assert::AreEqual(widePath, changes[0]);
+			Assert::IsTrue(before != pWatcher->getStamp(widePath));
+			pWatcher->unwatchAll();
+#endif
+			unlink(path.c_str());
+			rmdir(directory);
+			Assert::IsFalse(pWatcher->getStamp(widePath).exists);
+		}
+#endif
+
+	};
+}
@@ -0,0 +1,120 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ShortcutJournal.h"
+#include "MemoryConfigStore.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(ShortcutJournalTests)
+	{
+	public:
+
+		const wstring listName = L"connectedShortcutsList";
+
+		TEST_METHOD(TestJournalAddWritesOneValue)
+		{
+			MemoryConfigStore store;
+			ShortcutJournal journal(store, listName);
+
+			journal.add(L"C:\\a.lnk");
+			journal.add(L"C:\\b.lnk");
+			journal.add(L"C:\\a.lnk");
+			Assert::AreEqual<size_t>(2, journal.getJournalSize());
+			Assert::AreEqual<size_t>(2, store.getValueNames().size());
+			Assert::IsFalse(store.contains(listName));
+			Assert::AreEqual<wstring>(L"C:\\a.lnk",
+				store.readString(journal.getEntryName(L"C:\\a.lnk")));
+		}
+
+		TEST_METHOD(TestJournalEntryNames)
+		{
+			MemoryConfigStore store;
+			ShortcutJournal journal(store, listName);
+			const wstring name = journal.getEntryName(L"C:\\a.lnk");
+
+			Assert::AreEqual(listName.size() + 17, name.size());
+			Assert::AreEqual<wstring>(listName + L".", name.substr(0, listName.size() + 1));
+			Assert::AreEqual(name, journal.getEntryName(L"C:\\a.lnk"));
+			Assert::AreNotEqual(name, journal.getEntryName(L"C:\\A.lnk"));
+		}
+
+		TEST_METHOD(TestJournalReadMergesList)
+		{
+			MemoryConfigStore store;
+			store.writeMultiString(listName, { L"C:\\z.lnk", L"C:\\b.lnk" });
+			ShortcutJournal journal(store, listName);
+			Assert::IsTrue(journal.read() ==
+				vector<wstring>({ L"C:\\z.lnk", L"C:\\b.lnk" }));
+
+			journal.add(L"C:\\c.lnk");
+			journal.add(L"C:\\b.lnk");
+			journal.add(L"C:\\a.lnk");
+			Assert::IsTrue(journal.read() == vector<wstring>(
+				{ L"C:\\z.lnk", L"C:\\b.lnk", L"C:\\a.lnk", L"C:\\c.lnk" }));
+		}
+
+		TEST_METHOD(TestJournalCompact)
+		{
+			MemoryConfigStore store;
+			store.writeInt(L"interval", 60);
+			ShortcutJournal journal(store, listName);
+			Assert::IsTrue(journal.compact().empty());
+			Assert::IsFalse(store.contains(listName));
+
+			journal.add(L"C:\\b.lnk");
+			journal.add(L"C:\\a.lnk");
+			const vector<wstring> files = journal.read();
+			Assert::IsTrue(journal.compact() == files);
+
+			Assert::AreEqual<size_t>(0, journal.getJournalSize());
+			Assert::IsTrue(store.readMultiString(listName) == files);
+			Assert::IsTrue(journal.read() == files);
+			Assert::AreEqual(60, store.readInt(L"interval"));
+		}
+
+		TEST_METHOD(TestJournalCompactPrunes)
+		{
+			MemoryConfigStore store;
+			store.writeMultiString(listName, { L"C:\\a.lnk", L"C:\\a.lnk" });
+			ShortcutJournal journal(store, listName);
+			auto keepLast = [](const vector<wstring>& files) {
+				return vector<wstring>(files.end() - 1, files.end());
+			};
+
+			// Even without journal entries.
+			Assert::IsTrue(journal.compact(keepLast) == vector<wstring>({ L"C:\\a.lnk" }));
+			Assert::IsTrue(store.readMultiString(listName) == vector<wstring>({ L"C:\\a.lnk" }));
+
+			journal.add(L"C:\\b.lnk");
+			Assert::IsTrue(journal.compact(keepLast) == vector<wstring>({ L"C:\\b.lnk" }));
+			Assert::AreEqual<size_t>(0, journal.getJournalSize());
+		}
+
+		TEST_METHOD(TestJournalConcurrentCompactionsKeepEntries)
+		{
+			MemoryConfigStore store;
+			ShortcutJournal first(store, listName);
+			ShortcutJournal second(store, listName);
+			first.add(L"C:\\a.lnk");
+
+			// The second instance starts, and compacts, while the first one
+			// is still pruning what it read.
+			vector<wstring> compacted = first.compact([&](const vector<wstring>& files) {
+				second.add(L"C:\\b.lnk");
+				Assert::IsTrue(second.compact() ==
+					vector<wstring>({ L"C:\\a.lnk", L"C:\\b.lnk" }));
+				Assert::AreEqual<size_t>(0, second.getJournalSize());
+				return files;
+			});
+
+			const vector<wstring> both({ L"C:\\a.lnk", L"C:\\b.lnk" });
+			Assert::IsTrue(compacted == both);
+			Assert::IsTrue(store.readMultiString(listName) == both);
+			Assert::IsTrue(first.read() == both);
+		}
+
+	};
+}
@@ -0,0 +1,82 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ShortcutListCompactor.h"
+#include <atomic>
+#include <unordered_set>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(ShortcutListCompactorTests)
+	{
+	public:
+
+		static vector<wstring> makePaths(size_t count)
+		{
+			vector<wstring> paths;
+			for (size_t i = 0; i < count; ++i)
+				paths.push_back(L"C:\\Shortcut " + to_wstring(i) + L".lnk");
+			return paths;
+		}
+
+		TEST_METHOD(TestCompactorDropsDuplicatesAndDeadFiles)
+		{
+			const unordered_set<wstring> existing = { L"C:\\a.lnk", L"C:\\c.lnk" };
+			ShortcutListCompactor compactor([&existing](const wstring& file) {
+				return existing.count(file) == 1;
+			});
+
+			vector<wstring> files = compactor.compact(
+				{ L"C:\\c.lnk", L"C:\\a.lnk", L"C:\\b.lnk", L"c:/C.lnk", L"C:\\c.lnk" });
+			Assert::IsTrue(files == vector<wstring>({ L"C:\\a.lnk", L"C:\\c.lnk" }));
+			Assert::AreEqual<size_t>(2, compactor.getResult().duplicates);
+			Assert::AreEqual<size_t>(1, compactor.getResult().deadFiles);
+			Assert::AreEqual<size_t>(0, compactor.getResult().overflow);
+		}
+
+		TEST_METHOD(TestCompactorKeepsNewest)
+		{
+			ShortcutListCompactor compactor(
+				[](const wstring&) { return true; }, 3, 1);
+			vector<wstring> files = compactor.compact(makePaths(5));
+			Assert::IsTrue(files == vector<wstring>(
+				{ L"C:\\Shortcut 2.lnk", L"C:\\Shortcut 3.lnk", L"C:\\Shortcut 4.lnk" }));
+			Assert::AreEqual<size_t>(2, compactor.getResult().overflow);
+		}
+
+		TEST_METHOD(TestCompactorChecksEachFileOnceInParallel)
+		{
+			vector<wstring> paths = makePaths(1000);
+			vector<wstring> input = paths;
+			input.insert(input.end(), paths.begin(), paths.end());
+			atomic<size_t> checkCount(0);
+			auto isEven = [&checkCount](const wstring& file) {
+				++checkCount;
+				return (file[file.size() - 5] - L'0') % 2 == 0;
+			};
+
+			ShortcutListCompactor serial(isEven, 2000, 1);
+			ShortcutListCompactor parallel(isEven, 2000, 8);
+			Assert::AreEqual(8u, parallel.getThreadCount());
+			const vector<wstring> expected = serial.compact(input);
+			Assert::AreEqual<size_t>(1000, checkCount);
+			checkCount = 0;
+			Assert::IsTrue(expected == parallel.compact(input));
+			Assert::AreEqual<size_t>(1000, checkCount);
+			Assert::AreEqual<size_t>(500, expected.size());
+		}
+
+		TEST_METHOD(TestCompactorEmptyList)
+		{
+			ShortcutListCompactor compactor;
+			Assert::IsTrue(compactor.compact(vector<wstring>()).empty());
+			Assert::AreEqual((unsigned) ShortcutListCompactor::maxThreadCount,
+				compactor.getThreadCount());
+			Assert::AreEqual(1u, ShortcutListCompactor(Platform::fileExists,
+				10, 0).getThreadCount());
+		}
+
+	};
+}
@@ -0,0 +1,81 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "SortedPathList.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(SortedPathListTests)
+	{
+	public:
+
+		TEST_METHOD(TestPathListInsertSorts)
+		{
+			SortedPathList list;
+			Assert::AreEqual<size_t>(0, list.insert(L"C:\\b.lnk"));
+			Assert::AreEqual<size_t>(0, list.insert(L"C:\\A.lnk"));
+			Assert::AreEqual<size_t>(2, list.insert(L"C:\\c.lnk"));
+			Assert::AreEqual((size_t) SortedPathList::npos, list.insert(L"c:/B.lnk"));
+
+			vector<wstring> expected = { L"C:\\A.lnk", L"C:\\b.lnk", L"C:\\c.lnk" };
+			Assert::IsTrue(expected == list.getPaths());
+			Assert::IsTrue(list.contains(L"c:\\a.LNK"));
+			Assert::AreEqual<size_t>(1, list.find(L"C:\\B.lnk"));
+			Assert::AreEqual((size_t) SortedPathList::npos, list.find(L"C:\\d.lnk"));
+		}
+
+		TEST_METHOD(TestPathListEraseAt)
+		{
+			SortedPathList list;
+			for (wchar_t c = L'a'; c <= L'f'; ++c)
+				list.insert(wstring(L"C:\\") + c + L".lnk");
+
+			Assert::AreEqual<size_t>(3, list.eraseAt({ 5, 0, 2, 2, 99 }));
+			vector<wstring> expected = { L"C:\\b.lnk", L"C:\\d.lnk", L"C:\\e.lnk" };
+			Assert::IsTrue(expected == list.getPaths());
+			Assert::IsFalse(list.contains(L"C:\\a.lnk"));
+			Assert::AreEqual<size_t>(2, list.find(L"C:\\e.lnk"));
+
+			Assert::IsTrue(list.erase(L"C:\\D.LNK"));
+			Assert::IsFalse(list.erase(L"C:\\d.lnk"));
+			Assert::AreEqual<size_t>(1, list.insert(L"C:\\c.lnk"));
+			Assert::AreEqual<size_t>(3, list.size());
+		}
+
+		TEST_METHOD(TestPathListInsertMany)
+		{
+			SortedPathList list;
+			list.insert(L"C:\\b.lnk");
+			list.insert(L"C:\\d.lnk");
+			Assert::AreEqual<size_t>(3, list.insert(vector<wstring>(
+				{ L"C:\\e.lnk", L"C:\\B.lnk", L"C:\\a.lnk", L"C:\\c.lnk", L"c:/A.lnk" })));
+
+			vector<wstring> expected = { L"C:\\a.lnk", L"C:\\b.lnk", L"C:\\c.lnk",
+				L"C:\\d.lnk", L"C:\\e.lnk" };
+			Assert::IsTrue(expected == list.getPaths());
+			Assert::AreEqual<size_t>(3, list.find(L"C:\\d.lnk"));
+			Assert::AreEqual<size_t>(8, list.getMaxLength());
+		}
+
+		TEST_METHOD(TestPathListMaxLength)
+		{
+			SortedPathList list;
+			Assert::AreEqual<size_t>(0, list.getMaxLength());
+			list.insert(L"C:\\a.lnk");
+			list.insert(L"C:\\long\\b.lnk");
+			list.insert(L"C:\\long\\c.lnk");
+			Assert::AreEqual<size_t>(13, list.getMaxLength());
+
+			list.erase(L"C:\\long\\b.lnk");
+			Assert::AreEqual<size_t>(13, list.getMaxLength());
+			list.erase(L"C:\\long\\c.lnk");
+			Assert::AreEqual<size_t>(8, list.getMaxLength());
+			list.clear();
+			Assert::AreEqual<size_t>(0, list.getMaxLength());
+			Assert::IsTrue(list.empty());
+		}
+
+	};
+}
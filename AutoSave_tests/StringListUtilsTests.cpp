@@ -0,0 +1,60 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "StringListUtils.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(StringListUtilsTests)
+	{
+	public:
+
+		TEST_METHOD(TestMultiStringRoundTrip)
+		{
+			vector<wstring> strings = { L"first", L"second one", L"äöü" };
+			wstring multiString = StringListUtils::vectorToMultiString(strings);
+			Assert::AreEqual<size_t>(6 + 11 + 4, multiString.size());
+			Assert::IsTrue(strings == StringListUtils::multiStringToVector(multiString.c_str()));
+		}
+
+		TEST_METHOD(TestMultiStringEmpty)
+		{
+			Assert::AreEqual(wstring(), StringListUtils::vectorToMultiString({}));
+			Assert::IsTrue(StringListUtils::multiStringToVector(L"").empty());
+			Assert::IsTrue(StringListUtils::multiStringToVector(L"\0\0").empty());
+		}
+
+		TEST_METHOD(TestMultiStringStopsAtEmptyString)
+		{
+			vector<wstring> strings = StringListUtils::multiStringToVector(L"a\0b\0\0c\0");
+			Assert::AreEqual<size_t>(2, strings.size());
+			Assert::AreEqual(wstring(L"b"), strings[1]);
+		}
+
+		TEST_METHOD(TestMergeLists)
+		{
+			vector<wstring> acceptor = { L"a", L"b", L"c" };
+			StringListUtils::mergeLists(acceptor, { L"c", L"d", L"a", L"e" });
+			vector<wstring> expected = { L"a", L"b", L"c", L"d", L"e" };
+			Assert::IsTrue(expected == acceptor);
+		}
+
+		TEST_METHOD(TestNormalizePath)
+		{
+			Assert::AreEqual<wstring>(L"c:\\users\\a.lnk",
+				StringListUtils::normalizePath(L"C:/Users//A.lnk"));
+			Assert::AreEqual<wstring>(L"\\\\server\\share\\a.lnk",
+				StringListUtils::normalizePath(L"\\\\Server\\\\share\\a.lnk"));
+		}
+
+		TEST_METHOD(TestRemoveDuplicatePaths)
+		{
+			vector<wstring> paths = { L"C:\\a", L"C:\\b", L"c:/A", L"C:\\c", L"C:\\b" };
+			Assert::AreEqual<size_t>(2, StringListUtils::removeDuplicatePaths(paths));
+			vector<wstring> expected = { L"c:/A", L"C:\\c", L"C:\\b" };
+			Assert::IsTrue(expected == paths);
+		}
+	};
+}
@@ -0,0 +1,59 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "WindowListDiff.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(WindowListDiffTests)
+	{
+	public:
+
+		TEST_METHOD(TestDiffIdenticalLists)
+		{
+			vector<wstring> rows = { L"a", L"b", L"c" };
+			WindowListDiff diff(rows, rows);
+			Assert::IsTrue(diff.isEmpty());
+			Assert::IsTrue(diff.applyTo(rows) == rows);
+		}
+
+		TEST_METHOD(TestDiffOnlyTouchesChangedRows)
+		{
+			vector<wstring> oldRows = { L"a", L"b", L"c", L"d" };
+			vector<wstring> newRows = { L"a", L"x", L"c", L"d", L"e" };
+			WindowListDiff diff(oldRows, newRows);
+
+			Assert::AreEqual<size_t>(1, diff.getRemovals().size());
+			Assert::AreEqual<size_t>(1, diff.getRemovals()[0]);
+			Assert::AreEqual<size_t>(2, diff.getInsertions().size());
+			Assert::IsTrue(diff.applyTo(oldRows) == newRows);
+		}
+
+		TEST_METHOD(TestDiffRemovalsAreDescending)
+		{
+			vector<wstring> oldRows = { L"a", L"b", L"c", L"d", L"e" };
+			vector<wstring> newRows = { L"b", L"d" };
+			WindowListDiff diff(oldRows, newRows);
+
+			const vector<size_t>& removals = diff.getRemovals();
+			Assert::AreEqual<size_t>(3, removals.size());
+			for (size_t i = 1; i < removals.size(); ++i)
+				Assert::IsTrue(removals[i - 1] > removals[i]);
+			Assert::IsTrue(diff.getInsertions().empty());
+			Assert::IsTrue(diff.applyTo(oldRows) == newRows);
+		}
+
+		TEST_METHOD(TestDiffFromAndToEmpty)
+		{
+			vector<wstring> rows = { L"a", L"[...]" };
+			vector<wstring> empty;
+
+			Assert::IsTrue(WindowListDiff(empty, rows).applyTo(empty) == rows);
+			Assert::IsTrue(WindowListDiff(rows, empty).applyTo(rows) == empty);
+			Assert::IsTrue(WindowListDiff(empty, empty).isEmpty());
+		}
+
+	};
+}
@@ -0,0 +1,213 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "WriteBehindStore.h"
+#include "MemoryConfigStore.h"
+#include "Configuration.h"
+#include <algorithm>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std;
+
+namespace {
+	// Counts writes and deletions; fails them once the budget is used up.
+	class CountingStore : public MemoryConfigStore
+	{
+	public:
+		CountingStore(size_t* pWrites, size_t budget = SIZE_MAX)
+			: m_pWrites(pWrites), m_budget(budget) {}
+
+		virtual void writeInt(const wstring& valueName, int valueData) {
+			count();
+			MemoryConfigStore::writeInt(valueName, valueData);
+		}
+		virtual void writeString(const wstring& valueName, const wstring& valueData) {
+			count();
+			MemoryConfigStore::writeString(valueName, valueData);
+		}
+		virtual void writeMultiString(const wstring& valueName,
+			const vector<wstring>& strings) {
+			count();
+			MemoryConfigStore::writeMultiString(valueName, strings);
+		}
+		virtual void deleteValue(const wstring& valueName) {
+			count();
+			MemoryConfigStore::deleteValue(valueName);
+		}
+
+	private:
+		void count() {
+			if (*m_pWrites == m_budget)
+				throw ConfigStoreException(ERROR_ACCESS_DENIED);
+			++*m_pWrites;
+		}
+
+		size_t* m_pWrites;
+		size_t m_budget;
+	};
+}
+
+namespace AutoSave_tests
+{
+	TEST_CLASS(WriteBehindStoreTests)
+	{
+	public:
+
+		TEST_METHOD(TestWriteBehindCoalesces)
+		{
+			size_t writes = 0;
+			CountingStore* pInner = new CountingStore(&writes);
+			WriteBehindStore store((unique_ptr<ConfigStore>(pInner)));
+
+			for (int i = 0; i < 100; ++i)
+				store.writeInt(L"interval", i);
+			store.writeString(L"phrase", L"a");
+			store.writeString(L"phrase", L"b");
+			Assert::AreEqual<size_t>(0, writes);
+			Assert::AreEqual<size_t>(2, store.getPendingCount());
+
+			Assert::AreEqual<size_t>(2, store.flush());
+			Assert::AreEqual<size_t>(2, writes);
+			Assert::AreEqual(99, pInner->readInt(L"interval"));
+			Assert::AreEqual<wstring>(L"b", pInner->readString(L"phrase"));
+			Assert::AreEqual<size_t>(0, store.flush());
+		}
+
+		TEST_METHOD(TestWriteBehindReadsPending)
+		{
+			size_t writes = 0;
+			CountingStore* pInner = new CountingStore(&writes);
+			pInner->writeInt(L"old", 1);
+			pInner->writeInt(L"gone", 2);
+			WriteBehindStore store((unique_ptr<ConfigStore>(pInner)));
+
+			store.writeMultiString(L"list", { L"a", L"b" });
+			store.deleteValue(L"gone");
+			Assert::AreEqual(1, store.readInt(L"old"));
+			Assert::IsTrue(store.readMultiString(L"list") ==
+				vector<wstring>({ L"a", L"b" }));
+
+			try {
+				store.readInt(L"gone");
+				Assert::Fail(L"read a deleted value");
+			}
+			catch (ConfigStoreException& exc) {
+				Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND, exc.errorCode());
+			}
+			try {
+				store.readString(L"list");
+				Assert::Fail(L"wrong type");
+			}
+			catch (ConfigStoreException& exc) {
+				Assert::AreEqual<long>(ERROR_UNSUPPORTED_TYPE, exc.errorCode());
+			}
+
+			vector<wstring> names = store.getValueNames();
+			sort(names.begin(), names.end());
+			Assert::IsTrue(names == vector<wstring>({ L"list", L"old" }));
+
+			store.flush();
+			Assert::IsFalse(pInner->contains(L"gone"));
+			Assert::IsTrue(pInner->contains(L"list"));
+		}
+
+		TEST_METHOD(TestWriteBehindTryRead)
+		{
+			size_t writes = 0;
+			CountingStore* pInner = new CountingStore(&writes);
+			pInner->writeInt(L"old", 1);
+			pInner->writeInt(L"gone", 2);
+			WriteBehindStore store((unique_ptr<ConfigStore>(pInner)));
+
+			store.writeString(L"new", L"text");
+			store.deleteValue(L"gone");
+			Assert::AreEqual(1, store.tryReadInt(L"old").value());
+			Assert::AreEqual<wstring>(L"text", store.tryReadString(L"new").value());
+			Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND,
+				store.tryReadInt(L"gone").error().errorCode());
+			Assert::AreEqual<long>(ERROR_FILE_NOT_FOUND,
+				store.tryReadMultiString(L"missing").error().errorCode());
+			Assert::AreEqual<long>(ERROR_UNSUPPORTED_TYPE,
+				store.tryReadInt(L"new").error().errorCode());
+			Assert::AreEqual<long>(ERROR_UNSUPPORTED_TYPE,
+				store.tryReadString(L"old").error().errorCode());
+		}
+
+		TEST_METHOD(TestWriteBehindFailedFlushKeepsRest)
+		{
+			size_t writes = 0;
+			CountingStore* pInner = new CountingStore(&writes, 1);
+			WriteBehindStore store((unique_ptr<ConfigStore>(pInner)));
+			store.writeInt(L"a", 1);
+			store.writeInt(L"b", 2);
+			store.writeInt(L"c", 3);
+
+			Assert::ExpectException<ConfigStoreException>([&store]() {
+				store.flush();
+			});
+			Assert::AreEqual<size_t>(2, store.getPendingCount());
+			Assert::AreEqual(1, pInner->readInt(L"a"));
+			Assert::AreEqual(3, store.readInt(L"c"));
+		}
+
+		TEST_METHOD(TestConfigurationSavesOnlyChanges)
+		{
+			size_t writes = 0;
+			CountingStore store(&writes);
+			Configuration cfg;
+			cfg.saveChangesToStore(store);
+			const size_t allValues = writes;
+			Assert::IsTrue(allValues > 2);
+
+			writes = 0;
+			cfg.saveChangesToStore(store);
+			Assert::AreEqual<size_t>(0, writes);
+
+			cfg.settings.setInterval(cfg.settings.getInterval() + 1);
+			cfg.filter.setPhrase(L"gimp");
+			cfg.filter.setPhrase(L"gimp");
+			cfg.saveChangesToStore(store);
+			Assert::AreEqual<size_t>(2, writes);
+
+			Configuration otherCfg;
+			otherCfg.loadFromStore(store);
+			Assert::IsTrue(otherCfg == cfg);
+
+			// Loading makes it up to date, too.
+			writes = 0;
+			otherCfg.settings.setHotkey(0x0444);
+			otherCfg.saveChangesToStore(store);
+			Assert::AreEqual<size_t>(1, writes);
+
+			writes = 0;
+			otherCfg.forgetStore();
+			otherCfg.saveChangesToStore(store);
+			Assert::AreEqual(allValues, writes);
+		}
+
+		// Like Application, when it is told to reload its settings.
+		TEST_METHOD(TestConfigurationReloadsAfterFlush)
+		{
+			const wstring key = L"AutoSave WriteBehindStore Reload Test";
+			Configuration cfg;
+			cfg.saveToRegistry(key.data());
+			const UINT interval = cfg.settings.getInterval();
+			WriteBehindStore pending(Platform::openConfigStore(key));
+			cfg.settings.setInterval(interval + 1);
+			cfg.saveChangesToStore(pending);
+
+			// Without flushing, the registry still has the old value.
+			Configuration staleCfg;
+			staleCfg.loadFromRegistry(key.data());
+			Assert::AreEqual(interval, staleCfg.settings.getInterval());
+
+			pending.flush();
+			cfg.loadFromRegistry(key.data());
+			Assert::AreEqual(interval + 1, cfg.settings.getInterval());
+			Assert::AreEqual<size_t>(0, pending.getPendingCount());
+			Assert::AreEqual<int>(interval + 1,
+				Platform::openConfigStore(key)->readInt(L"interval"));
+			Platform::purgeConfigStore(key);
+		}
+
+	};
+}
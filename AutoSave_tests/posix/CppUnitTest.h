@@ -0,0 +1,283 @@
+// CppUnitTest.h : Just enough of Visual Studio's CppUnitTest framework
+// to compile and run the portable tests outside of Windows.
+// Tests register themselves when the program starts; TestRunner.cpp
+// runs them. Failed assertions throw AssertFailedException, which the
+// runner reports.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <typeinfo>
+#include <type_traits>
+#include <functional>
+
+namespace Microsoft {
+	namespace VisualStudio {
+		namespace CppUnitTestFramework
+		{
+			struct AssertFailedException
+			{
+				std::wstring message;
+			};
+
+
+
+			namespace Details
+			{
+				template<typename Q, typename = void>
+				struct IsStreamable : std::false_type {};
+				template<typename Q>
+				struct IsStreamable<Q, decltype(void(
+					std::declval<std::wostream&>() << std::declval<const Q&>()))>
+					: std::true_type {};
+
+				template<typename Q>
+				std::wstring toString(const Q& q, std::true_type)
+				{
+					std::wostringstream stream;
+					stream << q;
+					return stream.str();
+				}
+
+				template<typename Q>
+				std::wstring toString(const Q& q, std::false_type)
+				{
+					std::string name = typeid(Q).name();
+					return L"[" + std::wstring(name.begin(), name.end()) + L"]";
+				}
+			}
+
+			template<typename Q>
+			inline std::wstring ToString(const Q& q)
+			{
+				return Details::toString(q, Details::IsStreamable<Q>());
+			}
+
+
+
+			class Assert
+			{
+			public:
+				template<typename T>
+				static void AreEqual(const T& expected, const T& actual,
+					const wchar_t* message = NULL)
+				{
+					if (!(expected == actual))
+						failEqual(ToString(expected), ToString(actual), message);
+				}
+
+				static void AreEqual(const wchar_t* expected, const wchar_t* actual,
+					bool ignoreCase = false, const wchar_t* message = NULL)
+				{
+					std::wstring e = expected ? expected : L"(null)";
+					std::wstring a = actual ? actual : L"(null)";
+					if (ignoreCase ? !equalIgnoringCase(e, a) : e != a)
+						failEqual(e, a, message);
+				}
+
+				static void AreEqual(double expected, double actual, double tolerance,
+					const wchar_t* message = NULL)
+				{
+					double difference = expected - actual;
+					if (difference > tolerance || -difference > tolerance)
+						failEqual(ToString(expected), ToString(actual), message);
+				}
+
+				template<typename T>
+				static void AreNotEqual(const T& notExpected, const T& actual,
+					const wchar_t* message = NULL)
+				{
+					if (notExpected == actual)
+						fail(L"Assert::AreNotEqual failed. Both are <" +
+							ToString(actual) + L">.", message);
+				}
+
+				template<typename T>
+				static void AreSame(const T& expected, const T& actual,
+					const wchar_t* message = NULL)
+				{
+					if (&expected != &actual)
+						fail(L"Assert::AreSame failed.", message);
+				}
+
+				static void IsTrue(bool condition, const wchar_t* message = NULL)
+				{
+					if (!condition)
+						fail(L"Assert::IsTrue failed.", message);
+				}
+
+				static void IsFalse(bool condition, const wchar_t* message = NULL)
+				{
+					if (condition)
+						fail(L"Assert::IsFalse failed.", message);
+				}
+
+				template<typename T>
+				static void IsNull(const T* pointer, const wchar_t* message = NULL)
+				{
+					if (pointer != NULL)
+						fail(L"Assert::IsNull failed.", message);
+				}
+
+				template<typename T>
+				static void IsNotNull(const T* pointer, const wchar_t* message = NULL)
+				{
+					if (pointer == NULL)
+						fail(L"Assert::IsNotNull failed.", message);
+				}
+
+				static void Fail(const wchar_t* message = NULL)
+				{
+					fail(L"Assert::Fail.", message);
+				}
+
+				template<typename E, typename F>
+				static void ExpectException(F functor, const wchar_t* message = NULL)
+				{
+					try {
+						functor();
+					}
+					catch (E&) {
+						return;
+					}
+					catch (...) {
+						fail(L"Assert::ExpectException failed. "
+							L"A different exception was thrown.", message);
+					}
+					fail(L"Assert::ExpectException failed. "
+						L"No exception was thrown.", message);
+				}
+
+			private:
+				static void fail(const std::wstring& what, const wchar_t* message)
+				{
+					std::wstring text = what;
+					if (message != NULL && *message != L'\0')
+						text += L" " + std::wstring(message);
+					throw AssertFailedException{ text };
+				}
+
+				static void failEqual(const std::wstring& expected,
+					const std::wstring& actual, const wchar_t* message)
+				{
+					fail(L"Assert::AreEqual failed. Expected <" + expected +
+						L">, actual <" + actual + L">.", message);
+				}
+
+				static bool equalIgnoringCase(const std::wstring& a, const std::wstring& b);
+			};
+
+
+
+			class Logger
+			{
+			public:
+				static void WriteMessage(const wchar_t* message);
+				static void WriteMessage(const char* message);
+			};
+		}
+	}
+}
+
+
+
+// The registry behind the macros. Not part of the original framework.
+namespace CppUnitTestShim
+{
+	typedef void (*StaticFunction)();
+	typedef void (*MemberFunction)(void* pInstance);
+
+	struct TestMethod
+	{
+		std::string name;
+		MemberFunction run;
+	};
+
+	struct TestClassInfo
+	{
+		std::string name;
+		void* (*create)();
+		void (*destroy)(void*);
+		StaticFunction classInitialize;
+		StaticFunction classCleanup;
+		MemberFunction methodInitialize;
+		MemberFunction methodCleanup;
+		std::vector<TestMethod> methods;
+	};
+
+	// Returns the entry for the class, creating it if necessary.
+	TestClassInfo& getClassInfo(const std::type_info& type,
+		void* (*create)(), void (*destroy)(void*));
+	std::vector<TestClassInfo*>& getAllClasses();
+
+	template<typename T>
+	class TestClass
+	{
+	public:
+		typedef T ThisClass;
+
+		static void* createInstance() { return new T; }
+		static void destroyInstance(void* pInstance) { delete (T*) pInstance; }
+		static TestClassInfo& getInfo() {
+			return getClassInfo(typeid(T), createInstance, destroyInstance);
+		}
+	};
+}
+
+
+
+// Member functions of nested classes are compiled once the test class
+// is complete, so the registrars may refer to methods declared later.
+
+#define TEST_CLASS(className) \
+	class className : public ::CppUnitTestShim::TestClass<className>
+
+#define TEST_METHOD(methodName) \
+	struct methodName##_Registrar { \
+		methodName##_Registrar() { \
+			getInfo().methods.push_back({ #methodName, &run }); \
+		} \
+		static void run(void* pInstance) { \
+			static_cast<ThisClass*>(pInstance)->methodName(); \
+		} \
+	}; \
+	static inline methodName##_Registrar methodName##_registrar; \
+	void methodName()
+
+#define TEST_CLASS_INITIALIZE(methodName) \
+	struct methodName##_Registrar { \
+		methodName##_Registrar() { getInfo().classInitialize = &run; } \
+		static void run() { ThisClass::methodName(); } \
+	}; \
+	static inline methodName##_Registrar methodName##_registrar; \
+	static void methodName()
+
+#define TEST_CLASS_CLEANUP(methodName) \
+	struct methodName##_Registrar { \
+		methodName##_Registrar() { getInfo().classCleanup = &run; } \
+		static void run() { ThisClass::methodName(); } \
+	}; \
+	static inline methodName##_Registrar methodName##_registrar; \
+	static void methodName()
+
+#define TEST_METHOD_INITIALIZE(methodName) \
+	struct methodName##_Registrar { \
+		methodName##_Registrar() { getInfo().methodInitialize = &run; } \
+		static void run(void* pInstance) { \
+			static_cast<ThisClass*>(pInstance)->methodName(); \
+		} \
+	}; \
+	static inline methodName##_Registrar methodName##_registrar; \
+	void methodName()
+
+#define TEST_METHOD_CLEANUP(methodName) \
+	struct methodName##_Registrar { \
+		methodName##_Registrar() { getInfo().methodCleanup = &run; } \
+		static void run(void* pInstance) { \
+			static_cast<ThisClass*>(pInstance)->methodName(); \
+		} \
+	}; \
+	static inline methodName##_Registrar methodName##_registrar; \
+	void methodName()
@@ -0,0 +1,183 @@
+// TestRunner.cpp : Runs the tests registered through CppUnitTest.h.
+// Usage: autosave_tests [filter...]
+// Only runs tests whose "Class::Method" name contains one of the
+// filters, if any are given. Returns 1 if any of them failed.
+
+#include "CppUnitTest.h"
+
+#include <iostream>
+#include <memory>
+#include <cwctype>
+#include <cstring>
+#include <cxxabi.h>
+#include <clocale>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace CppUnitTestShim;
+
+
+namespace {
+	std::string demangle(const char* name)
+	{
+		int status = 0;
+		std::unique_ptr<char, void (*)(void*)> demangled(
+			abi::__cxa_demangle(name, NULL, NULL, &status), free);
+		return (status == 0) ? demangled.get() : name;
+	}
+
+	std::wstring widen(const std::string& s)
+	{
+		return std::wstring(s.begin(), s.end());
+	}
+
+	bool isSelected(const std::string& fullName, int argc, char* argv[])
+	{
+		if (argc < 2)
+			return true;
+		for (int i = 1; i < argc; ++i)
+		{
+			if (fullName.find(argv[i]) != std::string::npos)
+				return true;
+		}
+		return false;
+	}
+
+	// Returns an empty string on success, the failure message otherwise.
+	std::wstring runGuarded(const std::function<void()>& function)
+	{
+		try {
+			function();
+			return L"";
+		}
+		catch (AssertFailedException& exc) {
+			return exc.message;
+		}
+		catch (std::exception& exc) {
+			return L"Unexpected exception: " + widen(exc.what());
+		}
+		catch (...) {
+			return L"Unexpected exception.";
+		}
+	}
+}
+
+
+
+TestClassInfo& CppUnitTestShim::getClassInfo(const std::type_info& type,
+	void* (*create)(), void (*destroy)(void*))
+{
+	std::string name = demangle(type.name());
+	for (TestClassInfo* pInfo : getAllClasses())
+	{
+		if (pInfo->name == name)
+			return *pInfo;
+	}
+	auto pInfo = new TestClassInfo{ name, create, destroy,
+		NULL, NULL, NULL, NULL, {} };
+	getAllClasses().push_back(pInfo);
+	return *pInfo;
+}
+
+
+
+std::vector<TestClassInfo*>& CppUnitTestShim::getAllClasses()
+{
+	static std::vector<TestClassInfo*> classes;
+	return classes;
+}
+
+
+
+bool Assert::equalIgnoringCase(const std::wstring& a, const std::wstring& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (towlower(a[i]) != towlower(b[i]))
+			return false;
+	}
+	return true;
+}
+
+
+
+void Logger::WriteMessage(const wchar_t* message)
+{
+	std::wclog << message << std::endl;
+}
+
+void Logger::WriteMessage(const char* message)
+{
+	std::wclog << widen(message) << std::endl;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+	setlocale(LC_ALL, "");
+	int passed = 0;
+	int failed = 0;
+
+	for (TestClassInfo* pClass : getAllClasses())
+	{
+		std::vector<const TestMethod*> selected;
+		for (const TestMethod& method : pClass->methods)
+		{
+			if (isSelected(pClass->name + "::" + method.name, argc, argv))
+				selected.push_back(&method);
+		}
+		if (selected.empty())
+			continue;
+
+		if (pClass->classInitialize != NULL)
+		{
+			std::wstring error = runGuarded(pClass->classInitialize);
+			if (!error.empty())
+			{
+				std::wcout << L"FAILED " << widen(pClass->name)
+					<< L" (class initialize): " << error << std::endl;
+				failed += (int) selected.size();
+				continue;
+			}
+		}
+
+		for (const TestMethod* pMethod : selected)
+		{
+			void* pInstance = pClass->create();
+			std::wstring error = runGuarded([&]() {
+				if (pClass->methodInitialize != NULL)
+					pClass->methodInitialize(pInstance);
+				pMethod->run(pInstance);
+			});
+			if (pClass->methodCleanup != NULL)
+			{
+				std::wstring cleanupError = runGuarded([&]() {
+					pClass->methodCleanup(pInstance);
+				});
+				if (error.empty())
+					error = cleanupError;
+			}
+			pClass->destroy(pInstance);
+
+			const std::wstring fullName =
+				widen(pClass->name) + L"::" + widen(pMethod->name);
+			if (error.empty())
+			{
+				++passed;
+				std::wcout << L"passed " << fullName << std::endl;
+			}
+			else {
+				++failed;
+				std::wcout << L"FAILED " << fullName << L": " << error << std::endl;
+			}
+		}
+
+		if (pClass->classCleanup != NULL)
+			runGuarded(pClass->classCleanup);
+	}
+
+	std::wcout << passed << L" passed, " << failed << L" failed." << std::endl;
+	return (failed == 0) ? 0 : 1;
+}
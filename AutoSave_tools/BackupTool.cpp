@@ -0,0 +1,201 @@
+// BackupTool.cpp : Looks into, and restores from, the versions that
+// AutoSave keeps of saved documents (see BackupStore).
+// Usage: autosave_backup [--store=DIR] COMMAND
+//   documents                 Lists the documents that have versions.
+//   list FILE                 Lists the versions of FILE, oldest first.
+//   restore FILE ID [DEST]    Writes version ID of FILE to DEST, or next
+//                             to FILE as "name (version ID).ext".
+//   backup FILE...            Adds versions, as AutoSave would.
+//   prune LAST [DAYS]         Keeps the LAST newest versions of each
+//                             document and the newest of each of the
+//                             last DAYS days, and drops unused chunks.
+// FILE is the document's path as AutoSave knew it; relative paths are
+// taken from the current directory, even if the file is gone.
+// The store is the one in AutoSave's data directory unless --store says.
+
+#include "stdafx.h"
+#include "BackupStore.h"
+#include "Platform.h"
+
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+
+namespace {
+#ifdef _WIN32
+	const wchar_t separator = L'\\';
+#else
+	const wchar_t separator = L'/';
+#endif
+
+	// The store knows documents by their full path.
+	wstring getFullPath(const char* path)
+	{
+#ifdef _WIN32
+		wchar_t fullPath[MAX_PATH];
+		const wstring wide = Platform::toWide(path);
+		return _wfullpath(fullPath, wide.c_str(), MAX_PATH) ? fullPath : wide;
+#else
+		if (char* resolved = realpath(path, NULL))
+		{
+			const wstring fullPath = Platform::toWide(resolved);
+			free(resolved);
+			return fullPath;
+		}
+		char currentDirectory[4096];
+		if (path[0] == '/' || getcwd(currentDirectory, sizeof(currentDirectory)) == NULL)
+			return Platform::toWide(path);
+		return Platform::toWide(currentDirectory) + separator + Platform::toWide(path);
+#endif
+	}
+
+	// "report.psd" becomes "report (version 3).psd".
+	wstring getRestorePath(const wstring& path, ULONGLONG id)
+	{
+		const size_t nameStart = path.find_last_of(L"\\/") + 1;
+		size_t dot = path.rfind(L'.');
+		if (dot == wstring::npos || dot <= nameStart)
+			dot = path.size();
+		return path.substr(0, dot) + L" (version " + std::to_wstring(id) + L")" +
+			path.substr(dot);
+	}
+
+	string formatTime(ULONGLONG seconds)
+	{
+		const time_t time = (time_t) seconds;
+		char text[32];
+		const tm* pLocal = localtime(&time);
+		if (pLocal == NULL || strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", pLocal) == 0)
+			return "?";
+		return text;
+	}
+
+	int fail(const char* what, ErrorCode error)
+	{
+		fprintf(stderr, "%s (error %ld)\n", what, error.errorCode());
+		return 1;
+	}
+
+	int usage(const char* program)
+	{
+		fprintf(stderr,
+			"Usage: %s [--store=DIR] documents\n"
+			"       %s [--store=DIR] list FILE\n"
+			"       %s [--store=DIR] restore FILE ID [DEST]\n"
+			"       %s [--store=DIR] backup FILE...\n"
+			"       %s [--store=DIR] prune LAST [DAYS]\n",
+			program, program, program, program, program);
+		return 2;
+	}
+}
+
+
+
+int main(int argc, char* argv[])
+{
+	setlocale(LC_ALL, "");
+
+	int next = 1;
+	wstring root;
+	if (next < argc && strncmp(argv[next], "--store=", 8) == 0)
+		root = Platform::toWide(argv[next++] + 8);
+	else {
+		const wstring dataDirectory = Platform::getDataDirectory();
+		if (!dataDirectory.empty())
+			root = dataDirectory + separator + L"Backups";
+	}
+	if (next >= argc)
+		return usage(argv[0]);
+	if (root.empty())
+	{
+		fprintf(stderr, "There is no data directory; use --store.\n");
+		return 1;
+	}
+
+	BackupStore store(root);
+	const string command = argv[next++];
+	const int argCount = argc - next;
+	char** args = argv + next;
+
+	if (command == "documents" && argCount == 0)
+	{
+		for (const string& document : store.listDocuments())
+			puts(document.c_str());
+		return 0;
+	}
+	if (command == "list" && argCount == 1)
+	{
+		const vector<BackupVersion> versions = store.listVersions(getFullPath(args[0]));
+		if (versions.empty())
+		{
+			fprintf(stderr, "%s has no versions.\n", args[0]);
+			return 1;
+		}
+		printf("%8s  %-19s  %14s  %14s  %6s\n", "VERSION", "TIME", "SIZE", "NEW", "CHUNKS");
+		for (const BackupVersion& version : versions)
+		{
+			printf("%8llu  %-19s  %14llu  %14llu  %6u\n",
+				(unsigned long long) version.id, formatTime(version.time).c_str(),
+				(unsigned long long) version.size,
+				(unsigned long long) version.newBytes, (UINT) version.chunkCount);
+		}
+		return 0;
+	}
+	if (command == "restore" && (argCount == 2 || argCount == 3))
+	{
+		const wstring path = getFullPath(args[0]);
+		const ULONGLONG id = strtoull(args[1], NULL, 10);
+		const wstring destination = (argCount == 3) ? Platform::toWide(args[2]) :
+			getRestorePath(path, id);
+		ErrorCode error = store.restore(path, id, destination);
+		if (error.errorCode() == ERROR_FILE_NOT_FOUND)
+		{
+			fprintf(stderr, "%s has no version %s.\n", args[0], args[1]);
+			return 1;
+		}
+		if (error.isError())
+			return fail("Couldn't restore the version", error);
+		printf("Restored version %llu to %s\n", (unsigned long long) id,
+			Platform::toNarrow(destination).c_str());
+		return 0;
+	}
+	if (command == "backup" && argCount >= 1)
+	{
+		int result = 0;
+		for (int i = 0; i < argCount; ++i)
+		{
+			bool isNew = false;
+			Expected<BackupVersion> version = store.backUp(getFullPath(args[i]),
+				(ULONGLONG) time(NULL), &isNew);
+			if (!version)
+			{
+				result = fail(args[i], version.error());
+				continue;
+			}
+			printf("%s: version %llu, %s\n", args[i],
+				(unsigned long long) version.value().id,
+				isNew ? "new" : "unchanged");
+		}
+		return result;
+	}
+	if (command == "prune" && (argCount == 1 || argCount == 2))
+	{
+		RetentionPolicy policy;
+		policy.keepLast = (UINT) strtoul(args[0], NULL, 10);
+		policy.keepDaily = (argCount == 2) ? (UINT) strtoul(args[1], NULL, 10) : 0;
+		Expected<BackupStore::PruneResult> result =
+			store.prune(policy, (ULONGLONG) time(NULL));
+		if (!result)
+			return fail("Couldn't remove all versions", result.error());
+		printf("Removed %u versions and %u chunks\n",
+			(UINT) result.value().versionsRemoved, (UINT) result.value().chunksRemoved);
+		return 0;
+	}
+	return usage(argv[0]);
+}
@@ -0,0 +1,47 @@
+// EventLogViewer.cpp : Prints the event log files that AutoSave writes
+// to its temporary directory (AutoSave.events, and the older
+// AutoSave.events.1 and so on), one event per line.
+// Usage: autosave_events FILE...
+// Pass the older files first to see everything in order.
+
+#include "stdafx.h"
+#include "EventLog.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s FILE...\n", argv[0]);
+		return 2;
+	}
+
+	int result = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::ifstream file(argv[i], std::ios::binary);
+		if (!file)
+		{
+			fprintf(stderr, "Couldn't open %s\n", argv[i]);
+			result = 1;
+			continue;
+		}
+		const string bytes((std::istreambuf_iterator<char>(file)),
+			std::istreambuf_iterator<char>());
+
+		vector<EventRecord> records;
+		if (!EventLog::decodeFile(bytes, &records))
+		{
+			fprintf(stderr, "%s isn't an event log\n", argv[i]);
+			result = 1;
+			continue;
+		}
+		for (const EventRecord& record : records)
+			puts(EventLog::format(record).c_str());
+	}
+	return result;
+}
@@ -0,0 +1,38 @@
+// MetricsViewer.cpp : Prints a metrics file as saved by AutoSave's
+// "Save metrics to a file" menu item, with percentiles.
+// Usage: autosave_metrics FILE
+
+#include "stdafx.h"
+#include "Metrics.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+
+int main(int argc, char* argv[])
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: %s FILE\n", argv[0]);
+		return 2;
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file)
+	{
+		fprintf(stderr, "Couldn't open %s\n", argv[1]);
+		return 1;
+	}
+	const string bytes((std::istreambuf_iterator<char>(file)),
+		std::istreambuf_iterator<char>());
+
+	MetricsSnapshot snapshot;
+	if (!MetricsSnapshot::deserialize(bytes, &snapshot))
+	{
+		fprintf(stderr, "%s isn't a metrics file\n", argv[1]);
+		return 1;
+	}
+	fputs(snapshot.format().c_str(), stdout);
+	return 0;
+}